@@ -0,0 +1,83 @@
+#include "bench.hpp"
+
+#include <core/util/chunked_vector.hpp>
+
+#include <array>
+#include <utility>
+
+namespace {
+
+using riistudio::util::ChunkedVector;
+
+// A vertex position
+using Element = std::array<float, 3>;
+constexpr std::size_t NumElements = 1 << 20;
+
+} // namespace
+
+// What a history snapshot costs, and what the next edit costs after it
+RII_BENCHMARK(ChunkedVectorSnapshot) {
+  std::vector<Element> flat(NumElements);
+  ChunkedVector<Element> chunked(NumElements);
+
+  double ns = riistudio::bench::measure([&] {
+    auto copy = flat;
+    riistudio::bench::doNotOptimize(copy[0]);
+  });
+  riistudio::bench::report("std::vector copy", ns);
+  ns = riistudio::bench::measure([&] {
+    auto copy = chunked;
+    riistudio::bench::doNotOptimize(copy[0]);
+  });
+  riistudio::bench::report("ChunkedVector copy", ns);
+
+  std::size_t edit = 0;
+  ns = riistudio::bench::measure(
+      [&] {
+        const auto snapshot = chunked;
+        edit = (edit + 7919) % NumElements;
+        chunked[edit][0] += 1.0f;
+        riistudio::bench::doNotOptimize(snapshot);
+      },
+      1000);
+  riistudio::bench::report("ChunkedVector copy, then edit one element", ns);
+}
+
+// Reading through mutable access detaches every chunk shared with a snapshot
+RII_BENCHMARK(ChunkedVectorIterate) {
+  ChunkedVector<Element> chunked(NumElements);
+
+  double ns = riistudio::bench::measure([&] {
+    float sum = 0.0f;
+    for (const auto& elem : std::as_const(chunked))
+      sum += elem[0];
+    riistudio::bench::doNotOptimize(sum);
+  });
+  riistudio::bench::report("Const iteration", ns);
+
+  ns = riistudio::bench::measure([&] {
+    const auto snapshot = chunked;
+    float sum = 0.0f;
+    for (auto& elem : chunked)
+      sum += elem[0];
+    riistudio::bench::doNotOptimize(sum);
+    riistudio::bench::doNotOptimize(snapshot);
+  });
+  riistudio::bench::report("Mutable iteration, shared with a snapshot", ns);
+
+  ns = riistudio::bench::measure([&] {
+    for (auto& elem : chunked)
+      elem[0] += 1.0f;
+    riistudio::bench::doNotOptimize(chunked);
+  });
+  riistudio::bench::report("Write every element, mutable iteration", ns);
+
+  ns = riistudio::bench::measure([&] {
+    chunked.forEachChunk([](std::span<Element> chunk) {
+      for (auto& elem : chunk)
+        elem[0] += 1.0f;
+    });
+    riistudio::bench::doNotOptimize(chunked);
+  });
+  riistudio::bench::report("Write every element, forEachChunk", ns);
+}
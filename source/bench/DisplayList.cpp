@@ -0,0 +1,168 @@
+#include "bench.hpp"
+
+#include <plugins/gc/Util/DisplayList.hpp>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace libcube;
+
+struct Layout {
+  const char* name;
+  std::vector<std::pair<gx::VertexAttribute, gx::VertexAttributeType>>
+      attributes;
+};
+
+// A typical skinned, lit, textured mesh mixes direct, u8 and u16 indices
+const Layout Layouts[] = {
+    {"mixed",
+     {{gx::VertexAttribute::PositionNormalMatrixIndex,
+       gx::VertexAttributeType::Direct},
+      {gx::VertexAttribute::Position, gx::VertexAttributeType::Short},
+      {gx::VertexAttribute::Normal, gx::VertexAttributeType::Short},
+      {gx::VertexAttribute::Color0, gx::VertexAttributeType::Byte},
+      {gx::VertexAttribute::TexCoord0, gx::VertexAttributeType::Short}}},
+    {"u8",
+     {{gx::VertexAttribute::Position, gx::VertexAttributeType::Byte},
+      {gx::VertexAttribute::Normal, gx::VertexAttributeType::Byte},
+      {gx::VertexAttribute::TexCoord0, gx::VertexAttributeType::Byte}}},
+    {"u16",
+     {{gx::VertexAttribute::Position, gx::VertexAttributeType::Short},
+      {gx::VertexAttribute::Normal, gx::VertexAttributeType::Short},
+      {gx::VertexAttribute::TexCoord0, gx::VertexAttributeType::Short}}},
+};
+
+VertexDescriptor makeDescriptor(const Layout& layout) {
+  VertexDescriptor vcd;
+  for (const auto& [attr, type] : layout.attributes)
+    vcd.mAttributes[attr] = type;
+  vcd.calcVertexDescriptorFromAttributeList();
+  return vcd;
+}
+
+// `numPrims` triangle strips of `vertsPerPrim` vertices each
+std::vector<u8> makeDisplayList(const VertexDecodePlan& plan, u32 numPrims,
+                                u32 vertsPerPrim) {
+  MatrixPrimitive mp;
+  mp.mVertices.setAttributes(plan.mBitfield);
+  u16 next = 0;
+  for (u32 p = 0; p < numPrims; ++p) {
+    const auto vertices = mp.vertices(
+        mp.addPrimitive(gx::PrimitiveType::TriangleStrip, vertsPerPrim));
+    for (auto vtx : vertices) {
+      for (u32 i = 0; i < plan.mNumAttributes; ++i) {
+        const auto& attrib = plan.mAttributes[i];
+        vtx[attrib.attr] = (next++ * 7) % (attrib.size == 1 ? 0xfe : 0x7ffe);
+      }
+    }
+  }
+  std::vector<u8> out;
+  EncodeMeshDisplayList(out, plan, mp);
+  return out;
+}
+
+// The decoder DecodeMeshDisplayList replaced: per vertex, each enabled
+// attribute's type is looked up and its index read through the reader
+void DecodeMeshDisplayListPerVertex(
+    oishii::BinaryReader& reader, u32 size, MatrixPrimitive& mp,
+    const std::map<gx::VertexAttribute, gx::VertexAttributeType>& types,
+    u32 bitfield, std::map<gx::VertexBufferAttribute, u32>& usage) {
+  constexpr auto BE = oishii::EndianSelect::Big;
+  while (reader.tell() < size) {
+    const u8 tag = reader.readUnaligned<u8>();
+    if (tag == 0)
+      continue;
+    const u16 nVerts = reader.readUnaligned<u16, BE>();
+    const auto vertices = mp.vertices(
+        mp.addPrimitive(gx::DecodeDrawPrimitiveCommand(tag), nVerts));
+    for (u16 vi = 0; vi < nVerts; ++vi) {
+      for (int a = 0; a < (int)gx::VertexAttribute::Max; ++a) {
+        if ((bitfield & (1 << a)) == 0)
+          continue;
+        const auto attr = static_cast<gx::VertexAttribute>(a);
+        const u16 val = types.at(attr) == gx::VertexAttributeType::Short
+                            ? reader.read<u16, BE, true>()
+                            : reader.read<u8, BE, true>();
+        vertices[vi][attr] = val;
+        u32& max = usage[static_cast<gx::VertexBufferAttribute>(a)];
+        if (max <= val)
+          max = val;
+      }
+    }
+  }
+}
+
+} // namespace
+
+RII_BENCHMARK(DisplayListCompilePlan) {
+  for (const auto& layout : Layouts) {
+    const auto vcd = makeDescriptor(layout);
+    const double ns = riistudio::bench::measure(
+        [&] {
+          auto plan = CompileVertexDecodePlan(vcd);
+          riistudio::bench::doNotOptimize(plan->mStride);
+        },
+        100000);
+    riistudio::bench::report(
+        std::string("CompileVertexDecodePlan, ") + layout.name, ns);
+  }
+}
+
+RII_BENCHMARK(DisplayListDecode) {
+  for (const auto& layout : Layouts) {
+    const auto vcd = makeDescriptor(layout);
+    const auto plan = *CompileVertexDecodePlan(vcd);
+    const std::map<gx::VertexAttribute, gx::VertexAttributeType> types(
+        layout.attributes.begin(), layout.attributes.end());
+
+    for (const u32 vertsPerPrim : {3u, 16u, 256u}) {
+      const u32 numPrims = 65536 / vertsPerPrim;
+      std::vector<u8> dl = makeDisplayList(plan, numPrims, vertsPerPrim);
+      const std::string shape = std::string(layout.name) + ", " +
+                                std::to_string(numPrims) + " x " +
+                                std::to_string(vertsPerPrim) + " vertices";
+
+      // Indices only, into preallocated primitives
+      MatrixPrimitive prims;
+      prims.mVertices.setAttributes(plan.mBitfield);
+      for (u32 p = 0; p < numPrims; ++p)
+        prims.addPrimitive(gx::PrimitiveType::TriangleStrip, vertsPerPrim);
+      const u32 primBytes = 3 + plan.mStride * vertsPerPrim;
+      double ns = riistudio::bench::measure([&] {
+        for (u32 p = 0; p < numPrims; ++p)
+          DecodeIndexedVertices(
+              {dl.data() + p * primBytes + 3, primBytes - 3u}, plan,
+              prims.vertices(prims.mPrimitives[p]));
+        riistudio::bench::doNotOptimize(prims.mVertices.size());
+      });
+      riistudio::bench::report("DecodeIndexedVertices, " + shape, ns);
+
+      // Whole display list, including command parsing and allocation
+      const u32 size = dl.size();
+      oishii::DataProvider provider(std::move(dl));
+      ns = riistudio::bench::measure([&] {
+        oishii::BinaryReader reader(provider.slice());
+        MatrixPrimitive mp;
+        std::map<gx::VertexBufferAttribute, u32> usage;
+        auto err = DecodeMeshDisplayList(reader, 0, size, mp, vcd, &usage);
+        riistudio::bench::doNotOptimize(mp.mPrimitives.size());
+        llvm::consumeError(std::move(err));
+      });
+      riistudio::bench::report("DecodeMeshDisplayList, " + shape, ns);
+
+      ns = riistudio::bench::measure([&] {
+        oishii::BinaryReader reader(provider.slice());
+        MatrixPrimitive mp;
+        std::map<gx::VertexBufferAttribute, u32> usage;
+        DecodeMeshDisplayListPerVertex(reader, size, mp, types, vcd.mBitfield,
+                                       usage);
+        riistudio::bench::doNotOptimize(mp.mPrimitives.size());
+      });
+      riistudio::bench::report("Per-vertex (old), " + shape, ns);
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#include "bench.hpp"
+
+#include <plugins/gc/GX/Shader/GXProgram.hpp>
+#include <plugins/gc/GX/Shader/GXShaderCache.hpp>
+#include <unittests/fixtures/Material.hpp>
+
+#include <deque>
+
+namespace {
+
+using namespace libcube;
+using namespace libcube::gx;
+
+constexpr u32 NumMaterials = 1000;
+
+using riistudio::test::GCMaterial;
+
+// Two to nine stages over two texgens; every third material is lit
+void makeSyntheticMaterial(GCMaterialData& data, u32 i) {
+  riistudio::test::makeTexturedMaterial(data);
+  data.name = "mat" + std::to_string(i);
+  for (u32 s = 0; s < 1 + i % 8; ++s) {
+    auto& stage = data.shader.mStages.emplace_back();
+    stage.colorStage.a = static_cast<TevColorArg>((i + s) % 15);
+    stage.colorStage.b = TevColorArg::texc;
+    stage.colorStage.scale = static_cast<TevScale>(s % 4);
+    stage.colorStage.bias = static_cast<TevBias>((i / 8) % 3);
+    stage.texCoord = s % 2;
+    stage.texMap = s % 3;
+    stage.indirectStage.wrapU = static_cast<IndTexWrap>(i % 4);
+  }
+  if (i % 3 == 0) {
+    auto& chan = data.colorChanControls[0];
+    chan.enabled = true;
+    chan.lightMask = static_cast<LightID>(i & 0xff);
+    chan.attenuationFn = AttenuationFunction::Spotlight;
+  }
+}
+
+} // namespace
+
+// CPU cost of generating GLSL for 1000 distinct materials; no GL context
+RII_BENCHMARK(GXProgramGenerate) {
+  std::deque<GCMaterial> materials(NumMaterials);
+  std::vector<GXMaterial> mats;
+  for (u32 i = 0; i < NumMaterials; ++i) {
+    makeSyntheticMaterial(materials[i].data, i);
+    mats.push_back(GXMaterial{0, materials[i].getName(), materials[i]});
+  }
+
+  std::size_t bytes = 0;
+  double ns = riistudio::bench::measure([&] {
+    bytes = 0;
+    for (auto& mat : mats) {
+      ShaderSourceCache::global().clear();
+      const auto [vert, frag] = GXProgram(mat).generateShaders();
+      bytes += vert.size() + frag.size();
+    }
+  });
+  std::printf("  %zu bytes of GLSL per pass\n", bytes);
+  riistudio::bench::report("Generate, uncached", ns / NumMaterials);
+
+  ShaderSourceCache::global().clear();
+  ns = riistudio::bench::measure([&] {
+    for (auto& mat : mats)
+      riistudio::bench::doNotOptimize(
+          GXProgram(mat).generateShaders().first.size());
+  });
+  riistudio::bench::report("Generate, cached", ns / NumMaterials);
+}
@@ -0,0 +1,46 @@
+#include "bench.hpp"
+
+#include <core/kpi/History.hpp>
+#include <unittests/fixtures/Document.hpp>
+
+#include <string>
+
+using riistudio::test::Document;
+
+// One edited object per commit, as in the property editor
+RII_BENCHMARK(HistoryCommit) {
+  for (const std::size_t size : {100, 1000, 10000}) {
+    Document doc;
+    auto meshes = doc.getMeshes();
+    for (std::size_t i = 0; i < size; ++i) {
+      auto& mesh = meshes.add();
+      mesh.mName = "Mesh " + std::to_string(i);
+      mesh.mIndices.assign(1024, static_cast<u32>(i));
+    }
+    kpi::History history;
+    history.commit(doc);
+
+    std::size_t edit = 0;
+    const auto editOne = [&] {
+      edit = (edit + 7919) % size;
+      ++meshes[edit].mIndices[0];
+      meshes.objectAt(edit)->markDirty();
+    };
+    const std::string label = std::to_string(size) + " objects";
+    double ns = riistudio::bench::measure(
+        [&] {
+          editOne();
+          history.commit(doc);
+        },
+        20);
+    riistudio::bench::report("commit, " + label, ns);
+    ns = riistudio::bench::measure(
+        [&] {
+          editOne();
+          history.commitMarked(doc);
+        },
+        20);
+    riistudio::bench::report("commitMarked, " + label, ns);
+    history.flush();
+  }
+}
@@ -0,0 +1,52 @@
+#include "bench.hpp"
+
+#include <plugins/gc/Encoder/ImagePlatform.hpp>
+#include <unittests/fixtures/Image.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace libcube::image_platform;
+using riistudio::test::makeImage;
+
+struct Resize {
+  int sx, sy, dx, dy;
+};
+
+// 2x and 4x downscales, then non-integer ratios including non-power-of-two
+// sizes and an upscale
+constexpr Resize Resizes[] = {
+    {256, 256, 128, 128},    {1024, 1024, 512, 512},
+    {2048, 2048, 1024, 1024}, {1024, 1024, 256, 256},
+    {2048, 2048, 512, 512},   {1024, 1024, 640, 640},
+    {1500, 1000, 700, 466},   {1000, 1000, 1024, 1024},
+};
+
+void benchResize(ResizingAlgorithm algorithm, const char* name) {
+  for (const auto [sx, sy, dx, dy] : Resizes) {
+    const auto src = makeImage(sx, sy);
+    std::vector<u8> dst(dx * dy * 4);
+    const std::string shape = std::to_string(sx) + "x" + std::to_string(sy) +
+                              " -> " + std::to_string(dx) + "x" +
+                              std::to_string(dy);
+    // 0 splits large images across all cores (where threads are available)
+    for (const unsigned threads : {1u, 0u}) {
+      setResizeConcurrency(threads);
+      const double ns = riistudio::bench::measure([&] {
+        resize(dst.data(), dx, dy, src.data(), sx, sy, algorithm);
+        riistudio::bench::doNotOptimize(dst[0]);
+      });
+      riistudio::bench::report(std::string(name) + " " + shape +
+                                   (threads == 1 ? ", 1 thread" : ", pool"),
+                               ns);
+    }
+  }
+  setResizeConcurrency(0);
+}
+
+} // namespace
+
+RII_BENCHMARK(ImageResizeAvir) { benchResize(AVIR, "AVIR"); }
+RII_BENCHMARK(ImageResizeLanczos) { benchResize(Lanczos, "Lanczos"); }
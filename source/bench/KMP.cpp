@@ -0,0 +1,104 @@
+#include "bench.hpp"
+
+#include <oishii/data_provider.hxx>
+#include <oishii/writer/binary_writer.hxx>
+#include <plugins/mk/KMP/io/KMP.hpp>
+
+#include <string>
+
+namespace {
+
+using namespace riistudio::mk;
+
+// Groups linked in a ring, so the path analysis run on write stays quiet
+template <typename Paths, typename SetPoint>
+void addRing(Paths paths, u32 numGroups, u32 pointsPerGroup,
+             SetPoint setPoint) {
+  for (u32 g = 0; g < numGroups; ++g) {
+    auto& path = paths.add();
+    path.mPredecessors.push_back((g + numGroups - 1) % numGroups);
+    path.mSuccessors.push_back((g + 1) % numGroups);
+    path.misc = {};
+    path.mPoints.resize(pointsPerGroup);
+    for (u32 p = 0; p < pointsPerGroup; ++p)
+      setPoint(path.mPoints[p], g, p);
+  }
+}
+
+// About as large as a KMP can be: point indices are stored in a byte
+void makeSyntheticMap(CourseMap& map) {
+  addRing(map.getEnemyPaths(), 16, 15, [](EnemyPoint& pt, u32 g, u32 p) {
+    pt.position = {float(g), float(p), 0.0f};
+    pt.deviation = 1.0f;
+    pt.param = {};
+  });
+  addRing(map.getItemPaths(), 16, 15, [](ItemPoint& pt, u32 g, u32 p) {
+    pt.position = {float(g), float(p), 1.0f};
+    pt.param = {};
+  });
+  // One key checkpoint per group, the lap checkpoint in group 0
+  addRing(map.getCheckPaths(), 16, 15, [](CheckPoint& pt, u32 g, u32 p) {
+    pt.setLeft({float(g), float(p)});
+    pt.setRight({float(g), float(p) + 1.0f});
+    pt.setLapCheck(p == 0 ? g : 0xFF);
+  });
+  for (u32 i = 0; i < 1000; ++i) {
+    auto& obj = map.getGeoObjs().add();
+    obj.id = i % 0x200;
+    obj.position = {float(i), 0.0f, 0.0f};
+    obj.settings = {};
+    obj.flags = 0x3F;
+  }
+  for (u32 i = 0; i < 200; ++i)
+    map.getAreas().add();
+  for (u32 i = 0; i < 12; ++i) {
+    auto& start = map.getStartPoints().add();
+    start.position = {float(i), 0.0f, 0.0f};
+    start.rotation = {};
+    start.player_index = -1;
+    start._ = 0;
+  }
+  auto& stage = map.getStages().add();
+  stage.mLapCount = 3;
+  stage.mCorner = Corner::Left;
+  stage.mStartPosition = StartPosition::Standard;
+  stage.mFlareTobi = 0;
+  stage.mLensFlareOptions = {0xE6, 0xE6, 0xE6, 0x32};
+  stage.mUnk08 = 0;
+  stage._ = 0;
+  stage.mSpeedModifier = 0;
+}
+
+} // namespace
+
+// Reading and writing a large synthetic KMP
+RII_BENCHMARK(KMPReadWrite) {
+  CourseMap source;
+  makeSyntheticMap(source);
+  oishii::Writer writer(0);
+  KMP().write(source, writer);
+  std::vector<u8> file(writer.getDataBlockStart(),
+                       writer.getDataBlockStart() + writer.getBufSize());
+  std::printf("  %zu bytes\n", file.size());
+
+  oishii::DataProvider provider(std::move(file), "synthetic.kmp");
+  double ns = riistudio::bench::measure(
+      [&] {
+        CourseMap map;
+        kpi::IOTransaction transaction{map, provider.slice(),
+                                       [](auto&&...) {}};
+        KMP().read(transaction);
+        riistudio::bench::doNotOptimize(map);
+      },
+      100);
+  riistudio::bench::report("Read", ns);
+
+  ns = riistudio::bench::measure(
+      [&] {
+        oishii::Writer out(0);
+        KMP().write(source, out);
+        riistudio::bench::doNotOptimize(out.getDataBlockStart()[0]);
+      },
+      100);
+  riistudio::bench::report("Write", ns);
+}
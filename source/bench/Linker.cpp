@@ -0,0 +1,65 @@
+#include "bench.hpp"
+
+#include <oishii/writer/binary_writer.hxx>
+#include <oishii/writer/linker.hxx>
+
+#include <string>
+
+namespace {
+
+constexpr u32 NumGroups = 100;
+constexpr u32 ItemsPerGroup = 100;
+
+// Links to its group by ID, which only resolves globally, and to itself
+struct Item final : public oishii::Node {
+  Item(u32 index, const std::string& group)
+      : Node("item" + std::to_string(index),
+             {oishii::LinkingRestriction::Leaf, 4}),
+        mGroup(group) {}
+
+  Result write(oishii::Writer& writer) const noexcept override {
+    writer.write<u32>(0x1234);
+    writer.writeLink<u32>(oishii::Hook(mGroup), oishii::Hook(*this));
+    return {};
+  }
+
+  std::string mGroup;
+};
+
+// Links to its first child by ID, and to its own end of children
+struct Group final : public oishii::Node {
+  explicit Group(u32 index)
+      : Node("group" + std::to_string(index), {{}, 32}) {}
+
+  Result write(oishii::Writer& writer) const noexcept override {
+    writer.writeLink<u32>(oishii::Hook(*this), oishii::Hook("item0"));
+    writer.writeLink<u32>(oishii::Hook(*this),
+                          oishii::Hook(*this, oishii::Hook::EndOfChildren));
+    return {};
+  }
+  Result gatherChildren(NodeDelegate& out) const override {
+    for (u32 i = 0; i < ItemsPerGroup; ++i)
+      out.addNode(std::make_unique<Item>(i, mId));
+    return {};
+  }
+};
+
+} // namespace
+
+// Gather, write and resolve about 10k nodes, each with links by name
+RII_BENCHMARK(LinkerWrite) {
+  std::size_t size = 0;
+  double ns = riistudio::bench::measure([&] {
+    oishii::Writer writer(0);
+    oishii::Linker linker;
+    linker.mDumpMap = false;
+    for (u32 i = 0; i < NumGroups; ++i)
+      linker.gather(std::make_unique<Group>(i), "");
+    linker.write(writer);
+    size = writer.tell();
+    riistudio::bench::doNotOptimize(writer.getDataBlockStart()[0]);
+  });
+  std::printf("  %u groups of %u items, %zu bytes\n", NumGroups, ItemsPerGroup,
+              size);
+  riistudio::bench::report("Gather and write", ns);
+}
@@ -0,0 +1,68 @@
+#include "bench.hpp"
+
+#include <plugins/g3d/io/Common.hpp>
+
+#include <string>
+
+namespace {
+
+using riistudio::g3d::RelocWriter;
+
+// The relocations MDL0 writes for `numMaterials` materials, each with its own
+// shader and display list
+void writeSyntheticModel(oishii::Writer& writer, u32 numMaterials) {
+  RelocWriter linker(writer);
+
+  linker.label("MDL0");
+  writer.write<u32>('MDL0');
+  linker.writeReloc<u32>("MDL0", "MDL0_END");
+  for (const char* section : {"RenderTree", "Bones", "Buffer_Position",
+                              "Buffer_Normal", "Buffer_Color", "Buffer_UV",
+                              "Materials", "Shaders", "Meshes"})
+    linker.writeReloc<s32>("MDL0", section);
+
+  linker.label("Materials");
+  for (u32 i = 0; i < numMaterials; ++i) {
+    const std::size_t mat_start = writer.tell();
+    const auto mat = linker.intern("Mat" + std::to_string(mat_start));
+    linker.label(mat, mat_start);
+    writer.write<u32>(i);
+    linker.writeReloc<s32>(mat, linker.intern("Shader" + std::to_string(i)));
+    linker.writeReloc<s32>(mat, linker.intern("DL" + std::to_string(i)));
+    writer.skip(0x400);
+  }
+  linker.label("Shaders");
+  for (u32 i = 0; i < numMaterials; ++i) {
+    linker.label("Shader" + std::to_string(i));
+    writer.skip(0x200);
+  }
+  for (const char* section : {"RenderTree", "Bones", "Buffer_Position",
+                              "Buffer_Normal", "Buffer_Color", "Buffer_UV",
+                              "Meshes"})
+    linker.label(section);
+
+  for (u32 i = 0; i < numMaterials; ++i) {
+    linker.label("DL" + std::to_string(i));
+    for (u32 j = 0; j < 32; ++j)
+      writer.write<u32>(i ^ j);
+  }
+  linker.label("MDL0_END");
+  linker.resolve();
+}
+
+} // namespace
+
+// Label and relocation bookkeeping of an MDL0 export, without the
+// material and mesh encoding around it
+RII_BENCHMARK(RelocWriterMDL0) {
+  for (const u32 numMaterials : {100, 1000, 10000}) {
+    double ns = riistudio::bench::measure([&] {
+      // Sized up front, so the stream never grows
+      oishii::Writer writer(numMaterials * 0x800);
+      writeSyntheticModel(writer, numMaterials);
+      riistudio::bench::doNotOptimize(writer.getDataBlockStart()[0]);
+    });
+    riistudio::bench::report(std::to_string(numMaterials) + " materials", ns);
+    riistudio::bench::report("  per material", ns / numMaterials);
+  }
+}
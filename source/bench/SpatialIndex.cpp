@@ -0,0 +1,141 @@
+#include "bench.hpp"
+
+#include <plugins/mk/KMP/SpatialIndex.hpp>
+
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace {
+
+using namespace riistudio::mk;
+
+constexpr u32 NumObjects = 20000;
+constexpr u32 NumAreas = 1000;
+constexpr u32 NumQueries = 1000;
+constexpr f32 Extent = 50000.0f;
+constexpr f32 Radius = 2000.0f;
+
+// Objects and unrotated boxes spread evenly over the course
+void makeSyntheticMap(CourseMap& map, std::mt19937& rng) {
+  std::uniform_real_distribution<f32> coord(-Extent, Extent);
+  std::uniform_real_distribution<f32> scale(0.1f, 1.0f);
+  for (u32 i = 0; i < NumObjects; ++i) {
+    auto& obj = map.getGeoObjs().add();
+    obj.position = {coord(rng), coord(rng), coord(rng)};
+    obj.settings = {};
+    obj.flags = 0x3F;
+  }
+  for (u32 i = 0; i < NumAreas; ++i) {
+    auto& model = map.getAreas().add().getModel();
+    model.setPosition({coord(rng), coord(rng), coord(rng)});
+    model.setScaling({scale(rng), scale(rng), scale(rng)});
+  }
+}
+
+// What the editor did before the index: test every object or area
+u32 nearestLinear(const CourseMap& map, const glm::vec3& position) {
+  const auto objs = map.getGeoObjs();
+  u32 best = 0;
+  f32 best2 = std::numeric_limits<f32>::infinity();
+  for (u32 i = 0; i < objs.size(); ++i) {
+    const glm::vec3 d = objs[i].position - position;
+    if (glm::dot(d, d) < best2) {
+      best = i;
+      best2 = glm::dot(d, d);
+    }
+  }
+  return best;
+}
+u32 countInRadiusLinear(const CourseMap& map, const glm::vec3& position) {
+  u32 count = 0;
+  for (auto& obj : map.getGeoObjs()) {
+    const glm::vec3 d = obj.position - position;
+    count += glm::dot(d, d) <= Radius * Radius;
+  }
+  return count;
+}
+u32 countAreasLinear(const CourseMap& map, const glm::vec3& position) {
+  u32 count = 0;
+  for (auto& area : map.getAreas()) {
+    const AreaModel& model = area.getModel();
+    const glm::vec3 local = position - model.getPosition();
+    const glm::vec3 half = model.getScaling() * 5000.0f;
+    count += std::abs(local.x) <= half.x && std::abs(local.z) <= half.z &&
+             local.y >= 0.0f && local.y <= model.getScaling().y * 10000.0f;
+  }
+  return count;
+}
+
+} // namespace
+
+// Queries over 20k objects and 1k areas, against the linear scans they replace
+RII_BENCHMARK(SpatialIndexQueries) {
+  std::mt19937 rng(0x5EED);
+  CourseMap map;
+  makeSyntheticMap(map, rng);
+  const CourseMap& source = map;
+  std::uniform_real_distribution<f32> coord(-Extent, Extent);
+  std::vector<glm::vec3> queries(NumQueries);
+  for (auto& query : queries)
+    query = {coord(rng), coord(rng), coord(rng)};
+
+  SpatialIndex index;
+  double ns = riistudio::bench::measure([&] { index.rebuild(source); });
+  riistudio::bench::report("Build", ns);
+  ns = riistudio::bench::measure(
+      [&] { riistudio::bench::doNotOptimize(index.update(source)); }, 1000);
+  riistudio::bench::report("Staleness check", ns);
+
+  // Both sides agree before either is timed
+  u32 mismatches = 0;
+  for (const auto& query : queries) {
+    const auto nearest = index.nearest(query);
+    mismatches +=
+        !nearest || nearest->point.index != nearestLinear(source, query);
+    u32 in_radius = 0, in_areas = 0;
+    index.forEachInRadius(query, Radius, [&](auto&&...) { ++in_radius; });
+    index.forEachAreaContaining(query, [&](u32) { ++in_areas; });
+    mismatches += in_radius != countInRadiusLinear(source, query);
+    mismatches += in_areas != countAreasLinear(source, query);
+  }
+  std::printf("  %u mismatches against the linear scans\n", mismatches);
+
+  const auto compare = [&](std::string_view label, auto indexed, auto linear) {
+    double ns = riistudio::bench::measure([&] {
+      for (const auto& query : queries)
+        riistudio::bench::doNotOptimize(indexed(query));
+    });
+    riistudio::bench::report(std::string(label) + ", indexed",
+                             ns / NumQueries);
+    ns = riistudio::bench::measure([&] {
+      for (const auto& query : queries)
+        riistudio::bench::doNotOptimize(linear(query));
+    });
+    riistudio::bench::report(std::string(label) + ", linear", ns / NumQueries);
+  };
+  compare(
+      "Nearest object",
+      [&](const glm::vec3& query) { return index.nearest(query)->point.index; },
+      [&](const glm::vec3& query) { return nearestLinear(source, query); });
+  compare(
+      "Objects in radius",
+      [&](const glm::vec3& query) {
+        u32 count = 0;
+        index.forEachInRadius(query, Radius, [&](auto&&...) { ++count; });
+        return count;
+      },
+      [&](const glm::vec3& query) {
+        return countInRadiusLinear(source, query);
+      });
+  compare(
+      "Areas containing a point",
+      [&](const glm::vec3& query) {
+        u32 count = 0;
+        index.forEachAreaContaining(query, [&](u32) { ++count; });
+        return count;
+      },
+      [&](const glm::vec3& query) { return countAreasLinear(source, query); });
+}
@@ -0,0 +1,106 @@
+#include "bench.hpp"
+
+#include <plugins/gc/Export/VertexDescriptor.hpp>
+#include <plugins/gc/Util/DisplayList.hpp>
+
+#include <map>
+
+namespace {
+
+using namespace libcube;
+
+constexpr u32 NumAttributes = (u32)gx::VertexAttribute::Max;
+
+VertexDescriptor makeDescriptor() {
+  VertexDescriptor vcd;
+  vcd.mAttributes[gx::VertexAttribute::PositionNormalMatrixIndex] =
+      gx::VertexAttributeType::Direct;
+  vcd.mAttributes[gx::VertexAttribute::Position] =
+      gx::VertexAttributeType::Short;
+  vcd.mAttributes[gx::VertexAttribute::Normal] = gx::VertexAttributeType::Short;
+  vcd.mAttributes[gx::VertexAttribute::Color0] = gx::VertexAttributeType::Byte;
+  vcd.mAttributes[gx::VertexAttribute::TexCoord0] =
+      gx::VertexAttributeType::Short;
+  vcd.mAttributes[gx::VertexAttribute::TexCoord1] =
+      gx::VertexAttributeType::Byte;
+  vcd.calcVertexDescriptorFromAttributeList();
+  return vcd;
+}
+
+} // namespace
+
+// Per-attribute type lookups, as done for every vertex before descriptors
+// were flat arrays
+RII_BENCHMARK(VertexDescriptorLookup) {
+  const auto vcd = makeDescriptor();
+  std::map<gx::VertexAttribute, gx::VertexAttributeType> map;
+  for (const auto& [attr, type] : vcd.mAttributes)
+    map[attr] = type;
+
+  double ns = riistudio::bench::measure(
+      [&] {
+        u32 sum = 0;
+        for (u32 i = 0; i < NumAttributes; ++i) {
+          const auto found = map.find(static_cast<gx::VertexAttribute>(i));
+          if (found != map.end())
+            sum += static_cast<u32>(found->second);
+        }
+        riistudio::bench::doNotOptimize(sum);
+      },
+      100000);
+  riistudio::bench::report("std::map, all attributes", ns);
+
+  ns = riistudio::bench::measure(
+      [&] {
+        u32 sum = 0;
+        for (u32 i = 0; i < NumAttributes; ++i)
+          sum += static_cast<u32>(
+              vcd.mAttributes.at(static_cast<gx::VertexAttribute>(i)));
+        riistudio::bench::doNotOptimize(sum);
+      },
+      100000);
+  riistudio::bench::report("VertexAttributeArray, all attributes", ns);
+}
+
+RII_BENCHMARK(VertexDescriptorLayout) {
+  auto vcd = makeDescriptor();
+
+  double ns = riistudio::bench::measure(
+      [&] {
+        u32 sum = vcd.getVertexSize();
+        for (u32 i = 0; i < NumAttributes; ++i)
+          sum += vcd.getAttributeOffset(static_cast<gx::VertexAttribute>(i));
+        riistudio::bench::doNotOptimize(sum);
+      },
+      100000);
+  riistudio::bench::report("Size and all offsets, cached", ns);
+
+  ns = riistudio::bench::measure(
+      [&] {
+        // Mutable access invalidates the cached layout
+        vcd.mAttributes.begin();
+        u32 sum = vcd.getVertexSize();
+        for (u32 i = 0; i < NumAttributes; ++i)
+          sum += vcd.getAttributeOffset(static_cast<gx::VertexAttribute>(i));
+        riistudio::bench::doNotOptimize(sum);
+      },
+      100000);
+  riistudio::bench::report("Size and all offsets, after an edit", ns);
+
+  ns = riistudio::bench::measure(
+      [&] {
+        auto plan = CompileVertexDecodePlan(vcd);
+        riistudio::bench::doNotOptimize(plan->mStride);
+      },
+      100000);
+  riistudio::bench::report("CompileVertexDecodePlan, cached", ns);
+
+  ns = riistudio::bench::measure(
+      [&] {
+        const VertexDescriptor copy = vcd;
+        riistudio::bench::doNotOptimize(copy.hash());
+        riistudio::bench::doNotOptimize(copy == vcd);
+      },
+      100000);
+  riistudio::bench::report("Copy, hash and compare", ns);
+}
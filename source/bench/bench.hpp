@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>      // std::atomic_signal_fence
+#include <chrono>      // std::chrono::steady_clock
+#include <cstdio>      // std::printf
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+
+namespace riistudio::bench {
+
+//! @brief A named benchmark, registered with `RII_BENCHMARK`.
+//!
+//! Benchmarks run single-threaded unless they say otherwise and report through
+//! `report`. Inputs are synthetic so results do not depend on local files.
+//!
+struct Benchmark {
+  std::string_view name;
+  void (*run)();
+};
+
+inline std::vector<Benchmark>& registry() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct Registrar {
+  Registrar(std::string_view name, void (*run)()) {
+    registry().push_back({name, run});
+  }
+};
+
+#define RII_BENCHMARK(NAME)                                                    \
+  static void NAME();                                                          \
+  static ::riistudio::bench::Registrar NAME##_registrar(#NAME, NAME);          \
+  static void NAME()
+
+//! Keep `value` from being optimized away.
+template <typename T> inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  // cl has no inline assembly on x64: publish the address instead
+  static const void* volatile sink;
+  sink = &value;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+//! Best time of `samples` runs of `fn`, in nanoseconds per iteration.
+template <typename Fn>
+double measure(Fn&& fn, int iterations = 1, int samples = 5) {
+  double best = 0.0;
+  for (int s = 0; s < samples; ++s) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+      fn();
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double per_iteration = elapsed.count() / iterations;
+    if (s == 0 || per_iteration < best)
+      best = per_iteration;
+  }
+  return best;
+}
+
+inline void report(std::string_view label, double ns) {
+  if (ns >= 1e6)
+    std::printf("  %-48.*s %10.2f ms\n", int(label.size()), label.data(),
+                ns / 1e6);
+  else if (ns >= 1e3)
+    std::printf("  %-48.*s %10.2f us\n", int(label.size()), label.data(),
+                ns / 1e3);
+  else
+    std::printf("  %-48.*s %10.2f ns\n", int(label.size()), label.data(), ns);
+}
+
+} // namespace riistudio::bench
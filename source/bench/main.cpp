@@ -0,0 +1,29 @@
+// CPU benchmarks over synthetic inputs.
+//
+// Usage: bench [name-prefix...]
+//
+// Runs every benchmark whose name starts with one of the given prefixes, or
+// all of them.
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+int main(int argc, const char** argv) {
+  auto& benchmarks = riistudio::bench::registry();
+  std::sort(benchmarks.begin(), benchmarks.end(),
+            [](const auto& l, const auto& r) { return l.name < r.name; });
+
+  for (const auto& benchmark : benchmarks) {
+    const bool selected =
+        argc < 2 || std::any_of(argv + 1, argv + argc, [&](const char* arg) {
+          return benchmark.name.starts_with(arg);
+        });
+    if (!selected)
+      continue;
+    std::printf("%.*s\n", int(benchmark.name.size()), benchmark.name.data());
+    benchmark.run();
+  }
+  return 0;
+}
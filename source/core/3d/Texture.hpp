@@ -3,6 +3,7 @@
 #include "PixelOcclusion.hpp"
 #include <core/common.h>
 #include <core/kpi/Node2.hpp>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -31,9 +32,25 @@ struct Texture : public virtual kpi::IObject {
       return getWidth() * getHeight() * 4;
     }
   }
+  //! @brief Size of a single decoded RGBA8 level of detail.
+  //!
+  //! @param[in] level LOD to query. Zero is the base image.
+  //!
+  u32 getDecodedLevelSize(u32 level) const {
+    return (getWidth() >> level) * (getHeight() >> level) * 4;
+  }
   virtual u32 getEncodedSize(bool mip) const = 0;
   virtual void decode(std::vector<u8>& out, bool mip) const = 0;
 
+  //! @brief Decode a single level of detail to 8-bit RGBA, without touching the
+  //!        rest of the mip chain.
+  //!
+  //! @param[in] level LOD to decode. Must not exceed getMipmapCount().
+  //! @param[in] out   Destination. Must be at least getDecodedLevelSize(level)
+  //!                  bytes.
+  //!
+  virtual void decodeLevel(u32 level, std::span<u8> out) const = 0;
+
   // 0 -- no mipmap, 1 -- one mipmap; not lod max
   virtual u32 getMipmapCount() const = 0;
   virtual void setMipmapCount(u32 c) = 0;
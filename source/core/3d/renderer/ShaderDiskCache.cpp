@@ -0,0 +1,273 @@
+#include "ShaderDiskCache.hpp"
+
+#include <algorithm>             // std::sort
+#include <charconv>              // std::from_chars
+#include <chrono>                // std::chrono::steady_clock
+#include <cstdio>                // std::snprintf
+#include <cstdlib>               // std::getenv
+#include <fstream>               // std::ifstream
+#include <llvm/Support/xxhash.h> // llvm::xxHash64
+#include <memory>                // std::unique_ptr
+#include <random>                // std::random_device
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr u32 RecordMagic = 0x43445352; // "RSDC"
+
+struct RecordHeader {
+  u32 magic;
+  u32 version;
+  u64 key;
+  u64 size;
+  u64 checksum;
+};
+
+u64 checksumOf(std::span<const u8> data) {
+  return llvm::xxHash64(llvm::ArrayRef<u8>(data.data(), data.size()));
+}
+
+std::string recordName(u64 key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(key));
+  return name;
+}
+
+// Inverse of `recordName` for "<key>.bin"; other files are ignored
+std::optional<u64> parseRecordName(const fs::path& path) {
+  if (path.extension() != ".bin")
+    return std::nullopt;
+  const std::string stem = path.stem().string();
+  u64 key = 0;
+  const auto result =
+      std::from_chars(stem.data(), stem.data() + stem.size(), key, 16);
+  if (stem.size() != 16 || result.ec != std::errc() ||
+      result.ptr != stem.data() + stem.size())
+    return std::nullopt;
+  return key;
+}
+
+std::optional<std::vector<u8>> readRecord(const fs::path& path, u64 key) {
+  std::ifstream stream(path, std::ios::binary | std::ios::ate);
+  if (!stream)
+    return std::nullopt;
+  const u64 file_size = static_cast<u64>(stream.tellg());
+  if (file_size < sizeof(RecordHeader))
+    return std::nullopt;
+  stream.seekg(0);
+
+  RecordHeader header;
+  if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    return std::nullopt;
+  if (header.magic != RecordMagic ||
+      header.version != ShaderDiskCache::FormatVersion || header.key != key ||
+      header.size != file_size - sizeof(RecordHeader))
+    return std::nullopt;
+
+  std::vector<u8> data(header.size);
+  if (!stream.read(reinterpret_cast<char*>(data.data()), data.size()))
+    return std::nullopt;
+  if (checksumOf(data) != header.checksum)
+    return std::nullopt;
+  return data;
+}
+
+std::unique_ptr<ShaderDiskCache> sGlobal;
+
+} // namespace
+
+ShaderDiskCache::ShaderDiskCache(const fs::path& directory, u64 maxBytes)
+    : mDirectory(directory / ("v" + std::to_string(FormatVersion))),
+      mMaxBytes(maxBytes) {
+  const u64 now = std::chrono::steady_clock::now().time_since_epoch().count();
+  mTempNonce = (u64(std::random_device{}()) << 32) ^ now;
+  scan();
+}
+
+ShaderDiskCache* ShaderDiskCache::global() { return sGlobal.get(); }
+
+void ShaderDiskCache::openGlobal(const fs::path& directory, u64 maxBytes) {
+  sGlobal = std::make_unique<ShaderDiskCache>(directory, maxBytes);
+}
+
+fs::path ShaderDiskCache::userDirectory() {
+  const auto env = [](const char* name) -> fs::path {
+    const char* value = std::getenv(name);
+    return value != nullptr ? value : "";
+  };
+#if defined(_WIN32)
+  const fs::path base = env("LOCALAPPDATA");
+  return base.empty() ? base : base / "RiiStudio" / "shaders";
+#elif defined(__APPLE__)
+  const fs::path home = env("HOME");
+  return home.empty() ? home
+                      : home / "Library" / "Caches" / "RiiStudio" / "shaders";
+#else
+  if (const fs::path base = env("XDG_CACHE_HOME"); base.is_absolute())
+    return base / "riistudio" / "shaders";
+  const fs::path home = env("HOME");
+  return home.empty() ? home : home / ".cache" / "riistudio" / "shaders";
+#endif
+}
+
+fs::path ShaderDiskCache::pathOf(u64 key) const {
+  return mDirectory / (recordName(key) + ".bin");
+}
+
+void ShaderDiskCache::scan() {
+  std::error_code ec;
+  fs::create_directories(mDirectory, ec);
+
+  // Records of other format versions can never be read again
+  for (const auto& it : fs::directory_iterator(mDirectory.parent_path(), ec)) {
+    const std::string name = it.path().filename().string();
+    const bool is_version =
+        name.size() > 1 && name[0] == 'v' &&
+        std::all_of(name.begin() + 1, name.end(),
+                    [](char c) { return c >= '0' && c <= '9'; });
+    if (is_version && it.is_directory(ec) && it.path() != mDirectory)
+      fs::remove_all(it.path(), ec);
+  }
+
+  struct Found {
+    u64 key;
+    u64 bytes;
+    fs::file_time_type lastUse;
+  };
+  std::vector<Found> found;
+  for (const auto& it : fs::directory_iterator(mDirectory, ec)) {
+    // Left behind by a writer that did not get to rename. Recent ones may
+    // still be in use by another instance sharing the directory.
+    if (it.path().extension() == ".tmp") {
+      const auto written = it.last_write_time(ec);
+      if (!ec && fs::file_time_type::clock::now() - written > StaleTempAge)
+        fs::remove(it.path(), ec);
+      continue;
+    }
+    const auto key = parseRecordName(it.path());
+    if (!key)
+      continue;
+    const u64 bytes = it.file_size(ec);
+    if (ec)
+      continue;
+    found.push_back({*key, bytes, it.last_write_time(ec)});
+  }
+  std::sort(found.begin(), found.end(), [](const auto& l, const auto& r) {
+    return l.lastUse > r.lastUse;
+  });
+
+  for (const auto& it : found) {
+    mEntries.push_back({it.key, it.bytes});
+    mByKey.emplace(it.key, std::prev(mEntries.end()));
+    mTotalBytes += it.bytes;
+  }
+  evictLocked();
+}
+
+std::optional<std::vector<u8>> ShaderDiskCache::load(u64 key) {
+  std::lock_guard<std::mutex> guard(mMutex);
+  const fs::path path = pathOf(key);
+  auto data = readRecord(path, key);
+  if (!data) {
+    eraseLocked(key);
+    return std::nullopt;
+  }
+
+  // The record may have been written by another instance since `scan`
+  touchLocked(key, sizeof(RecordHeader) + data->size());
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  evictLocked();
+  return data;
+}
+
+bool ShaderDiskCache::store(u64 key, std::span<const u8> data) {
+  const u64 bytes = sizeof(RecordHeader) + data.size();
+  if (bytes > mMaxBytes)
+    return false;
+
+  std::lock_guard<std::mutex> guard(mMutex);
+  const fs::path path = pathOf(key);
+  const fs::path temp_path =
+      mDirectory / (recordName(key) + "." + recordName(mTempNonce) + "-" +
+                    std::to_string(mTempCount++) + ".tmp");
+
+  std::error_code ec;
+  {
+    const RecordHeader header{RecordMagic, FormatVersion, key, data.size(),
+                              checksumOf(data)};
+    std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+    stream.close();
+    if (!stream) {
+      fs::remove(temp_path, ec);
+      return false;
+    }
+  }
+  // Readers see either the previous record or this one, never a partial write
+  fs::rename(temp_path, path, ec);
+  if (ec) {
+    fs::remove(temp_path, ec);
+    return false;
+  }
+
+  touchLocked(key, bytes);
+  evictLocked();
+  return true;
+}
+
+void ShaderDiskCache::erase(u64 key) {
+  std::lock_guard<std::mutex> guard(mMutex);
+  eraseLocked(key);
+}
+
+void ShaderDiskCache::clear() {
+  std::lock_guard<std::mutex> guard(mMutex);
+  std::error_code ec;
+  for (const auto& entry : mEntries)
+    fs::remove(pathOf(entry.key), ec);
+  mEntries.clear();
+  mByKey.clear();
+  mTotalBytes = 0;
+}
+
+std::size_t ShaderDiskCache::size() const {
+  std::lock_guard<std::mutex> guard(mMutex);
+  return mEntries.size();
+}
+
+u64 ShaderDiskCache::totalBytes() const {
+  std::lock_guard<std::mutex> guard(mMutex);
+  return mTotalBytes;
+}
+
+void ShaderDiskCache::touchLocked(u64 key, u64 bytes) {
+  if (const auto found = mByKey.find(key); found != mByKey.end()) {
+    mTotalBytes -= found->second->bytes;
+    found->second->bytes = bytes;
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+  } else {
+    mEntries.push_front({key, bytes});
+    mByKey.emplace(key, mEntries.begin());
+  }
+  mTotalBytes += bytes;
+}
+
+void ShaderDiskCache::eraseLocked(u64 key) {
+  std::error_code ec;
+  fs::remove(pathOf(key), ec);
+  const auto found = mByKey.find(key);
+  if (found == mByKey.end())
+    return;
+  mTotalBytes -= found->second->bytes;
+  mEntries.erase(found->second);
+  mByKey.erase(found);
+}
+
+void ShaderDiskCache::evictLocked() {
+  while (mTotalBytes > mMaxBytes && !mEntries.empty())
+    eraseLocked(mEntries.back().key);
+}
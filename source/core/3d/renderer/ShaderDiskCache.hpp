@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>        // std::chrono::hours
+#include <core/common.h> // u64
+#include <filesystem>    // std::filesystem::path
+#include <list>          // std::list
+#include <mutex>         // std::mutex
+#include <optional>      // std::optional
+#include <span>          // std::span
+#include <unordered_map> // std::unordered_map
+#include <vector>        // std::vector
+
+//! @brief Persistent store of shader blobs such as driver program binaries,
+//! keyed by a 64-bit hash chosen by the caller.
+//!
+//! Records live in a subdirectory named after `FormatVersion`; directories of
+//! other versions are removed on open. Each record is written to a temporary
+//! file and renamed into place, so a crash never leaves a partial record
+//! visible; temporary files older than `StaleTempAge` are removed on open.
+//! Records also carry a checksum, and unreadable or corrupt records are
+//! dropped as misses.
+//!
+//! The total size is bounded: past `maxBytes`, the least recently used
+//! records are removed. Recency persists across runs through file
+//! modification times.
+//!
+//! The cache is best-effort: filesystem errors are treated as misses. It has
+//! no GL dependency.
+//!
+class ShaderDiskCache {
+public:
+  //! Open (creating if needed) the cache in `directory`.
+  explicit ShaderDiskCache(const std::filesystem::path& directory,
+                           u64 maxBytes = DefaultMaxBytes);
+
+  //! Cache shared by the renderer, or null if not opened.
+  static ShaderDiskCache* global();
+  //! Open the global cache in `directory`.
+  static void openGlobal(const std::filesystem::path& directory,
+                         u64 maxBytes = DefaultMaxBytes);
+  //! The per-user cache directory for shaders: under %LOCALAPPDATA% on
+  //! Windows, ~/Library/Caches on macOS, and $XDG_CACHE_HOME or ~/.cache
+  //! elsewhere. Empty if none can be determined.
+  static std::filesystem::path userDirectory();
+
+  //! Contents of the record for `key`, marking it most recently used.
+  std::optional<std::vector<u8>> load(u64 key);
+  //! Add or replace the record for `key`, evicting the least recently used
+  //! records past the size bound. Returns false if nothing was written.
+  bool store(u64 key, std::span<const u8> data);
+  void erase(u64 key);
+  void clear();
+
+  std::size_t size() const;
+  u64 totalBytes() const;
+  u64 maxBytes() const { return mMaxBytes; }
+  const std::filesystem::path& directory() const { return mDirectory; }
+
+  static constexpr u32 FormatVersion = 1;
+  static constexpr u64 DefaultMaxBytes = 64 * 1024 * 1024;
+  //! Younger temporary files may belong to another instance still writing.
+  static constexpr std::chrono::hours StaleTempAge{1};
+
+private:
+  struct Entry {
+    u64 key;
+    u64 bytes;
+  };
+
+  std::filesystem::path pathOf(u64 key) const;
+  void scan();
+  // Index `key` as most recently used
+  void touchLocked(u64 key, u64 bytes);
+  void eraseLocked(u64 key);
+  void evictLocked();
+
+  std::filesystem::path mDirectory;
+  u64 mMaxBytes;
+  // Most recently used first
+  std::list<Entry> mEntries;
+  std::unordered_map<u64, std::list<Entry>::iterator> mByKey;
+  u64 mTotalBytes = 0;
+  // Distinguishes temporary files of concurrent writers
+  u64 mTempNonce = 0;
+  u64 mTempCount = 0;
+  mutable std::mutex mMutex;
+};
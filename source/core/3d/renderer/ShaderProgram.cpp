@@ -1,8 +1,14 @@
 #include "ShaderProgram.hpp"
+#include "ShaderDiskCache.hpp"
 
 #include <core/3d/gl.hpp>
 
+#include <cstring>
 #include <iostream>
+#include <llvm/Support/xxhash.h>
+#include <string>
+#include <string_view>
+#include <vector>
 
 bool checkShaderErrors(u32 id, std::string& error) {
   s32 success;
@@ -18,7 +24,103 @@ bool checkShaderErrors(u32 id, std::string& error) {
   return success;
 }
 
+#ifndef __EMSCRIPTEN__
+static bool supportsProgramBinaries() {
+  static const bool supported = [] {
+    s32 numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+  }();
+  return supported;
+}
+
+// Hash of a shader without the comments of its header. GXProgram names the
+// material there: identically shaded materials share a binary, and renaming a
+// material keeps it.
+static u64 hashShaderCode(std::string_view source) {
+  std::string code;
+  code.reserve(source.size());
+  bool header = true;
+  while (!source.empty()) {
+    const auto end = source.find('\n');
+    const auto line =
+        source.substr(0, end == std::string_view::npos ? end : end + 1);
+    source.remove_prefix(line.size());
+    if (header && line.starts_with("//"))
+      continue;
+    header &= line.starts_with("#");
+    code += line;
+  }
+  return llvm::xxHash64(code);
+}
+
+// Binaries are only valid for the driver that produced them
+static u64 programBinaryKey(const char* vtx, const char* frag) {
+  static const std::string driver = [] {
+    std::string id;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      const auto* str = reinterpret_cast<const char*>(glGetString(name));
+      id += str != nullptr ? str : "";
+      id += '\n';
+    }
+    return id;
+  }();
+  const u64 hashes[] = {llvm::xxHash64(driver), hashShaderCode(vtx),
+                        hashShaderCode(frag)};
+  return llvm::xxHash64(llvm::ArrayRef<u8>(
+      reinterpret_cast<const u8*>(hashes), sizeof(hashes)));
+}
+
+// Record layout: u32 binary format, binary
+static bool loadProgramBinary(ShaderDiskCache& disk, u64 key, u32& program) {
+  const auto record = disk.load(key);
+  if (!record || record->size() <= sizeof(u32))
+    return false;
+  u32 format;
+  std::memcpy(&format, record->data(), sizeof(u32));
+
+  const u32 loaded = glCreateProgram();
+  glProgramBinary(loaded, format, record->data() + sizeof(u32),
+                  record->size() - sizeof(u32));
+  s32 linked = 0;
+  glGetProgramiv(loaded, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    // Drivers may reject their old binaries, for instance after an update
+    glDeleteProgram(loaded);
+    disk.erase(key);
+    return false;
+  }
+  program = loaded;
+  return true;
+}
+
+static void storeProgramBinary(ShaderDiskCache& disk, u64 key, u32 program) {
+  s32 linked = 0, length = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (!linked || length <= 0)
+    return;
+  std::vector<u8> record(sizeof(u32) + length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, nullptr, &format,
+                     record.data() + sizeof(u32));
+  const u32 format32 = format;
+  std::memcpy(record.data(), &format32, sizeof(u32));
+  disk.store(key, record);
+}
+#endif
+
 ShaderProgram::ShaderProgram(const char* vtx, const char* frag) {
+#ifndef __EMSCRIPTEN__
+  // Skip compilation entirely if the driver binary was persisted
+  ShaderDiskCache* disk = ShaderDiskCache::global();
+  if (disk != nullptr && !supportsProgramBinaries())
+    disk = nullptr;
+  const u64 binaryKey = disk != nullptr ? programBinaryKey(vtx, frag) : 0;
+  if (disk != nullptr && loadProgramBinary(*disk, binaryKey, mShaderProgram))
+    return;
+#endif
+
   u32 vertexShader = glCreateShader(GL_VERTEX_SHADER);
   glShaderSource(vertexShader, 1, &vtx, NULL);
   glCompileShader(vertexShader);
@@ -36,12 +138,22 @@ ShaderProgram::ShaderProgram(const char* vtx, const char* frag) {
     // mErrorDesc = frag;
   }
   mShaderProgram = glCreateProgram();
+#ifndef __EMSCRIPTEN__
+  if (disk != nullptr)
+    glProgramParameteri(mShaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+#endif
   glAttachShader(mShaderProgram, vertexShader);
   glAttachShader(mShaderProgram, fragmentShader);
   glLinkProgram(mShaderProgram);
 
   glDeleteShader(vertexShader);
   glDeleteShader(fragmentShader);
+
+#ifndef __EMSCRIPTEN__
+  if (disk != nullptr && !bError)
+    storeProgramBinary(*disk, binaryKey, mShaderProgram);
+#endif
 }
 ShaderProgram::ShaderProgram(const std::string& vtx, const std::string& frag)
     : ShaderProgram(vtx.c_str(), frag.c_str()) {}
@@ -36,7 +36,8 @@ IconDatabase::Icon::Icon(lib3d::Texture& texture, u32 dimension) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
   assert(dimension <= 128);
-  texture.decode(tmp, false);
+  tmp.resize(texture.getDecodedLevelSize(0));
+  texture.decodeLevel(0, tmp);
   libcube::image_platform::resize(
       scratch.data(), dimension, dimension, tmp.data(), texture.getWidth(),
       texture.getHeight(), libcube::image_platform::Lanczos);
@@ -51,6 +51,38 @@ void ImagePreview::setFromImage(const lib3d::Texture& tex) {
   mDecodeBuf.clear();
 }
 
+void ImagePreview::setFromImageLevel(const lib3d::Texture& tex, u32 level) {
+  width = tex.getWidth() >> level;
+  height = tex.getHeight() >> level;
+  mNumMipMaps = 0;
+  mLod = 0;
+
+  if (mTexUploaded) {
+    glDeleteTextures(1, &mGpuTexId);
+  }
+  if (level > tex.getMipmapCount() || !width || !height) {
+    mTexUploaded = false;
+    return;
+  }
+  mDecodeBuf.resize(tex.getDecodedLevelSize(level));
+  tex.decodeLevel(level, mDecodeBuf);
+
+  glGenTextures(1, &mGpuTexId);
+  mTexUploaded = true;
+
+  glBindTexture(GL_TEXTURE_2D, mGpuTexId);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, mDecodeBuf.data());
+  mDecodeBuf.clear();
+}
+
 void ImagePreview::draw(float wd, float ht, bool mip_slider) {
   if (!mTexUploaded) {
     ImGui::Text("No image to display");
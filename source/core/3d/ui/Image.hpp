@@ -12,6 +12,8 @@ public:
   ImagePreview();
   ~ImagePreview();
   void setFromImage(const lib3d::Texture& tex);
+  //! Upload only a single level of detail. The preview has no mip chain.
+  void setFromImageLevel(const lib3d::Texture& tex, u32 level);
 
   void draw(float width = -1.0f, float height = -1.0f, bool mip_slider=true);
 
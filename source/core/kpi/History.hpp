@@ -1,22 +1,45 @@
 #pragma once
 
 #include "Memento.hpp"
+#include "Node2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <core/util/latency_histogram.hpp>
+#include <core/util/thread_pool.hpp>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 #include <vector>
 
 namespace kpi {
 
+//! @brief Linear undo history of a document.
+//!
+//! A commit builds a snapshot of the document on the calling thread. Objects
+//! equal to their record in the previous state share it; the others are
+//! copied, and large buffers inside them share their unmodified chunks. How
+//! unchanged objects are found depends on the commit: `commit` compares every
+//! object, `commitMarked` only those flagged dirty.
+//!
+//! Only sizing snapshots for the memory budget and releasing discarded states
+//! happen on a background thread. Undo and redo only depend on the snapshots
+//! themselves, so they are always ordered correctly against commits that are
+//! still being sized.
+//!
 class History {
 public:
-  void commit(const IMementoOriginator& doc) {
-    if (history_cursor >= 0)
-      root_history.erase(root_history.begin() + history_cursor + 1,
-                         root_history.end());
-    root_history.push_back(setNext(
-        doc, root_history.empty() ? nullptr : root_history.back().get()));
-    ++history_cursor;
-    onCommit(doc);
-  }
+  //! Record the state of `doc`. Every object is compared against its record in
+  //! the previous state, so the cost on the calling thread grows with the size
+  //! of the document, not of the edit.
+  void commit(const IMementoOriginator& doc) { commit(doc, false); }
+  //! @brief Like `commit`, but objects not flagged with IObject::markDirty
+  //! since they were last recorded share their record without being compared.
+  //! Flagged objects are compared and copied as by `commit`, so the cost
+  //! follows the objects flagged.
+  //!
+  //! @pre Every object modified since the last commit was flagged.
+  //!
+  void commitMarked(const IMementoOriginator& doc) { commit(doc, true); }
   void undo(IMementoOriginator& doc) {
     if (history_cursor <= 0)
       return;
@@ -32,6 +55,47 @@ public:
   std::size_t cursor() const { return history_cursor; }
   std::size_t size() const { return root_history.size(); }
 
+  //! Block until every commit has been sized and the memory budget enforced.
+  void flush() {
+    worker.wait();
+    collect();
+  }
+
+  //! @brief Bound the memory retained by history to about `bytes`; 0 means
+  //! unlimited. The oldest states are discarded first. The current state is
+  //! always kept.
+  //!
+  void setMemoryBudget(std::size_t bytes) {
+    memory_budget = bytes;
+    collect();
+    // collect() only enforces the budget when new sizes came in
+    enforceBudget();
+  }
+  std::size_t getMemoryBudget() const { return memory_budget; }
+
+  //! Approximate memory retained by all states, counting shared data once.
+  //! States still being sized in the background are not counted.
+  std::size_t retainedSize() {
+    collect();
+    std::size_t total = 0;
+    for (const auto& entry : root_history)
+      total += entry.unique_size;
+    return total;
+  }
+  //! Approximate memory retained by state `index` that is not shared with the
+  //! state before it, or 0 while it is being sized in the background.
+  std::size_t retainedSize(std::size_t index) {
+    collect();
+    assert(index < root_history.size());
+    return root_history[index].unique_size;
+  }
+
+  //! Time spent blocking the committing thread, across all histories.
+  static riistudio::util::LatencyHistogram& getCommitLatency() {
+    static riistudio::util::LatencyHistogram sCommitLatency;
+    return sCommitLatency;
+  }
+
   struct Observer {
     virtual ~Observer() = default;
     virtual void onCommit() {}
@@ -43,11 +107,145 @@ public:
   void removeObserver(Observer* observer) { mObservers.erase(observer); }
 
 private:
+  struct Entry {
+    std::shared_ptr<const IMemento> memento;
+    u64 id = 0;
+    bool is_sized = false;
+    // Size of every record of the state
+    std::size_t total_size = 0;
+    // Size of the records not shared with the previous state
+    std::size_t unique_size = 0;
+  };
+  struct Sizes {
+    u64 id = 0;
+    std::size_t total_size = 0;
+    std::size_t unique_size = 0;
+  };
+
+  void commit(const IMementoOriginator& doc, bool trust_dirty_flags) {
+    const auto start = std::chrono::steady_clock::now();
+    collect();
+    if (history_cursor >= 0 && history_cursor + 1 < root_history.size()) {
+      std::vector<Entry> discarded(
+          std::make_move_iterator(root_history.begin() + history_cursor + 1),
+          std::make_move_iterator(root_history.end()));
+      root_history.erase(root_history.begin() + history_cursor + 1,
+                         root_history.end());
+      // The records of the discarded branch are no longer the latest
+      worker.enqueue([this, discarded = std::move(discarded),
+                      back = root_history.back().memento]() mutable {
+        last_records = recordsOf(*back);
+        discarded.clear();
+      });
+    }
+    detail::sTrustDirtyFlags = trust_dirty_flags;
+    Entry entry{setNext(doc, root_history.empty()
+                                 ? nullptr
+                                 : root_history.back().memento.get())};
+    detail::sTrustDirtyFlags = false;
+    entry.id = next_id++;
+    worker.enqueue([this, memento = entry.memento, id = entry.id] {
+      Sizes sizes = account(*memento);
+      sizes.id = id;
+      std::unique_lock<std::mutex> lock(sized_mutex);
+      sized.push_back(sizes);
+    });
+    root_history.push_back(std::move(entry));
+    ++history_cursor;
+    enforceBudget();
+    onCommit(doc);
+    getCommitLatency().record(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+  }
+
+  static std::unordered_set<const void*> recordsOf(const IMemento& memento) {
+    std::unordered_set<const void*> records;
+    memento.visitRecords([&](const void* record, std::size_t) {
+      return records.insert(record).second;
+    });
+    return records;
+  }
+  // Size `memento` against the latest state, then make it the latest state.
+  // Runs on the worker.
+  Sizes account(const IMemento& memento) {
+    std::unordered_set<const void*> records;
+    Sizes sizes;
+    memento.visitRecords([&](const void* record, std::size_t bytes) {
+      if (!records.insert(record).second)
+        return false;
+      sizes.total_size += bytes;
+      if (!last_records.contains(record))
+        sizes.unique_size += bytes;
+      return true;
+    });
+    last_records = std::move(records);
+    return sizes;
+  }
+
+  // Apply the sizes computed by the worker so far
+  void collect() {
+    std::vector<Sizes> done;
+    {
+      std::unique_lock<std::mutex> lock(sized_mutex);
+      done.swap(sized);
+    }
+    if (done.empty())
+      return;
+    for (const Sizes& sizes : done) {
+      // Ids are increasing; states of a discarded branch are not found
+      auto it = std::lower_bound(
+          root_history.begin(), root_history.end(), sizes.id,
+          [](const Entry& entry, u64 id) { return entry.id < id; });
+      if (it == root_history.end() || it->id != sizes.id)
+        continue;
+      it->is_sized = true;
+      it->total_size = sizes.total_size;
+      // The oldest state may have lost its predecessor to the budget
+      it->unique_size =
+          it == root_history.begin() ? sizes.total_size : sizes.unique_size;
+    }
+    enforceBudget();
+  }
+
+  void enforceBudget() {
+    if (memory_budget == 0)
+      return;
+    std::size_t total = 0;
+    for (const auto& entry : root_history)
+      total += entry.unique_size;
+    std::vector<Entry> evicted;
+    while (total > memory_budget && history_cursor > 0 &&
+           root_history[0].is_sized) {
+      total -= root_history[0].unique_size;
+      evicted.push_back(std::move(root_history[0]));
+      root_history.erase(root_history.begin());
+      --history_cursor;
+      // Records shared with the discarded state are now only retained here
+      total -= root_history[0].unique_size;
+      root_history[0].unique_size = root_history[0].total_size;
+      total += root_history[0].unique_size;
+    }
+    // Release the evicted states off the committing thread
+    if (!evicted.empty())
+      worker.enqueue([evicted = std::move(evicted)] {});
+  }
+
   // At the roots, we don't need persistence
   // We don't ever expose history to anyone -- only the current document
-  std::vector<std::shared_ptr<const IMemento>> root_history;
+  std::vector<Entry> root_history;
   signed history_cursor = -1;
   std::set<Observer*> mObservers;
+  std::size_t memory_budget = 0;
+  u64 next_id = 0;
+
+  // Sizes computed by the worker, waiting to be collected
+  std::mutex sized_mutex;
+  std::vector<Sizes> sized;
+  // Records of the latest state. Only accessed by the worker.
+  std::unordered_set<const void*> last_records;
+  // Declared last: tasks referring to the members above finish first
+  riistudio::util::SerialTaskQueue worker;
 
   void onCommit(const IMementoOriginator& doc) {
     for (auto& observer : mObservers)
@@ -56,7 +254,7 @@ private:
   void onRollback(IMementoOriginator& doc) {
     for (auto& observer : mObservers)
       observer->beforeRollback();
-    rollback(doc, *root_history[history_cursor].get());
+    rollback(doc, *root_history[history_cursor].memento.get());
     for (auto& observer : mObservers)
       observer->afterRollback();
   }
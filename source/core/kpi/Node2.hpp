@@ -3,11 +3,17 @@
 #pragma once
 
 #include <algorithm>              // std::find_if
-#include <core/common.h>          // u32
+#include <atomic>                 // std::atomic
+#include <core/common.h>          // u32, u64
 #include <cstddef>                // std::size_t
+#include <llvm/ADT/STLExtras.h>   // llvm::function_ref
 #include <llvm/ADT/SmallVector.h> // llvm::SmallVector
+#include <functional>             // std::equal_to
+#include <memory>                 // std::weak_ptr
+#include <string>                 // std::string
 #include <string_view>            // std::string_view
 #include <type_traits>            // std::is_same_v
+#include <unordered_map>          // std::unordered_map
 #include <vector>                 // std::vector
 
 namespace kpi {
@@ -26,6 +32,38 @@ struct IObject {
   ICollection* collectionOf = nullptr;
   // The owner of the collection
   INode* childOf = nullptr;
+
+  //! Flag the object as modified since it was last recorded in history, and
+  //! invalidate caches of its collection's contents. Called by write sites
+  //! (property delegates, editors) that commit with History::commitMarked.
+  void markDirty();
+  u32 getGeneration() const { return mGeneration; }
+
+  //! Tell the collection that getName() changed, so its name index is
+  //! rebuilt. Called by setName(); write sites that assign a name member
+  //! directly must call it too, unless no lookup happened since the object
+  //! was added.
+  void onRenamed();
+
+  //! Whether `record` was created from this object and the object has not
+  //! been flagged as modified since.
+  template <typename T>
+  bool isRecordedAs(const std::shared_ptr<T>& record) const {
+    return record != nullptr && mRecordGeneration == mGeneration &&
+           !mRecord.owner_before(record) && !record.owner_before(mRecord);
+  }
+  template <typename T>
+  void setRecordedAs(const std::shared_ptr<T>& record) const {
+    mRecord = record;
+    mRecordGeneration = mGeneration;
+  }
+
+private:
+  u32 mGeneration = 1;
+  // The last history record of this object. Weak, so an expired record's
+  // address cannot be mistaken for a live one.
+  mutable std::weak_ptr<const void> mRecord;
+  mutable u32 mRecordGeneration = 0;
 };
 struct SelectionState {
   std::vector<std::size_t> selectedChildren;
@@ -44,16 +82,33 @@ struct ICollection {
   virtual const IObject* atObject(std::size_t) const = 0;
   virtual void add() = 0;
 
+  //! @brief Index of the first object named `name`, or `size()` if none.
+  //!
+  //! Larger collections keep a name index, rebuilt after objects are added,
+  //! removed or renamed (IObject::onRenamed). The index is trusted: an object
+  //! renamed without notifying the collection is found under its old name.
+  //!
   std::size_t indexOf(const std::string_view name) const {
     const auto _size = size();
+    if (_size >= MinIndexedSize) {
+      if (mNameIndexGeneration != mNamesGeneration)
+        rebuildNameIndex();
+      const auto it = mNameIndex.find(name);
+      return it != mNameIndex.end() ? it->second : _size;
+    }
     for (std::size_t i = 0; i < _size; ++i) {
-      const auto* obj = atObject(i);
-      if (obj->getName() == name)
+      if (atObject(i)->getName() == name)
         return i;
     }
     return _size;
   }
 
+  //! Invalidate the name index. Called through IObject::onRenamed.
+  void onObjectRenamed() {
+    ++mNamesGeneration;
+    onContentChanged();
+  }
+
   SelectionState state;
 
   bool isSelected(std::size_t index) const {
@@ -88,8 +143,71 @@ struct ICollection {
     state.activeSelectChild = value;
     return old;
   }
+
+  //! Changes whenever objects are added, removed, renamed, flagged with
+  //! IObject::markDirty, committed to history with changes or restored from
+  //! it. For caches derived from the contents of the collection; merely
+  //! reading through a mutable accessor does not change it.
+  //!
+  //! Generations are drawn from a single counter, so no two collections
+  //! share one. A cache cannot mistake a collection created at the address
+  //! of its destroyed source for that source.
+  //!
+  u64 getContentGeneration() const { return mContentGeneration; }
+
+  //! Invalidate caches of the contents.
+  void onContentChanged() { mContentGeneration = nextContentGeneration(); }
+
+protected:
+  //! Invalidate the name index. Called when objects are added or removed.
+  void onStructureChanged() {
+    ++mNamesGeneration;
+    mContentGeneration = nextContentGeneration();
+  }
+private:
+  // Below this size, scanning is cheaper than maintaining the index
+  static constexpr std::size_t MinIndexedSize = 8;
+
+  struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+
+  void rebuildNameIndex() const {
+    mNameIndex.clear();
+    const auto _size = size();
+    for (std::size_t i = 0; i < _size; ++i) {
+      // Keep the first of duplicate names, like the scan
+      mNameIndex.try_emplace(atObject(i)->getName(), i);
+    }
+    mNameIndexGeneration = mNamesGeneration;
+  }
+
+  static u64 nextContentGeneration() {
+    static std::atomic<u64> sNext = 1;
+    return sNext.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  u32 mNamesGeneration = 1;
+  u64 mContentGeneration = nextContentGeneration();
+  mutable u32 mNameIndexGeneration = 0;
+  mutable std::unordered_map<std::string, std::size_t, NameHash,
+                             std::equal_to<>>
+      mNameIndex;
 };
 
+inline void IObject::markDirty() {
+  ++mGeneration;
+  if (collectionOf != nullptr)
+    collectionOf->onContentChanged();
+}
+inline void IObject::onRenamed() {
+  if (collectionOf != nullptr)
+    collectionOf->onObjectRenamed();
+}
+
 template <typename T> struct CollectionIterator {
   CollectionIterator(ICollection* data, std::size_t i) : data(data), i(i) {}
   CollectionIterator(const CollectionIterator& src) {
@@ -232,6 +350,9 @@ public:
     assert(at(i));
     return *at(i);
   }
+  const IObject* objectAt(std::size_t i) const {
+    return low == nullptr ? nullptr : low->atObject(i);
+  }
 
   ConstCollectionIterator<T> begin() const {
     return ConstCollectionIterator<T>{low, 0};
@@ -296,6 +417,9 @@ public:
     assert(at(i));
     return *at(i);
   }
+  IObject* objectAt(std::size_t i) {
+    return low != nullptr ? low->atObject(i) : nullptr;
+  }
 
   MutCollectionIterator<T> begin() { return {low, 0}; }
   MutCollectionIterator<T> end() { return {low, size()}; }
@@ -361,11 +485,13 @@ template <typename T> struct CollectionImpl final : public ICollection {
   IObject* atObject(std::size_t i) override { return &data[i]; }
   const IObject* atObject(std::size_t i) const override { return &data[i]; }
   void add() override {
+    onStructureChanged();
     auto& last = data.emplace_back();
     last.collectionOf = this;
     last.childOf = parent;
   }
   void resize(std::size_t size) override {
+    onStructureChanged();
     data.resize(size);
     for (auto& elem : data) {
       elem.collectionOf = this;
@@ -387,8 +513,16 @@ template <typename T> struct CollectionImpl final : public ICollection {
 
 // Memento
 
+//! Receives a memento record and its approximate size in bytes. Returns
+//! whether the record had not been seen before, in which case the records it
+//! holds are visited too.
+using RecordVisitor = llvm::function_ref<bool(const void*, std::size_t)>;
+
 struct IMemento {
   virtual ~IMemento() = default;
+
+  //! Visit every record held by this memento, for memory accounting.
+  virtual void visitRecords(RecordVisitor visitor) const {}
 };
 template <typename T, typename V = void> struct _MementoIfy {
   using _type = T;
@@ -401,6 +535,32 @@ template <typename T> using MementoIfy = typename _MementoIfy<T>::_type;
 template <typename T>
 using ConstPersistentVec = std::vector<std::shared_ptr<const MementoIfy<T>>>;
 
+//! Approximate memory retained by a record. Types owning heap data may report
+//! it with a `retainedSize()` member. Heap data that may be shared between
+//! records is instead reported by a `visitShared(RecordVisitor)` member, so
+//! that it is only counted once.
+template <typename T> std::size_t RecordSize(const T& record) {
+  if constexpr (requires { record.retainedSize(); })
+    return sizeof(T) + record.retainedSize();
+  else
+    return sizeof(T);
+}
+
+template <typename VecT>
+void visitFolder(const VecT& folder, RecordVisitor visitor) {
+  // The vector itself is owned by the memento
+  visitor(&folder, folder.capacity() * sizeof(typename VecT::value_type));
+  for (const auto& record : folder) {
+    if (!visitor(record.get(), RecordSize(*record)))
+      continue;
+    if constexpr (requires { record->visitShared(visitor); })
+      record->visitShared(visitor);
+    using record_t = typename VecT::value_type::element_type;
+    if constexpr (std::is_base_of_v<IMemento, record_t>)
+      record->visitRecords(visitor);
+  }
+}
+
 template <typename T, typename U> bool should_set(const T* out, const U* in) {
   assert(in);
   if (out == nullptr)
@@ -423,25 +583,54 @@ std::shared_ptr<R> set_m(const T* last, const U& in) {
   }
 }
 
+namespace detail {
+// Set while committing with History::commitMarked
+inline thread_local bool sTrustDirtyFlags = false;
+} // namespace detail
+
 // Create a composite memento
+//
+// When committing with History::commitMarked, objects recorded into `old` and
+// not flagged dirty since are shared without being compared. Nodes with
+// folders of their own are always recursed into: their children are tracked
+// individually.
 template <typename InT, typename OutT, typename OldT>
 void nextFolder(OutT& out, const InT& in, const OldT* old) {
-  if (old != nullptr) {
-    auto& last = *old;
-    out.resize(in.size());
-    for (int i = 0; i < in.size(); ++i) {
-      if (should_set(last[i].get(), &in[i])) {
-        using record_t = MementoIfy<typename OutT::value_type::element_type>;
-        out[i] = set_m<record_t>(last[i].get(), in[i]);
-      } else {
-        out[i] = last[i];
+  using record_t = MementoIfy<typename OutT::value_type::element_type>;
+  using object_t = std::remove_cvref_t<decltype(in[0])>;
+  constexpr bool is_leaf =
+      std::is_same_v<std::remove_const_t<record_t>, object_t>;
+
+  out.resize(in.size());
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    const auto* last =
+        old != nullptr && i < old->size() ? &(*old)[i] : nullptr;
+    const IObject* obj = in.objectAt(i);
+
+    if constexpr (is_leaf) {
+      if (detail::sTrustDirtyFlags && last != nullptr && obj != nullptr &&
+          obj->isRecordedAs(*last)) {
+        out[i] = *last;
+        continue;
       }
     }
-  } else {
-    out.resize(in.size());
-    for (int i = 0; i < in.size(); ++i) {
-      using record_t = MementoIfy<typename OutT::value_type::element_type>;
+
+    if (last == nullptr) {
       out[i] = std::make_shared<const record_t>(in[i]);
+    } else if (should_set(last->get(), &in[i])) {
+      out[i] = set_m<record_t>(last->get(), in[i]);
+      // Edited through a reference, without being flagged
+      if constexpr (is_leaf) {
+        if (obj != nullptr && obj->collectionOf != nullptr)
+          obj->collectionOf->onContentChanged();
+      }
+    } else {
+      out[i] = *last;
+    }
+
+    if constexpr (is_leaf) {
+      if (obj != nullptr)
+        obj->setRecordedAs(out[i]);
     }
   }
 }
@@ -467,21 +656,37 @@ void set_concrete_element(CType& out, const MType& memento) {
 // Restore a concrete object from a memento
 template <typename InT, typename OutT>
 void fromFolder(OutT&& out /*rvalue range*/, const InT& in) {
+  using object_t = std::remove_cvref_t<decltype(out[0])>;
+  using record_t = std::remove_cvref_t<decltype(*in[0])>;
+  // The restored object matches its record: the next commit may share it
+  auto recorded = [&](std::size_t i) {
+    if constexpr (std::is_same_v<object_t, record_t>) {
+      if (const auto* obj = out.objectAt(i))
+        obj->setRecordedAs(in[i]);
+    }
+  };
+
   const auto both = std::min(in.size(), out.size());
   for (int i = 0; i < both; ++i) {
     if (should_set(&out[i], in[i].get())) {
       set_concrete_element(out[i], *in[i].get());
+      // The restored state may name the object differently; this also
+      // invalidates caches of the contents
+      if (auto* obj = out.objectAt(i))
+        obj->onRenamed();
     }
+    recorded(i);
   }
   if (in.size() < out.size()) {
     out.resize(in.size());
   } else if (in.size() > out.size()) {
     const auto added = in.size() - out.size();
     out.resize(in.size());
-    for (int i = in.size() - added; i <= in.size(); ++i) {
+    for (int i = in.size() - added; i < in.size(); ++i) {
       out[i] = *in[i];
       // Observers are not notified here.
       // Rationale: New objects likely do not have observers.
+      recorded(i);
     }
   }
 }
@@ -39,16 +39,19 @@ enum class TransactionState {
   ResolveDependencies, //!< Interrupted: The entire point of this system!
 };
 
+//! Receives the diagnostics of a reader or writer.
+using IOMessageCallback =
+    std::function<void(IOMessageClass message_class,
+                       const std::string_view domain,
+                       const std::string_view message_body)>;
+
 struct IOTransaction {
   // Caller -> Deserializer
   kpi::INode& node;
   oishii::ByteView data;
 
   // Deserializer -> Caller
-  std::function<void(IOMessageClass message_class,
-                     const std::string_view domain,
-                     const std::string_view message_body)>
-      callback;
+  IOMessageCallback callback;
 
   TransactionState state = TransactionState::Complete;
 
@@ -74,6 +77,12 @@ struct IBinarySerializer {
   virtual std::unique_ptr<IBinarySerializer> clone() const = 0;
   virtual bool canWrite_(kpi::INode& node) const = 0;
   virtual void write_(kpi::INode& node, oishii::Writer& writer) const = 0;
+  //! Write, reporting diagnostics to `callback`. Output is incomplete if an
+  //! Error was reported, and must not be saved.
+  virtual void write_(kpi::INode& node, oishii::Writer& writer,
+                      const IOMessageCallback& callback) const {
+    write_(node, writer);
+  }
 };
 
 // Part of the application state itself. Not part of the persistent document.
@@ -5,6 +5,7 @@
 #include <imgui/imgui.h>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -41,7 +42,8 @@ public:
   void postUpdate() { bCommitPosted = true; }
   void consumeUpdate(kpi::History& history, kpi::INode& doc) {
     assert(bCommitPosted);
-    history.commit(doc);
+    // Only posted by PropertyDelegate, which flags what it modifies
+    history.commitMarked(doc);
     bCommitPosted = false;
   }
   void handleUpdates(kpi::History& history, kpi::INode& doc) {
@@ -56,11 +58,18 @@ public:
 
   T& getActive() { return mActive; }
   virtual const T& getActive() const { return mActive; }
+  //! The active object as a collection item, e.g. for the node owning it.
+  const IObject& getActiveObject() const { return mActiveObject; }
 
   void commit(const char* changeName) {
     ((void)changeName);
 
-    mHistory.commit(mTransientRoot);
+    // Views may have edited the objects through references held since the
+    // last commit
+    mActiveObject.markDirty();
+    for (IObject* it : mAffectedObjects)
+      it->markDirty();
+    mHistory.commitMarked(mTransientRoot);
   }
 
   template <typename U, typename TGet, typename TSet>
@@ -68,9 +77,10 @@ public:
     if (before == after)
       return;
 
-    for (T* it : mAffected) {
-      if (!(get(*it) == after)) {
-        set(*it, after);
+    for (std::size_t i = 0; i < mAffected.size(); ++i) {
+      if (!(get(*mAffected[i]) == after)) {
+        set(*mAffected[i], after);
+        mAffectedObjects[i]->markDirty();
       }
     }
 
@@ -118,6 +128,10 @@ public:
 
 private:
   T& mActive;
+  // The objects being edited, as collection items. T need not derive from
+  // IObject, so these are what edits are flagged on.
+  IObject& mActiveObject;
+  std::vector<IObject*> mAffectedObjects;
 
 public:
   std::vector<T*> mAffected;
@@ -130,10 +144,16 @@ private:
 
 public:
   PropertyDelegate(IPropertyView& view, T& active, std::vector<T*> affected,
+                   IObject& activeObject,
+                   std::vector<IObject*> affectedObjects,
                    kpi::History& history, const kpi::INode& transientRoot,
                    riistudio::frontend::EditorWindow* ed)
-      : mActive(active), mAffected(affected), mEd(ed), mHistory(history),
-        mTransientRoot(transientRoot), mView(view) {}
+      : mActive(active), mActiveObject(activeObject),
+        mAffectedObjects(std::move(affectedObjects)), mAffected(affected),
+        mEd(ed), mHistory(history), mTransientRoot(transientRoot),
+        mView(view) {
+    assert(mAffectedObjects.size() == mAffected.size());
+  }
 };
 
 class PropertyViewStateHolder {
@@ -244,7 +264,8 @@ struct PropertyViewImpl final : public IPropertyView {
       assert(_affected[i] != nullptr);
     }
 
-    PropertyDelegate<T> delegate(*this, *_active, _affected, history, root, ed);
+    PropertyDelegate<T> delegate(*this, *_active, _affected, active, affected,
+                                 history, root, ed);
     if constexpr (is_stateful_v<U>) {
       IPropertyViewState* state = state_holder.requestState(active, *this);
       assert(state != nullptr);
@@ -322,7 +343,8 @@ struct StatelessPropertyViewImpl : public IPropertyView {
       assert(_affected[i] != nullptr);
     }
 
-    PropertyDelegate<T> delegate(*this, *_active, _affected, history, root, ed);
+    PropertyDelegate<T> delegate(*this, *_active, _affected, active, affected,
+                                 history, root, ed);
     mFunctor(delegate);
     handleUpdates(history, root);
   }
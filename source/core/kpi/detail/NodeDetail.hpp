@@ -52,6 +52,9 @@ struct ApplicationPluginsImpl {
   //! Requires methods:
   //! - `T::canWrite(doc_node_t node) const`
   //! - `T::write(kpi::INode& node, oishii::Writer& writer) const`
+  //!
+  //! Writers that report diagnostics may also provide
+  //! `T::write(kpi::INode&, oishii::Writer&, const IOMessageCallback&) const`.
   template <typename T>
   struct TBinarySerializer final : public IBinarySerializer, public T {
     std::unique_ptr<IBinarySerializer> clone() const override {
@@ -63,6 +66,13 @@ struct ApplicationPluginsImpl {
     void write_(kpi::INode& node, oishii::Writer& writer) const override {
       T::write(node, writer);
     }
+    void write_(kpi::INode& node, oishii::Writer& writer,
+                const IOMessageCallback& callback) const override {
+      if constexpr (requires(const T& t) { t.write(node, writer, callback); })
+        T::write(node, writer, callback);
+      else
+        T::write(node, writer);
+    }
   };
   //! Requires: `::write(doc_node_t, oishii::Writer& writer, X*_=nullptr)`
   //! where `X` is some child that may be wrapped in a doc_node_t. No support
@@ -75,6 +85,7 @@ struct ApplicationPluginsImpl {
     bool canWrite_(kpi::INode& node) const override {
       return dynamic_cast<T*>(&node) != nullptr;
     }
+    using IBinarySerializer::write_;
     void write_(kpi::INode& node, oishii::Writer& writer) const override {
       write(node, writer, static_cast<T*>(nullptr));
     }
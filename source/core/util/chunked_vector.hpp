@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>   // std::equal
+#include <array>       // std::array
+#include <cassert>     // assert
+#include <cstddef>     // std::size_t
+#include <iterator>    // std::random_access_iterator_tag
+#include <memory>      // std::shared_ptr
+#include <span>        // std::span
+#include <type_traits> // std::conditional_t
+#include <vector>      // std::vector
+
+namespace riistudio::util {
+
+//! @brief Vector stored as fixed-size chunks that are shared between copies
+//! until written to.
+//!
+//! Copying only copies chunk references, so snapshots of a large array (such
+//! as history mementos of a vertex buffer) cost O(number of chunks), and an
+//! edit only duplicates the chunk it touches. Elements are not contiguous.
+//!
+//! Mutable element access detaches the chunk from other copies; prefer const
+//! access when reading. Mutable iteration also pays for a sharing check per
+//! element: to write every element, use `forEachChunk`.
+//!
+template <typename T, std::size_t ChunkBytes = 4096> class ChunkedVector {
+public:
+  static constexpr std::size_t ChunkSize =
+      std::max<std::size_t>(1, ChunkBytes / sizeof(T));
+
+private:
+  using Chunk = std::array<T, ChunkSize>;
+
+public:
+  template <bool IsConst> class Iterator {
+    using VecT =
+        std::conditional_t<IsConst, const ChunkedVector, ChunkedVector>;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+
+    Iterator() = default;
+    Iterator(VecT* vec, std::size_t index) : mVec(vec), mIndex(index) {}
+    operator Iterator<true>() const { return {mVec, mIndex}; }
+
+    reference operator*() const { return (*mVec)[mIndex]; }
+    pointer operator->() const { return &(*mVec)[mIndex]; }
+    reference operator[](difference_type n) const {
+      return (*mVec)[mIndex + n];
+    }
+
+    Iterator& operator++() {
+      ++mIndex;
+      return *this;
+    }
+    Iterator operator++(int) { return {mVec, mIndex++}; }
+    Iterator& operator--() {
+      --mIndex;
+      return *this;
+    }
+    Iterator operator--(int) { return {mVec, mIndex--}; }
+    Iterator& operator+=(difference_type n) {
+      mIndex += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      mIndex -= n;
+      return *this;
+    }
+    Iterator operator+(difference_type n) const { return {mVec, mIndex + n}; }
+    Iterator operator-(difference_type n) const { return {mVec, mIndex - n}; }
+    difference_type operator-(const Iterator& rhs) const {
+      return static_cast<difference_type>(mIndex) -
+             static_cast<difference_type>(rhs.mIndex);
+    }
+    bool operator==(const Iterator& rhs) const { return mIndex == rhs.mIndex; }
+    auto operator<=>(const Iterator& rhs) const {
+      return mIndex <=> rhs.mIndex;
+    }
+
+  private:
+    VecT* mVec = nullptr;
+    std::size_t mIndex = 0;
+  };
+  using value_type = T;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  ChunkedVector() = default;
+  ChunkedVector(std::size_t size) { resize(size); }
+
+  std::size_t size() const { return mSize; }
+  bool empty() const { return mSize == 0; }
+  void clear() {
+    mChunks.clear();
+    mSize = 0;
+  }
+  //! New elements are value-initialized.
+  void resize(std::size_t size) {
+    // Reset the unused tail of the last chunk, which may hold stale values
+    if (size > mSize && mSize % ChunkSize != 0) {
+      Chunk& last = mutableChunk(mSize / ChunkSize);
+      const std::size_t end = std::min(ChunkSize, size - mSize / ChunkSize *
+                                                          ChunkSize);
+      std::fill(last.begin() + mSize % ChunkSize, last.begin() + end, T{});
+    }
+    const std::size_t numChunks = (size + ChunkSize - 1) / ChunkSize;
+    const std::size_t oldChunks = mChunks.size();
+    mChunks.resize(numChunks);
+    for (std::size_t i = oldChunks; i < numChunks; ++i)
+      mChunks[i] = std::make_shared<Chunk>();
+    mSize = size;
+  }
+  void reserve(std::size_t size) {
+    mChunks.reserve((size + ChunkSize - 1) / ChunkSize);
+  }
+  void push_back(const T& value) {
+    resize(mSize + 1);
+    (*this)[mSize - 1] = value;
+  }
+
+  const T& operator[](std::size_t i) const {
+    assert(i < mSize);
+    return (*mChunks[i / ChunkSize])[i % ChunkSize];
+  }
+  T& operator[](std::size_t i) {
+    assert(i < mSize);
+    return mutableChunk(i / ChunkSize)[i % ChunkSize];
+  }
+
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, mSize}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, mSize}; }
+  const_iterator cbegin() const { return {this, 0}; }
+  const_iterator cend() const { return {this, mSize}; }
+
+  //! The elements from `i` to the end of its chunk, which are contiguous.
+  std::span<const T> segment(std::size_t i) const {
+    assert(i < mSize);
+    const std::size_t n = std::min(ChunkSize - i % ChunkSize, mSize - i);
+    return {mChunks[i / ChunkSize]->data() + i % ChunkSize, n};
+  }
+  //! Like the const overload, detaching the chunk from other copies.
+  std::span<T> segment(std::size_t i) {
+    assert(i < mSize);
+    const std::size_t n = std::min(ChunkSize - i % ChunkSize, mSize - i);
+    return {mutableChunk(i / ChunkSize).data() + i % ChunkSize, n};
+  }
+
+  //! Invoke `fn(std::span<T>)` for every chunk, in order, detaching each from
+  //! other copies once.
+  template <typename F> void forEachChunk(F&& fn) {
+    for (std::size_t i = 0; i < mChunks.size(); ++i) {
+      const std::size_t n = std::min(ChunkSize, mSize - i * ChunkSize);
+      fn(std::span<T>(mutableChunk(i).data(), n));
+    }
+  }
+  //! Invoke `fn(std::span<const T>)` for every chunk, in order.
+  template <typename F> void forEachChunk(F&& fn) const {
+    for (std::size_t i = 0; i < mChunks.size(); ++i) {
+      const std::size_t n = std::min(ChunkSize, mSize - i * ChunkSize);
+      fn(std::span<const T>(mChunks[i]->data(), n));
+    }
+  }
+
+  //! Invoke `fn(const void* chunk, std::size_t bytes)` for every chunk, for
+  //! memory accounting of shared chunks.
+  template <typename F> void forEachAllocation(F&& fn) const {
+    for (const auto& chunk : mChunks)
+      fn(static_cast<const void*>(chunk.get()), sizeof(Chunk));
+  }
+
+  bool operator==(const ChunkedVector& rhs) const {
+    if (mSize != rhs.mSize)
+      return false;
+    for (std::size_t i = 0; i < mChunks.size(); ++i) {
+      // Shared chunks are trivially equal
+      if (mChunks[i] == rhs.mChunks[i])
+        continue;
+      const std::size_t n = std::min(ChunkSize, mSize - i * ChunkSize);
+      if (!std::equal(mChunks[i]->begin(), mChunks[i]->begin() + n,
+                      rhs.mChunks[i]->begin()))
+        return false;
+    }
+    return true;
+  }
+
+private:
+  Chunk& mutableChunk(std::size_t index) {
+    auto& chunk = mChunks[index];
+    if (chunk.use_count() > 1)
+      chunk = std::make_shared<Chunk>(*chunk);
+    return *chunk;
+  }
+
+  std::vector<std::shared_ptr<Chunk>> mChunks;
+  std::size_t mSize = 0;
+};
+
+} // namespace riistudio::util
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <core/common.h> // u8
+#include <cstring>       // memcpy, memcmp
+#include <memory>        // std::shared_ptr
+#include <span>          // std::span
+#include <vector>        // std::vector
+
+namespace riistudio::util {
+
+//! @brief Byte buffer that may borrow its contents from a shared source (for
+//! instance, the file a model was read from) until it is first modified.
+//!
+//! Read-only access never copies. Mutable access to a borrowed buffer first
+//! copies it into storage owned by this buffer. Copies of a buffer, borrowed
+//! or owned, only copy the reference until either is modified, which keeps
+//! history snapshots of untouched data cheap.
+//!
+class CowBuffer {
+public:
+  CowBuffer() = default;
+
+  //! @brief Borrow `size` bytes at `view`. The buffer keeps the owner of
+  //! `view` alive until it is modified or destroyed.
+  //!
+  void setView(std::shared_ptr<const u8> view, std::size_t size) {
+    mOwned = nullptr;
+    mView = std::move(view);
+    mViewSize = size;
+  }
+  //! Whether the contents are borrowed.
+  bool isView() const { return mView != nullptr; }
+
+  const u8* data() const {
+    if (isView())
+      return mView.get();
+    return mOwned ? mOwned->data() : nullptr;
+  }
+  u8* data() {
+    detach();
+    return mOwned->data();
+  }
+  std::size_t size() const {
+    if (isView())
+      return mViewSize;
+    return mOwned ? mOwned->size() : 0;
+  }
+  bool empty() const { return size() == 0; }
+  //! Bytes allocated by this buffer, possibly shared with copies of it.
+  //! Borrowed contents are not counted.
+  std::size_t ownedSize() const { return mOwned ? mOwned->capacity() : 0; }
+  //! Invoke `fn(const void* storage, std::size_t bytes)` for the owned
+  //! storage, for memory accounting of storage shared between copies.
+  template <typename F> void forEachAllocation(F&& fn) const {
+    if (mOwned)
+      fn(static_cast<const void*>(mOwned.get()), ownedSize());
+  }
+
+  std::span<const u8> span() const { return {data(), size()}; }
+  const u8* begin() const { return data(); }
+  const u8* end() const { return data() + size(); }
+
+  //! Resize, preserving the existing contents like `std::vector::resize`.
+  void resize(std::size_t size) {
+    if (isView() && size == mViewSize)
+      return;
+    detach();
+    mOwned->resize(size);
+  }
+
+  bool operator==(const CowBuffer& rhs) const {
+    if (size() != rhs.size())
+      return false;
+    return empty() || data() == rhs.data() ||
+           !memcmp(data(), rhs.data(), size());
+  }
+
+private:
+  void detach() {
+    if (isView()) {
+      mOwned = std::make_shared<std::vector<u8>>(mView.get(),
+                                                 mView.get() + mViewSize);
+      mView = nullptr;
+      mViewSize = 0;
+    } else if (!mOwned) {
+      mOwned = std::make_shared<std::vector<u8>>();
+    } else if (mOwned.use_count() > 1) {
+      mOwned = std::make_shared<std::vector<u8>>(*mOwned);
+    }
+  }
+
+  //! Shared with copies of this buffer until modified
+  std::shared_ptr<std::vector<u8>> mOwned;
+  std::shared_ptr<const u8> mView;
+  std::size_t mViewSize = 0;
+};
+
+} // namespace riistudio::util
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>     // std::min
+#include <array>         // std::array
+#include <atomic>        // std::atomic
+#include <bit>           // std::bit_width
+#include <chrono>        // std::chrono::microseconds
+#include <core/common.h> // u32
+#include <cstddef>       // std::size_t
+
+namespace riistudio::util {
+
+//! @brief Histogram of durations with power-of-two buckets, from 1us to ~1s.
+//!
+//! Bucket `i` counts durations in [2^(i-1), 2^i) microseconds; the last bucket
+//! also counts anything longer. Safe to record from any thread.
+//!
+class LatencyHistogram {
+public:
+  static constexpr std::size_t NumBuckets = 21;
+
+  void record(std::chrono::microseconds duration) {
+    const auto us = static_cast<u64>(std::max<s64>(duration.count(), 0));
+    const std::size_t bucket =
+        std::min<std::size_t>(std::bit_width(us), NumBuckets - 1);
+    mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  u32 getBucket(std::size_t bucket) const {
+    return mBuckets[bucket].load(std::memory_order_relaxed);
+  }
+  //! Exclusive upper bound of a bucket.
+  static std::chrono::microseconds getBucketLimit(std::size_t bucket) {
+    return std::chrono::microseconds(1ll << bucket);
+  }
+  u32 getCount() const {
+    u32 count = 0;
+    for (std::size_t i = 0; i < NumBuckets; ++i)
+      count += getBucket(i);
+    return count;
+  }
+  //! Upper bound of the bucket holding the given fraction of samples, for
+  //! instance 0.99 for the 99th percentile.
+  std::chrono::microseconds getPercentile(float fraction) const {
+    const u32 count = getCount();
+    u32 seen = 0;
+    for (std::size_t i = 0; i < NumBuckets; ++i) {
+      seen += getBucket(i);
+      if (seen != 0 && seen >= fraction * count)
+        return getBucketLimit(i);
+    }
+    return getBucketLimit(NumBuckets - 1);
+  }
+
+  void reset() {
+    for (auto& bucket : mBuckets)
+      bucket.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<u32>, NumBuckets> mBuckets{};
+};
+
+} // namespace riistudio::util
@@ -1,29 +1,70 @@
 #pragma once
 
-#include <algorithm>        // std::fill
-#include <core/common.h>    // assert
-#include <llvm/ADT/Twine.h> // llvm::Twine
-#include <string_view>      // std::string_view
+#include <charconv>                // std::to_chars
+#include <core/common.h>          // assert
+#include <cstring>                // std::memcpy
+#include <llvm/ADT/SmallString.h> // llvm::SmallString
+#include <llvm/ADT/Twine.h>       // llvm::Twine
+#include <memory>                 // std::unique_ptr
+#include <string_view>            // std::string_view
 
 namespace riistudio::util {
 
+//! @brief Append-only string writer. The contents are always null-terminated.
+//!
+//! A builder either writes into a caller-provided buffer, which must not
+//! overflow, or into storage it owns. Owned storage grows as needed and is
+//! kept by `reset()`, so a builder reused across calls stops allocating once
+//! it has seen its largest output. Neither zero-fills its storage upfront.
+//!
 class StringBuilder {
 public:
+  //! Write into storage owned by the builder.
+  StringBuilder() = default;
+  //! Write into `buf`, which must outlive the builder.
   StringBuilder(char* buf, std::size_t size)
       : mBuf(buf), mIt(buf), mEnd(buf + size) {
-    std::fill(mBuf, mEnd, '\0');
+    assert(size > 0);
+    *mIt = '\0';
   }
+  StringBuilder(const StringBuilder&) = delete;
+  StringBuilder& operator=(const StringBuilder&) = delete;
 
   void append(std::string_view string) {
-    assert(mIt + string.length() < mEnd);
+    if (static_cast<std::size_t>(mEnd - mIt) <= string.length())
+      grow(string.length());
     std::memcpy(mIt, string.data(), string.length());
     mIt += string.length();
+    *mIt = '\0';
+  }
+  //! Append the decimal representation of `value`.
+  void appendInt(s64 value) {
+    char buf[24];
+    const auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    append({buf, static_cast<std::size_t>(result.ptr - buf)});
+  }
+  void appendTwine(const llvm::Twine& string) {
+    if (string.isSingleStringRef()) {
+      const llvm::StringRef ref = string.getSingleStringRef();
+      append({ref.data(), ref.size()});
+      return;
+    }
+    llvm::SmallString<256> buf;
+    const llvm::StringRef ref = string.toStringRef(buf);
+    append({ref.data(), ref.size()});
   }
-  void appendTwine(const llvm::Twine& string) { append(string.str()); }
   void reset() {
-    std::fill(mBuf, mIt, '\0');
     mIt = mBuf;
+    if (mIt != nullptr)
+      *mIt = '\0';
+  }
+
+  std::string_view view() const {
+    return {mBuf, static_cast<std::size_t>(mIt - mBuf)};
   }
+  const char* c_str() const { return mBuf != nullptr ? mBuf : ""; }
+  std::size_t size() const { return mIt - mBuf; }
+  bool empty() const { return mIt == mBuf; }
 
   StringBuilder& operator+=(std::string_view string) {
     append(string);
@@ -35,9 +76,28 @@ public:
   }
 
 private:
-  char* mBuf;
-  char* mIt;
-  char* mEnd;
+  // Make room for `size` more characters and the terminator
+  void grow(std::size_t size) {
+    assert((mOwned || mBuf == nullptr) && "Fixed buffer overflow");
+    const std::size_t used = mIt - mBuf;
+    std::size_t capacity = mEnd - mBuf;
+    if (capacity == 0)
+      capacity = 1024;
+    while (capacity <= used + size)
+      capacity *= 2;
+    auto storage = std::make_unique_for_overwrite<char[]>(capacity);
+    if (used != 0)
+      std::memcpy(storage.get(), mBuf, used);
+    mOwned = std::move(storage);
+    mBuf = mOwned.get();
+    mIt = mBuf + used;
+    mEnd = mBuf + capacity;
+  }
+
+  std::unique_ptr<char[]> mOwned;
+  char* mBuf = nullptr;
+  char* mIt = nullptr;
+  char* mEnd = nullptr;
 };
 
 } // namespace riistudio::util
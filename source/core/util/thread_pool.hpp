@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>          // std::min
+#include <atomic>             // std::atomic
+#include <condition_variable> // std::condition_variable
+#include <core/common.h>      // assert
+#include <cstddef>            // std::size_t
+#include <deque>              // std::deque
+#include <functional>         // std::function
+#include <mutex>              // std::mutex
+#include <thread>             // std::thread
+#include <vector>             // std::vector
+
+namespace riistudio::util {
+
+//! Whether this target can spawn threads. Emscripten builds only can when
+//! compiled with -pthread.
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+inline constexpr bool HasThreads = false;
+#else
+inline constexpr bool HasThreads = true;
+#endif
+
+//! @brief Fixed-size pool of worker threads executing tasks in FIFO order.
+//!
+//! A pool of zero or one threads runs tasks inline on the calling thread. On
+//! targets without thread support, every pool does, and `size()` is 1.
+//!
+class ThreadPool {
+public:
+  explicit ThreadPool(
+      unsigned num_threads = std::thread::hardware_concurrency()) {
+    if (!HasThreads || num_threads <= 1)
+      return;
+    mWorkers.reserve(num_threads);
+    for (unsigned i = 0; i < num_threads; ++i)
+      mWorkers.emplace_back([this] { workerMain(); });
+  }
+  ~ThreadPool() {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mStopping = true;
+    }
+    mTaskReady.notify_all();
+    for (auto& worker : mWorkers)
+      worker.join();
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  //! Number of threads tasks may run on concurrently.
+  unsigned size() const { return mWorkers.empty() ? 1 : mWorkers.size(); }
+
+  void enqueue(std::function<void()> task) {
+    if (mWorkers.empty()) {
+      task();
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mTasks.push_back(std::move(task));
+      ++mPending;
+    }
+    mTaskReady.notify_one();
+  }
+
+  //! Block until every enqueued task has finished.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mAllDone.wait(lock, [this] { return mPending == 0; });
+  }
+
+private:
+  void workerMain() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mTaskReady.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+        if (mTasks.empty())
+          return;
+        task = std::move(mTasks.front());
+        mTasks.pop_front();
+      }
+      task();
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (--mPending == 0)
+          mAllDone.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::thread> mWorkers;
+  std::deque<std::function<void()>> mTasks;
+  std::mutex mMutex;
+  std::condition_variable mTaskReady;
+  std::condition_variable mAllDone;
+  std::size_t mPending = 0;
+  bool mStopping = false;
+};
+
+//! @brief Single background thread executing tasks one at a time, in FIFO
+//! order.
+//!
+//! On targets without thread support, tasks run inline on the calling thread.
+//!
+class SerialTaskQueue {
+public:
+  SerialTaskQueue() {
+    if (HasThreads)
+      mWorker = std::thread([this] { workerMain(); });
+  }
+  ~SerialTaskQueue() {
+    if (!mWorker.joinable())
+      return;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mStopping = true;
+    }
+    mTaskReady.notify_one();
+    mWorker.join();
+  }
+  SerialTaskQueue(const SerialTaskQueue&) = delete;
+  SerialTaskQueue& operator=(const SerialTaskQueue&) = delete;
+
+  void enqueue(std::function<void()> task) {
+    if (!mWorker.joinable()) {
+      task();
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mTasks.push_back(std::move(task));
+    }
+    mTaskReady.notify_one();
+  }
+
+  //! Block until every enqueued task has finished.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mAllDone.wait(lock, [this] { return mTasks.empty() && !mBusy; });
+  }
+
+private:
+  void workerMain() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+      mTaskReady.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+      // Drain the queue before stopping
+      if (mTasks.empty())
+        return;
+      std::function<void()> task = std::move(mTasks.front());
+      mTasks.pop_front();
+      mBusy = true;
+      lock.unlock();
+      task();
+      // Release anything the task captured before reporting completion
+      task = nullptr;
+      lock.lock();
+      mBusy = false;
+      if (mTasks.empty())
+        mAllDone.notify_all();
+    }
+  }
+
+  std::thread mWorker;
+  std::deque<std::function<void()>> mTasks;
+  std::mutex mMutex;
+  std::condition_variable mTaskReady;
+  std::condition_variable mAllDone;
+  bool mBusy = false;
+  bool mStopping = false;
+};
+
+//! @brief Invoke `fn(i)` for every i in [0, count) across the pool, blocking
+//! until all calls have returned.
+//!
+//! Indices are handed out dynamically, so uneven work balances itself.
+//!
+//! @pre Not called from a task of the same pool.
+//!
+template <typename Fn>
+void parallelFor(ThreadPool& pool, std::size_t count, Fn&& fn) {
+  std::atomic<std::size_t> next = 0;
+  const auto num_tasks = std::min<std::size_t>(pool.size(), count);
+  for (std::size_t t = 0; t < num_tasks; ++t) {
+    pool.enqueue([&] {
+      for (std::size_t i = next++; i < count; i = next++)
+        fn(i);
+    });
+  }
+  pool.wait();
+}
+
+} // namespace riistudio::util
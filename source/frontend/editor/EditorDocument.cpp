@@ -60,13 +60,28 @@ void EditorDocument::saveAs(const std::string_view _path) {
     path += ".bmd";
   }
   oishii::Writer writer(1024);
+  mMessages.clear();
 
   auto ex = SpawnExporter(getRoot());
   if (!ex) {
     DebugReport("Failed to spawn exporter.\n");
     return;
   }
-  ex->write_(getRoot(), writer);
+  bool failed = false;
+  ex->write_(getRoot(), writer,
+             [&](kpi::IOMessageClass message_class,
+                 const std::string_view domain,
+                 const std::string_view message_body) {
+               failed |= message_class == kpi::IOMessageClass::Error;
+               mMessages.emplace_back(message_class, std::string(domain),
+                                      std::string(message_body));
+             });
+  // Keep the file on disk rather than replace it with an incomplete one
+  if (failed) {
+    mMessages.emplace_back(kpi::IOMessageClass::Error, std::string(path),
+                           "The file was not saved.");
+    return;
+  }
 
   plate::Platform::writeFile({writer.getDataBlockStart(), writer.getBufSize()},
                              path);
@@ -22,7 +22,8 @@ public:
 
   //! Save to the original location.
   void save();
-  //! Save to the specified location.
+  //! Save to the specified location. Messages of the exporter replace any
+  //! messages still held.
   void saveAs(const std::string_view path);
 
   std::string_view getPath() const { return mFilePath; }
@@ -31,6 +32,7 @@ private:
   std::string mFilePath;
 
 protected:
+  //! Messages of the importer or the last save, until they are dismissed
   llvm::SmallVector<Message, 16> mMessages;
 };
 
@@ -2,6 +2,7 @@
 #include <core/3d/i3dmodel.hpp>                  // lib3d::Scene
 #include <core/util/gui.hpp>                     // ImGui::DockBuilderDockWindow
 #include <frontend/applet.hpp>                   // core::Applet
+#include <frontend/editor/ImporterWindow.hpp>    // DrawMessages
 #include <frontend/editor/views/HistoryList.hpp> // MakePropertyEditor
 #include <frontend/editor/views/Outliner.hpp>    // MakeHistoryList
 #include <frontend/editor/views/PropertyEditor.hpp>   // MakeOutliner
@@ -77,6 +78,27 @@ void EditorWindow::draw_() {
     }
   }
 
+  drawMessages();
+}
+
+void EditorWindow::drawMessages() {
+  if (mMessages.empty())
+    return;
+
+  ImGui::PushID(this);
+  ImGui::OpenPopup("Messages");
+  ImGui::SetNextWindowSize({800.0f, 0.0f});
+  if (ImGui::BeginPopupModal("Messages", nullptr,
+                             ImGuiWindowFlags_NoCollapse)) {
+    DrawMessages(mMessages);
+    if (ImGui::Button("OK",
+                      ImVec2{ImGui::GetContentRegionAvailWidth(), 0.0f})) {
+      mMessages.clear();
+      ImGui::CloseCurrentPopup();
+    }
+    ImGui::EndPopup();
+  }
+  ImGui::PopID();
 }
 
 } // namespace riistudio::frontend
@@ -40,9 +40,10 @@ public:
 private:
   void init();
 
+  void drawMessages();
+
   IconManager mIconManager;
   kpi::IObject* mActive = nullptr;
-  // bool mShowMessages = true;
 };
 
 } // namespace riistudio::frontend
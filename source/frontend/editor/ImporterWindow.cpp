@@ -108,7 +108,9 @@ void ImporterWindow::draw() {
   }
 }
 
-void ImporterWindow::drawMessages() {
+void ImporterWindow::drawMessages() { DrawMessages(mMessages); }
+
+void DrawMessages(std::span<const Message> messages) {
   // ImGui::SetWindowFontScale(1.2f);
   const auto entry_flags = ImGuiTableFlags_Borders | ImGuiTableFlags_Sortable |
                            ImGuiTableFlags_Resizable |
@@ -119,7 +121,7 @@ void ImporterWindow::drawMessages() {
     ImGui::TableSetupColumn("Path", ImGuiTableColumnFlags_None, .3f);
     ImGui::TableSetupColumn("Body", ImGuiTableColumnFlags_None, .6f);
     ImGui::TableAutoHeaders();
-    for (auto& msg : mMessages) {
+    for (auto& msg : messages) {
       ImGui::TableNextRow();
       ImGui::TableSetColumnIndex(0);
       ImGui::TextUnformatted([](kpi::IOMessageClass mclass) -> const char* {
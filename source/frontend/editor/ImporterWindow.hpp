@@ -1,9 +1,13 @@
 #pragma once
 
 #include <frontend/editor/EditorImporter.hpp> // EditorImporter
+#include <span>                               // std::span
 
 namespace riistudio::frontend {
 
+//! Draw a table of reader or writer messages.
+void DrawMessages(std::span<const Message> messages);
+
 class ImporterWindow : public EditorImporter {
 public:
   ImporterWindow(FileData&& data, kpi::INode* fileState = nullptr)
@@ -1,4 +1,5 @@
 #include "HistoryList.hpp"
+#include <algorithm>                      // for std::max
 #include <core/common.h>                  // for u32
 #include <core/util/gui.hpp>              // for ImGui::Button
 #include <vendor/fa5/IconsFontAwesome5.h> // for ICON_FA_SAVE
@@ -34,10 +35,17 @@ void HistoryList::draw_() {
     mHost.redo(mRoot);
   }
 
+  int budget = static_cast<int>(mHost.getMemoryBudget() >> 20);
+  if (ImGui::InputInt("Memory budget (MiB, 0: unlimited)", &budget))
+    mHost.setMemoryBudget(static_cast<std::size_t>(std::max(budget, 0)) << 20);
+  ImGui::Text("Retained: %.1f MiB",
+              static_cast<float>(mHost.retainedSize()) / (1024 * 1024));
+
   ImGui::BeginChild("Record List");
   for (std::size_t i = 0; i < mHost.size(); ++i) {
-    ImGui::Text("(%s) History #%u", i == mHost.cursor() ? "X" : " ",
-                static_cast<u32>(i));
+    ImGui::Text("(%s) History #%u (%.1f KiB)", i == mHost.cursor() ? "X" : " ",
+                static_cast<u32>(i),
+                static_cast<float>(mHost.retainedSize(i)) / 1024);
   }
   ImGui::EndChild();
 }
@@ -1,5 +1,6 @@
 #include "root.hpp"
 #include <core/3d/gl.hpp>
+#include <core/3d/renderer/ShaderDiskCache.hpp>
 #include <core/api.hpp>
 #include <core/util/gui.hpp>
 #include <core/util/timestamp.hpp>
@@ -215,7 +216,8 @@ void RootWindow::draw() {
                 bmd_shape.id = m_i;
                 bmd_shape.mVertexDescriptor = vcd;
                 for (auto& e : bmd_shape.mVertexDescriptor.mAttributes) {
-                  e.second = libcube::gx::VertexAttributeType::Short;
+                  bmd_shape.mVertexDescriptor.mAttributes[e.first] =
+                      libcube::gx::VertexAttributeType::Short;
                 }
                 bmd_shape.mVertexDescriptor
                     .calcVertexDescriptorFromAttributeList();
@@ -227,91 +229,88 @@ void RootWindow::draw() {
                   bmd_mp.mCurrentMatrix = 0;
                   bmd_mp.mDrawMatrixIndices.push_back(0);
                   // No multi mtx yet
-                  for (int j = 0;
-                       j < from_shape.getMatrixPrimitiveNumIndexedPrimitive(i);
-                       ++j) {
-                    const auto& prim =
-                        from_shape.getMatrixPrimitiveIndexedPrimitive(i, j);
-                    auto& p = bmd_mp.mPrimitives.emplace_back(prim);
-                    // Remap vtx indices
-                    for (auto& v : p.mVertices) {
-                      for (u32 x = 0;
-                           x < (u32)libcube::gx::VertexAttribute::Max; ++x) {
-                        if (!(vcd.mBitfield & (1 << x)))
-                          continue;
-                        auto& bufs = bmd_model.mBufs;
-                        switch (static_cast<libcube::gx::VertexAttribute>(x)) {
-                        case libcube::gx::VertexAttribute::
-                            PositionNormalMatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture0MatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture1MatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture2MatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture3MatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture4MatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture5MatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture6MatrixIndex:
-                        case libcube::gx::VertexAttribute::Texture7MatrixIndex:
-                          break;
-                        case libcube::gx::VertexAttribute::Position: {
-                          auto pos = from_shape.getPos(
-                              v[libcube::gx::VertexAttribute::Position]);
-                          auto found = std::find(bufs.pos.mData.begin(),
-                                                 bufs.pos.mData.end(), pos);
-                          if (found == bufs.pos.mData.end()) {
-                            bmd_model.mBufs.pos.mData.push_back(pos);
-                            v[libcube::gx::VertexAttribute::Position] =
-                                bmd_model.mBufs.pos.mData.size() - 1;
-                          } else {
-                            v[libcube::gx::VertexAttribute::Position] =
-                                found - bufs.pos.mData.begin();
-                          }
-                          break;
-                        }
-                        case libcube::gx::VertexAttribute::Color0: {
-                          const auto scolor = from_shape.getClr(
-                              0, v[libcube::gx::VertexAttribute::Color0]);
-                          libcube::gx::Color clr;
-                          clr.r = roundf(scolor[0] * 255.0f);
-                          clr.g = roundf(scolor[1] * 255.0f);
-                          clr.b = roundf(scolor[2] * 255.0f);
-                          clr.a = roundf(scolor[3] * 255.0f);
-                          bmd_model.mBufs.color[0].mData.push_back(clr);
-                          v[libcube::gx::VertexAttribute::Color0] =
-                              bmd_model.mBufs.color[0].mData.size() - 1;
-                          break;
-                        }
-                        case libcube::gx::VertexAttribute::TexCoord0:
-                        case libcube::gx::VertexAttribute::TexCoord1:
-                        case libcube::gx::VertexAttribute::TexCoord2:
-                        case libcube::gx::VertexAttribute::TexCoord3:
-                        case libcube::gx::VertexAttribute::TexCoord4:
-                        case libcube::gx::VertexAttribute::TexCoord5:
-                        case libcube::gx::VertexAttribute::TexCoord6:
-                        case libcube::gx::VertexAttribute::TexCoord7: {
-                          const auto chan =
-                              x - static_cast<int>(
-                                      libcube::gx::VertexAttribute::TexCoord0);
-                          const auto attr =
-                              static_cast<libcube::gx::VertexAttribute>(x);
-                          const auto data = from_shape.getUv(chan, v[attr]);
-
-                          bmd_model.mBufs.uv[chan].mData.push_back(data);
-                          v[static_cast<libcube::gx::VertexAttribute>(x)] =
-                              bmd_model.mBufs.uv[chan].mData.size() - 1;
-
-                          break;
-                        }
-                        case libcube::gx::VertexAttribute::Normal:
-                          bmd_model.mBufs.norm.mData.push_back(
-                              from_shape.getNrm(
-                                  v[libcube::gx::VertexAttribute::Normal]));
-                          v[libcube::gx::VertexAttribute::Normal] =
-                              bmd_model.mBufs.norm.mData.size() - 1;
-                          break;
-                        default:
-                          throw "Invalid vtx attrib";
-                          break;
+                  const auto& from_mp =
+                      from_shape.getMeshData().mMatrixPrimitives[i];
+                  bmd_mp.mPrimitives = from_mp.mPrimitives;
+                  bmd_mp.mVertices = from_mp.mVertices;
+                  // Remap vtx indices
+                  for (auto v : bmd_mp.mVertices) {
+                    for (u32 x = 0;
+                         x < (u32)libcube::gx::VertexAttribute::Max; ++x) {
+                      if (!(vcd.mBitfield & (1 << x)))
+                        continue;
+                      auto& bufs = bmd_model.mBufs;
+                      switch (static_cast<libcube::gx::VertexAttribute>(x)) {
+                      case libcube::gx::VertexAttribute::
+                          PositionNormalMatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture0MatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture1MatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture2MatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture3MatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture4MatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture5MatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture6MatrixIndex:
+                      case libcube::gx::VertexAttribute::Texture7MatrixIndex:
+                        break;
+                      case libcube::gx::VertexAttribute::Position: {
+                        auto pos = from_shape.getPos(
+                            v[libcube::gx::VertexAttribute::Position]);
+                        auto found = std::find(bufs.pos.mData.begin(),
+                                               bufs.pos.mData.end(), pos);
+                        if (found == bufs.pos.mData.end()) {
+                          bmd_model.mBufs.pos.mData.push_back(pos);
+                          v[libcube::gx::VertexAttribute::Position] =
+                              bmd_model.mBufs.pos.mData.size() - 1;
+                        } else {
+                          v[libcube::gx::VertexAttribute::Position] =
+                              found - bufs.pos.mData.begin();
                         }
+                        break;
+                      }
+                      case libcube::gx::VertexAttribute::Color0: {
+                        const auto scolor = from_shape.getClr(
+                            0, v[libcube::gx::VertexAttribute::Color0]);
+                        libcube::gx::Color clr;
+                        clr.r = roundf(scolor[0] * 255.0f);
+                        clr.g = roundf(scolor[1] * 255.0f);
+                        clr.b = roundf(scolor[2] * 255.0f);
+                        clr.a = roundf(scolor[3] * 255.0f);
+                        bmd_model.mBufs.color[0].mData.push_back(clr);
+                        v[libcube::gx::VertexAttribute::Color0] =
+                            bmd_model.mBufs.color[0].mData.size() - 1;
+                        break;
+                      }
+                      case libcube::gx::VertexAttribute::TexCoord0:
+                      case libcube::gx::VertexAttribute::TexCoord1:
+                      case libcube::gx::VertexAttribute::TexCoord2:
+                      case libcube::gx::VertexAttribute::TexCoord3:
+                      case libcube::gx::VertexAttribute::TexCoord4:
+                      case libcube::gx::VertexAttribute::TexCoord5:
+                      case libcube::gx::VertexAttribute::TexCoord6:
+                      case libcube::gx::VertexAttribute::TexCoord7: {
+                        const auto chan =
+                            x - static_cast<int>(
+                                    libcube::gx::VertexAttribute::TexCoord0);
+                        const auto attr =
+                            static_cast<libcube::gx::VertexAttribute>(x);
+                        const auto data = from_shape.getUv(chan, v[attr]);
+
+                        bmd_model.mBufs.uv[chan].mData.push_back(data);
+                        v[static_cast<libcube::gx::VertexAttribute>(x)] =
+                            bmd_model.mBufs.uv[chan].mData.size() - 1;
+
+                        break;
+                      }
+                      case libcube::gx::VertexAttribute::Normal:
+                        bmd_model.mBufs.norm.mData.push_back(
+                            from_shape.getNrm(
+                                v[libcube::gx::VertexAttribute::Normal]));
+                        v[libcube::gx::VertexAttribute::Normal] =
+                            bmd_model.mBufs.norm.mData.size() - 1;
+                        break;
+                      default:
+                        throw "Invalid vtx attrib";
+                        break;
                       }
                     }
                   }
@@ -415,6 +414,13 @@ RootWindow::RootWindow() : Applet("RiiStudio " RII_TIME_STAMP) {
 
   spInstance = this;
 
+#ifndef __EMSCRIPTEN__
+  // Driver program binaries persist across launches
+  if (const auto directory = ShaderDiskCache::userDirectory();
+      !directory.empty())
+    ShaderDiskCache::openGlobal(directory);
+#endif
+
   InitAPI();
 }
 RootWindow::~RootWindow() { DeinitAPI(); }
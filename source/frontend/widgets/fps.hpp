@@ -1,8 +1,28 @@
-#include <core/util/gui.hpp> // ImGui::Text
-#include <numeric>           // roundf
+#include <array>                // std::array
+#include <cfloat>               // FLT_MAX
+#include <core/kpi/History.hpp> // kpi::History
+#include <core/util/gui.hpp>    // ImGui::Text
+#include <numeric>              // roundf
 
 namespace riistudio {
 
+inline void DrawCommitLatency() {
+  const auto& latency = kpi::History::getCommitLatency();
+  const u32 count = latency.getCount();
+  if (count == 0) {
+    ImGui::Text("No commits");
+    return;
+  }
+  ImGui::Text("Commit latency (%u): p50 < %lldus, p99 < %lldus", count,
+              static_cast<long long>(latency.getPercentile(0.5f).count()),
+              static_cast<long long>(latency.getPercentile(0.99f).count()));
+  std::array<float, util::LatencyHistogram::NumBuckets> buckets;
+  for (std::size_t i = 0; i < buckets.size(); ++i)
+    buckets[i] = static_cast<float>(latency.getBucket(i));
+  ImGui::PlotHistogram("##CommitLatency", buckets.data(), buckets.size(), 0,
+                       "1us .. 1s (log2)", 0.0f, FLT_MAX, ImVec2(240, 60));
+}
+
 void DrawFps() {
   const auto& io = ImGui::GetIO();
 #ifndef NDEBUG
@@ -11,6 +31,11 @@ void DrawFps() {
 #else
   ImGui::Text("%u fps", static_cast<u32>(roundf(io.Framerate)));
 #endif
+  if (ImGui::IsItemHovered()) {
+    ImGui::BeginTooltip();
+    DrawCommitLatency();
+    ImGui::EndTooltip();
+  }
 }
 
 } // namespace riistudio
@@ -2,6 +2,7 @@
 
 #include "types.hxx"
 #include <assert.h>
+#include <memory>
 #include <span>
 #include <string>
 #include <string_view>
@@ -50,32 +51,42 @@ public:
   //! Construct a `DataProvider` from a vector of data.
   DataProvider(std::vector<u8>&& data,
                std::string_view file_path = "<unknown file>")
-      : mData(std::move(data)), mPath(file_path) {}
+      : mData(std::make_shared<const std::vector<u8>>(std::move(data))),
+        mPath(file_path) {}
 
   //! Get a read-only slice of the data.
   ByteView slice(std::size_t start = 0,
                  std::size_t extent = std::dynamic_extent) {
     const std::size_t adjusted_size =
-        extent == std::dynamic_extent ? mData.size() : extent;
-    std::span<const u8> sliced_span{mData.data() + start, adjusted_size};
+        extent == std::dynamic_extent ? mData->size() : extent;
+    std::span<const u8> sliced_span{mData->data() + start, adjusted_size};
     return {sliced_span, *this, mPath};
   }
 
   std::string_view getFilePath() const { return mPath; }
 
+  //! Get a pointer to an element that keeps the data alive, even past the
+  //! lifetime of the provider.
+  std::shared_ptr<const u8> share(const u8* element) const {
+    assert(element >= mData->data() &&
+           element <= mData->data() + mData->size() &&
+           "element is out of bounds.");
+    return {mData, element};
+  }
+
   // For ByteView to compute file offsets.
   std::ptrdiff_t computeOffset(const u8* element) const {
-    assert(element < mData.data() + mData.size() &&
+    assert(element < mData->data() + mData->size() &&
            "element is out of bounds.");
-    if (element > mData.data() + mData.size())
+    if (element > mData->data() + mData->size())
       return 0;
-    return element - mData.data();
+    return element - mData->data();
   }
 
 private:
   // We don't keep track of slices, which would hold dangling pointers if mData
-  // reallocated.
-  const std::vector<u8> mData;
+  // reallocated. Shared so that borrowed payloads may outlive the provider.
+  std::shared_ptr<const std::vector<u8>> mData;
 
   std::string mPath;
 };
@@ -5,6 +5,7 @@
 #include "../util/util.hxx"
 #include <array>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -185,6 +186,34 @@ public:
               std::back_inserter(out));
     mPos += size;
   }
+  //! Like readBuffer, but borrows the bytes instead of copying them. The result
+  //! keeps the underlying file data alive.
+  //!
+  //! Returns null, without advancing, if the range extends past the end of
+  //! the file: unlike a copy, a truncated view cannot be made safe later.
+  //!
+  std::shared_ptr<const u8> shareBuffer(u32 size, s32 ofs = -1) {
+    if (ofs < 0)
+      ofs = mPos;
+    if (static_cast<u64>(ofs) + size > endpos()) {
+      warnAt("Data extends past the end of the file", ofs, endpos());
+      return nullptr;
+    }
+    mPos += size;
+    return mView.getProvider()->share(mView.data() + ofs);
+  }
+  //! Borrow `size` bytes at the current position, without decoding them, and
+  //! advance past them. The result is valid for the lifetime of the reader.
+  std::span<const u8> readBytes(u32 size) {
+    boundsCheck(size);
+    const u8* data = getStreamStart() + mPos;
+    mPos += size;
+    return {data, size};
+  }
+  //! Whether multi-byte values are byte-swapped when decoded.
+  bool isSwapped() const noexcept {
+    return Options::MULTIENDIAN_SUPPORT && bigEndian == Options::PLATFORM_LE;
+  }
 
 private:
   bool bigEndian = true; // to swap
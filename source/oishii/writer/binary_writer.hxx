@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -84,6 +86,19 @@ public:
     seek<Whence::Current>(sz);
   }
 
+  //! Copy raw bytes into the stream in one step.
+  void writeBuffer(std::span<const u8> data) {
+    if (data.empty())
+      return;
+    if (tell() + data.size() > mBuf.size())
+      mBuf.resize(tell() + data.size());
+
+    breakPointProcess(data.size());
+    memcpy(&mBuf[tell()], data.data(), data.size());
+
+    seek<Whence::Current>(data.size());
+  }
+
   std::string mNameSpace = ""; // set by linker, stored in reservations
   std::string mBlockName = ""; // set by linker, stored in reservations
 
@@ -27,98 +27,79 @@ public:
                                       const std::string& nameSpace,
                                       const std::string& blockName,
                                       std::string& resultName) {
-    // TODO: This can be optimized, no need to check two constructed strings
+    auto find = [&](const std::string& nameSpacedSymbol) -> const Node* {
+      const u32 id = linker.mSymbols.find(nameSpacedSymbol);
+      if (id == SymbolTable::None)
+        return nullptr;
+      resultName = nameSpacedSymbol;
+      return linker.mSymbolNodes[id];
+    };
 
     // On same level
-    {
-      const std::string nameSpacedSymbol =
-          nameSpace.empty() ? symbol : nameSpace + "::" + symbol;
-      for (const auto& entry : linker.mLayout)
-        if ((entry.mNamespace.empty()
-                 ? entry.mNode->getId()
-                 : entry.mNamespace + "::" + entry.mNode->getId()) ==
-            nameSpacedSymbol) {
-          // if (resultName)
-          resultName = nameSpacedSymbol;
-          return entry.mNode.get();
-        }
-    }
+    if (const Node* node =
+            find(nameSpace.empty() ? symbol : nameSpace + "::" + symbol))
+      return node;
     // Children
     {
       std::string nameSpacePrefix = nameSpace.empty() ? "" : nameSpace + "::";
       //	if (hasEnding(nameSpacePrefix, "::::"))
       //		nameSpacePrefix = nameSpacePrefix.substr(0,
       // nameSpacePrefix.size() - 2);
-      const std::string nameSpacedSymbol =
-          nameSpacePrefix + (blockName.empty() ? "" : blockName + "::") +
-          symbol;
-      for (const auto& entry : linker.mLayout)
-        if ((entry.mNamespace.empty()
-                 ? entry.mNode->getId()
-                 : entry.mNamespace + "::" + entry.mNode->getId()) ==
-            nameSpacedSymbol) {
-          // if (resultName)
-          resultName = nameSpacedSymbol;
-          return entry.mNode.get();
-        }
+      const std::string blockPrefix = blockName.empty() ? "" : blockName + "::";
+      if (const Node* node = find(nameSpacePrefix + blockPrefix + symbol))
+        return node;
     }
     // Global
-    {
-      for (const auto& entry : linker.mLayout)
-        if ((entry.mNamespace.empty()
-                 ? entry.mNode->getId()
-                 : entry.mNamespace + "::" + entry.mNode->getId()) == symbol) {
-          // if (resultName)
-          resultName = symbol;
-          return entry.mNode.get();
-        }
-    }
+    if (const Node* node = find(symbol))
+      return node;
     printf("Search for %s failed!\n", symbol.c_str());
     assert(!"Failed critical namespaced symbol lookup in layout");
     return nullptr;
   }
+  static const Linker::MapEntry* findMapEntry(const Linker& linker,
+                                              const std::string& symbol) {
+    const u32 id = linker.mSymbols.find(symbol);
+    if (id == SymbolTable::None || id >= linker.mSymbolMapEntries.size() ||
+        linker.mSymbolMapEntries[id] == SymbolTable::None)
+      return nullptr;
+    return &linker.mMap[linker.mSymbolMapEntries[id]];
+  }
   // TODO: Offset might be better removed
   static u32 resolveHook(const Linker& linker, const std::string& symbol,
                          Hook::RelativePosition pos, int offset = 0) {
     std::string symbol_ = symbol;
-    // TODO: This can be much more optimized
     if (pos == Hook::RelativePosition::EndOfChildren) {
       if (!symbol_.empty())
         symbol_ += "::";
       symbol_ += "EndOfChildren";
     }
-    for (const auto& entry : linker.mMap) {
-      if (entry.symbol == symbol_) {
-        switch (pos) {
-        case Hook::RelativePosition::Begin:
-        case Hook::RelativePosition::EndOfChildren: // begin of marker node
-        {
-          auto roundDown = [](u32 in, u32 align) -> u32 {
-            return align ? in & ~(align - 1) : in;
-          };
-          auto roundUp = [roundDown](u32 in, u32 align) -> u32 {
-            return align ? roundDown(in + (align - 1), align) : in;
-          };
-          u32 x = entry.begin + offset;
-          // TODO: We don't need to make another pass from the start
-          u32 align = pos == Hook::RelativePosition::Begin
-                          ? entry.restrict.alignment
-                          : std::find_if(linker.mMap.begin(), linker.mMap.end(),
-                                         [symbol](auto& e) {
-                                           return e.symbol == symbol;
-                                         })
-                                ->restrict.alignment;
-          u32 rounded = roundUp(x, align);
-          return rounded;
-        }
-        case Hook::RelativePosition::End:
-          return entry.end + offset;
-        default:
-          printf("Linker Error: Unknown hook type %u -- assuming Begin (no "
-                 "align)\n",
-                 pos);
-          return entry.begin + offset;
-        }
+    if (const auto* entry = findMapEntry(linker, symbol_)) {
+      switch (pos) {
+      case Hook::RelativePosition::Begin:
+      case Hook::RelativePosition::EndOfChildren: // begin of marker node
+      {
+        auto roundDown = [](u32 in, u32 align) -> u32 {
+          return align ? in & ~(align - 1) : in;
+        };
+        auto roundUp = [roundDown](u32 in, u32 align) -> u32 {
+          return align ? roundDown(in + (align - 1), align) : in;
+        };
+        u32 x = entry->begin + offset;
+        // The end of children is aligned like the parent block
+        const auto* aligned = pos == Hook::RelativePosition::Begin
+                                  ? entry
+                                  : findMapEntry(linker, symbol);
+        assert(aligned);
+        u32 rounded = roundUp(x, aligned ? aligned->restrict.alignment : 0);
+        return rounded;
+      }
+      case Hook::RelativePosition::End:
+        return entry->end + offset;
+      default:
+        printf("Linker Error: Unknown hook type %u -- assuming Begin (no "
+               "align)\n",
+               pos);
+        return entry->begin + offset;
       }
     }
     printf("Linker Error: Cannot resolve symbol \"%s\"!\n", symbol_.c_str());
@@ -133,11 +114,25 @@ struct EndOfChildrenMarker : public Node {
   const Node& mParent;
 };
 
+Node& Linker::addToLayout(std::unique_ptr<Node> node,
+                          const std::string& nameSpace) {
+  auto& entry = mLayout.emplace_back(std::move(node), nameSpace);
+  entry.mSymbol =
+      mSymbols.intern(nameSpace.empty()
+                          ? entry.mNode->getId()
+                          : nameSpace + "::" + entry.mNode->getId());
+  // Lookups resolve to the first node of a symbol
+  if (entry.mSymbol == mSymbolNodes.size())
+    mSymbolNodes.push_back(entry.mNode.get());
+  mNodeSymbols.emplace(entry.mNode.get(), entry.mSymbol);
+  return *entry.mNode;
+}
+
 // We call this recursively
 void Linker::gather(std::unique_ptr<Node> pRoot,
                     const std::string& nameSpace) noexcept {
   // Add the node
-  auto& root = *mLayout.emplace_back(std::move(pRoot), nameSpace).mNode.get();
+  auto& root = addToLayout(std::move(pRoot), nameSpace);
 
   std::vector<std::unique_ptr<Node>> children;
   const Node::eResult result = root.getChildren(children);
@@ -149,9 +144,8 @@ void Linker::gather(std::unique_ptr<Node> pRoot,
            (nameSpace.empty() ? "" : (nameSpace + "::")) + root.getId());
 
   if (!(root.getLinkingRestriction().options & LinkingRestriction::Leaf)) {
-    mLayout.emplace_back(std::make_unique<EndOfChildrenMarker>(root),
-                         (nameSpace.empty() ? "" : (nameSpace + "::")) +
-                             root.getId());
+    addToLayout(std::make_unique<EndOfChildrenMarker>(root),
+                (nameSpace.empty() ? "" : (nameSpace + "::")) + root.getId());
   }
 }
 
@@ -181,9 +175,12 @@ void Linker::write(Writer& writer, bool doShuffle) {
                  writer.tell() - pad_begin);
     }
     // Fill map: symbol and begin position
-    mMap.push_back({(entry.mNamespace.empty() ? "" : entry.mNamespace + "::") +
-                        entry.mNode->getId(),
-                    writer.tell(), 0, entry.mNode->getLinkingRestriction()});
+    if (mSymbolMapEntries.size() < mSymbols.size())
+      mSymbolMapEntries.resize(mSymbols.size(), SymbolTable::None);
+    if (mSymbolMapEntries[entry.mSymbol] == SymbolTable::None)
+      mSymbolMapEntries[entry.mSymbol] = static_cast<u32>(mMap.size());
+    mMap.push_back({mSymbols.get(entry.mSymbol), writer.tell(), 0,
+                    entry.mNode->getLinkingRestriction()});
     // Write
     writer.mNameSpace = entry.mNamespace;
     writer.mBlockName = entry.mNode->getId();
@@ -203,7 +200,7 @@ void Linker::write(Writer& writer, bool doShuffle) {
     }
   }
 
-  {
+  if (mDumpMap) {
     printf("Begin    End      Size     Align    Static Leaf  Symbol\n");
     for (const auto& entry : mMap) {
       printf("0x%06x 0x%06x 0x%06x 0x%06x %s  %s %s\n", (u32)entry.begin,
@@ -247,39 +244,18 @@ void Linker::write(Writer& writer, bool doShuffle) {
                                               reserve.blockName, toBlockSymbol);
     //#endif
     // TODO: Generalize all of these from/to methods
-    if (link.from.mBlock) {
-      bool bSuccess = false;
-      for (const auto& entry : mLayout) {
-        if (entry.mNode.get() == link.from.mBlock) {
-          fromBlockSymbol =
-              entry.mNamespace.empty()
-                  ? entry.mNode->getId()
-                  : entry.mNamespace + "::" + entry.mNode->getId();
-          bSuccess = true;
-          break;
-        }
-      }
-      if (!bSuccess)
+    auto blockSymbol = [&](const Node* block, std::string& symbol) {
+      if (const auto it = mNodeSymbols.find(block); it != mNodeSymbols.end())
+        symbol = mSymbols.get(it->second);
+      else
         printf("Linker Error: Block %s was never written to stream, so canot "
                "be resolved.\n",
-               link.from.mBlock->getId().c_str());
-    }
-    if (link.to.mBlock) {
-      bool bSuccess = false;
-      for (const auto& entry : mLayout) {
-        if (entry.mNode.get() == link.to.mBlock) {
-          toBlockSymbol = entry.mNamespace.empty()
-                              ? entry.mNode->getId()
-                              : entry.mNamespace + "::" + entry.mNode->getId();
-          bSuccess = true;
-          break;
-        }
-      }
-      if (!bSuccess)
-        printf("Linker Error: Block %s was never written to stream, so canot "
-               "be resolved.\n",
-               link.to.mBlock->getId().c_str());
-    }
+               block->getId().c_str());
+    };
+    if (link.from.mBlock)
+      blockSymbol(link.from.mBlock, fromBlockSymbol);
+    if (link.to.mBlock)
+      blockSymbol(link.to.mBlock, toBlockSymbol);
     // TODO: Link: EndOfChildren + put that in map + if not all children static
     // and in shuffle, supply random number
     const u32 fromAddr = LinkerHelper::resolveHook(
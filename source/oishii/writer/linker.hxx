@@ -8,12 +8,14 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../types.hxx"
 
 #include "hook.hxx"
 #include "node.hxx"
+#include "symbol_table.hxx"
 
 namespace oishii {
 
@@ -58,18 +60,35 @@ public:
 
   using PadFunction = void (*)(char* dst, u32 size);
   PadFunction mUserPad = nullptr;
+  //! Print the layout map to stdout after writing.
+  bool mDumpMap = true;
 
 private:
   struct LayoutElement {
     std::unique_ptr<Node> mNode;
     std::string mNamespace;
+    //! Namespaced ID, interned in mSymbols
+    u32 mSymbol = SymbolTable::None;
 
     LayoutElement(std::unique_ptr<Node> node, const std::string& Namespace)
         : mNode(std::move(node)), mNamespace(Namespace) {}
   };
 
+  //! @brief Append a node to the layout, registering its symbol.
+  //!
+  Node& addToLayout(std::unique_ptr<Node> node, const std::string& nameSpace);
+
   std::vector<LayoutElement> mLayout;
 
+  //! Namespaced IDs of the layout, filled by gather.
+  SymbolTable mSymbols;
+  //! Symbol -> first node with that symbol
+  std::vector<const Node*> mSymbolNodes;
+  //! Node -> symbol
+  std::unordered_map<const Node*, u32> mNodeSymbols;
+  //! Symbol -> index of its first entry in mMap, filled by write
+  std::vector<u32> mSymbolMapEntries;
+
 public:
   //! Associates namespaced IDs to writer positions.
   //!
@@ -0,0 +1,89 @@
+/*!
+ * @file
+ * @brief Interned symbol table used by the linker.
+ */
+
+#pragma once
+
+#include "../types.hxx"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace oishii {
+
+//! @brief Assigns dense IDs to strings, with open-addressing lookup.
+//!
+//! IDs are assigned in order of first insertion, starting from zero, and stay
+//! valid for the lifetime of the table.
+//!
+class SymbolTable {
+public:
+  static constexpr u32 None = ~0u;
+
+  //! @brief Get the ID of a symbol, inserting it if absent.
+  //!
+  u32 intern(std::string_view symbol) {
+    if (2 * (mSymbols.size() + 1) > mSlots.size())
+      rehash(mSlots.empty() ? 64 : mSlots.size() * 2);
+    const std::size_t hash = hashOf(symbol);
+    u32& slot = mSlots[findSlot(symbol, hash)];
+    if (slot == None) {
+      slot = static_cast<u32>(mSymbols.size());
+      mSymbols.emplace_back(symbol);
+      mHashes.push_back(hash);
+    }
+    return slot;
+  }
+
+  //! @brief Get the ID of a symbol, or `None` if absent.
+  //!
+  u32 find(std::string_view symbol) const {
+    if (mSlots.empty())
+      return None;
+    return mSlots[findSlot(symbol, hashOf(symbol))];
+  }
+
+  const std::string& get(u32 id) const { return mSymbols[id]; }
+  std::size_t size() const { return mSymbols.size(); }
+
+  void clear() {
+    mSymbols.clear();
+    mHashes.clear();
+    mSlots.clear();
+  }
+
+private:
+  static std::size_t hashOf(std::string_view symbol) {
+    return std::hash<std::string_view>{}(symbol);
+  }
+
+  // Index of the slot holding `symbol`, or of the empty slot it belongs in
+  std::size_t findSlot(std::string_view symbol, std::size_t hash) const {
+    const std::size_t mask = mSlots.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+      const u32 slot = mSlots[i];
+      if (slot == None || (mHashes[slot] == hash && mSymbols[slot] == symbol))
+        return i;
+    }
+  }
+
+  void rehash(std::size_t numSlots) {
+    mSlots.assign(numSlots, None);
+    const std::size_t mask = numSlots - 1;
+    for (u32 id = 0; id < mSymbols.size(); ++id) {
+      std::size_t i = mHashes[id] & mask;
+      while (mSlots[i] != None)
+        i = (i + 1) & mask;
+      mSlots[i] = id;
+    }
+  }
+
+  std::vector<std::string> mSymbols;
+  std::vector<std::size_t> mHashes;
+  // Power of two, at most half full
+  std::vector<u32> mSlots;
+};
+
+} // namespace oishii
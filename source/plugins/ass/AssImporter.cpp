@@ -64,9 +64,7 @@ void AssImporter::ProcessMeshTrianglesStatic(
   auto& mp = poly_data.getMeshData().mMatrixPrimitives.emplace_back();
   // Copy triangle data
   // We will do triangle-stripping in a post-process
-  auto& tris = mp.mPrimitives.emplace_back();
-  tris.mType = libcube::gx::PrimitiveType::Triangles;
-  tris.mVertices = std::move(vertices);
+  mp.addPrimitive(libcube::gx::PrimitiveType::Triangles, vertices);
 
   const int boneId = get_bone_id(singleInfluence);
   assert(boneId >= 0);
@@ -147,10 +145,9 @@ void AssImporter::ProcessMeshTrianglesWeighted(
 
       // But submit what we have so far, first:
       auto& mp = poly_data.getMeshData().mMatrixPrimitives.emplace_back();
-      auto& tris = mp.mPrimitives.emplace_back();
-      tris.mType = libcube::gx::PrimitiveType::Triangles;
-      std::copy(vertices.begin() + last_sweep_vtx, vertices.begin() + v0,
-                std::back_inserter(tris.mVertices));
+      mp.addPrimitive(libcube::gx::PrimitiveType::Triangles,
+                      std::span(vertices.begin() + last_sweep_vtx,
+                                vertices.begin() + v0));
       last_sweep_vtx = v0;
       mp.mCurrentMatrix = -1;
       const auto sweep_begin = sweep_wave * 10;
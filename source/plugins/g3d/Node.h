@@ -110,6 +110,15 @@ public:
             kpi::nextFolder(this->mBuf_Clr, _new.getBuf_Clr(), old ? &old->mBuf_Clr : nullptr);
             kpi::nextFolder(this->mBuf_Uv, _new.getBuf_Uv(), old ? &old->mBuf_Uv : nullptr);
         }
+        void visitRecords(kpi::RecordVisitor visitor) const override {
+            kpi::visitFolder(mMaterials, visitor);
+            kpi::visitFolder(mBones, visitor);
+            kpi::visitFolder(mMeshes, visitor);
+            kpi::visitFolder(mBuf_Pos, visitor);
+            kpi::visitFolder(mBuf_Nrm, visitor);
+            kpi::visitFolder(mBuf_Clr, visitor);
+            kpi::visitFolder(mBuf_Uv, visitor);
+        }
     };
     std::unique_ptr<kpi::IMemento> next(const kpi::IMemento* last) const override {
         return std::make_unique<_Memento>(*this, last);
@@ -190,6 +199,10 @@ public:
             kpi::nextFolder(this->mModels, _new.getModels(), old ? &old->mModels : nullptr);
             kpi::nextFolder(this->mTextures, _new.getTextures(), old ? &old->mTextures : nullptr);
         }
+        void visitRecords(kpi::RecordVisitor visitor) const override {
+            kpi::visitFolder(mModels, visitor);
+            kpi::visitFolder(mTextures, visitor);
+        }
     };
     std::unique_ptr<kpi::IMemento> next(const kpi::IMemento* last) const override {
         return std::make_unique<_Memento>(*this, last);
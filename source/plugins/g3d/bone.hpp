@@ -70,14 +70,17 @@ struct Bone : public libcube::IBoneDelegate,
               public BoneData,
               public virtual kpi::IObject {
   std::string getName() const { return mName; }
-  void setName(const std::string& name) override { mName = name; }
+  void setName(const std::string& name) override {
+    mName = name;
+    onRenamed();
+  }
   // std::string getName() const override { return mName; }
   s64 getId() override { return id; }
   void copy(lib3d::Bone& to) const override {
     IBoneDelegate::copy(to);
     Bone* pJoint = dynamic_cast<Bone*>(&to);
     if (pJoint) {
-      pJoint->mName = mName;
+      pJoint->setName(mName);
       pJoint->matrixId = matrixId;
       pJoint->flag = flag;
 
@@ -6,13 +6,7 @@ namespace riistudio::g3d {
 
 const libcube::Texture* Material::getTexture(const std::string& id) const {
   const auto textures = getTextureSource();
-
-  for (auto& tex : textures) {
-    if (tex.getName() == id)
-      return &tex;
-  }
-
-  return nullptr;
+  return textures.empty() ? nullptr : textures.findByName(id);
 }
 
 } // namespace riistudio::g3d
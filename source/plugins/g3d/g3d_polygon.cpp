@@ -1,5 +1,6 @@
 #include "model.hpp"
 #include "polygon.hpp"
+#include <utility> // std::as_const
 
 namespace riistudio::g3d {
 
@@ -47,9 +48,11 @@ glm::vec3 Polygon::getNrm(u64 id) const {
 
 template <typename X, typename Y>
 auto add_to_buffer(const X& entry, Y& buf) -> u16 {
-  const auto found = std::find(buf.mEntries.begin(), buf.mEntries.end(), entry);
-  if (found != buf.mEntries.end()) {
-    return found - buf.mEntries.begin();
+  // Search without detaching the buffer from history snapshots
+  const auto& entries = std::as_const(buf.mEntries);
+  const auto found = std::find(entries.begin(), entries.end(), entry);
+  if (found != entries.end()) {
+    return found - entries.begin();
   }
 
   buf.mEntries.push_back(entry);
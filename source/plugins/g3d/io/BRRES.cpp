@@ -7,7 +7,9 @@
 #include <plugins/g3d/collection.hpp>
 #include <plugins/g3d/util/Dictionary.hpp>
 #include <plugins/g3d/util/NameTable.hpp>
+#include <plugins/gc/Util/TextureDedup.hpp>
 
+#include <optional>
 #include <set>
 #include <string>
 
@@ -17,7 +19,8 @@ namespace riistudio::g3d {
 
 // MDL0.cpp
 void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
-                NameTable& names, std::size_t brres_start);
+                NameTable& names, std::size_t brres_start,
+                const kpi::IOMessageCallback& callback);
 void readModel(Model& mdl, oishii::BinaryReader& reader,
                kpi::IOTransaction& transaction,
                const std::string& transaction_path);
@@ -25,7 +28,8 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
 // TEX0.cpp
 void readTexture(Texture& data, oishii::BinaryReader& reader);
 void writeTexture(const Texture& data, oishii::Writer& writer,
-                  NameTable& names);
+                  NameTable& names,
+                  std::optional<u32> shared_data = std::nullopt);
 
 class ArchiveDeserializer {
 public:
@@ -104,6 +108,12 @@ public:
     return dynamic_cast<Collection*>(&node) != nullptr;
   }
   void write(kpi::INode& node, oishii::Writer& writer) const {
+    write(node, writer, {});
+  }
+  //! Write, reporting shared texture data and unencodable meshes to
+  //! `callback`. An unencodable mesh is an Error: the output is incomplete.
+  void write(kpi::INode& node, oishii::Writer& writer,
+             const kpi::IOMessageCallback& callback) const {
     writer.setEndian(true);
     assert(dynamic_cast<Collection*>(&node) != nullptr);
     Collection& collection = *dynamic_cast<Collection*>(&node);
@@ -194,13 +204,27 @@ public:
       writer.alignTo(32);
       models_dict.mNodes[i + 1].setDataDestination(writer.tell());
       auto mdl_linker = linker.sublet("Models/" + std::to_string(i));
-      writeModel(collection.getModels()[i], writer, mdl_linker, names, start);
+      writeModel(collection.getModels()[i], writer, mdl_linker, names, start,
+                 callback);
     }
+    // Textures with identical content share the data of the first instance.
+    // Each duplicate is a bare TEX0 header with a negative texture offset.
+    // NW4R and our reader follow the offset, but tools that copy a TEX0 by its
+    // size field only get the header of a duplicate.
+    libcube::TextureDeduplicator tex_dedup;
+    std::vector<u32> tex_data_pos;
     for (int i = 0; i < collection.getTextures().size(); ++i) {
       writer.alignTo(32);
       textures_dict.mNodes[i + 1].setDataDestination(writer.tell());
-      writeTexture(collection.getTextures()[i], writer, names);
+      tex_data_pos.push_back(writer.tell() + 64);
+      const auto& tex = collection.getTextures()[i];
+      const u32 canonical = tex_dedup.add(tex);
+      if (canonical == i)
+        writeTexture(tex, writer, names);
+      else
+        writeTexture(tex, writer, names, tex_data_pos[canonical]);
     }
+    tex_dedup.report(callback, "brres/Textures");
     const auto end = writer.tell();
     writer.seekSet(subdicts_pos);
     if (root_dict.hasModels()) {
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <core/util/glm_io.hpp>
-#include <functional>
+#include <cstddef>
 #include <llvm/ADT/SmallVector.h>
 #include <map>
 #include <oishii/writer/binary_writer.hxx>
+#include <oishii/writer/symbol_table.hxx>
 #include <plugins/g3d/util/NameTable.hpp>
 #include <plugins/gc/GX/Material.hpp>
 #include <plugins/gc/GX/VertexTypes.hpp>
 #include <string>
+#include <string_view>
 #include <plugins/g3d/util/Dictionary.hpp>
 
 inline void operator<<(libcube::gx::Color& out, oishii::BinaryReader& reader) {
@@ -37,9 +40,12 @@ namespace riistudio::g3d {
 
 class RelocWriter {
 public:
+  //! Interned label
+  using LabelId = u32;
+
   struct Reloc {
-    std::string from, to;
-    std::size_t ofs, sz;
+    LabelId from, to;
+    u32 ofs, sz;
   };
 
   RelocWriter(oishii::Writer& writer) : mWriter(writer) {}
@@ -50,48 +56,44 @@ public:
     return RelocWriter(mWriter, mPrefix + "/" + path);
   }
 
-  // Define a label, associated with the current stream position
-  void label(const std::string& id, const std::size_t addr) {
-    mLabels.try_emplace(id, addr);
+  LabelId intern(std::string_view id) {
+    const LabelId label = mSymbols.intern(id);
+    if (label >= mLabels.size())
+      mLabels.resize(label + 1, Undefined);
+    return label;
+  }
+
+  // Define a label, associated with the current stream position. The first
+  // definition of a label is kept.
+  void label(LabelId id, const std::size_t addr) {
+    if (mLabels[id] == Undefined)
+      mLabels[id] = addr;
   }
-  void label(const std::string& id) { label(id, mWriter.tell()); }
+  void label(std::string_view id, const std::size_t addr) {
+    label(intern(id), addr);
+  }
+  void label(LabelId id) { label(id, mWriter.tell()); }
+  void label(std::string_view id) { label(intern(id), mWriter.tell()); }
   // Write a relocation, to be filled in by a resolve() call
-  template <typename T>
-  void writeReloc(const std::string& from, const std::string& to) {
-    mRelocs.emplace_back(
-        Reloc{.from = from, .to = to, .ofs = mWriter.tell(), .sz = sizeof(T)});
+  template <typename T> void writeReloc(LabelId from, LabelId to) {
+    mRelocs.push_back({from, to, mWriter.tell(), static_cast<u32>(sizeof(T))});
     mWriter.write<T>(static_cast<T>(0));
   }
-  // Write a relocation, with an associated child frame to be written by
-  // writeChildren()
   template <typename T>
-  void writeReloc(const std::string& from, const std::string& to,
-                  std::function<void(oishii::Writer&)> write) {
-    mRelocs.emplace_back(
-        Reloc{.from = from, .to = to, .ofs = mWriter.tell(), .sz = sizeof(T)});
-    mWriter.write<T>(static_cast<T>(-1));
-    mChildren.emplace_back(to, write);
+  void writeReloc(std::string_view from, std::string_view to) {
+    writeReloc<T>(intern(from), intern(to));
   }
-  // Write all child bodies
-  void writeChildren() {
-    for (auto& child : mChildren) {
-      label(child.first);
-      child.second(mWriter);
-    }
-    mChildren.clear();
-  }
-  // Resolve a single relocation
-  void resolve(Reloc& reloc) {
-    const auto from = mLabels.find(reloc.from);
-    const auto to = mLabels.find(reloc.to);
-
-    int delta = 0;
-    if (from == mLabels.end() || to == mLabels.end()) {
-      printf("Bad lookup: %s to %s\n", reloc.from.c_str(), reloc.to.c_str());
-      return; // come back..
-    } else {
-      delta = to->second - from->second;
+  // Resolve a single relocation. Returns false if a label is undefined.
+  bool resolve(const Reloc& reloc) {
+    const std::size_t from = mLabels[reloc.from];
+    const std::size_t to = mLabels[reloc.to];
+
+    if (from == Undefined || to == Undefined) {
+      printf("Bad lookup: %s to %s\n", mSymbols.get(reloc.from).c_str(),
+             mSymbols.get(reloc.to).c_str());
+      return false; // come back..
     }
+    const int delta = to - from;
 
     const auto back = mWriter.tell();
 
@@ -107,38 +109,40 @@ public:
     }
 
     mWriter.seekSet(back);
+    return true;
   }
-  // Resolve all relocations
+  // Resolve all relocations, keeping those with undefined labels
   void resolve() {
-    for (auto& reloc : mRelocs)
-      resolve(reloc);
-    mRelocs.erase(
-        std::remove_if(mRelocs.begin(), mRelocs.end(), [&](auto& reloc) {
-          const auto from = mLabels.find(reloc.from);
-          const auto to = mLabels.find(reloc.to);
-
-          return from != mLabels.end() && to != mLabels.end();
-        }));
+    mRelocs.erase(std::remove_if(mRelocs.begin(), mRelocs.end(),
+                                 [&](auto& reloc) { return resolve(reloc); }),
+                  mRelocs.end());
   }
 
-  auto& getLabels() const { return mLabels; }
   void printLabels() const {
-    for (auto& [label, at] : mLabels) {
+    std::vector<std::pair<std::string_view, std::size_t>> labels;
+    for (LabelId id = 0; id < mLabels.size(); ++id) {
+      if (mLabels[id] != Undefined)
+        labels.emplace_back(mSymbols.get(id), mLabels[id]);
+    }
+    std::sort(labels.begin(), labels.end());
+    for (auto& [label, at] : labels) {
       const auto uat = static_cast<unsigned>(at);
-      printf("%s: 0x%x (%u)\n", label.c_str(), uat, uat);
+      printf("%.*s: 0x%x (%u)\n", static_cast<int>(label.size()),
+             label.data(), uat, uat);
     }
   }
 
 private:
+  static constexpr std::size_t Undefined = ~static_cast<std::size_t>(0);
+
   std::string mPrefix;
 
   oishii::Writer& mWriter;
-  std::map<std::string, std::size_t> mLabels;
+  oishii::SymbolTable mSymbols;
+  //! Offset of each label, or Undefined
+  std::vector<std::size_t> mLabels;
 
   llvm::SmallVector<Reloc, 64> mRelocs;
-  llvm::SmallVector<
-      std::pair<std::string, std::function<void(oishii::Writer&)>>, 16>
-      mChildren;
 };
 
 template <bool Named, typename T, typename U>
@@ -8,6 +8,7 @@
 #include <plugins/gc/GPU/DLPixShader.hpp>
 #include <plugins/gc/GPU/GPUMaterial.hpp>
 #include <plugins/gc/GX/VertexTypes.hpp>
+#include <plugins/gc/Util/DisplayList.hpp>
 
 namespace riistudio::g3d {
 
@@ -98,10 +99,12 @@ void readGenericBuffer(GenericBuffer<T, HasMinimum, HasDivisor, kind>& out,
 
   reader.seekSet(start + startOfs);
   // TODO: Recompute bounds
-  for (auto& entry : out.mEntries) {
-    entry = libcube::gx::readComponents<T>(reader, out.mQuantize.mType,
-                                           nComponents, out.mQuantize.divisor);
-  }
+  out.mEntries.forEachChunk([&](std::span<T> chunk) {
+    for (auto& entry : chunk) {
+      entry = libcube::gx::readComponents<T>(
+          reader, out.mQuantize.mType, nComponents, out.mQuantize.divisor);
+    }
+  });
 }
 
 // Does not write size or mdl0 offset
@@ -257,47 +260,22 @@ struct DlHandle {
   void setBufSize(std::size_t c) { buf_size = c; }
   void setBufAddr(s32 addr) { ofs_buf = addr - tag_start; }
 };
-void writeVertexDataDL(const libcube::IndexedPolygon& poly,
-                       const MatrixPrimitive& mp, oishii::Writer& writer) {
-  using VATAttrib = libcube::gx::VertexAttribute;
-  using VATType = libcube::gx::VertexAttributeType;
-
-  for (auto& prim : mp.mPrimitives) {
-    writer.write<u8>(libcube::gx::EncodeDrawPrimitiveCommand(prim.mType));
-    writer.write<u16>(prim.mVertices.size());
-    for (const auto& v : prim.mVertices) {
-      for (int a = 0; a < (int)VATAttrib::Max; ++a) {
-        if (poly.getVcd()[(VATAttrib)a]) {
-          switch (poly.getVcd().mAttributes.at((VATAttrib)a)) {
-          case VATType::None:
-            break;
-          case VATType::Byte:
-            writer.write<u8>(v[(VATAttrib)a]);
-            break;
-          case VATType::Short:
-            writer.write<u16>(v[(VATAttrib)a]);
-            break;
-          case VATType::Direct:
-            if (((VATAttrib)a) != VATAttrib::PositionNormalMatrixIndex) {
-              assert(!"Direct vertex data is unsupported.");
-              abort();
-            }
-            writer.write<u8>(v[(VATAttrib)a]);
-            break;
-          default:
-            assert("!Unknown vertex attribute format.");
-            abort();
-          }
-        }
-      }
-    }
+llvm::Error writeVertexDataDL(const libcube::IndexedPolygon& poly,
+                              oishii::Writer& writer) {
+  auto plan = libcube::CompileVertexDecodePlan(poly.getVcd());
+  if (!plan)
+    return plan.takeError();
+  for (auto& mp : poly.getMeshData().mMatrixPrimitives) {
+    libcube::EncodeMeshDisplayList(writer, *plan, mp);
+    // DL pad
+    while (writer.tell() % 32)
+      writer.write<u8>(0);
   }
-  // DL pad
-  while (writer.tell() % 32)
-    writer.write<u8>(0);
+  return llvm::Error::success();
 }
 void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
-                NameTable& names, std::size_t brres_start) {
+                NameTable& names, std::size_t brres_start,
+                const kpi::IOMessageCallback& callback) {
   const auto mdl_start = writer.tell();
   int d_cursor = 0;
 
@@ -570,7 +548,8 @@ void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
   write_dict(
       "Materials", mdl.getMaterials(),
       [&](const Material& mat, std::size_t mat_start) {
-        linker.label("Mat" + std::to_string(mat_start), mat_start);
+        const auto mat_label = linker.intern("Mat" + std::to_string(mat_start));
+        linker.label(mat_label, mat_start);
         printf("MAT_START %x\n", (u32)mat_start);
         printf("MAT_NAME %x\n", writer.tell());
         writeNameForward(names, writer, mat_start, mat.getName());
@@ -595,8 +574,8 @@ void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
           writer.write<u8>(mat.indConfig[i].normalMapLightRef);
         for (u8 i = mat.info.nIndStage; i < 4; ++i)
           writer.write<u8>(0xff);
-        linker.writeReloc<s32>("Mat" + std::to_string(mat_start),
-                               get_shader_id(mat.shader));
+        linker.writeReloc<s32>(mat_label,
+                               linker.intern(get_shader_id(mat.shader)));
         writer.write<u32>(mat.samplers.size());
         u32 sampler_offset = 0;
         if (mat.samplers.size()) {
@@ -1056,9 +1035,19 @@ void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
         writer.alignTo(32);
         data.setBufAddr(writer.tell());
         const auto data_start = writer.tell();
-        {
-          for (auto& mp : mesh.mMatrixPrimitives)
-            writeVertexDataDL(mesh, mp, writer);
+        if (auto err = writeVertexDataDL(mesh, writer)) {
+          // The mesh is left empty. Reporting an Error tells the caller the
+          // file is incomplete and must not be saved; without a callback
+          // there is nobody to tell.
+          const auto message = llvm::toString(std::move(err));
+          if (!callback) {
+            printf("Cannot encode vertex data: %s\n", message.c_str());
+            abort();
+          }
+          callback(kpi::IOMessageClass::Error,
+                   "brres/Models/" + mdl.getName() + "/Meshes/" +
+                       mesh.getName(),
+                   "Cannot encode vertex data: " + message);
         }
         data.setCmdSize(writer.tell() - data_start);
         writer.alignTo(32);
@@ -1091,7 +1080,6 @@ void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
       },
       false, 32);
 
-  linker.writeChildren();
   linker.label("MDL0_END");
   linker.resolve();
 } // namespace riistudio::g3d
@@ -1428,40 +1416,52 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
     // Display Lists
     reader.seekSet(start + ofsDisplayLists);
     {
-      libcube::gpu::QDisplayListMaterialHandler matHandler(mat);
+      libcube::gpu::GPUMaterial gpuMat;
+      auto applyDL = [&](u32 size) {
+        const u32 pos = reader.tell();
+        const u32 end = reader.endpos();
+        // Decode what is in the file; missing registers keep their defaults
+        if (pos > end || size > end - pos)
+          reader.warnAt("Material display list extends past the end of the "
+                        "file",
+                        std::min(pos, end), end);
+        const u32 avail = pos < end ? std::min(size, end - pos) : 0;
+        libcube::gpu::ApplyMaterialDisplayList(
+            {reader.getStreamStart() + std::min(pos, end), avail}, gpuMat);
+        reader.skip(size);
+      };
 
       // Pixel data
-      libcube::gpu::RunDisplayList(reader, matHandler, 32);
-      mat.alphaCompare = matHandler.mGpuMat.mPixel.mAlphaCompare;
-      mat.zMode = matHandler.mGpuMat.mPixel.mZMode;
-      mat.blendMode = matHandler.mGpuMat.mPixel.mBlendMode;
+      applyDL(32);
+      mat.alphaCompare = gpuMat.mPixel.mAlphaCompare;
+      mat.zMode = gpuMat.mPixel.mZMode;
+      mat.blendMode = gpuMat.mPixel.mBlendMode;
       // TODO: Dst alpha
 
       // Uniform data
-      libcube::gpu::RunDisplayList(reader, matHandler, 128);
+      applyDL(128);
       mat.tevColors[0] = {0xff, 0xff, 0xff, 0xff};
       mat.tevColors.nElements = 4;
       for (int i = 0; i < 3; ++i) {
-        mat.tevColors[i + 1] = matHandler.mGpuMat.mShaderColor.Registers[i + 1];
+        mat.tevColors[i + 1] = gpuMat.mShaderColor.Registers[i + 1];
       }
       mat.tevKonstColors.nElements = 4;
       for (int i = 0; i < 4; ++i) {
-        mat.tevKonstColors[i] = matHandler.mGpuMat.mShaderColor.Konstants[i];
+        mat.tevKonstColors[i] = gpuMat.mShaderColor.Konstants[i];
       }
 
       // Indirect data
-      libcube::gpu::RunDisplayList(reader, matHandler, 64);
+      applyDL(64);
       for (u8 i = 0; i < mat.info.nIndStage; ++i) {
         const auto& curScale =
-            matHandler.mGpuMat.mIndirect.mIndTexScales[i > 1 ? i - 2 : i];
+            gpuMat.mIndirect.mIndTexScales[i > 1 ? i - 2 : i];
         mat.mIndScales.push_back(
             {static_cast<libcube::gx::IndirectTextureScalePair::Selection>(
                  curScale.ss0),
              static_cast<libcube::gx::IndirectTextureScalePair::Selection>(
                  curScale.ss1)});
 
-        mat.mIndMatrices.push_back(
-            matHandler.mGpuMat.mIndirect.mIndMatrices[i]);
+        mat.mIndMatrices.push_back(gpuMat.mIndirect.mIndMatrices[i]);
       }
 
       const std::array<u32, 9> texGenDlSizes{
@@ -1472,10 +1472,9 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
           128, 128, // 6, 7
           160       // 8
       };
-      libcube::gpu::RunDisplayList(reader, matHandler,
-                                   texGenDlSizes[mat.info.nTexGen]);
+      applyDL(texGenDlSizes[mat.info.nTexGen]);
       for (u8 i = 0; i < mat.info.nTexGen; ++i) {
-        mat.texGens.push_back(matHandler.mGpuMat.mTexture[i]);
+        mat.texGens.push_back(gpuMat.mTexture[i]);
         mat.texMatrices[i]->projection = mat.texGens[i].func;
       }
     }
@@ -1554,34 +1553,24 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
                          libcube::gx::PrimitiveType type, u16 nverts) override {
         if (mPoly.mMatrixPrimitives.empty())
           mPoly.mMatrixPrimitives.push_back(MatrixPrimitive{});
-        auto& prim = mPoly.mMatrixPrimitives.back().mPrimitives.emplace_back(
-            libcube::IndexedPrimitive{});
-        prim.mType = type;
-        prim.mVertices.resize(nverts);
-        for (auto& vert : prim.mVertices) {
-          for (u32 i = 0;
-               i < static_cast<u32>(libcube::gx::VertexAttribute::Max); ++i) {
-            if (mPoly.mVertexDescriptor.mBitfield & (1 << i)) {
-              const auto attr = static_cast<libcube::gx::VertexAttribute>(i);
-              switch (mPoly.mVertexDescriptor.mAttributes[attr]) {
-              case libcube::gx::VertexAttributeType::Direct:
-                throw "TODO";
-                break;
-              case libcube::gx::VertexAttributeType::None:
-                break;
-              case libcube::gx::VertexAttributeType::Byte:
-                vert[attr] = reader.readUnaligned<u8>();
-                break;
-              case libcube::gx::VertexAttributeType::Short:
-                vert[attr] = reader.readUnaligned<u16>();
-                break;
-              }
-            }
-          }
+        auto& mprim = mPoly.mMatrixPrimitives.back();
+        const u32 nbytes = mPlan.mStride * nverts;
+        if (reader.tell() + nbytes > reader.endpos())
+          throw "Invalid mesh display list";
+        mprim.mVertices.addAttributes(mPlan.mBitfield);
+        const auto& prim = mprim.addPrimitive(type, nverts);
+        libcube::DecodeIndexedVertices(reader, mPlan, mprim.vertices(prim));
+      }
+      QDisplayListMeshHandler(Polygon& poly) : mPoly(poly) {
+        auto plan = libcube::CompileVertexDecodePlan(poly.mVertexDescriptor);
+        if (!plan) {
+          llvm::consumeError(plan.takeError());
+          throw "TODO";
         }
+        mPlan = *plan;
       }
-      QDisplayListMeshHandler(Polygon& poly) : mPoly(poly) {}
       Polygon& mPoly;
+      libcube::VertexDecodePlan mPlan;
     } meshHandler(poly);
     primitiveData.seekTo(reader);
     libcube::gpu::RunDisplayList(reader, meshHandler, primitiveData.buf_size);
@@ -2,17 +2,23 @@
 #include <plugins/g3d/collection.hpp>
 #include <plugins/g3d/util/NameTable.hpp>
 
+#include <optional>
+
 namespace riistudio::g3d {
 
 void writeTexture(const Texture& data, oishii::Writer& writer,
-                  NameTable& names) {
+                  NameTable& names, std::optional<u32> shared_data) {
   const auto start = writer.tell();
+  // When sharing, the texture offset points into an earlier TEX0
+  const s32 ofsTex =
+      shared_data.has_value() ? static_cast<s32>(*shared_data - start) : 64;
 
   writer.write<u32>('TEX0');
-  writer.write<u32>(64 + data.getEncodedSize(true));
+  writer.write<u32>(64 +
+                    (shared_data.has_value() ? 0 : data.getEncodedSize(true)));
   writer.write<u32>(3);      // revision
   writer.write<s32>(-start); // brres offset
-  writer.write<s32>(64);     // texture offset
+  writer.write<s32>(ofsTex); // texture offset
   writeNameForward(names, writer, start, data.name);
   writer.write<u32>(0); // flag, ci
   writer.write<u16>(data.dimensions.width);
@@ -24,10 +30,9 @@ void writeTexture(const Texture& data, oishii::Writer& writer,
   writer.write<u32>(0); // src path
   writer.write<u32>(0); // user data
   writer.alignTo(32);   // Assumes already 32b aligned
-  // TODO
-  for (const u8* pData = data.getData();
-       pData < data.getData() + data.getEncodedSize(true); ++pData)
-    writer.write<u8>(*pData);
+  if (shared_data.has_value())
+    return;
+  writer.writeBuffer({data.getData(), data.getEncodedSize(true)});
 }
 void readTexture(Texture& data, oishii::BinaryReader& reader) {
   const auto start = reader.tell();
@@ -51,11 +56,12 @@ void readTexture(Texture& data, oishii::BinaryReader& reader) {
   data.sourcePath = readName(reader, start);
   // Skip user data
   reader.seekSet(start + ofsTex);
-  data.resizeData();
-  assert(reader.tell() + data.getEncodedSize(true) < reader.endpos());
-  memcpy(data.data.data(), reader.getStreamStart() + reader.tell(),
-         data.getEncodedSize(true));
-  reader.skip(data.getEncodedSize(true));
+  const u32 size = data.getEncodedSize(true);
+  // Borrowed from the file until edited
+  if (auto view = reader.shareBuffer(size))
+    data.data.setView(std::move(view), size);
+  else
+    data.data.resize(size); // Truncated file: leave the image blank
 }
 
 } // namespace riistudio::g3d
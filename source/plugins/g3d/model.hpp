@@ -4,6 +4,7 @@
 #include "material.hpp"
 #include "polygon.hpp"
 #include <core/kpi/Node2.hpp>
+#include <core/util/chunked_vector.hpp>
 #include <glm/vec2.hpp> // glm::vec2
 #include <glm/vec3.hpp> // glm::vec3
 #include <plugins/gc/Export/Scene.hpp>
@@ -39,7 +40,12 @@ struct GenericBuffer : public virtual kpi::IObject {
   std::string getName() const { return mName; }
 
   Quantization mQuantize;
-  std::vector<T> mEntries;
+  //! Shares unmodified chunks with history snapshots
+  util::ChunkedVector<T> mEntries;
+
+  template <typename F> void visitShared(F&& visitor) const {
+    mEntries.forEachAllocation(visitor);
+  }
 
   bool operator==(const GenericBuffer& rhs) const {
     return mName == rhs.mName && mId == rhs.mId && mQuantize == rhs.mQuantize &&
@@ -117,7 +123,10 @@ struct G3DModelData : public virtual kpi::IObject {
   std::string mName = "course";
 
   std::string getName() const { return mName; }
-  void setName(const std::string& name) { mName = name; }
+  void setName(const std::string& name) {
+    mName = name;
+    onRenamed();
+  }
 };
 
 } // namespace riistudio::g3d
@@ -151,7 +160,7 @@ inline std::pair<u32, u32> computeVertTriCounts(const Polygon& mesh) {
       const u8 pIdx = static_cast<u8>(prim.mType);
       assert(pIdx < static_cast<u8>(libcube::gx::PrimitiveType::Max));
       const LinEq& pCvtr = triVertCvt[pIdx];
-      const u32 pVCount = prim.mVertices.size();
+      const u32 pVCount = prim.mNumVertices;
 
       if (pVCount == 0)
         continue;
@@ -46,7 +46,10 @@ struct Polygon : public PolygonData,
   virtual const g3d::Model* getParent() const;
   g3d::Model* getMutParent();
   std::string getName() const { return mName; }
-  void setName(const std::string& name) override { mName = name; }
+  void setName(const std::string& name) override {
+    mName = name;
+    onRenamed();
+  }
 
   // Matrix list access
   u64 getMatrixPrimitiveNumIndexedPrimitive(u64 idx) const override {
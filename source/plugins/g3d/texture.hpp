@@ -5,6 +5,7 @@
 
 #include <core/3d/texture_dimensions.hpp>
 #include <core/common.h>
+#include <core/util/cow_buffer.hpp>
 
 #include <plugins/gc/Export/Texture.hpp>
 
@@ -20,7 +21,11 @@ struct TextureData {
   f32 maxLod{1.0f};
 
   std::string sourcePath;
-  std::vector<u8> data;
+  util::CowBuffer data;
+
+  template <typename F> void visitShared(F&& visitor) const {
+    data.forEachAllocation(visitor);
+  }
 
   bool operator==(const TextureData& rhs) const {
     return name == rhs.name && format == rhs.format &&
@@ -32,7 +37,10 @@ struct TextureData {
 
 struct Texture : public TextureData, public libcube::Texture, public virtual kpi::IObject {
   std::string getName() const override { return name; }
-  void setName(const std::string& n) override { name = n; }
+  void setName(const std::string& n) override {
+    name = n;
+    onRenamed();
+  }
   u32 getTextureFormat() const override { return (u32)format; }
   void setTextureFormat(u32 f) override { format = f; }
   u32 getMipmapCount() const override { return mipLevel - 1; }
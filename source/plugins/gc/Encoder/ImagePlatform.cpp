@@ -1,22 +1,49 @@
 #include "ImagePlatform.hpp"
 
 #include "CmprEncoder.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <core/util/thread_pool.hpp>
+#include <mutex>
+#include <optional>
 #include <span>
+#include <utility>
 #include <vendor/avir/avir.h>
 #include <vendor/avir/lancir.h>
 #include <vendor/dolemu/TextureDecoder/TextureDecoder.h>
 #include <vendor/mp/Metaphrasis.h>
 #include <vendor/ogc/texture.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) ||               \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RII_AVIR_SSE
+#include <vendor/avir/avir_float4_sse.h>
+#endif
+
 namespace libcube::image_platform {
 
 std::pair<int, int> getBlockedDimensions(int width, int height,
                                          gx::TextureFormat format) {
   assert(width > 0 && height > 0);
-  const u32 blocksize = format == gx::TextureFormat::RGBA8 ? 64 : 32;
+  int block_width = 4, block_height = 4;
+  switch (format) {
+  case gx::TextureFormat::I4:
+  case gx::TextureFormat::C4:
+  case gx::TextureFormat::CMPR:
+    block_width = block_height = 8;
+    break;
+  case gx::TextureFormat::I8:
+  case gx::TextureFormat::IA4:
+  case gx::TextureFormat::C8:
+    block_width = 8;
+    break;
+  default:
+    break;
+  }
 
-  return {(width + blocksize - 1) & ~(blocksize - 1),
-          (height + blocksize - 1) & ~(blocksize - 1)};
+  return {(width + block_width - 1) & ~(block_width - 1),
+          (height + block_height - 1) & ~(block_height - 1)};
 }
 
 int getEncodedSize(int width, int height, gx::TextureFormat format,
@@ -95,6 +122,157 @@ void reencode(u8* dst, const u8* src, int width, int height,
   encode(dst, tmp.data(), width, height, newFormat);
 }
 
+namespace {
+
+#ifdef RII_AVIR_SSE
+// Process all four channels of a pixel in a single SSE register.
+using AvirResizer = avir::CImageResizer<avir::fpclass_float4>;
+#else
+using AvirResizer = avir::CImageResizer<>;
+#endif
+
+// Below this many pixels, dispatching to the pool costs more than it saves.
+constexpr int ParallelResizeThreshold = 512 * 512;
+
+std::atomic<unsigned> sResizeConcurrency = 0;
+
+//! Shared by every resize() call. Only one call may use it at a time; the
+//! others fall back to single-threaded resizing.
+struct ResizePool {
+  std::mutex mMutex;
+  std::unique_ptr<riistudio::util::ThreadPool> mPool;
+
+  riistudio::util::ThreadPool* acquire(unsigned num_threads) {
+    if (!mMutex.try_lock())
+      return nullptr;
+    if (mPool == nullptr || mPool->size() != num_threads)
+      mPool = std::make_unique<riistudio::util::ThreadPool>(num_threads);
+    return mPool.get();
+  }
+  void release() { mMutex.unlock(); }
+};
+ResizePool sResizePool;
+
+unsigned getResizeThreads() {
+  // ThreadPool would run everything inline anyway
+  if (!riistudio::util::HasThreads)
+    return 1;
+  const unsigned setting = sResizeConcurrency;
+  return setting != 0 ? setting
+                      : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+//! Runs AVIR's scanline workloads on our thread pool.
+class AvirThreadPool : public avir::CImageResizerThreadPool {
+public:
+  explicit AvirThreadPool(riistudio::util::ThreadPool& pool) : mPool(pool) {}
+
+  int getSuggestedWorkloadCount() const override {
+    // Includes the calling thread.
+    return static_cast<int>(mPool.size());
+  }
+  void addWorkload(CWorkload* const workload) override {
+    mWorkloads.push_back(workload);
+  }
+  void startAllWorkloads() override {
+    for (auto* workload : mWorkloads)
+      mPool.enqueue([workload] { workload->process(); });
+  }
+  void waitAllWorkloadsToFinish() override { mPool.wait(); }
+  void removeAllWorkloads() override { mWorkloads.clear(); }
+
+private:
+  riistudio::util::ThreadPool& mPool;
+  std::vector<CWorkload*> mWorkloads;
+};
+
+void resizeAvir(u8* dst, int dx, int dy, const u8* src, int sx, int sy,
+                riistudio::util::ThreadPool* pool) {
+  // Building the filter bank is expensive; resizeImage() is const and safe to
+  // call concurrently.
+  static const AvirResizer resizer(8);
+
+  avir::CImageResizerVars vars;
+  std::optional<AvirThreadPool> avir_pool;
+  if (pool != nullptr) {
+    avir_pool.emplace(*pool);
+    vars.ThreadPool = &*avir_pool;
+  }
+  // TODO: Allow more customization (args, k)
+  resizer.resizeImage(src, sx, sy, 0, dst, dx, dy, 4, 0, &vars);
+}
+
+void resizeLanczos(u8* dst, int dx, int dy, const u8* src, int sx, int sy,
+                   riistudio::util::ThreadPool* pool) {
+  // CLancIR caches its filters and scanline buffers between calls, but is not
+  // thread-safe.
+  thread_local avir::CLancIR lanczos;
+
+  const unsigned num_bands =
+      pool != nullptr ? std::min<unsigned>(pool->size(), dx) : 1;
+  if (num_bands <= 1) {
+    lanczos.resizeImage(src, sx, sy, 0, dst, dx, dy, 4);
+    return;
+  }
+
+  // CLancIR runs a horizontal pass over every source row, then a vertical pass
+  // over every output column. Splitting the output into column bands keeps
+  // both passes proportional to the band width. The scale and offset CLancIR
+  // would have chosen for the whole image are passed explicitly (a negative
+  // scale disables its centering), so each band samples the same positions.
+  double kx, ox = 0.0;
+  if (dx > sx) {
+    kx = static_cast<double>(sx - 1) / (dx - 1);
+  } else {
+    kx = static_cast<double>(sx) / dx;
+    ox = (kx - 1.0) * 0.5;
+  }
+  double ky, oy = 0.0;
+  if (dy > sy) {
+    ky = static_cast<double>(sy - 1) / (dy - 1);
+  } else {
+    ky = static_cast<double>(sy) / dy;
+    oy = (ky - 1.0) * 0.5;
+  }
+
+  // A band computes column x at (ox + x0 * kx) + (x - x0) * kx, which may
+  // round differently from ox + x * kx. CLancIR only uses the integer part and
+  // one of 607 fractional filter phases; where either would change, a new band
+  // starts, since a band's first column is exact.
+  const auto sample = [&](int x0, int x) {
+    const double o = (ox + x0 * kx) + kx * (x - x0);
+    const double ix = std::floor(o);
+    return std::pair(ix, std::floor((o - ix) * 607));
+  };
+  std::vector<int> bounds{0};
+  for (unsigned band = 1; band <= num_bands; ++band) {
+    const int end = dx * band / num_bands;
+    for (int x = bounds.back() + 1; x < end; ++x) {
+      if (sample(bounds.back(), x) != sample(x, x))
+        bounds.push_back(x);
+    }
+    bounds.push_back(end);
+  }
+
+  riistudio::util::parallelFor(*pool, bounds.size() - 1, [&](std::size_t i) {
+    const int x0 = bounds[i];
+    const int width = bounds[i + 1] - x0;
+
+    thread_local std::vector<u8> tmp;
+    tmp.resize(width * dy * 4);
+    lanczos.resizeImage(src, sx, sy, 0, tmp.data(), width, dy, 4, -kx, -ky,
+                        ox + x0 * kx, oy);
+    for (int y = 0; y < dy; ++y)
+      memcpy(dst + (y * dx + x0) * 4, tmp.data() + y * width * 4, width * 4);
+  });
+}
+
+} // namespace
+
+void setResizeConcurrency(unsigned num_threads) {
+  sResizeConcurrency = num_threads;
+}
+
 void resize(u8* dst, int dx, int dy, const u8* src, int sx, int sy,
             ResizingAlgorithm type) {
   bool dstSrcTmp = dst == src;
@@ -113,17 +291,22 @@ void resize(u8* dst, int dx, int dy, const u8* src, int sx, int sy,
     realDst = dst;
     dst = tmp.data();
   }
-  if (type == ResizingAlgorithm::AVIR) {
 
-    avir::CImageResizer<> Avir8BitImageResizer(8);
-    // TODO: Allow more customization (args, k)
-    Avir8BitImageResizer.resizeImage(src, sx, sy, 0, dst, dx, dy, 4, 0);
+  riistudio::util::ThreadPool* pool = nullptr;
+  const unsigned num_threads = getResizeThreads();
+  if (num_threads > 1 && std::max(sx * sy, dx * dy) >= ParallelResizeThreshold)
+    pool = sResizePool.acquire(num_threads);
+
+  if (type == ResizingAlgorithm::AVIR) {
+    resizeAvir(dst, dx, dy, src, sx, sy, pool);
     assert((sx == dx && sy == dy) || memcmp(src, dst, sx * sy * 4));
   } else {
-    avir::CLancIR AvirLanczos;
-    AvirLanczos.resizeImage(src, sx, sy, 0, dst, dx, dy, 4, 0);
+    resizeLanczos(dst, dx, dy, src, sx, sy, pool);
   }
 
+  if (pool != nullptr)
+    sResizePool.release();
+
   if (dstSrcTmp) {
     assert(realDst);
     memcpy(realDst, dst, tmp.size());
@@ -13,10 +13,10 @@ namespace libcube::image_platform {
 //!
 //! @param[in] width  Width of the image.
 //! @param[in] height Height of the image.
-//! @param[in] format Format of the image. All formats except RGBA8 have 32 byte
-//! blocks, the exception being twice that.
+//! @param[in] format Format of the image. Blocks are 8x8 pixels for I4, C4 and
+//! CMPR, 8x4 for I8, IA4 and C8, and 4x4 for every other format.
 //!
-//! @return Dimensions rounded up blocked size.
+//! @return Dimensions rounded up to whole blocks.
 //!
 std::pair<int, int> getBlockedDimensions(int width, int height,
                                          gx::TextureFormat format);
@@ -86,6 +86,14 @@ enum ResizingAlgorithm { AVIR, Lanczos };
 void resize(u8* dst, int dx, int dy, const u8* src, int sx, int sy,
             ResizingAlgorithm type = ResizingAlgorithm::AVIR);
 
+//! @brief Set the number of threads a single large resize may be split across.
+//!
+//! @param[in] num_threads Zero selects the hardware concurrency; one disables
+//! threading, which is preferable when the caller already resizes several
+//! images in parallel.
+//!
+void setResizeConcurrency(unsigned num_threads);
+
 //! @brief Perform a composite transformation on image data, with mipmap
 //! support.
 //!
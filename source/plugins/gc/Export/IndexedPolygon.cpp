@@ -129,27 +129,39 @@ IndexedPolygon::getIndexedPrimitiveFromSuperIndex(u64 idx) const {
 u64 IndexedPolygon::getPrimitiveVertexCount(u64 index) const {
   const IndexedPrimitive* prim = getIndexedPrimitiveFromSuperIndex(index);
   assert(prim);
-  return prim->mVertices.size();
+  return prim->mNumVertices;
 }
 void IndexedPolygon::resizePrimitiveVertexArray(u64 index, u64 size) {
-  IndexedPrimitive* prim = getIndexedPrimitiveFromSuperIndex(index);
-  assert(prim);
-  prim->mVertices.resize(size);
+  for (auto& mp : getMeshData().mMatrixPrimitives) {
+    if (index < mp.mPrimitives.size()) {
+      mp.resizePrimitive(index, size);
+      return;
+    }
+    index -= mp.mPrimitives.size();
+  }
+  assert(!"Invalid primitive index");
 }
 IndexedPolygon::SimpleVertex IndexedPolygon::getPrimitiveVertex(u64 prim_idx,
                                                                 u64 vtx_idx) {
-  const auto& iprim = *getIndexedPrimitiveFromSuperIndex(prim_idx);
-  assert(vtx_idx < iprim.mVertices.size());
-  const auto& vtx = iprim.mVertices[vtx_idx];
+  for (const auto& mp : getMeshData().mMatrixPrimitives) {
+    if (prim_idx >= mp.mPrimitives.size()) {
+      prim_idx -= mp.mPrimitives.size();
+      continue;
+    }
+    const auto vertices = mp.vertices(mp.mPrimitives[prim_idx]);
+    assert(vtx_idx < vertices.size());
+    const auto vtx = vertices[vtx_idx];
 
-  return {(u8)vtx[gx::VertexAttribute::PositionNormalMatrixIndex],
-          getPos(vtx[gx::VertexAttribute::Position])};
+    return {(u8)vtx[gx::VertexAttribute::PositionNormalMatrixIndex],
+            getPos(vtx[gx::VertexAttribute::Position])};
+  }
+  assert(!"Invalid primitive index");
   return {};
 }
 void IndexedPolygon::propogate(VBOBuilder& out) const {
   u32 final_bitfield = 0;
 
-  auto propVtx = [&](const IndexedVertex& vtx) {
+  auto propVtx = [&](IndexedVertexList::ConstRef vtx) {
     const auto& vcd = getVcd();
     out.mIndices.push_back(static_cast<u32>(out.mIndices.size()));
     assert(final_bitfield == 0 || final_bitfield == vcd.mBitfield);
@@ -222,15 +234,16 @@ void IndexedPolygon::propogate(VBOBuilder& out) const {
   for (int i = 0; i < getMeshData().mMatrixPrimitives.size(); ++i) {
     for (int j = 0; j < getMatrixPrimitiveNumIndexedPrimitive(i); ++j) {
       const auto& idx = getMatrixPrimitiveIndexedPrimitive(i, j);
-      auto propV = [&](int id) { propVtx(idx.mVertices[id]); };
-      if (idx.mVertices.empty())
+      const auto vertices = getMeshData().mMatrixPrimitives[i].vertices(idx);
+      auto propV = [&](int id) { propVtx(vertices[id]); };
+      if (vertices.empty())
         goto broken;
       switch (idx.mType) {
       case gx::PrimitiveType::TriangleStrip: {
         for (int v = 0; v < 3; ++v) {
           propV(v);
         }
-        for (int v = 3; v < idx.mVertices.size(); ++v) {
+        for (int v = 3; v < vertices.size(); ++v) {
           propV(v - ((v & 1) ? 1 : 2));
           propV(v - ((v & 1) ? 2 : 1));
           propV(v);
@@ -238,7 +251,7 @@ void IndexedPolygon::propogate(VBOBuilder& out) const {
         break;
       }
       case gx::PrimitiveType::Triangles:
-        for (const auto& v : idx.mVertices) {
+        for (auto v : vertices) {
           propVtx(v);
         }
         break;
@@ -246,7 +259,7 @@ void IndexedPolygon::propogate(VBOBuilder& out) const {
         for (int v = 0; v < 3; ++v) {
           propV(v);
         }
-        for (int v = 3; v < idx.mVertices.size(); ++v) {
+        for (int v = 3; v < vertices.size(); ++v) {
           propV(0);
           propV(v - 1);
           propV(v);
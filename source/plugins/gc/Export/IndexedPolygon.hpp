@@ -8,28 +8,25 @@
 #include "VertexDescriptor.hpp"
 
 namespace libcube {
-struct MatrixPrimitive {
-  // Part of the polygon in G3D
-  // Not the most robust solution, but currently each expoerter will pick which
-  // of the data to use
-  s16 mCurrentMatrix = -1;
-
-  std::vector<s16> mDrawMatrixIndices;
-
-  std::vector<libcube::IndexedPrimitive> mPrimitives;
-
-  MatrixPrimitive() = default;
-  MatrixPrimitive(s16 current_matrix, std::vector<s16> drawMatrixIndices)
-      : mCurrentMatrix(current_matrix), mDrawMatrixIndices(drawMatrixIndices) {}
-  bool operator==(const MatrixPrimitive& rhs) const {
-    return mCurrentMatrix == rhs.mCurrentMatrix &&
-           mDrawMatrixIndices == rhs.mDrawMatrixIndices &&
-           mPrimitives == rhs.mPrimitives;
-  }
-};
 struct MeshData {
   std::vector<MatrixPrimitive> mMatrixPrimitives;
   libcube::VertexDescriptor mVertexDescriptor;
+
+  //! Heap memory owned by the primitives, in bytes. Vertex chunks, which are
+  //! shared with copies, are reported by `visitShared`.
+  std::size_t retainedSize() const {
+    std::size_t size = mMatrixPrimitives.capacity() * sizeof(MatrixPrimitive);
+    for (const auto& mp : mMatrixPrimitives) {
+      size += mp.mDrawMatrixIndices.capacity() * sizeof(s16);
+      size += mp.mPrimitives.capacity() * sizeof(IndexedPrimitive);
+      size += mp.mVertices.retainedSize();
+    }
+    return size;
+  }
+  template <typename F> void visitShared(F&& visitor) const {
+    for (const auto& mp : mMatrixPrimitives)
+      mp.mVertices.forEachAllocation(visitor);
+  }
 };
 
 struct IndexedPolygon : public riistudio::lib3d::Polygon {
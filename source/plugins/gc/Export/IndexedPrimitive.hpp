@@ -2,21 +2,92 @@
 
 #include <core/common.h>
 #include <plugins/gc/GX/VertexTypes.hpp>
+
 #include <vector>
 
-#include "IndexedVertex.hpp"
+#include "IndexedVertexList.hpp"
 
 namespace libcube {
 
+//! @brief A draw command over a range of the vertices of its MatrixPrimitive.
 struct IndexedPrimitive {
   gx::PrimitiveType mType;
-  std::vector<IndexedVertex> mVertices;
+  //! First vertex in MatrixPrimitive::mVertices.
+  u32 mFirstVertex = 0;
+  u32 mNumVertices = 0;
 
   IndexedPrimitive() = default;
-  IndexedPrimitive(gx::PrimitiveType type, u64 size)
-      : mType(type), mVertices(size) {}
-  bool operator==(const IndexedPrimitive& rhs) const {
-    return mType == rhs.mType && mVertices == rhs.mVertices;
+  IndexedPrimitive(gx::PrimitiveType type, u32 first, u32 size)
+      : mType(type), mFirstVertex(first), mNumVertices(size) {}
+  bool operator==(const IndexedPrimitive& rhs) const = default;
+};
+
+struct MatrixPrimitive {
+  // Part of the polygon in G3D
+  // Not the most robust solution, but currently each expoerter will pick which
+  // of the data to use
+  s16 mCurrentMatrix = -1;
+
+  std::vector<s16> mDrawMatrixIndices;
+
+  std::vector<libcube::IndexedPrimitive> mPrimitives;
+  //! Vertices of every primitive, back to back. Primitives refer to them by
+  //! offset, so all share one set of index streams.
+  IndexedVertexList mVertices;
+
+  MatrixPrimitive() = default;
+  MatrixPrimitive(s16 current_matrix, std::vector<s16> drawMatrixIndices)
+      : mCurrentMatrix(current_matrix), mDrawMatrixIndices(drawMatrixIndices) {}
+  bool operator==(const MatrixPrimitive& rhs) const {
+    return mCurrentMatrix == rhs.mCurrentMatrix &&
+           mDrawMatrixIndices == rhs.mDrawMatrixIndices &&
+           mPrimitives == rhs.mPrimitives && mVertices == rhs.mVertices;
+  }
+
+  MutIndexedVertexRange vertices(const IndexedPrimitive& prim) {
+    return {mVertices, prim.mFirstVertex, prim.mNumVertices};
+  }
+  ConstIndexedVertexRange vertices(const IndexedPrimitive& prim) const {
+    return {mVertices, prim.mFirstVertex, prim.mNumVertices};
+  }
+
+  //! Append a primitive of `size` zeroed vertices.
+  IndexedPrimitive& addPrimitive(gx::PrimitiveType type, u32 size = 0) {
+    const u32 first = static_cast<u32>(mVertices.size());
+    mVertices.resize(first + size);
+    return mPrimitives.emplace_back(type, first, size);
+  }
+  //! Append a primitive holding `vertices`.
+  IndexedPrimitive& addPrimitive(gx::PrimitiveType type,
+                                 std::span<const IndexedVertex> vertices) {
+    auto& prim = addPrimitive(type);
+    mVertices.reserve(mVertices.size() + vertices.size());
+    for (const auto& vtx : vertices)
+      pushVertex(vtx);
+    return prim;
+  }
+  //! Append a vertex to the last primitive.
+  void pushVertex(const IndexedVertex& vtx) {
+    assert(!mPrimitives.empty());
+    assert(mPrimitives.back().mFirstVertex +
+               mPrimitives.back().mNumVertices ==
+           mVertices.size());
+    mVertices.push_back(vtx);
+    ++mPrimitives.back().mNumVertices;
+  }
+  //! Resize a primitive, moving the vertices of the primitives after it. New
+  //! vertices are zeroed.
+  void resizePrimitive(std::size_t index, u32 size) {
+    auto& prim = mPrimitives[index];
+    const u32 end = prim.mFirstVertex + std::min(prim.mNumVertices, size);
+    if (size > prim.mNumVertices)
+      mVertices.insert(end, size - prim.mNumVertices);
+    else
+      mVertices.erase(end, prim.mNumVertices - size);
+    const s64 delta = static_cast<s64>(size) - prim.mNumVertices;
+    prim.mNumVertices = size;
+    for (std::size_t i = index + 1; i < mPrimitives.size(); ++i)
+      mPrimitives[i].mFirstVertex += delta;
   }
 };
 
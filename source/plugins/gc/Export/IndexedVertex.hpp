@@ -7,21 +7,58 @@
 
 namespace libcube {
 
+//! @brief A single vertex with a slot for every attribute.
+//!
+//! Used to build vertices. Primitives store them in an IndexedVertexList,
+//! which only keeps the attributes that were assigned.
+//!
 struct IndexedVertex {
+  //! Assignable reference to one index of a vertex. Assigning through it
+  //! marks the attribute as assigned; reading through it does not.
+  class IndexRef {
+  public:
+    IndexRef(IndexedVertex& vtx, gx::VertexAttribute attr)
+        : mVertex(&vtx), mAttr(attr) {}
+    IndexRef(const IndexRef&) = default;
+
+    operator u16() const { return mVertex->get(mAttr); }
+    //! Assigns the referenced index, not the reference.
+    const IndexRef& operator=(u16 value) const {
+      mVertex->set(mAttr, value);
+      return *this;
+    }
+    const IndexRef& operator=(const IndexRef& rhs) const {
+      return *this = static_cast<u16>(rhs);
+    }
+
+  private:
+    IndexedVertex* mVertex;
+    gx::VertexAttribute mAttr;
+  };
+
   inline const u16& operator[](gx::VertexAttribute attr) const {
     assert((u64)attr < (u64)gx::VertexAttribute::Max);
     return indices[(u64)attr];
   }
-  inline u16& operator[](gx::VertexAttribute attr) {
+  inline IndexRef operator[](gx::VertexAttribute attr) { return {*this, attr}; }
+
+  u16 get(gx::VertexAttribute attr) const { return (*this)[attr]; }
+  void set(gx::VertexAttribute attr, u16 value) {
     assert((u64)attr < (u64)gx::VertexAttribute::Max);
-    return indices[(u64)attr];
+    mAssigned |= 1 << (u64)attr;
+    indices[(u64)attr] = value;
   }
   bool operator==(const IndexedVertex& rhs) const {
     return indices == rhs.indices;
   }
 
+  //! Bitfield of attributes assigned, in the format of
+  //! VertexDescriptor::mBitfield.
+  u32 getAssigned() const { return mAssigned; }
+
 private:
-  std::array<u16, (u64)gx::VertexAttribute::Max> indices;
+  std::array<u16, (u64)gx::VertexAttribute::Max> indices{};
+  u32 mAssigned = 0;
 };
 
 } // namespace libcube
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <core/common.h>
+#include <core/util/chunked_vector.hpp>
+#include <plugins/gc/GX/VertexTypes.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "IndexedVertex.hpp"
+
+namespace libcube {
+
+//! @brief Vertices of the primitives of a MatrixPrimitive, stored as one
+//! index stream per attribute.
+//!
+//! Only attributes that were assigned are stored: a mesh with a position, a
+//! normal and a single UV costs 6 bytes per vertex. Elements are accessed
+//! through lightweight references, so `list[i][attr]` works as it does for an
+//! array of IndexedVertex. Reading an attribute that is not stored yields 0;
+//! only assigning to one adds its stream.
+//!
+//! Streams are chunked and shared with copies of the list until written to,
+//! so a history snapshot of a mesh only duplicates the chunks an edit touches.
+//! Runs of vertices within a chunk are contiguous; see `forEachRun`.
+//!
+class IndexedVertexList {
+  static constexpr u32 NumAttributes = (u32)gx::VertexAttribute::Max;
+  using Stream = riistudio::util::ChunkedVector<u16>;
+
+public:
+  //! Vertices per chunk of every stream.
+  static constexpr std::size_t ChunkVertices = Stream::ChunkSize;
+
+  //! Read-only reference to a vertex.
+  class ConstRef {
+  public:
+    ConstRef(const IndexedVertexList& list, std::size_t index)
+        : mList(&list), mIndex(index) {}
+
+    u16 operator[](gx::VertexAttribute attr) const { return get(attr); }
+    u16 get(gx::VertexAttribute attr) const { return mList->get(mIndex, attr); }
+    operator IndexedVertex() const { return mList->getVertex(mIndex); }
+
+  private:
+    const IndexedVertexList* mList;
+    std::size_t mIndex;
+  };
+
+  //! Assignable reference to one index of a vertex. Assigning through it adds
+  //! the attribute to the list if absent; reading through it does not.
+  class IndexRef {
+  public:
+    IndexRef(IndexedVertexList& list, std::size_t index,
+             gx::VertexAttribute attr)
+        : mList(&list), mIndex(index), mAttr(attr) {}
+    IndexRef(const IndexRef&) = default;
+
+    operator u16() const { return mList->get(mIndex, mAttr); }
+    //! Assigns the referenced index, not the reference.
+    const IndexRef& operator=(u16 value) const {
+      mList->set(mIndex, mAttr, value);
+      return *this;
+    }
+    const IndexRef& operator=(const IndexRef& rhs) const {
+      return *this = static_cast<u16>(rhs);
+    }
+
+  private:
+    IndexedVertexList* mList;
+    std::size_t mIndex;
+    gx::VertexAttribute mAttr;
+  };
+
+  //! Mutable reference to a vertex.
+  class Ref {
+  public:
+    Ref(IndexedVertexList& list, std::size_t index)
+        : mList(&list), mIndex(index) {}
+    Ref(const Ref&) = default;
+
+    IndexRef operator[](gx::VertexAttribute attr) const {
+      return {*mList, mIndex, attr};
+    }
+    u16 get(gx::VertexAttribute attr) const { return mList->get(mIndex, attr); }
+    //! Adds the attribute to the list if absent.
+    void set(gx::VertexAttribute attr, u16 value) const {
+      mList->set(mIndex, attr, value);
+    }
+    //! Assigns the referenced vertex, not the reference.
+    const Ref& operator=(const IndexedVertex& vtx) const {
+      mList->setVertex(mIndex, vtx);
+      return *this;
+    }
+    const Ref& operator=(const Ref& rhs) const {
+      return *this = static_cast<IndexedVertex>(rhs);
+    }
+    operator ConstRef() const { return {*mList, mIndex}; }
+    operator IndexedVertex() const { return mList->getVertex(mIndex); }
+
+  private:
+    IndexedVertexList* mList;
+    std::size_t mIndex;
+  };
+
+  template <typename ListT, typename RefT> class Iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = IndexedVertex;
+    using difference_type = std::ptrdiff_t;
+    using reference = RefT;
+    using pointer = void;
+
+    Iterator() = default;
+    Iterator(ListT* list, std::size_t index) : mList(list), mIndex(index) {}
+
+    RefT operator*() const { return {*mList, mIndex}; }
+    RefT operator[](difference_type n) const { return {*mList, mIndex + n}; }
+
+    Iterator& operator++() {
+      ++mIndex;
+      return *this;
+    }
+    Iterator operator++(int) { return {mList, mIndex++}; }
+    Iterator& operator--() {
+      --mIndex;
+      return *this;
+    }
+    Iterator operator--(int) { return {mList, mIndex--}; }
+    Iterator& operator+=(difference_type n) {
+      mIndex += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      mIndex -= n;
+      return *this;
+    }
+    Iterator operator+(difference_type n) const { return {mList, mIndex + n}; }
+    Iterator operator-(difference_type n) const { return {mList, mIndex - n}; }
+    difference_type operator-(const Iterator& rhs) const {
+      return static_cast<difference_type>(mIndex) -
+             static_cast<difference_type>(rhs.mIndex);
+    }
+    bool operator==(const Iterator& rhs) const { return mIndex == rhs.mIndex; }
+    auto operator<=>(const Iterator& rhs) const {
+      return mIndex <=> rhs.mIndex;
+    }
+
+  private:
+    ListT* mList = nullptr;
+    std::size_t mIndex = 0;
+  };
+
+  using value_type = IndexedVertex;
+  using iterator = Iterator<IndexedVertexList, Ref>;
+  using const_iterator = Iterator<const IndexedVertexList, ConstRef>;
+
+  IndexedVertexList() = default;
+  //! @param[in] attributes Attributes to store, in the format of
+  //!                       VertexDescriptor::mBitfield.
+  explicit IndexedVertexList(std::size_t size, u32 attributes = 0) {
+    setAttributes(attributes);
+    resize(size);
+  }
+  IndexedVertexList(const std::vector<IndexedVertex>& vertices) {
+    u32 attributes = 0;
+    for (const auto& vtx : vertices)
+      attributes |= vtx.getAssigned();
+    setAttributes(attributes);
+    resize(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+      setVertex(i, vertices[i]);
+  }
+
+  std::size_t size() const { return mSize; }
+  bool empty() const { return mSize == 0; }
+  //! Bytes allocated for the list of streams. The chunks, which may be
+  //! shared with copies, are reported by `forEachAllocation`.
+  std::size_t retainedSize() const {
+    return mStreams.capacity() * sizeof(Stream);
+  }
+  //! Invoke `fn(const void* chunk, std::size_t bytes)` for every chunk, for
+  //! memory accounting of chunks shared between copies.
+  template <typename F> void forEachAllocation(F&& fn) const {
+    for (const auto& stream : mStreams)
+      stream.forEachAllocation(fn);
+  }
+  void clear() { resize(0); }
+  void reserve(std::size_t capacity) {
+    for (auto& stream : mStreams)
+      stream.reserve(capacity);
+  }
+  //! New vertices are zeroed.
+  void resize(std::size_t size) {
+    for (auto& stream : mStreams)
+      stream.resize(size);
+    mSize = size;
+  }
+  void push_back(const IndexedVertex& vtx) {
+    addAttributes(vtx.getAssigned());
+    resize(mSize + 1);
+    setVertex(mSize - 1, vtx);
+  }
+  //! Insert `count` zeroed vertices before `pos`.
+  void insert(std::size_t pos, std::size_t count) {
+    assert(pos <= mSize);
+    for (auto& stream : mStreams) {
+      stream.resize(mSize + count);
+      std::move_backward(stream.begin() + pos, stream.begin() + mSize,
+                         stream.end());
+      std::fill_n(stream.begin() + pos, count, 0);
+    }
+    mSize += count;
+  }
+  //! Remove `count` vertices starting at `pos`.
+  void erase(std::size_t pos, std::size_t count) {
+    assert(pos + count <= mSize);
+    for (auto& stream : mStreams) {
+      std::move(stream.begin() + pos + count, stream.end(),
+                stream.begin() + pos);
+      stream.resize(mSize - count);
+    }
+    mSize -= count;
+  }
+
+  Ref operator[](std::size_t index) {
+    assert(index < mSize);
+    return {*this, index};
+  }
+  ConstRef operator[](std::size_t index) const {
+    assert(index < mSize);
+    return {*this, index};
+  }
+
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, mSize}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, mSize}; }
+
+  //! Bitfield of stored attributes, in the format of
+  //! VertexDescriptor::mBitfield.
+  u32 getAttributes() const { return mAttributes; }
+  bool hasAttribute(gx::VertexAttribute attr) const {
+    return mAttributes & (1 << (u32)attr);
+  }
+  //! Store exactly these attributes. New attributes are zero-initialized.
+  void setAttributes(u32 attributes) {
+    if (attributes == mAttributes)
+      return;
+    std::vector<Stream> streams;
+    streams.reserve(std::popcount(attributes));
+    for (u32 a = 0; a < NumAttributes; ++a) {
+      if (!(attributes & (1 << a)))
+        continue;
+      const auto attr = static_cast<gx::VertexAttribute>(a);
+      if (hasAttribute(attr))
+        streams.push_back(std::move(mStreams[slotOf(attr)]));
+      else
+        streams.emplace_back(mSize);
+    }
+    mStreams = std::move(streams);
+    mAttributes = attributes;
+  }
+  void addAttributes(u32 attributes) {
+    setAttributes(mAttributes | attributes);
+  }
+
+  //! Invoke `fn(std::size_t first, std::size_t count)` for consecutive runs
+  //! of the `count` vertices from `first`. Each run is contiguous in every
+  //! stream.
+  template <typename F>
+  static void forEachRun(std::size_t first, std::size_t count, F&& fn) {
+    const std::size_t end = first + count;
+    while (first < end) {
+      const std::size_t run =
+          std::min(end, (first / ChunkVertices + 1) * ChunkVertices) - first;
+      fn(first, run);
+      first += run;
+    }
+  }
+  //! The indices of an attribute for a run of vertices from `forEachRun`.
+  //! Empty if not stored.
+  std::span<const u16> getStream(gx::VertexAttribute attr, std::size_t first,
+                                 std::size_t count) const {
+    if (!hasAttribute(attr) || count == 0)
+      return {};
+    return mStreams[slotOf(attr)].segment(first).first(count);
+  }
+  //! @pre The attribute is stored.
+  std::span<u16> getStream(gx::VertexAttribute attr, std::size_t first,
+                           std::size_t count) {
+    assert(hasAttribute(attr));
+    if (count == 0)
+      return {};
+    return mStreams[slotOf(attr)].segment(first).first(count);
+  }
+
+  u16 get(std::size_t index, gx::VertexAttribute attr) const {
+    assert((u32)attr < NumAttributes);
+    return hasAttribute(attr) ? std::as_const(mStreams[slotOf(attr)])[index]
+                              : 0;
+  }
+  //! Adds the attribute to the list if absent.
+  void set(std::size_t index, gx::VertexAttribute attr, u16 value) {
+    assert((u32)attr < NumAttributes);
+    addAttributes(1 << (u32)attr);
+    mStreams[slotOf(attr)][index] = value;
+  }
+  IndexedVertex getVertex(std::size_t index) const {
+    IndexedVertex vtx;
+    for (u32 a = 0; a < NumAttributes; ++a) {
+      const auto attr = static_cast<gx::VertexAttribute>(a);
+      if (hasAttribute(attr))
+        vtx.set(attr, get(index, attr));
+    }
+    return vtx;
+  }
+  void setVertex(std::size_t index, const IndexedVertex& vtx) {
+    addAttributes(vtx.getAssigned());
+    for (u32 a = 0; a < NumAttributes; ++a) {
+      const auto attr = static_cast<gx::VertexAttribute>(a);
+      if (hasAttribute(attr))
+        mStreams[slotOf(attr)][index] = vtx[attr];
+    }
+  }
+
+  bool operator==(const IndexedVertexList& rhs) const {
+    if (mSize != rhs.mSize)
+      return false;
+    const u32 attributes = mAttributes | rhs.mAttributes;
+    for (u32 a = 0; a < NumAttributes; ++a) {
+      const auto attr = static_cast<gx::VertexAttribute>(a);
+      if (!(attributes & (1 << a)))
+        continue;
+      if (hasAttribute(attr) && rhs.hasAttribute(attr)) {
+        // Skips chunks the lists share
+        if (!(mStreams[slotOf(attr)] == rhs.mStreams[rhs.slotOf(attr)]))
+          return false;
+        continue;
+      }
+      for (std::size_t i = 0; i < mSize; ++i)
+        if (get(i, attr) != rhs.get(i, attr))
+          return false;
+    }
+    return true;
+  }
+
+private:
+  u32 slotOf(gx::VertexAttribute attr) const {
+    return std::popcount(mAttributes & ((1u << (u32)attr) - 1));
+  }
+
+  //! One per stored attribute, in attribute order
+  std::vector<Stream> mStreams;
+  u32 mAttributes = 0;
+  std::size_t mSize = 0;
+};
+
+//! @brief A range of the vertices of an IndexedVertexList, such as those of
+//! one primitive. Indices are relative to the start of the range.
+//!
+//! The range refers to the list, not to its storage, so it stays valid while
+//! vertices outside of it are added.
+//!
+template <typename ListT> class IndexedVertexRange {
+  static constexpr bool IsConst = std::is_const_v<ListT>;
+
+public:
+  using reference = std::conditional_t<IsConst, IndexedVertexList::ConstRef,
+                                       IndexedVertexList::Ref>;
+  using iterator = IndexedVertexList::Iterator<ListT, reference>;
+  using value_type = IndexedVertex;
+
+  IndexedVertexRange(ListT& list, std::size_t first, std::size_t size)
+      : mList(&list), mFirst(first), mSize(size) {
+    assert(first + size <= list.size());
+  }
+  operator IndexedVertexRange<const IndexedVertexList>() const {
+    return {*mList, mFirst, mSize};
+  }
+
+  std::size_t size() const { return mSize; }
+  bool empty() const { return mSize == 0; }
+
+  reference operator[](std::size_t index) const {
+    assert(index < mSize);
+    return {*mList, mFirst + index};
+  }
+  iterator begin() const { return {mList, mFirst}; }
+  iterator end() const { return {mList, mFirst + mSize}; }
+
+  //! Bitfield of stored attributes, shared with the rest of the list.
+  u32 getAttributes() const { return mList->getAttributes(); }
+  bool hasAttribute(gx::VertexAttribute attr) const {
+    return mList->hasAttribute(attr);
+  }
+  //! Invoke `fn(std::size_t offset, std::size_t count)` for consecutive runs
+  //! of the range, each contiguous in storage. `offset` is relative to the
+  //! start of the range.
+  template <typename F> void forEachRun(F&& fn) const {
+    IndexedVertexList::forEachRun(
+        mFirst, mSize,
+        [&](std::size_t first, std::size_t count) { fn(first - mFirst, count); });
+  }
+  //! The indices of an attribute for a run from `forEachRun`. Empty if not
+  //! stored; when mutable, the attribute must be stored.
+  auto getStream(gx::VertexAttribute attr, std::size_t offset,
+                 std::size_t count) const {
+    return mList->getStream(attr, mFirst + offset, count);
+  }
+
+private:
+  ListT* mList;
+  std::size_t mFirst;
+  std::size_t mSize;
+};
+
+using MutIndexedVertexRange = IndexedVertexRange<IndexedVertexList>;
+using ConstIndexedVertexRange = IndexedVertexRange<const IndexedVertexList>;
+
+} // namespace libcube
@@ -289,6 +289,7 @@ struct IGCMaterial : public riistudio::lib3d::Material {
   std::string getName() const override { return getMaterialData().name; }
   void setName(const std::string& name) override {
     getMaterialData().name = name;
+    onRenamed();
   }
 
   void setMegaState(MegaState& state) const override;
@@ -16,6 +16,26 @@ struct Texture : public riistudio::lib3d::Texture {
                             mip && getMipmapCount() > 0,
                             mip ? getMipmapCount() + 1 : 0);
   }
+  //! @brief Compute the offset of a level of detail in the encoded data.
+  //!
+  //! @param[in] level The LOD to find the offset for. Zero is the base image.
+  //!
+  inline u32 getEncodedLevelOffset(u32 level) const {
+    u32 ofs = 0;
+    for (u32 i = 0; i < level; ++i)
+      ofs += GetTexBufferSize(getWidth() >> i, getHeight() >> i,
+                              getTextureFormat(), 0, 1);
+    return ofs;
+  }
+  inline void decodeLevel(u32 level, std::span<u8> out) const override {
+    assert(level <= getMipmapCount());
+    assert(out.size() >= getDecodedLevelSize(level));
+
+    TexDecoder_Decode(out.data(), getData() + getEncodedLevelOffset(level),
+                      getWidth() >> level, getHeight() >> level,
+                      (TextureFormat)getTextureFormat(), getPaletteData(),
+                      (TLUTFormat)getPaletteFormat());
+  }
   inline void decode(std::vector<u8>& out, bool mip) const override {
     const u32 size = getDecodedSize(mip);
     assert(size);
@@ -23,30 +43,11 @@ struct Texture : public riistudio::lib3d::Texture {
     if (out.size() < size) {
       out.resize(size);
     }
-    auto decodeSingle = [&](u32 out_ofs, u32 in_ofs, u32 lod) {
-      // const auto thisPlaneSize = GetTexBufferSize(
-      //     getWidth() >> lod, getHeight() >> lod, getTextureFormat(), false,
-      //     1);
-
-      TexDecoder_Decode(out.data() + out_ofs, getData() + in_ofs,
-                        getWidth() >> lod, getHeight() >> lod,
-                        (TextureFormat)getTextureFormat(), getPaletteData(),
-                        (TLUTFormat)getPaletteFormat());
-    };
-    decodeSingle(0, 0, 0);
-    if (mip && getMipmapCount() > 0) {
-
-      u32 i_ofs = 0;
-      u32 o_ofs = 0;
-      u32 w = getWidth();
-      u32 h = getHeight();
-      for (u32 i = 0; i < getMipmapCount(); ++i) {
-        i_ofs += GetTexBufferSize(w, h, getTextureFormat(), 0, 1);
-        o_ofs += w * h * 4;
-        decodeSingle(o_ofs, i_ofs, i + 1);
-        w >>= 1;
-        h >>= 1;
-      }
+    const u32 num_levels = mip ? getMipmapCount() + 1 : 1;
+    for (u32 i = 0; i < num_levels; ++i) {
+      const u32 out_ofs =
+          image_platform::getMipOffset(getWidth(), getHeight(), i);
+      decodeLevel(i, std::span<u8>(out).subspan(out_ofs));
     }
   }
 
@@ -1,22 +1,219 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bit>
 #include <core/common.h>
-#include <map>
+#include <functional>
+#include <iterator>
 #include <plugins/gc/GX/VertexTypes.hpp>
+#include <utility>
 
 namespace libcube {
 
+//! @brief Fixed-size table of attribute types, indexed by attribute.
+//!
+//! Offers the subset of the std::map interface used throughout the codebase.
+//! Like a map, it remembers which attributes were inserted (even if set to
+//! None); iteration visits those in ascending attribute order.
+//!
+//! Every change gives the array a new stamp, which lets descriptors cache
+//! values derived from it. Entries are only changed through `operator[]`,
+//! `erase` and `clear`; iteration and lookup are read-only.
+//!
+class VertexAttributeArray {
+  static constexpr u32 NumAttributes = (u32)gx::VertexAttribute::Max;
+
+public:
+  //! `first` must not be modified.
+  using value_type = std::pair<gx::VertexAttribute, gx::VertexAttributeType>;
+
+  template <typename ArrayT, typename ValueT> class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = VertexAttributeArray::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = ValueT&;
+    using pointer = ValueT*;
+
+    Iterator() = default;
+    Iterator(ArrayT* array, u32 index) : mArray(array), mIndex(index) {
+      skipAbsent();
+    }
+
+    reference operator*() const { return mArray->mEntries[mIndex]; }
+    pointer operator->() const { return &mArray->mEntries[mIndex]; }
+    Iterator& operator++() {
+      ++mIndex;
+      skipAbsent();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    bool operator==(const Iterator& rhs) const { return mIndex == rhs.mIndex; }
+
+  private:
+    void skipAbsent() {
+      while (mIndex < NumAttributes && !(mArray->mPresent & (1 << mIndex)))
+        ++mIndex;
+    }
+
+    ArrayT* mArray = nullptr;
+    u32 mIndex = NumAttributes;
+  };
+  using const_iterator =
+      Iterator<const VertexAttributeArray, const value_type>;
+  using iterator = const_iterator;
+
+  //! Assignable reference to an entry's type, which stamps the array when
+  //! assigned
+  class TypeRef {
+  public:
+    TypeRef(VertexAttributeArray& array, gx::VertexAttribute attr)
+        : mArray(array), mAttr(attr) {}
+
+    operator gx::VertexAttributeType() const { return mArray.at(mAttr); }
+    TypeRef& operator=(gx::VertexAttributeType type) {
+      auto& entry = mArray.mEntries[(u32)mAttr].second;
+      if (entry != type) {
+        entry = type;
+        mArray.touch();
+      }
+      return *this;
+    }
+    TypeRef& operator=(const TypeRef& rhs) {
+      return *this = static_cast<gx::VertexAttributeType>(rhs);
+    }
+
+  private:
+    VertexAttributeArray& mArray;
+    gx::VertexAttribute mAttr;
+  };
+
+  VertexAttributeArray() {
+    for (u32 i = 0; i < NumAttributes; ++i)
+      mEntries[i] = {static_cast<gx::VertexAttribute>(i),
+                     gx::VertexAttributeType::None};
+  }
+
+  //! Inserts the attribute (as None) if absent.
+  TypeRef operator[](gx::VertexAttribute attr) {
+    assert((u32)attr < NumAttributes);
+    if (!contains(attr)) {
+      mPresent |= 1 << (u32)attr;
+      touch();
+    }
+    return {*this, attr};
+  }
+  //! Unlike std::map::at, yields None rather than throwing for absent keys.
+  const gx::VertexAttributeType& at(gx::VertexAttribute attr) const {
+    assert((u32)attr < NumAttributes);
+    return mEntries[(u32)attr].second;
+  }
+
+  const_iterator find(gx::VertexAttribute attr) const {
+    return contains(attr) ? const_iterator(this, (u32)attr) : end();
+  }
+  bool contains(gx::VertexAttribute attr) const {
+    return (u32)attr < NumAttributes && (mPresent & (1 << (u32)attr));
+  }
+  std::size_t count(gx::VertexAttribute attr) const { return contains(attr); }
+  void erase(gx::VertexAttribute attr) {
+    assert((u32)attr < NumAttributes);
+    touch();
+    mPresent &= ~(1 << (u32)attr);
+    mEntries[(u32)attr].second = gx::VertexAttributeType::None;
+  }
+  void clear() { *this = {}; }
+
+  std::size_t size() const { return std::popcount(mPresent); }
+  bool empty() const { return mPresent == 0; }
+
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, NumAttributes}; }
+
+  bool operator==(const VertexAttributeArray& rhs) const {
+    return mPresent == rhs.mPresent && mEntries == rhs.mEntries;
+  }
+
+  //! Identifies the contents: arrays with the same stamp hold the same
+  //! entries. Unique across all arrays, so copies cannot be confused.
+  u64 stamp() const { return mStamp; }
+
+private:
+  void touch() {
+    static std::atomic<u64> sNextStamp = 1;
+    mStamp = sNextStamp.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::array<value_type, NumAttributes> mEntries;
+  //! Bitfield of inserted attributes
+  u32 mPresent = 0;
+  //! 0 for default-constructed contents
+  u64 mStamp = 0;
+};
+
+//! @brief Byte layout of a single vertex in a mesh display list.
+//!
+struct VertexLayout {
+  static constexpr u32 NumAttributes = (u32)gx::VertexAttribute::Max;
+
+  struct Attribute {
+    gx::VertexAttribute attr;
+    u8 size; //!< 1 or 2 bytes
+  };
+  //! Enabled attributes, in stream order
+  std::array<Attribute, NumAttributes> mAttributes;
+  u32 mNumAttributes = 0;
+  //! Size of a vertex in bytes
+  u32 mStride = 0;
+  //! Enabled attributes, in the format of VertexDescriptor::mBitfield
+  u32 mBitfield = 0;
+  //! Offset of each attribute's index within a vertex, enabled or not.
+  //! The last entry is the stride.
+  std::array<u8, NumAttributes + 1> mOffsets{};
+
+  enum class Status {
+    Ok,
+    DirectData,  //!< Direct data other than matrix indices (unsupported)
+    UnknownType, //!< Invalid attribute type
+  };
+  Status mStatus = Status::Ok;
+};
+
 struct VertexDescriptor {
-  std::map<gx::VertexAttribute, gx::VertexAttributeType> mAttributes;
-  u32 mBitfield; // values of VertexDescriptor
+  VertexAttributeArray mAttributes;
+  u32 mBitfield = 0; // values of VertexDescriptor
+
+  //! Number of enabled attributes.
+  u64 getVcdSize() const { return std::popcount(mBitfield); }
 
-  u64 getVcdSize() const {
-    u64 vcd_size = 0;
-    for (s64 i = 0; i < (s64)gx::VertexAttribute::Max; ++i)
-      if (mBitfield & (1 << 1))
-        ++vcd_size;
-    return vcd_size;
+  //! Size of an attribute's index in a display list, in bytes. Direct data is
+  //! only supported for matrix indices, which are a single byte.
+  u32 getAttributeSize(gx::VertexAttribute attr) const {
+    assert((u32)attr < (u32)gx::VertexAttribute::Max);
+    const auto& offsets = getLayout().mOffsets;
+    return offsets[(u32)attr + 1] - offsets[(u32)attr];
   }
+  //! Offset of an attribute's index within a display list vertex.
+  u32 getAttributeOffset(gx::VertexAttribute attr) const {
+    assert((u32)attr <= (u32)gx::VertexAttribute::Max);
+    return getLayout().mOffsets[(u32)attr];
+  }
+  //! Size of a display list vertex, in bytes.
+  u32 getVertexSize() const { return getLayout().mStride; }
+
+  //! Byte layout of a display list vertex. Computed on first use after
+  //! `mBitfield` or `mAttributes` change, then cached; not thread-safe.
+  const VertexLayout& getLayout() const {
+    if (mLayoutBitfield != mBitfield || mLayoutStamp != mAttributes.stamp())
+      computeLayout();
+    return mLayout;
+  }
+
   void calcVertexDescriptorFromAttributeList() {
     mBitfield = 0;
     for (gx::VertexAttribute i = gx::VertexAttribute::PositionNormalMatrixIndex;
@@ -31,12 +228,92 @@ struct VertexDescriptor {
   bool operator[](gx::VertexAttribute attr) const {
     return mBitfield & (1 << static_cast<u64>(attr));
   }
+  //! Descriptors are equal if they enable the same attributes with the same
+  //! types. Attributes set to None are ignored.
   bool operator==(const VertexDescriptor& rhs) const {
-    // FIXME: remove NULL attribs before comparing
-    return mAttributes.size() == rhs.mAttributes.size() &&
-           std::equal(mAttributes.begin(), mAttributes.end(),
-                      rhs.mAttributes.begin());
+    if (mBitfield != rhs.mBitfield)
+      return false;
+    for (u32 i = 0; i < (u32)gx::VertexAttribute::Max; ++i) {
+      const auto attr = static_cast<gx::VertexAttribute>(i);
+      if ((*this)[attr] && mAttributes.at(attr) != rhs.mAttributes.at(attr))
+        return false;
+    }
+    return true;
   }
+
+  //! Consistent with operator==.
+  std::size_t hash() const {
+    // Two bits per attribute type
+    u64 types = 0;
+    for (u32 i = 0; i < (u32)gx::VertexAttribute::Max; ++i) {
+      const auto attr = static_cast<gx::VertexAttribute>(i);
+      if ((*this)[attr])
+        types |= static_cast<u64>(mAttributes.at(attr)) << (i * 2);
+    }
+    return std::hash<u64>{}(types ^ (static_cast<u64>(mBitfield) << 52) ^
+                            (static_cast<u64>(mBitfield) >> 12));
+  }
+
+private:
+  void computeLayout() const {
+    mLayout = {};
+    u32 offset = 0;
+    for (u32 i = 0; i < (u32)gx::VertexAttribute::Max; ++i) {
+      const auto attr = static_cast<gx::VertexAttribute>(i);
+      mLayout.mOffsets[i] = offset;
+      if (!(*this)[attr])
+        continue;
+
+      u8 size = 0;
+      switch (mAttributes.at(attr)) {
+      case gx::VertexAttributeType::None:
+        continue;
+      case gx::VertexAttributeType::Byte:
+        size = 1;
+        break;
+      case gx::VertexAttributeType::Short:
+        size = 2;
+        break;
+      case gx::VertexAttributeType::Direct:
+        // As PNM indices are always direct, we
+        // still use them in an all-indexed vertex
+        if (attr != gx::VertexAttribute::PositionNormalMatrixIndex &&
+            attr != gx::VertexAttribute::Texture0MatrixIndex &&
+            attr != gx::VertexAttribute::Texture1MatrixIndex)
+          setStatus(VertexLayout::Status::DirectData);
+        size = 1;
+        break;
+      default:
+        setStatus(VertexLayout::Status::UnknownType);
+        continue;
+      }
+
+      mLayout.mAttributes[mLayout.mNumAttributes++] = {attr, size};
+      mLayout.mBitfield |= 1 << i;
+      offset += size;
+    }
+    mLayout.mOffsets[(u32)gx::VertexAttribute::Max] = offset;
+    mLayout.mStride = offset;
+    mLayoutBitfield = mBitfield;
+    mLayoutStamp = mAttributes.stamp();
+  }
+
+  // Keeps the first problem found
+  void setStatus(VertexLayout::Status status) const {
+    if (mLayout.mStatus == VertexLayout::Status::Ok)
+      mLayout.mStatus = status;
+  }
+
+  // Derived from mBitfield and mAttributes; see getLayout()
+  mutable VertexLayout mLayout;
+  mutable u32 mLayoutBitfield = 0;
+  mutable u64 mLayoutStamp = ~0ull;
 };
 
 } // namespace libcube
+
+template <> struct std::hash<libcube::VertexDescriptor> {
+  std::size_t operator()(const libcube::VertexDescriptor& vcd) const {
+    return vcd.hash();
+  }
+};
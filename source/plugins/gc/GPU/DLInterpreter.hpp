@@ -9,6 +9,9 @@
 
 #include <plugins/gc/GX/VertexTypes.hpp>
 
+#include <array>
+#include <span>
+
 namespace libcube::gpu {
 
 struct QBPCommand {
@@ -17,10 +20,18 @@ struct QBPCommand {
 };
 
 struct QXFCommand {
-  u16 reg;
+  u16 reg; // first register
   u32 val; // first val
 
-  std::vector<u32> vals; // first val repeated
+  //! Big-endian payload, borrowed from the display list. Register `reg + i`
+  //! is assigned `getValue(i)`.
+  std::span<const u8> data;
+
+  std::size_t size() const { return data.size() / 4; }
+  u32 getValue(std::size_t i) const {
+    const u8* p = data.data() + i * 4;
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  }
 };
 struct QCPCommand {
   u8 reg;
@@ -31,6 +42,11 @@ class QDisplayListHandler {
 public:
   virtual ~QDisplayListHandler() {}
   virtual void onCommandBP(const QBPCommand& token) {}
+  //! Consecutive BP commands, in order. Calls onCommandBP by default.
+  virtual void onCommandsBP(std::span<const QBPCommand> tokens) {
+    for (const auto& token : tokens)
+      onCommandBP(token);
+  }
   virtual void onCommandCP(const QCPCommand& token) {}
   virtual void onCommandXF(const QXFCommand& token) {}
   virtual void onCommandDraw(oishii::BinaryReader& reader,
@@ -40,6 +56,83 @@ public:
   virtual void onStreamEnd() {}
 };
 
+//! @brief Decode the register writes at the start of a display list.
+//!
+//! Nothing is allocated: XF payloads point into `dl` and BP commands are
+//! delivered in batches. `handler` need not derive from QDisplayListHandler;
+//! it only needs `onCommandsBP`, `onCommandCP` and `onCommandXF`.
+//!
+//! @return The number of bytes decoded. Decoding stops at the first draw or
+//!         unknown command, or at a command that does not fit in `dl`.
+//!
+template <typename T>
+std::size_t DecodeRegisterWrites(std::span<const u8> dl, T& handler) {
+  auto read32 = [](const u8* p) -> u32 {
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  };
+
+  std::array<QBPCommand, 32> bp;
+  std::size_t numBp = 0;
+  auto flushBp = [&] {
+    if (numBp != 0)
+      handler.onCommandsBP(std::span<const QBPCommand>{bp.data(), numBp});
+    numBp = 0;
+  };
+
+  std::size_t pos = 0;
+  while (pos < dl.size()) {
+    const u8* cmd = dl.data() + pos;
+    const std::size_t remaining = dl.size() - pos;
+
+    switch (static_cast<CommandType>(cmd[0])) {
+    case CommandType::NOP:
+      ++pos;
+      continue;
+    case CommandType::BP: {
+      if (remaining < 5)
+        break;
+      const u32 rv = read32(cmd + 1);
+      bp[numBp++] = {static_cast<BPAddress>(rv >> 24), rv & 0x00ffffff};
+      if (numBp == bp.size())
+        flushBp();
+      pos += 5;
+      continue;
+    }
+    case CommandType::CP: {
+      if (remaining < 6)
+        break;
+      flushBp();
+      handler.onCommandCP(QCPCommand{cmd[1], read32(cmd + 2)});
+      pos += 6;
+      continue;
+    }
+    case CommandType::XF: {
+      if (remaining < 5)
+        break;
+      // There are nCmd + 1 values
+      const std::size_t size = (((cmd[1] << 8) | cmd[2]) + 1) * 4;
+      if (remaining < 5 + size)
+        break;
+      flushBp();
+      QXFCommand xf;
+      xf.reg = (cmd[3] << 8) | cmd[4];
+      xf.val = read32(cmd + 5);
+      xf.data = {cmd + 5, size};
+      handler.onCommandXF(xf);
+      pos += 5 + size;
+      continue;
+    }
+    default:
+      break;
+    }
+    // Draw, unknown or truncated command
+    break;
+  }
+
+  flushBp();
+  return pos;
+}
+
 void RunDisplayList(oishii::BinaryReader& reader, QDisplayListHandler& handler,
                     u32 dlSize);
 
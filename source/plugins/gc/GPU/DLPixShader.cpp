@@ -245,65 +245,51 @@ QDisplayListMaterialHandler::QDisplayListMaterialHandler(
     : mMat(mat) {}
 QDisplayListMaterialHandler::~QDisplayListMaterialHandler() {}
 enum RegType { TEV_COLOR_REG = 0, TEV_KONSTANT_REG = 1 };
-void QDisplayListMaterialHandler::onCommandXF(const QXFCommand& token) {
-  switch (token.reg) {
-  case XF_TEX0_ID:
-  case XF_TEX0_ID + 1:
-  case XF_TEX0_ID + 2:
-  case XF_TEX0_ID + 3:
-  case XF_TEX0_ID + 4:
-  case XF_TEX0_ID + 5:
-  case XF_TEX0_ID + 6:
-  case XF_TEX0_ID + 7:
-    mGpuMat.mTexture[token.reg - XF_TEX0_ID].tex.hex = token.val;
-    break;
-  case XF_DUALTEX0_ID:
-  case XF_DUALTEX0_ID + 1:
-  case XF_DUALTEX0_ID + 2:
-  case XF_DUALTEX0_ID + 3:
-  case XF_DUALTEX0_ID + 4:
-  case XF_DUALTEX0_ID + 5:
-  case XF_DUALTEX0_ID + 6:
-  case XF_DUALTEX0_ID + 7:
-    mGpuMat.mTexture[token.reg - XF_DUALTEX0_ID].dualTex.hex = token.val;
-    break;
+void GPUMaterial::onCommandXF(const QXFCommand& token) {
+  for (std::size_t i = 0; i < token.size(); ++i) {
+    const u32 reg = token.reg + i;
+    const u32 val = token.getValue(i);
+    if (reg >= XF_TEX0_ID && reg < XF_TEX0_ID + 8)
+      mTexture[reg - XF_TEX0_ID].tex.hex = val;
+    else if (reg >= XF_DUALTEX0_ID && reg < XF_DUALTEX0_ID + 8)
+      mTexture[reg - XF_DUALTEX0_ID].dualTex.hex = val;
   }
 }
-void QDisplayListMaterialHandler::onCommandBP(const QBPCommand& token) {
+void GPUMaterial::onCommandBP(const QBPCommand& token) {
   switch ((u32)token.reg) {
   case BPAddress::ALPHACOMPARE:
-    mGpuMat.setReg(mGpuMat.mPixel.mAlphaCompare, token);
+    setReg(mPixel.mAlphaCompare, token);
     break;
   case BPAddress::ZMODE:
-    mGpuMat.setReg(mGpuMat.mPixel.mZMode, token);
+    setReg(mPixel.mZMode, token);
     break;
   case BPAddress::BP_MASK:
-    mGpuMat.mMask = 0xff000000 | (token.val & 0x00ffffff);
+    mMask = 0xff000000 | (token.val & 0x00ffffff);
     break;
   case BPAddress::BLENDMODE:
-    mGpuMat.setReg(mGpuMat.mPixel.mBlendMode, token);
+    setReg(mPixel.mBlendMode, token);
     break;
   case BPAddress::CONSTANTALPHA:
-    mGpuMat.setReg(mGpuMat.mPixel.mDstAlpha, token);
+    setReg(mPixel.mDstAlpha, token);
     break;
   case BPAddress::TEV_COLOR_RA:
   case BPAddress::TEV_COLOR_RA + 2:
   case BPAddress::TEV_COLOR_RA + 4:
   case BPAddress::TEV_COLOR_RA + 6: {
     GPUTevReg tmp;
-    tmp.low = (token.val & mGpuMat.mMask);
+    tmp.low = (token.val & mMask);
     if (tmp.type_ra.Value() == TEV_KONSTANT_REG) {
       auto& gpuReg =
-          mGpuMat.mShaderColor
+          mShaderColor
               .Konstants[((u32)token.reg - (u32)BPAddress::TEV_COLOR_RA) / 2];
-      gpuReg.low = (gpuReg.low.Value() & ~static_cast<u64>(mGpuMat.mMask)) |
-                   (token.val & static_cast<u64>(mGpuMat.mMask));
+      gpuReg.low = (gpuReg.low.Value() & ~static_cast<u64>(mMask)) |
+                   (token.val & static_cast<u64>(mMask));
     } else {
       auto& gpuReg =
-          mGpuMat.mShaderColor
+          mShaderColor
               .Registers[((u32)token.reg - (u32)BPAddress::TEV_COLOR_RA) / 2];
-      gpuReg.low = (gpuReg.low.Value() & ~static_cast<u64>(mGpuMat.mMask)) |
-                   (token.val & static_cast<u64>(mGpuMat.mMask));
+      gpuReg.low = (gpuReg.low.Value() & ~static_cast<u64>(mMask)) |
+                   (token.val & static_cast<u64>(mMask));
     }
     break;
   }
@@ -312,52 +298,48 @@ void QDisplayListMaterialHandler::onCommandBP(const QBPCommand& token) {
   case BPAddress::TEV_COLOR_BG + 4:
   case BPAddress::TEV_COLOR_BG + 6: {
     GPUTevReg tmp;
-    tmp.high = (token.val & mGpuMat.mMask);
+    tmp.high = (token.val & mMask);
     if (tmp.type_bg.Value() == TEV_KONSTANT_REG) {
       auto& gpuReg =
-          mGpuMat.mShaderColor
+          mShaderColor
               .Konstants[((u32)token.reg - (u32)BPAddress::TEV_COLOR_RA) / 2];
-      gpuReg.high = (gpuReg.high.Value() & ~static_cast<u64>(mGpuMat.mMask)) |
-                    (token.val & static_cast<u64>(mGpuMat.mMask));
+      gpuReg.high = (gpuReg.high.Value() & ~static_cast<u64>(mMask)) |
+                    (token.val & static_cast<u64>(mMask));
     } else {
       auto& gpuReg =
-          mGpuMat.mShaderColor
+          mShaderColor
               .Registers[((u32)token.reg - (u32)BPAddress::TEV_COLOR_RA) / 2];
-      gpuReg.high = (gpuReg.high.Value() & ~static_cast<u64>(mGpuMat.mMask)) |
-                    (token.val & static_cast<u64>(mGpuMat.mMask));
+      gpuReg.high = (gpuReg.high.Value() & ~static_cast<u64>(mMask)) |
+                    (token.val & static_cast<u64>(mMask));
     }
     break;
   }
   case BPAddress::RAS1_SS0:
   case BPAddress::RAS1_SS0 + 1:
-    mGpuMat.setReg(mGpuMat.mIndirect.mIndTexScales[(u32)token.reg -
-                                                   (u32)BPAddress::RAS1_SS0],
-                   token);
+    setReg(mIndirect.mIndTexScales[(u32)token.reg - (u32)BPAddress::RAS1_SS0],
+           token);
     break;
   case BPAddress::IND_MTXA:
   case BPAddress::IND_MTXA + 3:
   case BPAddress::IND_MTXA + 6:
-    mGpuMat.setReg(
-        mGpuMat.mIndirect
-            .mIndMatrices[((u32)token.reg - (u32)BPAddress::IND_MTXA) / 3]
+    setReg(
+        mIndirect.mIndMatrices[((u32)token.reg - (u32)BPAddress::IND_MTXA) / 3]
             .col0,
         token);
     break;
   case BPAddress::IND_MTXB:
   case BPAddress::IND_MTXB + 3:
   case BPAddress::IND_MTXB + 6:
-    mGpuMat.setReg(
-        mGpuMat.mIndirect
-            .mIndMatrices[((u32)token.reg - (u32)BPAddress::IND_MTXA) / 3]
+    setReg(
+        mIndirect.mIndMatrices[((u32)token.reg - (u32)BPAddress::IND_MTXA) / 3]
             .col1,
         token);
     break;
   case BPAddress::IND_MTXC:
   case BPAddress::IND_MTXC + 3:
   case BPAddress::IND_MTXC + 6:
-    mGpuMat.setReg(
-        mGpuMat.mIndirect
-            .mIndMatrices[((u32)token.reg - (u32)BPAddress::IND_MTXA) / 3]
+    setReg(
+        mIndirect.mIndMatrices[((u32)token.reg - (u32)BPAddress::IND_MTXA) / 3]
             .col2,
         token);
     break;
@@ -367,8 +349,26 @@ void QDisplayListMaterialHandler::onCommandBP(const QBPCommand& token) {
   }
   }
   // If mask has expired, reset it
-  if (mGpuMat.mMask != 0xffffffff && token.reg != (u32)BPAddress::BP_MASK)
-    mGpuMat.mMask = 0xffffffff;
+  if (mMask != 0xffffffff && token.reg != (u32)BPAddress::BP_MASK)
+    mMask = 0xffffffff;
+}
+void GPUMaterial::onCommandsBP(std::span<const QBPCommand> tokens) {
+  for (const auto& token : tokens)
+    onCommandBP(token);
+}
+std::size_t ApplyMaterialDisplayList(std::span<const u8> dl, GPUMaterial& mat) {
+  return DecodeRegisterWrites(dl, mat);
+}
+
+void QDisplayListMaterialHandler::onCommandBP(const QBPCommand& token) {
+  mGpuMat.onCommandBP(token);
+}
+void QDisplayListMaterialHandler::onCommandsBP(
+    std::span<const QBPCommand> tokens) {
+  mGpuMat.onCommandsBP(tokens);
+}
+void QDisplayListMaterialHandler::onCommandXF(const QXFCommand& token) {
+  mGpuMat.onCommandXF(token);
 }
 void QDisplayListMaterialHandler::onStreamEnd() {}
 void QDisplayListVertexSetupHandler::onCommandBP(const QBPCommand& token) {
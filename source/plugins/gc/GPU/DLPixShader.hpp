@@ -7,6 +7,7 @@
 #include <plugins/gc/GX/Struct/Shader.hpp>
 
 #include <array>
+#include <span>
 
 namespace libcube::gpu {
 
@@ -72,6 +73,12 @@ struct GPUMaterial {
     reg.hex = (reg.hex & ~mMask) | (cmd.val & mMask);
   }
 
+  // Register writes from a material display list
+  void onCommandBP(const QBPCommand& token);
+  void onCommandsBP(std::span<const QBPCommand> tokens);
+  void onCommandCP(const QCPCommand& token) {}
+  void onCommandXF(const QXFCommand& token);
+
   GPUMaterial() {
     for (int i = 0; i < 8; i++) {
       mTexture[i].id = i;
@@ -79,12 +86,20 @@ struct GPUMaterial {
   }
 };
 
+//! @brief Apply the register writes of a material display list to `mat`,
+//! without allocating or dispatching virtually.
+//!
+//! @return The number of bytes decoded.
+//!
+std::size_t ApplyMaterialDisplayList(std::span<const u8> dl, GPUMaterial& mat);
+
 class QDisplayListMaterialHandler : public QDisplayListHandler {
 public:
   QDisplayListMaterialHandler(GCMaterialData& mat);
   ~QDisplayListMaterialHandler();
 
   void onCommandBP(const QBPCommand& token) override;
+  void onCommandsBP(std::span<const QBPCommand> tokens) override;
   void onCommandXF(const QXFCommand& token) override;
   void onStreamEnd() override;
 
@@ -1,6 +1,8 @@
 #include <core/3d/gl.hpp>
 
 #include "GXProgram.hpp"
+#include "GXShaderCache.hpp"
+#include <cstdio> // std::snprintf
 
 namespace libcube {
 
@@ -12,11 +14,11 @@ llvm::Error GXProgram::generateMaterialSource(StringBuilder& builder,
   switch (chan.Material) {
   case ColorSource::Vertex:
     builder += "a_Color";
-    builder += std::to_string(i);
+    builder.appendInt(i);
     break;
   case ColorSource::Register:
     builder += "u_ColorMatReg[";
-    builder += std::to_string(i);
+    builder.appendInt(i);
     builder += "]";
     break;
   }
@@ -29,11 +31,11 @@ llvm::Error GXProgram::generateAmbientSource(StringBuilder& builder,
   switch (chan.Ambient) {
   case ColorSource::Vertex:
     builder += "a_Color";
-    builder += std::to_string(i);
+    builder.appendInt(i);
     break;
   case ColorSource::Register:
     builder += "u_ColorAmbReg[";
-    builder += std::to_string(i);
+    builder.appendInt(i);
     builder += "]";
     break;
   }
@@ -42,7 +44,7 @@ llvm::Error GXProgram::generateAmbientSource(StringBuilder& builder,
 
 llvm::Error GXProgram::generateLightDiffFn(StringBuilder& builder,
                                            const gx::ChannelControl& chan,
-                                           const std::string& lightName) {
+                                           std::string_view lightName) {
   const char* NdotL = "dot(t_Normal, t_LightDeltaDir)";
 
   switch (chan.diffuseFn) {
@@ -63,40 +65,42 @@ llvm::Error GXProgram::generateLightDiffFn(StringBuilder& builder,
 }
 llvm::Error GXProgram::generateLightAttnFn(StringBuilder& builder,
                                            const gx::ChannelControl& chan,
-                                           const std::string& lightName) {
+                                           std::string_view lightName) {
   if (chan.attenuationFn == AttenuationFunction::None) {
     builder += "t_Attenuation = 1.0;";
   } else if (chan.attenuationFn == AttenuationFunction::Spotlight) {
-    auto attn = std::string("max(0.0, dot(t_LightDeltaDir, ") + lightName +
-                ".Direction.xyz))";
-    auto cosAttn = std::string("max(0.0, ApplyAttenuation(") + lightName +
-                   ".CosAtten.xyz, " + attn + "))";
-    auto distAttn =
-        std::string("dot(") + lightName +
-        ".DistAtten.xyz, vec3(1.0, t_LightDeltaDist, t_LightDeltaDist2))";
-
+    // cosAttn / distAttn
     builder += "t_Attenuation = ";
-    builder += cosAttn;
+    builder += "max(0.0, ApplyAttenuation(";
+    builder += lightName;
+    builder += ".CosAtten.xyz, ";
+    builder += "max(0.0, dot(t_LightDeltaDir, ";
+    builder += lightName;
+    builder += ".Direction.xyz))";
+    builder += "))";
     builder += " / ";
-    builder += distAttn;
+    builder += "dot(";
+    builder += lightName;
+    builder += ".DistAtten.xyz, "
+               "vec3(1.0, t_LightDeltaDist, t_LightDeltaDist2))";
     builder += ";";
   } else if (chan.attenuationFn == AttenuationFunction::Specular) {
-    auto attn = std::string("(dot(t_Normal, t_LightDeltaDir) >= 0.0) ? "
-                            "max(0.0, dot(t_Normal, ") +
-                lightName + ".Direction.xyz)) : 0.0";
-    auto cosAttn = std::string("ApplyAttenuation(") + lightName +
-                   ".CosAtten.xyz, t_Attenuation)";
-    auto distAttn = std::string("ApplyAttenuation(") + lightName +
-                    ".DistAtten.xyz, t_Attenuation)";
-
     builder += "t_Attenuation = ";
-    builder += attn;
+    builder += "(dot(t_Normal, t_LightDeltaDir) >= 0.0) ? "
+               "max(0.0, dot(t_Normal, ";
+    builder += lightName;
+    builder += ".Direction.xyz)) : 0.0";
     builder += ";\n";
 
+    // cosAttn / distAttn
     builder += "t_Attenuation = ";
-    builder += cosAttn;
+    builder += "ApplyAttenuation(";
+    builder += lightName;
+    builder += ".CosAtten.xyz, t_Attenuation)";
     builder += " / ";
-    builder += distAttn;
+    builder += "ApplyAttenuation(";
+    builder += lightName;
+    builder += ".DistAtten.xyz, t_Attenuation)";
     builder += ";";
   } else {
     return llvm::createStringError(llvm::inconvertibleErrorCode(),
@@ -107,7 +111,7 @@ llvm::Error GXProgram::generateLightAttnFn(StringBuilder& builder,
 }
 llvm::Error GXProgram::generateColorChannel(StringBuilder& builder,
                                             const gx::ChannelControl& chan,
-                                            const std::string& outputName,
+                                            std::string_view outputName,
                                             int i) {
 
   if (chan.enabled) {
@@ -122,23 +126,29 @@ llvm::Error GXProgram::generateColorChannel(StringBuilder& builder,
       if (!(u32(chan.lightMask) & (1 << j)))
         continue;
 
-      const std::string lightName = "u_LightParams[" + std::to_string(j) + "]";
+      char light_name_buf[32];
+      StringBuilder lightName(light_name_buf, sizeof(light_name_buf));
+      lightName += "u_LightParams[";
+      lightName.appendInt(j);
+      lightName += "]";
 
       builder += "    t_LightDelta = ";
-      builder += lightName;
+      builder += lightName.view();
       builder += ".Position.xyz - v_Position.xyz;\n"
                  "    t_LightDeltaDist2 = dot(t_LightDelta, t_LightDelta);\n"
                  "    t_LightDeltaDist = sqrt(t_LightDeltaDist2);\n"
                  "    t_LightDeltaDir = t_LightDelta / t_LightDeltaDist;\n";
 
-      if (auto err = generateLightAttnFn(builder, chan, lightName)) {
+      if (auto err = generateLightAttnFn(builder, chan, lightName.view())) {
         return err;
       }
       builder += "    t_LightAccum += ";
-      if (auto err = generateLightDiffFn(builder, chan, lightName)) {
+      if (auto err = generateLightDiffFn(builder, chan, lightName.view())) {
         return err;
       }
-      builder += " * t_Attenuation * " + lightName + ".Color;\n";
+      builder += " * t_Attenuation * ";
+      builder += lightName.view();
+      builder += ".Color;\n";
     }
   } else {
     // Without lighting, everything is full-bright.
@@ -157,7 +167,7 @@ llvm::Error GXProgram::generateColorChannel(StringBuilder& builder,
 llvm::Error
 GXProgram::generateLightChannel(StringBuilder& builder,
                                 const LightingChannelControl& lightChannel,
-                                const std::string& outputName, int i) {
+                                std::string_view outputName, int i) {
   if (lightChannel.colorChannel == lightChannel.alphaChannel) {
     // TODO
     builder += "    ";
@@ -166,10 +176,14 @@ GXProgram::generateLightChannel(StringBuilder& builder,
   } else {
     llvm::cantFail(generateColorChannel(builder, lightChannel.colorChannel,
                                         "t_ColorChanTemp", i));
-    builder += "\n" + outputName + ".rgb = t_ColorChanTemp.rgb;\n";
+    builder += "\n";
+    builder += outputName;
+    builder += ".rgb = t_ColorChanTemp.rgb;\n";
     llvm::cantFail(generateColorChannel(builder, lightChannel.alphaChannel,
                                         "t_ColorChanTemp", i));
-    builder += "\n" + outputName + ".a = t_ColorChanTemp.a;\n";
+    builder += "\n";
+    builder += outputName;
+    builder += ".a = t_ColorChanTemp.a;\n";
   }
 
   return llvm::Error::success();
@@ -189,10 +203,10 @@ llvm::Error GXProgram::generateLightChannels(StringBuilder& builder) {
   if (src.size() > 3)
     ctrl[1].alphaChannel = src[3];
 
+  const std::array<const char*, 2> outputNames{"v_Color0", "v_Color1"};
   int i = 0;
   for (const auto& chan : ctrl) {
-    llvm::cantFail(
-        generateLightChannel(builder, chan, "v_Color" + std::to_string(i), i));
+    llvm::cantFail(generateLightChannel(builder, chan, outputNames[i], i));
     builder += "\n";
     ++i;
   }
@@ -201,30 +215,47 @@ llvm::Error GXProgram::generateLightChannels(StringBuilder& builder) {
 }
 
 // Matrix
-std::string GXProgram::generateMulPntMatrixStatic(gx::PostTexMatrix pnt,
-                                                  const std::string& src) {
+// Output is a vec3, src is a vec4.
+llvm::Error GXProgram::generateMulPntMatrixStatic(StringBuilder& builder,
+                                                  gx::PostTexMatrix pnt,
+                                                  std::string_view src) {
   // TODO
   if (pnt == gx::PostTexMatrix::Identity ||
       (int)pnt == (int)gx::TexMatrix::Identity) {
-    return src + ".xyz";
+    builder += src;
+    builder += ".xyz";
   } else if (pnt >= gx::PostTexMatrix::Matrix0) {
     const int pnMtxIdx = (((int)pnt - (int)gx::PostTexMatrix::Matrix0)) / 3;
-    return "(u_PosMtx[" + std::to_string(pnMtxIdx) + "] * " + src + ")";
+    builder += "(u_PosMtx[";
+    builder.appendInt(pnMtxIdx);
+    builder += "] * ";
+    builder += src;
+    builder += ")";
   } else if ((int)pnt >= (int)gx::TexMatrix::TexMatrix0) {
     const int texMtxIdx = (((int)pnt - (int)gx::TexMatrix::TexMatrix0)) / 3;
-    return "(u_TexMtx[" + std::to_string(texMtxIdx) + "] * " + src + ")";
+    builder += "(u_TexMtx[";
+    builder.appendInt(texMtxIdx);
+    builder += "] * ";
+    builder += src;
+    builder += ")";
   } else {
     throw "whoops";
   }
 
-  return "";
+  return llvm::Error::success();
 }
 // Output is a vec3, src is a vec4.
-std::string GXProgram::generateMulPntMatrixDynamic(const std::string& attrStr,
-                                                   const std::string& src) {
-  return "(GetPosTexMatrix(" + attrStr + ") * " + src + ")";
+llvm::Error GXProgram::generateMulPntMatrixDynamic(StringBuilder& builder,
+                                                   std::string_view attrStr,
+                                                   std::string_view src) {
+  builder += "(GetPosTexMatrix(";
+  builder += attrStr;
+  builder += ") * ";
+  builder += src;
+  builder += ")";
+  return llvm::Error::success();
 }
-std::string GXProgram::generateTexMtxIdxAttr(int index) {
+const char* GXProgram::generateTexMtxIdxAttr(int index) {
   switch (index) {
   case 0:
     return "a_TexMtx0123Idx.x";
@@ -253,7 +284,7 @@ std::string GXProgram::generateTexMtxIdxAttr(int index) {
 
 // Output is a vec4.
 //#if 0
-std::string GXProgram::generateTexGenSource(gx::TexGenSrc src) {
+const char* GXProgram::generateTexGenSource(gx::TexGenSrc src) {
   switch (src) {
   case gx::TexGenSrc::Position:
     return "vec4(a_Position, 1.0)";
@@ -298,52 +329,67 @@ std::string GXProgram::generateTexGenSource(gx::TexGenSrc src) {
   }
   return "";
 }
-// Output is a vec3, src is a vec4.
-std::string
-GXProgram::generatePostTexGenMatrixMult(const gx::TexCoordGen& texCoordGen,
-                                        int id, const std::string& src) {
+// Output is a vec3: the normalized texgen, post-multiplied as a vec4.
+llvm::Error
+GXProgram::generatePostTexGenMatrixMult(StringBuilder& builder,
+                                        const gx::TexCoordGen& texCoordGen,
+                                        int id) {
   // TODO:
   if (true || texCoordGen.postMatrix == gx::PostTexMatrix::Identity) {
-    return src + ".xyz";
+    builder += "vec4(";
+    llvm::cantFail(generateTexGenNrm(builder, texCoordGen, id));
+    builder += ", 1.0).xyz";
   } else if (texCoordGen.postMatrix >= gx::PostTexMatrix::Matrix0) {
     const u32 texMtxIdx =
         ((u32)texCoordGen.postMatrix - (u32)gx::PostTexMatrix::Matrix0) / 3;
     assert(texMtxIdx < 10);
-    return "(u_PostTexMtx[" + std::to_string(texMtxIdx) + std::string("] * ") +
-           src + ")";
+    builder += "(u_PostTexMtx[";
+    builder.appendInt(texMtxIdx);
+    builder += "] * vec4(";
+    llvm::cantFail(generateTexGenNrm(builder, texCoordGen, id));
+    builder += ", 1.0))";
   } else {
     throw "whoops";
-    return "";
   }
+  return llvm::Error::success();
 }
 // Output is a vec3, src is a vec3.
-vec3_string
-GXProgram::generateTexGenMatrixMult(const gx::TexCoordGen& texCoordGen, int id,
-                                    const vec3_string& src) {
+llvm::Error
+GXProgram::generateTexGenMatrixMult(StringBuilder& builder,
+                                    const gx::TexCoordGen& texCoordGen, int id,
+                                    std::string_view src) {
   // TODO: Will ID ever be different from index?
 
   // Dynamic TexMtxIdx is off by default.
   if (mMaterial.useTexMtxIdx[id]) {
-    const std::string attrStr = generateTexMtxIdxAttr(id);
-    return generateMulPntMatrixDynamic(attrStr, src);
+    const char* attrStr = generateTexMtxIdxAttr(id);
+    return generateMulPntMatrixDynamic(builder, attrStr, src);
   } else {
     // TODO: Verify
     return generateMulPntMatrixStatic(
-        static_cast<libcube::gx::PostTexMatrix>(texCoordGen.matrix), src);
+        builder, static_cast<libcube::gx::PostTexMatrix>(texCoordGen.matrix),
+        src);
   }
 }
 
 // Output is a vec3, src is a vec4.
-vec3_string GXProgram::generateTexGenType(const gx::TexCoordGen& texCoordGen,
-                                          int id, const vec4_string& src) {
+llvm::Error GXProgram::generateTexGenType(StringBuilder& builder,
+                                          const gx::TexCoordGen& texCoordGen,
+                                          int id, std::string_view src) {
   switch (texCoordGen.func) {
   case gx::TexGenType::SRTG:
-    return "vec3(" + src + ".xy, 1.0)";
+    builder += "vec3(";
+    builder += src;
+    builder += ".xy, 1.0)";
+    break;
   case gx::TexGenType::Matrix2x4:
-    return "vec3(" + generateTexGenMatrixMult(texCoordGen, id, src) +
-           ".xy, 1.0)";
+    builder += "vec3(";
+    llvm::cantFail(generateTexGenMatrixMult(builder, texCoordGen, id, src));
+    builder += ".xy, 1.0)";
+    break;
   case gx::TexGenType::Matrix3x4:
-    return generateTexGenMatrixMult(texCoordGen, id, src);
+    llvm::cantFail(generateTexGenMatrixMult(builder, texCoordGen, id, src));
+    break;
   case gx::TexGenType::Bump0:
   case gx::TexGenType::Bump1:
   case gx::TexGenType::Bump2:
@@ -352,60 +398,70 @@ vec3_string GXProgram::generateTexGenType(const gx::TexCoordGen& texCoordGen,
   case gx::TexGenType::Bump5:
   case gx::TexGenType::Bump6:
   case gx::TexGenType::Bump7:
-    return "vec3(0.5, 0.5, 0.5)";
+    builder += "vec3(0.5, 0.5, 0.5)";
+    break;
   default:
     throw "whoops";
   }
+  return llvm::Error::success();
 }
 
 // Output is a vec3.
-std::string GXProgram::generateTexGenNrm(const gx::TexCoordGen& texCoordGen,
+llvm::Error GXProgram::generateTexGenNrm(StringBuilder& builder,
+                                         const gx::TexCoordGen& texCoordGen,
                                          int id) {
-  const auto src = generateTexGenSource(texCoordGen.sourceParam);
-  const auto type = generateTexGenType(texCoordGen, id, src);
+  const char* src = generateTexGenSource(texCoordGen.sourceParam);
   if (texCoordGen.normalize)
-    return "normalize(" + type + ")";
-  else
-    return type;
+    builder += "normalize(";
+  llvm::cantFail(generateTexGenType(builder, texCoordGen, id, src));
+  if (texCoordGen.normalize)
+    builder += ")";
+  return llvm::Error::success();
 }
 // Output is a vec3.
-std::string GXProgram::generateTexGenPost(const gx::TexCoordGen& texCoordGen,
+llvm::Error GXProgram::generateTexGenPost(StringBuilder& builder,
+                                          const gx::TexCoordGen& texCoordGen,
                                           int id) {
-  const auto src = generateTexGenNrm(texCoordGen, id);
   // TODO
   if (true || texCoordGen.postMatrix == gx::PostTexMatrix::Identity)
-    return src;
+    return generateTexGenNrm(builder, texCoordGen, id);
   else
-    return generatePostTexGenMatrixMult(texCoordGen, id,
-                                        "vec4(" + src + ", 1.0)");
+    return generatePostTexGenMatrixMult(builder, texCoordGen, id);
 }
 
-std::string GXProgram::generateTexGen(const gx::TexCoordGen& texCoordGen,
+llvm::Error GXProgram::generateTexGen(StringBuilder& builder,
+                                      const gx::TexCoordGen& texCoordGen,
                                       int id) {
-  return "v_TexCoord" + std::to_string(/*texCoordGen.*/ id) + " = " +
-         generateTexGenPost(texCoordGen, id) + ";\n";
+  builder += "v_TexCoord";
+  builder.appendInt(/*texCoordGen.*/ id);
+  builder += " = ";
+  llvm::cantFail(generateTexGenPost(builder, texCoordGen, id));
+  builder += ";\n";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTexGens() {
-  std::string out;
+llvm::Error GXProgram::generateTexGens(StringBuilder& builder) {
   const auto& tgs = mMaterial.mat.getMaterialData().texGens;
   for (int i = 0; i < tgs.size(); ++i)
-    out += generateTexGen(tgs[i], i);
-  return out;
+    llvm::cantFail(generateTexGen(builder, tgs[i], i));
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTexCoordGetters() {
-  std::string out;
+llvm::Error GXProgram::generateTexCoordGetters(StringBuilder& builder) {
   for (int i = 0; i < mMaterial.mat.getMaterialData().texGens.size(); ++i) {
-    const std::string is = std::to_string(i);
-    out += "vec2 ReadTexCoord" + is + "() { return v_TexCoord" + is +
-           ".xy / v_TexCoord" + is + ".z; }\n";
+    builder += "vec2 ReadTexCoord";
+    builder.appendInt(i);
+    builder += "() { return v_TexCoord";
+    builder.appendInt(i);
+    builder += ".xy / v_TexCoord";
+    builder.appendInt(i);
+    builder += ".z; }\n";
   }
-  return out;
+  return llvm::Error::success();
 }
 
 // IndTex
-std::string GXProgram::generateIndTexStageScaleN(
+const char* GXProgram::generateIndTexStageScaleN(
     gx::IndirectTextureScalePair::Selection scale) {
   switch (scale) {
   case gx::IndirectTextureScalePair::Selection::x_1:
@@ -429,29 +485,40 @@ std::string GXProgram::generateIndTexStageScaleN(
   }
 }
 
-std::string
-GXProgram::generateIndTexStageScale(const gx::TevStage::IndirectStage& stage,
+llvm::Error
+GXProgram::generateIndTexStageScale(StringBuilder& builder,
+                                    const gx::TevStage::IndirectStage& stage,
                                     const gx::IndirectTextureScalePair& scale,
                                     const gx::IndOrder& mIndOrder) {
-  const std::string baseCoord =
-      "ReadTexCoord" + std::to_string(mIndOrder.refCoord) + "()";
-
-  if (scale.U == gx::IndirectTextureScalePair::Selection::x_1 &&
-      scale.V == gx::IndirectTextureScalePair::Selection::x_1)
-    return baseCoord;
-  else
-    return baseCoord + " * vec2(" + generateIndTexStageScaleN(scale.U) + ", " +
-           generateIndTexStageScaleN(scale.V) + ")";
+  builder += "ReadTexCoord";
+  builder.appendInt(mIndOrder.refCoord);
+  builder += "()";
+
+  if (scale.U != gx::IndirectTextureScalePair::Selection::x_1 ||
+      scale.V != gx::IndirectTextureScalePair::Selection::x_1) {
+    builder += " * vec2(";
+    builder += generateIndTexStageScaleN(scale.U);
+    builder += ", ";
+    builder += generateIndTexStageScaleN(scale.V);
+    builder += ")";
+  }
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTextureSample(u32 index,
-                                             const std::string& coord) {
-  const auto idx_str = std::to_string(index);
-  return "texture(u_Texture[" + idx_str + "], " + coord + ", TextureLODBias(" +
-         idx_str + "))";
+llvm::Error GXProgram::generateTextureSample(StringBuilder& builder, u32 index,
+                                             std::string_view coord) {
+  builder += "texture(u_Texture[";
+  builder.appendInt(index);
+  builder += "], ";
+  builder += coord;
+  builder += ", TextureLODBias(";
+  builder.appendInt(index);
+  builder += "))";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateIndTexStage(u32 indTexStageIndex) {
+llvm::Error GXProgram::generateIndTexStage(StringBuilder& builder,
+                                           u32 indTexStageIndex) {
   const auto& stage = mMaterial.mat.getMaterialData()
                           .shader.mStages[indTexStageIndex]
                           .indirectStage;
@@ -467,15 +534,19 @@ std::string GXProgram::generateIndTexStage(u32 indTexStageIndex) {
           : mMaterial.mat.getMaterialData()
                 .shader.mIndirectOrders[indTexStageIndex];
 
-  return "vec3 t_IndTexCoord" + std::to_string(indTexStageIndex) +
-         " = 255.0 * " +
-         generateTextureSample(order.refMap,
-                               generateIndTexStageScale(stage, scale, order)) +
-         ".abg;\n";
+  char coord_buf[64];
+  StringBuilder coord(coord_buf, sizeof(coord_buf));
+  llvm::cantFail(generateIndTexStageScale(coord, stage, scale, order));
+
+  builder += "vec3 t_IndTexCoord";
+  builder.appendInt(indTexStageIndex);
+  builder += " = 255.0 * ";
+  llvm::cantFail(generateTextureSample(builder, order.refMap, coord.view()));
+  builder += ".abg;\n";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateIndTexStages() {
-  std::string out;
+llvm::Error GXProgram::generateIndTexStages(StringBuilder& builder) {
   auto& matData = mMaterial.mat.getMaterialData();
   auto& shader = matData.shader;
 
@@ -488,13 +559,13 @@ std::string GXProgram::generateIndTexStages() {
     // TODO: This is wrong, but changing it breaks things..
     if (i < 4 && shader.mIndirectOrders[i].refCoord >= matData.texGens.size())
       continue;
-    out += generateIndTexStage(i);
+    llvm::cantFail(generateIndTexStage(builder, i));
   }
-  return out;
+  return llvm::Error::success();
 }
 
 // TEV
-std::string GXProgram::generateKonstColorSel(gx::TevKColorSel konstColor) {
+const char* GXProgram::generateKonstColorSel(gx::TevKColorSel konstColor) {
   switch (konstColor) {
   case gx::TevKColorSel::const_8_8:
     return "vec3(8.0/8.0)";
@@ -555,7 +626,7 @@ std::string GXProgram::generateKonstColorSel(gx::TevKColorSel konstColor) {
   }
 }
 
-std::string GXProgram::generateKonstAlphaSel(gx::TevKAlphaSel konstAlpha) {
+const char* GXProgram::generateKonstAlphaSel(gx::TevKAlphaSel konstAlpha) {
   switch (konstAlpha) {
   default: // k0/k1/k2/k3 not valid for alpha
   case gx::TevKAlphaSel::const_8_8:
@@ -609,7 +680,7 @@ std::string GXProgram::generateKonstAlphaSel(gx::TevKAlphaSel konstAlpha) {
   }
 }
 
-std::string GXProgram::generateRas(const gx::TevStage& stage) {
+const char* GXProgram::generateRas(const gx::TevStage& stage) {
   switch (stage.rasOrder) {
   case gx::ColorSelChanApi::color0: // For custom files..
   case gx::ColorSelChanApi::alpha0:
@@ -628,13 +699,16 @@ std::string GXProgram::generateRas(const gx::TevStage& stage) {
   }
 }
 
-std::string GXProgram::generateTexAccess(const gx::TevStage& stage) {
-  if (stage.texMap == 0xff)
-    return "vec4(1.0, 1.0, 1.0, 1.0)";
+llvm::Error GXProgram::generateTexAccess(StringBuilder& builder,
+                                         const gx::TevStage& stage) {
+  if (stage.texMap == 0xff) {
+    builder += "vec4(1.0, 1.0, 1.0, 1.0)";
+    return llvm::Error::success();
+  }
 
-  return generateTextureSample(stage.texMap, "t_TexCoord");
+  return generateTextureSample(builder, stage.texMap, "t_TexCoord");
 }
-std::string
+const char*
 GXProgram::generateComponentSwizzle(const gx::SwapTableEntry* swapTable,
                                     gx::ColorComponent channel) {
   const char* suffixes[] = {"r", "g", "b", "a"};
@@ -646,7 +720,8 @@ GXProgram::generateComponentSwizzle(const gx::SwapTableEntry* swapTable,
   return suffixes[(u8)channel];
 }
 
-std::string GXProgram::generateColorSwizzle(const gx::SwapTableEntry* swapTable,
+llvm::Error GXProgram::generateColorSwizzle(StringBuilder& builder,
+                                            const gx::SwapTableEntry* swapTable,
                                             gx::TevColorArg colorIn) {
   const auto swapR = generateComponentSwizzle(swapTable, gx::ColorComponent::r);
   const auto swapG = generateComponentSwizzle(swapTable, gx::ColorComponent::g);
@@ -656,123 +731,147 @@ std::string GXProgram::generateColorSwizzle(const gx::SwapTableEntry* swapTable,
   switch (colorIn) {
   case gx::TevColorArg::texc:
   case gx::TevColorArg::rasc:
-    return swapR + swapG + swapB;
+    builder += swapR;
+    builder += swapG;
+    builder += swapB;
+    break;
   case gx::TevColorArg::texa:
   case gx::TevColorArg::rasa:
-    return swapA + swapA + swapA;
+    builder += swapA;
+    builder += swapA;
+    builder += swapA;
+    break;
   default:
     throw "whoops";
   }
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateColorIn(const gx::TevStage& stage,
+llvm::Error GXProgram::generateColorIn(StringBuilder& builder,
+                                       const gx::TevStage& stage,
                                        gx::TevColorArg colorIn) {
+  const auto& swapTable = mMaterial.mat.getMaterialData().shader.mSwapTable;
   switch (colorIn) {
   case gx::TevColorArg::cprev:
-    return "t_ColorPrev.rgb";
+    builder += "t_ColorPrev.rgb";
+    break;
   case gx::TevColorArg::aprev:
-    return "t_ColorPrev.aaa";
+    builder += "t_ColorPrev.aaa";
+    break;
   case gx::TevColorArg::c0:
-    return "t_Color0.rgb";
+    builder += "t_Color0.rgb";
+    break;
   case gx::TevColorArg::a0:
-    return "t_Color0.aaa";
+    builder += "t_Color0.aaa";
+    break;
   case gx::TevColorArg::c1:
-    return "t_Color1.rgb";
+    builder += "t_Color1.rgb";
+    break;
   case gx::TevColorArg::a1:
-    return "t_Color1.aaa";
+    builder += "t_Color1.aaa";
+    break;
   case gx::TevColorArg::c2:
-    return "t_Color2.rgb";
+    builder += "t_Color2.rgb";
+    break;
   case gx::TevColorArg::a2:
-    return "t_Color2.aaa";
+    builder += "t_Color2.aaa";
+    break;
   case gx::TevColorArg::texc:
-    return generateTexAccess(stage) + "." +
-           generateColorSwizzle(&mMaterial.mat.getMaterialData()
-                                     .shader.mSwapTable[stage.texMapSwap],
-                                colorIn);
   case gx::TevColorArg::texa:
-    return generateTexAccess(stage) + "." +
-           generateColorSwizzle(&mMaterial.mat.getMaterialData()
-                                     .shader.mSwapTable[stage.texMapSwap],
-                                colorIn);
+    llvm::cantFail(generateTexAccess(builder, stage));
+    builder += ".";
+    llvm::cantFail(generateColorSwizzle(
+        builder, &swapTable[stage.texMapSwap], colorIn));
+    break;
   case gx::TevColorArg::rasc:
-    return "TevSaturate(" + generateRas(stage) + "." +
-           generateColorSwizzle(&mMaterial.mat.getMaterialData()
-                                     .shader.mSwapTable[stage.rasSwap],
-                                colorIn) +
-           ")";
   case gx::TevColorArg::rasa:
-    return "TevSaturate(" + generateRas(stage) + "." +
-           generateColorSwizzle(&mMaterial.mat.getMaterialData()
-                                     .shader.mSwapTable[stage.rasSwap],
-                                colorIn) +
-           ")";
+    builder += "TevSaturate(";
+    builder += generateRas(stage);
+    builder += ".";
+    llvm::cantFail(
+        generateColorSwizzle(builder, &swapTable[stage.rasSwap], colorIn));
+    builder += ")";
+    break;
   case gx::TevColorArg::one:
-    return "vec3(1)";
+    builder += "vec3(1)";
+    break;
   case gx::TevColorArg::half:
-    return "vec3(1.0/2.0)";
+    builder += "vec3(1.0/2.0)";
+    break;
   case gx::TevColorArg::konst:
-    return generateKonstColorSel(stage.colorStage.constantSelection);
+    builder += generateKonstColorSel(stage.colorStage.constantSelection);
+    break;
   case gx::TevColorArg::zero:
-    return "vec3(0)";
+    builder += "vec3(0)";
+    break;
   }
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateAlphaIn(const gx::TevStage& stage,
+llvm::Error GXProgram::generateAlphaIn(StringBuilder& builder,
+                                       const gx::TevStage& stage,
                                        gx::TevAlphaArg alphaIn) {
+  const auto& swapTable = mMaterial.mat.getMaterialData().shader.mSwapTable;
   switch (alphaIn) {
   case gx::TevAlphaArg::aprev:
-    return "t_ColorPrev.a";
+    builder += "t_ColorPrev.a";
+    break;
   case gx::TevAlphaArg::a0:
-    return "t_Color0.a";
+    builder += "t_Color0.a";
+    break;
   case gx::TevAlphaArg::a1:
-    return "t_Color1.a";
+    builder += "t_Color1.a";
+    break;
   case gx::TevAlphaArg::a2:
-    return "t_Color2.a";
+    builder += "t_Color2.a";
+    break;
   case gx::TevAlphaArg::texa:
-    return generateTexAccess(stage) + "." +
-           generateComponentSwizzle(&mMaterial.mat.getMaterialData()
-                                         .shader.mSwapTable[stage.texMapSwap],
-                                    gx::ColorComponent::a);
+    llvm::cantFail(generateTexAccess(builder, stage));
+    builder += ".";
+    builder += generateComponentSwizzle(&swapTable[stage.texMapSwap],
+                                        gx::ColorComponent::a);
+    break;
   case gx::TevAlphaArg::rasa:
-    return "TevSaturate(" + generateRas(stage) + "." +
-           generateComponentSwizzle(&mMaterial.mat.getMaterialData()
-                                         .shader.mSwapTable[stage.rasSwap],
-                                    gx::ColorComponent::a) +
-           ")";
+    builder += "TevSaturate(";
+    builder += generateRas(stage);
+    builder += ".";
+    builder += generateComponentSwizzle(&swapTable[stage.rasSwap],
+                                        gx::ColorComponent::a);
+    builder += ")";
+    break;
   case gx::TevAlphaArg::konst:
-    return generateKonstAlphaSel(stage.alphaStage.constantSelection);
+    builder += generateKonstAlphaSel(stage.alphaStage.constantSelection);
+    break;
   case gx::TevAlphaArg::zero:
-    return "0.0";
+    builder += "0.0";
+    break;
   }
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTevInputs(const gx::TevStage& stage) {
-  return R"(
-    t_TevA = TevOverflow(vec4()"
-         "\n        " +
-         generateColorIn(stage, stage.colorStage.a) + ",\n        " +
-         generateAlphaIn(stage, stage.alphaStage.a) +
-         "\n    "
-         R"());
-    t_TevB = TevOverflow(vec4()"
-         "\n        " +
-         generateColorIn(stage, stage.colorStage.b) + ",\n        " +
-         generateAlphaIn(stage, stage.alphaStage.b) +
-         "\n    "
-         R"());
-    t_TevC = TevOverflow(vec4()"
-         "\n        " +
-         generateColorIn(stage, stage.colorStage.c) + ",\n        " +
-         generateAlphaIn(stage, stage.alphaStage.c) +
-         "\n    "
-         R"());
-    t_TevD = vec4()"
-         "\n        " +
-         generateColorIn(stage, stage.colorStage.d) + ",\n        " +
-         generateAlphaIn(stage, stage.alphaStage.d) + "\n    );\n"; //.trim();
-}
-
-std::string GXProgram::generateTevRegister(gx::TevReg regId) {
+llvm::Error GXProgram::generateTevInputs(StringBuilder& builder,
+                                         const gx::TevStage& stage) {
+  builder += "\n    t_TevA = TevOverflow(vec4(\n        ";
+  llvm::cantFail(generateColorIn(builder, stage, stage.colorStage.a));
+  builder += ",\n        ";
+  llvm::cantFail(generateAlphaIn(builder, stage, stage.alphaStage.a));
+  builder += "\n    ));\n    t_TevB = TevOverflow(vec4(\n        ";
+  llvm::cantFail(generateColorIn(builder, stage, stage.colorStage.b));
+  builder += ",\n        ";
+  llvm::cantFail(generateAlphaIn(builder, stage, stage.alphaStage.b));
+  builder += "\n    ));\n    t_TevC = TevOverflow(vec4(\n        ";
+  llvm::cantFail(generateColorIn(builder, stage, stage.colorStage.c));
+  builder += ",\n        ";
+  llvm::cantFail(generateAlphaIn(builder, stage, stage.alphaStage.c));
+  builder += "\n    ));\n    t_TevD = vec4(\n        ";
+  llvm::cantFail(generateColorIn(builder, stage, stage.colorStage.d));
+  builder += ",\n        ";
+  llvm::cantFail(generateAlphaIn(builder, stage, stage.alphaStage.d));
+  builder += "\n    );\n";
+  return llvm::Error::success();
+}
+
+const char* GXProgram::generateTevRegister(gx::TevReg regId) {
   switch (regId) {
   case gx::TevReg::prev:
     return "t_ColorPrev";
@@ -785,227 +884,347 @@ std::string GXProgram::generateTevRegister(gx::TevReg regId) {
   }
 }
 
-std::string GXProgram::generateTevOpBiasScaleClamp(const std::string& value,
+llvm::Error GXProgram::generateTevOpBiasScaleClamp(StringBuilder& builder,
+                                                   std::string_view value,
                                                    gx::TevBias bias,
                                                    gx::TevScale scale) {
-  auto v = value;
+  // Scale is applied to the biased value
+  if (scale != gx::TevScale::scale_1)
+    builder += "(";
 
+  if (bias == gx::TevBias::add_half || bias == gx::TevBias::sub_half)
+    builder += "TevBias(";
+  builder += value;
   if (bias == gx::TevBias::add_half)
-    v = "TevBias(" + v + ", 0.5)";
+    builder += ", 0.5)";
   else if (bias == gx::TevBias::sub_half)
-    v = "TevBias(" + v + ", -0.5)";
+    builder += ", -0.5)";
 
   if (scale == gx::TevScale::scale_2)
-    v = "(" + v + ") * 2.0";
+    builder += ") * 2.0";
   else if (scale == gx::TevScale::scale_4)
-    v = "(" + v + ") * 4.0";
+    builder += ") * 4.0";
   else if (scale == gx::TevScale::divide_2)
-    v = "(" + v + ") * 0.5";
+    builder += ") * 0.5";
 
-  return v;
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTevOp(gx::TevColorOp op, gx::TevBias bias,
-                                     gx::TevScale scale, const std::string& a,
-                                     const std::string& b, const std::string& c,
-                                     const std::string& d,
-                                     const std::string& zero) {
+llvm::Error GXProgram::generateTevOp(StringBuilder& builder, gx::TevColorOp op,
+                                     gx::TevBias bias, gx::TevScale scale,
+                                     std::string_view a, std::string_view b,
+                                     std::string_view c, std::string_view d,
+                                     std::string_view zero) {
+  // ((compare) ? c : zero) + d
+  const auto compare = [&](const char* comparison) {
+    builder += comparison;
+    builder += c;
+    builder += " : ";
+    builder += zero;
+    builder += ") + ";
+    builder += d;
+  };
+
   switch (op) {
   case gx::TevColorOp::add:
   case gx::TevColorOp::subtract: {
-    const auto neg = (op == gx::TevColorOp::subtract) ? "-" : "";
-    const auto v =
-        neg + std::string("mix(") + a + ", " + b + ", " + c + ") + " + d;
-    return generateTevOpBiasScaleClamp(v, bias, scale);
+    char value_buf[128];
+    StringBuilder value(value_buf, sizeof(value_buf));
+    if (op == gx::TevColorOp::subtract)
+      value += "-";
+    value += "mix(";
+    value += a;
+    value += ", ";
+    value += b;
+    value += ", ";
+    value += c;
+    value += ") + ";
+    value += d;
+    return generateTevOpBiasScaleClamp(builder, value.view(), bias, scale);
   }
   case gx::TevColorOp::comp_r8_gt:
-    return "((t_TevA.r >  t_TevB.r) ? " + c + " : " + zero + ") + " + d;
+    compare("((t_TevA.r >  t_TevB.r) ? ");
+    break;
   case gx::TevColorOp::comp_r8_eq:
-    return "((t_TevA.r == t_TevB.r) ? " + c + " : " + zero + ") + " + d;
+    compare("((t_TevA.r == t_TevB.r) ? ");
+    break;
   case gx::TevColorOp::comp_gr16_gt:
-    return "((TevPack16(t_TevA.rg) >  TevPack16(t_TevB.rg)) ? " + c + " : " +
-           zero + ") + " + d;
+    compare("((TevPack16(t_TevA.rg) >  TevPack16(t_TevB.rg)) ? ");
+    break;
   case gx::TevColorOp::comp_gr16_eq:
-    return "((TevPack16(t_TevA.rg) == TevPack16(t_TevB.rg)) ? " + c + " : " +
-           zero + ") + " + d;
+    compare("((TevPack16(t_TevA.rg) == TevPack16(t_TevB.rg)) ? ");
+    break;
   case gx::TevColorOp::comp_bgr24_gt:
-    return "((TevPack24(t_TevA.rgb) >  TevPack24(t_TevB.rgb)) ? " + c + " : " +
-           zero + ") + " + d;
+    compare("((TevPack24(t_TevA.rgb) >  TevPack24(t_TevB.rgb)) ? ");
+    break;
   case gx::TevColorOp::comp_bgr24_eq:
-    return "((TevPack24(t_TevA.rgb) == TevPack24(t_TevB.rgb)) ? " + c + " : " +
-           zero + ") + " + d;
+    compare("((TevPack24(t_TevA.rgb) == TevPack24(t_TevB.rgb)) ? ");
+    break;
   case gx::TevColorOp::comp_rgb8_gt:
-    return "(TevPerCompGT(${a}, ${b}) * ${c}) + ${d}";
+    builder += "(TevPerCompGT(${a}, ${b}) * ${c}) + ${d}";
+    break;
   case gx::TevColorOp::comp_rgb8_eq:
-    return "(TevPerCompEQ(${a}, ${b}) * ${c}) + ${d}";
+    builder += "(TevPerCompEQ(${a}, ${b}) * ${c}) + ${d}";
+    break;
   default:
     throw "";
   }
 
-  return "";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTevOpValue(
-    gx::TevColorOp op, gx::TevBias bias, gx::TevScale scale, bool clamp,
-    const std::string& a, const std::string& b, const std::string& c,
-    const std::string& d, const std::string& zero) {
-  const auto expr = generateTevOp(op, bias, scale, a, b, c, d, zero);
-
+llvm::Error GXProgram::generateTevOpValue(
+    StringBuilder& builder, gx::TevColorOp op, gx::TevBias bias,
+    gx::TevScale scale, bool clamp, std::string_view a, std::string_view b,
+    std::string_view c, std::string_view d, std::string_view zero) {
   if (clamp)
-    return "TevSaturate(" + expr + ")";
-  else
-    return expr;
+    builder += "TevSaturate(";
+  llvm::cantFail(generateTevOp(builder, op, bias, scale, a, b, c, d, zero));
+  if (clamp)
+    builder += ")";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateColorOp(const gx::TevStage& stage) {
+llvm::Error GXProgram::generateColorOp(StringBuilder& builder,
+                                       const gx::TevStage& stage) {
   const auto a = "t_TevA.rgb", b = "t_TevB.rgb", c = "t_TevC.rgb",
              d = "t_TevD.rgb", zero = "vec3(0)";
-  const auto value = generateTevOpValue(
-      stage.colorStage.formula, stage.colorStage.bias, stage.colorStage.scale,
-      stage.colorStage.clamp, a, b, c, d, zero);
-  return std::string("    ") + generateTevRegister(stage.colorStage.out) +
-         ".rgb = " + value + ";\n";
+  builder += "    ";
+  builder += generateTevRegister(stage.colorStage.out);
+  builder += ".rgb = ";
+  llvm::cantFail(generateTevOpValue(
+      builder, stage.colorStage.formula, stage.colorStage.bias,
+      stage.colorStage.scale, stage.colorStage.clamp, a, b, c, d, zero));
+  builder += ";\n";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateAlphaOp(const gx::TevStage& stage) {
+llvm::Error GXProgram::generateAlphaOp(StringBuilder& builder,
+                                       const gx::TevStage& stage) {
   const auto a = "t_TevA.a", b = "t_TevB.a", c = "t_TevC.a", d = "t_TevD.a",
              zero = "0.0";
-  const auto value =
-      generateTevOpValue(static_cast<gx::TevColorOp>(stage.alphaStage.formula),
-                         stage.alphaStage.bias, stage.alphaStage.scale,
-                         stage.alphaStage.clamp, a, b, c, d, zero);
-  return std::string("    ") + generateTevRegister(stage.alphaStage.out) +
-         ".a = " + value + ";\n";
+  builder += "    ";
+  builder += generateTevRegister(stage.alphaStage.out);
+  builder += ".a = ";
+  llvm::cantFail(generateTevOpValue(
+      builder, static_cast<gx::TevColorOp>(stage.alphaStage.formula),
+      stage.alphaStage.bias, stage.alphaStage.scale, stage.alphaStage.clamp, a,
+      b, c, d, zero));
+  builder += ";\n";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTevTexCoordWrapN(const std::string& texCoord,
+llvm::Error GXProgram::generateTevTexCoordWrapN(StringBuilder& builder,
+                                                std::string_view texCoord,
                                                 gx::IndTexWrap wrap) {
+  const auto mod = [&](const char* divisor) {
+    builder += "mod(";
+    builder += texCoord;
+    builder += ", ";
+    builder += divisor;
+    builder += ")";
+  };
   switch (wrap) {
   case gx::IndTexWrap::off:
-    return texCoord;
+    builder += texCoord;
+    break;
   case gx::IndTexWrap::_0:
-    return "0.0";
+    builder += "0.0";
+    break;
   case gx::IndTexWrap::_256:
-    return "mod(" + texCoord + ", 256.0)";
+    mod("256.0");
+    break;
   case gx::IndTexWrap::_128:
-    return "mod(" + texCoord + ", 128.0)";
+    mod("128.0");
+    break;
   case gx::IndTexWrap::_64:
-    return "mod(" + texCoord + ", 64.0)";
+    mod("64.0");
+    break;
   case gx::IndTexWrap::_32:
-    return "mod(" + texCoord + ", 32.0)";
+    mod("32.0");
+    break;
   case gx::IndTexWrap::_16:
-    return "mod(" + texCoord + ", 16.0)";
+    mod("16.0");
+    break;
   }
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTevTexCoordWrap(const gx::TevStage& stage) {
+llvm::Error GXProgram::generateTevTexCoordWrap(StringBuilder& builder,
+                                               const gx::TevStage& stage) {
   const int lastTexGenId = mMaterial.mat.getMaterialData().texGens.size() - 1;
   int texGenId = stage.texCoord;
 
   if (texGenId >= lastTexGenId)
     texGenId = lastTexGenId;
-  if (texGenId < 0)
-    return "vec2(0.0, 0.0)";
+  if (texGenId < 0) {
+    builder += "vec2(0.0, 0.0)";
+    return llvm::Error::success();
+  }
 
-  const auto baseCoord = "ReadTexCoord" + std::to_string(texGenId) + "()";
+  const auto baseCoord = [&](StringBuilder& out) {
+    out += "ReadTexCoord";
+    out.appendInt(texGenId);
+    out += "()";
+  };
   if (stage.indirectStage.wrapU == gx::IndTexWrap::off &&
-      stage.indirectStage.wrapV == gx::IndTexWrap::off)
-    return baseCoord;
-  else
-    return "vec2(" +
-           generateTevTexCoordWrapN(baseCoord + ".x",
-                                    stage.indirectStage.wrapU) +
-           ", " +
-           generateTevTexCoordWrapN(baseCoord + ".y",
-                                    stage.indirectStage.wrapV) +
-           ")";
-}
-
-std::string
-GXProgram::generateTevTexCoordIndTexCoordBias(const gx::TevStage& stage) {
-  const std::string bias =
+      stage.indirectStage.wrapV == gx::IndTexWrap::off) {
+    baseCoord(builder);
+    return llvm::Error::success();
+  }
+
+  char u_buf[32], v_buf[32];
+  StringBuilder u(u_buf, sizeof(u_buf)), v(v_buf, sizeof(v_buf));
+  baseCoord(u);
+  u += ".x";
+  baseCoord(v);
+  v += ".y";
+  builder += "vec2(";
+  llvm::cantFail(
+      generateTevTexCoordWrapN(builder, u.view(), stage.indirectStage.wrapU));
+  builder += ", ";
+  llvm::cantFail(
+      generateTevTexCoordWrapN(builder, v.view(), stage.indirectStage.wrapV));
+  builder += ")";
+  return llvm::Error::success();
+}
+
+llvm::Error
+GXProgram::generateTevTexCoordIndTexCoordBias(StringBuilder& builder,
+                                              const gx::TevStage& stage) {
+  const char* bias =
       (stage.indirectStage.format == gx::IndTexFormat::_8bit) ? "-128.0"
                                                               : "1.0";
+  // Each component is the bias or 0.0
+  const auto vec3 = [&](bool s, bool t, bool u) {
+    builder += " + vec3(";
+    builder += s ? bias : "0.0";
+    builder += ", ";
+    builder += t ? bias : "0.0";
+    builder += ", ";
+    builder += u ? bias : "0.0";
+    builder += ")";
+  };
 
   switch (stage.indirectStage.bias) {
   case gx::IndTexBiasSel::none:
-    return "";
+    break;
   case gx::IndTexBiasSel::s:
-    return " + vec3(" + bias + ", 0.0, 0.0)";
+    vec3(true, false, false);
+    break;
   case gx::IndTexBiasSel::st:
-    return " + vec3(" + bias + ", " + bias + ", 0.0)";
+    vec3(true, true, false);
+    break;
   case gx::IndTexBiasSel::su:
-    return " + vec3(" + bias + ", 0.0, " + bias + ")";
+    vec3(true, false, true);
+    break;
   case gx::IndTexBiasSel::t:
-    return " + vec3(0.0, " + bias + ", 0.0)";
+    vec3(false, true, false);
+    break;
   case gx::IndTexBiasSel::tu:
-    return " + vec3(0.0, " + bias + ", " + bias + ")";
+    vec3(false, true, true);
+    break;
   case gx::IndTexBiasSel::u:
-    return " + vec3(0.0, 0.0, " + bias + ")";
+    vec3(false, false, true);
+    break;
   case gx::IndTexBiasSel::stu:
-    return " + vec3(" + bias + ")";
+    builder += " + vec3(";
+    builder += bias;
+    builder += ")";
+    break;
   }
+  return llvm::Error::success();
 }
 
-std::string
-GXProgram::generateTevTexCoordIndTexCoord(const gx::TevStage& stage) {
-  const auto baseCoord =
-      "(t_IndTexCoord" + std::to_string(stage.indirectStage.indStageSel) + ")";
+llvm::Error
+GXProgram::generateTevTexCoordIndTexCoord(StringBuilder& builder,
+                                          const gx::TevStage& stage) {
   switch (stage.indirectStage.format) {
   case gx::IndTexFormat::_8bit:
-    return baseCoord;
+    break;
   default:
     printf("Warning: Unsupported IndTexFmt\n");
-    return baseCoord;
+    break;
   }
+  builder += "(t_IndTexCoord";
+  builder.appendInt(stage.indirectStage.indStageSel);
+  builder += ")";
+  return llvm::Error::success();
 }
 
-std::string
-GXProgram::generateTevTexCoordIndirectMtx(const gx::TevStage& stage) {
-  const auto indTevCoord = "(" + generateTevTexCoordIndTexCoord(stage) +
-                           generateTevTexCoordIndTexCoordBias(stage) + ")";
-
+llvm::Error
+GXProgram::generateTevTexCoordIndirectMtx(StringBuilder& builder,
+                                          const gx::TevStage& stage) {
+  char coord_buf[64];
+  StringBuilder indTevCoord(coord_buf, sizeof(coord_buf));
+  indTevCoord += "(";
+  llvm::cantFail(generateTevTexCoordIndTexCoord(indTevCoord, stage));
+  llvm::cantFail(generateTevTexCoordIndTexCoordBias(indTevCoord, stage));
+  indTevCoord += ")";
+
+  const auto mul = [&](const char* mtx) {
+    builder += "(";
+    builder += mtx;
+    builder += " * vec4(";
+    builder += indTevCoord.view();
+    builder += ", 0.0))";
+  };
   switch (stage.indirectStage.matrix) {
   case gx::IndTexMtxID::_0:
-    return "(u_IndTexMtx[0] * vec4(" + indTevCoord + ", 0.0))";
+    mul("u_IndTexMtx[0]");
+    break;
   case gx::IndTexMtxID::_1:
-    return "(u_IndTexMtx[1] * vec4(" + indTevCoord + ", 0.0))";
+    mul("u_IndTexMtx[1]");
+    break;
   case gx::IndTexMtxID::_2:
-    return "(u_IndTexMtx[2] * vec4(" + indTevCoord + ", 0.0))";
+    mul("u_IndTexMtx[2]");
+    break;
   default:
     printf("Unimplemented indTexMatrix mode: %u\n",
            (u32)stage.indirectStage.matrix);
-    return indTevCoord + ".xy";
+    builder += indTevCoord.view();
+    builder += ".xy";
+    break;
   }
+  return llvm::Error::success();
 }
 
-std::string
-GXProgram::generateTevTexCoordIndirectTranslation(const gx::TevStage& stage) {
-  return "(" + generateTevTexCoordIndirectMtx(stage) + " * TextureInvScale(" +
-         std::to_string(stage.texMap) + "))";
+llvm::Error
+GXProgram::generateTevTexCoordIndirectTranslation(StringBuilder& builder,
+                                                  const gx::TevStage& stage) {
+  builder += "(";
+  llvm::cantFail(generateTevTexCoordIndirectMtx(builder, stage));
+  builder += " * TextureInvScale(";
+  builder.appendInt(stage.texMap);
+  builder += "))";
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTevTexCoordIndirect(const gx::TevStage& stage) {
-  const auto baseCoord = generateTevTexCoordWrap(stage);
+llvm::Error GXProgram::generateTevTexCoordIndirect(StringBuilder& builder,
+                                                   const gx::TevStage& stage) {
+  llvm::cantFail(generateTevTexCoordWrap(builder, stage));
 
   if (stage.indirectStage.matrix != gx::IndTexMtxID::off &&
       stage.indirectStage.indStageSel <
-          mMaterial.mat.getMaterialData().shader.mStages.size())
-    return baseCoord + " + " + generateTevTexCoordIndirectTranslation(stage);
-  else
-    return baseCoord;
+          mMaterial.mat.getMaterialData().shader.mStages.size()) {
+    builder += " + ";
+    llvm::cantFail(generateTevTexCoordIndirectTranslation(builder, stage));
+  }
+  return llvm::Error::success();
 }
 
-std::string GXProgram::generateTevTexCoord(const gx::TevStage& stage) {
+llvm::Error GXProgram::generateTevTexCoord(StringBuilder& builder,
+                                           const gx::TevStage& stage) {
   if (stage.texCoord == 0xff)
-    return "";
+    return llvm::Error::success();
 
-  const auto finalCoord = generateTevTexCoordIndirect(stage);
-  if (stage.indirectStage.addPrev) {
-    return "    t_TexCoord += " + finalCoord + ";\n";
-  } else {
-    return "    t_TexCoord = " + finalCoord + ";\n";
-  }
+  if (stage.indirectStage.addPrev)
+    builder += "    t_TexCoord += ";
+  else
+    builder += "    t_TexCoord = ";
+  llvm::cantFail(generateTevTexCoordIndirect(builder, stage));
+  builder += ";\n";
+  return llvm::Error::success();
 }
 
 llvm::Error GXProgram::generateTevStage(StringBuilder& builder,
@@ -1014,12 +1233,12 @@ llvm::Error GXProgram::generateTevStage(StringBuilder& builder,
       mMaterial.mat.getMaterialData().shader.mStages[tevStageIndex];
 
   builder += "\n\n    //\n    // TEV Stage ";
-  builder += std::to_string(tevStageIndex);
+  builder.appendInt(tevStageIndex);
   builder += "\n    //\n";
-  builder += generateTevTexCoord(stage);
-  builder += generateTevInputs(stage);
-  builder += generateColorOp(stage);
-  builder += generateAlphaOp(stage);
+  llvm::cantFail(generateTevTexCoord(builder, stage));
+  llvm::cantFail(generateTevInputs(builder, stage));
+  llvm::cantFail(generateColorOp(builder, stage));
+  llvm::cantFail(generateAlphaOp(builder, stage));
 
   return llvm::Error::success();
 }
@@ -1038,14 +1257,21 @@ GXProgram::generateTevStagesLastMinuteFixup(StringBuilder& builder) {
   const auto& tevStages = mMaterial.mat.getMaterialData().shader.mStages;
 
   const auto& lastTevStage = tevStages[tevStages.size() - 1];
-  const auto colorReg = generateTevRegister(lastTevStage.colorStage.out);
-  const auto alphaReg = generateTevRegister(lastTevStage.alphaStage.out);
+  const std::string_view colorReg =
+      generateTevRegister(lastTevStage.colorStage.out);
+  const std::string_view alphaReg =
+      generateTevRegister(lastTevStage.alphaStage.out);
 
   if (colorReg == alphaReg) {
-    builder += "    vec4 t_TevOutput = " + colorReg + ";\n";
+    builder += "    vec4 t_TevOutput = ";
+    builder += colorReg;
+    builder += ";\n";
   } else {
-    builder += "    vec4 t_TevOutput = vec4(" + colorReg + ".rgb, " + alphaReg +
-               ".a);\n";
+    builder += "    vec4 t_TevOutput = vec4(";
+    builder += colorReg;
+    builder += ".rgb, ";
+    builder += alphaReg;
+    builder += ".a);\n";
   }
 
   return llvm::Error::success();
@@ -1054,7 +1280,9 @@ GXProgram::generateTevStagesLastMinuteFixup(StringBuilder& builder) {
 llvm::Error GXProgram::generateAlphaTestCompare(StringBuilder& builder,
                                                 gx::Comparison compare,
                                                 float reference) {
-  const auto ref = std::to_string(static_cast<f32>(reference));
+  // Formatted as std::to_string would
+  char ref[64];
+  std::snprintf(ref, sizeof(ref), "%f", static_cast<f32>(reference));
   switch (compare) {
   case gx::Comparison::NEVER:
     builder += "false";
@@ -1123,18 +1351,30 @@ llvm::Error GXProgram::generateAlphaTest(StringBuilder& builder) {
   builder += "	if (!(";
   llvm::cantFail(generateAlphaTestOp(builder, alphaTest.op));
   builder += "))\n";
-  builder += "		discard; \n";
+  builder += "		discard;\n";
 
   return llvm::Error::success();
 }
-std::string GXProgram::generateFogZCoord() { return ""; }
-std::string GXProgram::generateFogBase() { return ""; }
+llvm::Error GXProgram::generateFogZCoord(StringBuilder& builder) {
+  return llvm::Error::success();
+}
+llvm::Error GXProgram::generateFogBase(StringBuilder& builder) {
+  return llvm::Error::success();
+}
 
-std::string GXProgram::generateFogAdj(const std::string& base) { return ""; }
+llvm::Error GXProgram::generateFogAdj(StringBuilder& builder,
+                                      std::string_view base) {
+  return llvm::Error::success();
+}
 
-std::string GXProgram::generateFogFunc(const std::string& base) { return ""; }
+llvm::Error GXProgram::generateFogFunc(StringBuilder& builder,
+                                       std::string_view base) {
+  return llvm::Error::success();
+}
 
-std::string GXProgram::generateFog() { return ""; }
+llvm::Error GXProgram::generateFog(StringBuilder& builder) {
+  return llvm::Error::success();
+}
 llvm::Error GXProgram::generateAttributeStorageType(StringBuilder& builder,
                                                     u32 glFormat, u32 count) {
   assert(glFormat == GL_FLOAT && "Invalid format");
@@ -1165,7 +1405,7 @@ llvm::Error GXProgram::generateVertAttributeDefs(StringBuilder& builder) {
   for (const auto& attr : vtxAttributeGenDefs) {
     // if (attr.format != GL_FLOAT) continue;
     builder += "layout(location = ";
-    builder += std::to_string(i);
+    builder.appendInt(i);
     builder += ")";
 
     builder += " in ";
@@ -1183,11 +1423,9 @@ llvm::Error GXProgram::generateMulPos(StringBuilder& builder) {
   // Default to using pnmtxidx.
   const auto src = "vec4(a_Position, 1.0)";
   if (mMaterial.usePnMtxIdx)
-    builder += generateMulPntMatrixDynamic("uint(a_PnMtxIdx)", src);
+    return generateMulPntMatrixDynamic(builder, "uint(a_PnMtxIdx)", src);
   else
-    builder += generateMulPntMatrixStatic(gx::PostTexMatrix::Matrix0, src);
-
-  return llvm::Error::success();
+    return generateMulPntMatrixStatic(builder, gx::PostTexMatrix::Matrix0, src);
 }
 
 llvm::Error GXProgram::generateMulNrm(StringBuilder& builder) {
@@ -1195,59 +1433,50 @@ llvm::Error GXProgram::generateMulNrm(StringBuilder& builder) {
   const auto src = "vec4(a_Normal, 0.0)";
   // TODO(jstpierre): Move to a normal matrix calculated on the CPU
   if (mMaterial.usePnMtxIdx)
-    builder += generateMulPntMatrixDynamic("uint(a_PnMtxIdx)", src);
+    return generateMulPntMatrixDynamic(builder, "uint(a_PnMtxIdx)", src);
   else
-    builder += generateMulPntMatrixStatic(gx::PostTexMatrix::Matrix0, src);
-
-  return llvm::Error::success();
+    return generateMulPntMatrixStatic(builder, gx::PostTexMatrix::Matrix0, src);
 }
 
+#if _WIN32
+static const char ShaderVersion[] = "#version 440\n";
+#else
+static const char ShaderVersion[] = "#version 300 es\n";
+#endif
+
 std::pair<std::string, std::string> GXProgram::generateShaders() {
+  auto& cache = ShaderSourceCache::global();
+  const u64 key = hashShaderState(mMaterial);
+  auto sources = cache.find(key);
+  if (!sources) {
+    // Reused across calls: once warm, generation does not allocate
+    thread_local StringBuilder vert, frag;
+    vert.reset();
+    frag.reset();
+    llvm::cantFail(generateShaderBodies(vert, frag));
+    sources.emplace(vert.view(), frag.view());
+    cache.insert(key, *sources);
+  }
+  // The version directive must come first
+  const std::string& name = mMaterial.mat.getName();
+  const auto withHeader = [&](const std::string& body) {
+    std::string source;
+    source.reserve(sizeof(ShaderVersion) + name.size() + 4 + body.size());
+    source += ShaderVersion;
+    source += "// ";
+    source += name;
+    source += "\n";
+    source += body;
+    return source;
+  };
+  return {withHeader(sources->first), withHeader(sources->second)};
+}
+
+llvm::Error GXProgram::generateShaderBodies(StringBuilder& vert,
+                                            StringBuilder& frag) {
   const auto bindingsDefinition = generateBindingsDefinition(
       mMaterial.hasPostTexMtxBlock, mMaterial.hasLightsBlock);
 
-#if _WIN32
-  const auto both = R"(#version 440
-// )" + mMaterial.mat.getName() +
-                    R"(
-precision mediump float;
-)" + bindingsDefinition;
-  const std::string varying_vert =
-      R"(out vec3 v_Position;
-out vec4 v_Color0;
-out vec4 v_Color1;
-out vec3 v_TexCoord0;
-out vec3 v_TexCoord1;
-out vec3 v_TexCoord2;
-out vec3 v_TexCoord3;
-out vec3 v_TexCoord4;
-out vec3 v_TexCoord5;
-out vec3 v_TexCoord6;
-out vec3 v_TexCoord7;
-)";
-  const std::string varying_frag =
-      R"(in vec3 v_Position;
-in vec4 v_Color0;
-in vec4 v_Color1;
-in vec3 v_TexCoord0;
-in vec3 v_TexCoord1;
-in vec3 v_TexCoord2;
-in vec3 v_TexCoord3;
-in vec3 v_TexCoord4;
-in vec3 v_TexCoord5;
-in vec3 v_TexCoord6;
-in vec3 v_TexCoord7;
-
-
-out vec4 fragOut;
-)";
-#else
-
-  const auto both = R"(#version 300 es
-// )" + mMaterial.mat.getName() +
-                    R"(
-precision mediump float;
-)" + bindingsDefinition;
 #if 0
 	const std::string varying =
 		R"(varying vec3 v_Position;
@@ -1266,7 +1495,7 @@ varying vec3 v_TexCoord7;
 	const std::string& varying_frag = varying;
 #else
 
-  const std::string varying_vert =
+  const char* varying_vert =
       R"(out vec3 v_Position;
 out vec4 v_Color0;
 out vec4 v_Color1;
@@ -1279,7 +1508,7 @@ out vec3 v_TexCoord5;
 out vec3 v_TexCoord6;
 out vec3 v_TexCoord7;
 )";
-  const std::string varying_frag =
+  const char* varying_frag =
       R"(in vec3 v_Position;
 in vec4 v_Color0;
 in vec4 v_Color1;
@@ -1295,28 +1524,25 @@ out vec4 fragOut;
 )";
 #endif
 
-#endif
-
-  std::array<char, 1024 * 64> vert_buf;
-  StringBuilder vert(vert_buf.data(), vert_buf.size());
-  vert += both;
+  vert += "precision mediump float;\n";
+  vert += bindingsDefinition;
   vert += varying_vert;
   llvm::cantFail(generateVertAttributeDefs(vert));
   vert += "mat4x3 GetPosTexMatrix(uint t_MtxIdx) {\n"
-          "    if (t_MtxIdx == " +
-          std::to_string((int)gx::TexMatrix::Identity) +
-          "u)\n"
+          "    if (t_MtxIdx == ";
+  vert.appendInt((int)gx::TexMatrix::Identity);
+  vert += "u)\n"
           "        return mat4x3(1.0);\n"
-          "    else if (t_MtxIdx >= " +
-          std::to_string((int)gx::TexMatrix::TexMatrix0) +
-          "u)\n"
-          "        return u_TexMtx[(t_MtxIdx - " +
-          std::to_string((int)gx::TexMatrix::TexMatrix0) +
-          "u) / 3u];\n"
+          "    else if (t_MtxIdx >= ";
+  vert.appendInt((int)gx::TexMatrix::TexMatrix0);
+  vert += "u)\n"
+          "        return u_TexMtx[(t_MtxIdx - ";
+  vert.appendInt((int)gx::TexMatrix::TexMatrix0);
+  vert += "u) / 3u];\n"
           "    else\n"
           "        return u_PosMtx[t_MtxIdx / 3u];\n"
-          "}\n" +
-          R"(
+          "}\n";
+  vert += R"(
 float ApplyAttenuation(vec3 t_Coeff, float t_Value) {
     return dot(t_Coeff, vec3(1.0, t_Value, t_Value*t_Value));
 }
@@ -1339,14 +1565,14 @@ float ApplyAttenuation(vec3 t_Coeff, float t_Value) {
           "    vec4 t_ColorChanTemp;\n"
           "    v_Color0 = a_Color0;\n";
   llvm::cantFail(generateLightChannels(vert));
-  vert += generateTexGens();
+  llvm::cantFail(generateTexGens(vert));
   vert += "gl_Position = (u_Projection * vec4(t_Position, 1.0));\n"
           "}\n";
-  std::array<char, 1024 * 64> frag_buf;
-  StringBuilder frag(frag_buf.data(), frag_buf.size());
-  frag += both;
+
+  frag += "precision mediump float;\n";
+  frag += bindingsDefinition;
   frag += varying_frag;
-  frag += generateTexCoordGetters();
+  llvm::cantFail(generateTexCoordGetters(frag));
   frag += R"(
 float TextureLODBias(int index) { return u_SceneTextureLODBias + u_TextureParams[index].w; }
 vec2 TextureInvScale(int index) { return 1.0 / u_TextureParams[index].xy; }
@@ -1375,7 +1601,7 @@ void main() {
     vec4 t_Color1    = u_Color[2];
     vec4 t_Color2    = u_Color[3];
 )";
-  frag += generateIndTexStages();
+  llvm::cantFail(generateIndTexStages(frag));
   frag +=
       R"(
     vec2 t_TexCoord = vec2(0.0, 0.0);
@@ -1384,11 +1610,12 @@ void main() {
   llvm::cantFail(generateTevStagesLastMinuteFixup(frag));
   frag += "    vec4 t_PixelOut = TevOverflow(t_TevOutput);\n";
   llvm::cantFail(generateAlphaTest(frag));
-  frag += generateFog();
+  llvm::cantFail(generateFog(frag));
   frag += "    fragOut = t_PixelOut;\n"
           "}\n";
-  return {vert_buf.data(), frag_buf.data()};
+  return llvm::Error::success();
 }
+
 u32 translateCullMode(gx::CullMode cullMode) {
   switch (cullMode) {
   case gx::CullMode::All:
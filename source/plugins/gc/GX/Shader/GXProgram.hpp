@@ -4,6 +4,7 @@
 #include <core/util/string_builder.hpp> // StringBuilder
 #include <llvm/Support/Error.h>         // llvm::Error
 #include <string>                       // std::string
+#include <string_view>                  // std::string_view
 #include <vendor/glm/vec4.hpp>
 
 namespace libcube {
@@ -18,12 +19,8 @@ public:
   ~GXProgram() = default;
 
 protected:
-  //----------------------------------
-  // Annotations
-  //----------------------------------
-#define vec2_string std::string
-#define vec3_string std::string
-#define vec4_string std::string
+  // Generators append GLSL to `builder`. Those that return a `const char*`
+  // select a constant expression and do not write.
 
   //----------------------------------
   // Lighting
@@ -34,111 +31,137 @@ protected:
                                     const gx::ChannelControl& chan, int i);
   llvm::Error generateLightDiffFn(StringBuilder& builder,
                                   const gx::ChannelControl& chan,
-                                  const std::string& lightName);
+                                  std::string_view lightName);
   llvm::Error generateLightAttnFn(StringBuilder& builder,
                                   const gx::ChannelControl& chan,
-                                  const std::string& lightName);
+                                  std::string_view lightName);
   llvm::Error generateColorChannel(StringBuilder& builder,
                                    const gx::ChannelControl& chan,
-                                   const std::string& outputName, int i);
+                                   std::string_view outputName, int i);
   llvm::Error generateLightChannel(StringBuilder& builder,
                                    const LightingChannelControl& lightChannel,
-                                   const std::string& outputName, int i);
+                                   std::string_view outputName, int i);
   llvm::Error generateLightChannels(StringBuilder& builder);
 
   //----------------------------------
   // Matrix
   //----------------------------------
-  std::string generateMulPntMatrixStatic(gx::PostTexMatrix pnt,
-                                         const std::string& src);
-  vec3_string generateMulPntMatrixDynamic(const std::string& attrStr,
-                                          const vec4_string& src);
-  std::string generateTexMtxIdxAttr(int index);
+  llvm::Error generateMulPntMatrixStatic(StringBuilder& builder,
+                                         gx::PostTexMatrix pnt,
+                                         std::string_view src);
+  llvm::Error generateMulPntMatrixDynamic(StringBuilder& builder,
+                                          std::string_view attrStr,
+                                          std::string_view src);
+  const char* generateTexMtxIdxAttr(int index);
 
   //----------------------------------
   // Texture Coordinate Generation
   //----------------------------------
-  vec4_string generateTexGenSource(gx::TexGenSrc src);
-  vec3_string generatePostTexGenMatrixMult(const gx::TexCoordGen& texCoordGen,
-                                           int id, const vec4_string& src);
-  vec3_string generateTexGenMatrixMult(const gx::TexCoordGen& texCoordGen,
-                                       int id, const vec3_string& src);
-  vec3_string generateTexGenType(const gx::TexCoordGen& texCoordGen, int id,
-                                 const vec4_string& src);
-  vec3_string generateTexGenNrm(const gx::TexCoordGen& texCoordGen, int id);
-  vec3_string generateTexGenPost(const gx::TexCoordGen& texCoordGen, int id);
-  std::string generateTexGen(const gx::TexCoordGen& texCoordGen, int id);
-  std::string generateTexGens();
-  std::string generateTexCoordGetters();
+  const char* generateTexGenSource(gx::TexGenSrc src);
+  llvm::Error generatePostTexGenMatrixMult(StringBuilder& builder,
+                                           const gx::TexCoordGen& texCoordGen,
+                                           int id);
+  llvm::Error generateTexGenMatrixMult(StringBuilder& builder,
+                                       const gx::TexCoordGen& texCoordGen,
+                                       int id, std::string_view src);
+  llvm::Error generateTexGenType(StringBuilder& builder,
+                                 const gx::TexCoordGen& texCoordGen, int id,
+                                 std::string_view src);
+  llvm::Error generateTexGenNrm(StringBuilder& builder,
+                                const gx::TexCoordGen& texCoordGen, int id);
+  llvm::Error generateTexGenPost(StringBuilder& builder,
+                                 const gx::TexCoordGen& texCoordGen, int id);
+  llvm::Error generateTexGen(StringBuilder& builder,
+                             const gx::TexCoordGen& texCoordGen, int id);
+  llvm::Error generateTexGens(StringBuilder& builder);
+  llvm::Error generateTexCoordGetters(StringBuilder& builder);
 
   //----------------------------------
   // Indirect Texturing
   //----------------------------------
-  std::string
+  const char*
   generateIndTexStageScaleN(gx::IndirectTextureScalePair::Selection scale);
-  std::string
-  generateIndTexStageScale(const gx::TevStage::IndirectStage& stage,
+  llvm::Error
+  generateIndTexStageScale(StringBuilder& builder,
+                           const gx::TevStage::IndirectStage& stage,
                            const gx::IndirectTextureScalePair& scale,
                            const gx::IndOrder& mIndOrder);
 
-  std::string generateTextureSample(u32 index, const std::string& coord);
-  std::string generateIndTexStage(u32 indTexStageIndex);
-  std::string generateIndTexStages();
+  llvm::Error generateTextureSample(StringBuilder& builder, u32 index,
+                                    std::string_view coord);
+  llvm::Error generateIndTexStage(StringBuilder& builder,
+                                  u32 indTexStageIndex);
+  llvm::Error generateIndTexStages(StringBuilder& builder);
 
   //----------------------------------
   // TEV
   //----------------------------------
   // Constant Values
-  std::string generateKonstColorSel(gx::TevKColorSel konstColor);
-  std::string generateKonstAlphaSel(gx::TevKAlphaSel konstAlpha);
+  const char* generateKonstColorSel(gx::TevKColorSel konstColor);
+  const char* generateKonstAlphaSel(gx::TevKAlphaSel konstAlpha);
 
   // Fragment inputs
-  std::string generateRas(const gx::TevStage& stage);
-  std::string generateTexAccess(const gx::TevStage& stage);
+  const char* generateRas(const gx::TevStage& stage);
+  llvm::Error generateTexAccess(StringBuilder& builder,
+                                const gx::TevStage& stage);
 
   // Swizzling / Swap Table
-  std::string generateComponentSwizzle(const gx::SwapTableEntry* swapTable,
+  const char* generateComponentSwizzle(const gx::SwapTableEntry* swapTable,
                                        gx::ColorComponent channel);
-  std::string generateColorSwizzle(const gx::SwapTableEntry* swapTable,
+  llvm::Error generateColorSwizzle(StringBuilder& builder,
+                                   const gx::SwapTableEntry* swapTable,
                                    gx::TevColorArg colorIn);
 
   // Color/Alpha Inputs
-  std::string generateColorIn(const gx::TevStage& stage,
+  llvm::Error generateColorIn(StringBuilder& builder, const gx::TevStage& stage,
                               gx::TevColorArg colorIn);
-  std::string generateAlphaIn(const gx::TevStage& stage,
+  llvm::Error generateAlphaIn(StringBuilder& builder, const gx::TevStage& stage,
                               gx::TevAlphaArg alphaIn);
 
   // Tev Misc
-  std::string generateTevInputs(const gx::TevStage& stage);
-  std::string generateTevRegister(gx::TevReg regId);
-  std::string generateTevOpBiasScaleClamp(const std::string& value,
+  llvm::Error generateTevInputs(StringBuilder& builder,
+                                const gx::TevStage& stage);
+  const char* generateTevRegister(gx::TevReg regId);
+  llvm::Error generateTevOpBiasScaleClamp(StringBuilder& builder,
+                                          std::string_view value,
                                           gx::TevBias bias, gx::TevScale scale);
 
   // Tev Operands
-  std::string generateTevOp(gx::TevColorOp op, gx::TevBias bias,
-                            gx::TevScale scale, const std::string& a,
-                            const std::string& b, const std::string& c,
-                            const std::string& d, const std::string& zero);
-
-  std::string generateTevOpValue(gx::TevColorOp op, gx::TevBias bias,
-                                 gx::TevScale scale, bool clamp,
-                                 const std::string& a, const std::string& b,
-                                 const std::string& c, const std::string& d,
-                                 const std::string& zero);
-
-  std::string generateColorOp(const gx::TevStage& stage);
-  std::string generateAlphaOp(const gx::TevStage& stage);
+  llvm::Error generateTevOp(StringBuilder& builder, gx::TevColorOp op,
+                            gx::TevBias bias, gx::TevScale scale,
+                            std::string_view a, std::string_view b,
+                            std::string_view c, std::string_view d,
+                            std::string_view zero);
+
+  llvm::Error generateTevOpValue(StringBuilder& builder, gx::TevColorOp op,
+                                 gx::TevBias bias, gx::TevScale scale,
+                                 bool clamp, std::string_view a,
+                                 std::string_view b, std::string_view c,
+                                 std::string_view d, std::string_view zero);
+
+  llvm::Error generateColorOp(StringBuilder& builder,
+                              const gx::TevStage& stage);
+  llvm::Error generateAlphaOp(StringBuilder& builder,
+                              const gx::TevStage& stage);
 
   // Indirect Texture Coordinate Transformation
-  std::string generateTevTexCoordWrapN(const std::string& texCoord,
+  llvm::Error generateTevTexCoordWrapN(StringBuilder& builder,
+                                       std::string_view texCoord,
                                        gx::IndTexWrap wrap);
-  std::string generateTevTexCoordWrap(const gx::TevStage& stage);
-  std::string generateTevTexCoordIndTexCoordBias(const gx::TevStage& stage);
-  std::string generateTevTexCoordIndTexCoord(const gx::TevStage& stage);
-  std::string generateTevTexCoordIndirectMtx(const gx::TevStage& stage);
-  std::string generateTevTexCoordIndirectTranslation(const gx::TevStage& stage);
-  std::string generateTevTexCoordIndirect(const gx::TevStage& stage);
-  std::string generateTevTexCoord(const gx::TevStage& stage);
+  llvm::Error generateTevTexCoordWrap(StringBuilder& builder,
+                                      const gx::TevStage& stage);
+  llvm::Error generateTevTexCoordIndTexCoordBias(StringBuilder& builder,
+                                                 const gx::TevStage& stage);
+  llvm::Error generateTevTexCoordIndTexCoord(StringBuilder& builder,
+                                             const gx::TevStage& stage);
+  llvm::Error generateTevTexCoordIndirectMtx(StringBuilder& builder,
+                                             const gx::TevStage& stage);
+  llvm::Error generateTevTexCoordIndirectTranslation(StringBuilder& builder,
+                                                     const gx::TevStage& stage);
+  llvm::Error generateTevTexCoordIndirect(StringBuilder& builder,
+                                          const gx::TevStage& stage);
+  llvm::Error generateTevTexCoord(StringBuilder& builder,
+                                  const gx::TevStage& stage);
 
   // Putting it all together
   llvm::Error generateTevStage(StringBuilder& builder, u32 tevStageIndex);
@@ -156,16 +179,17 @@ protected:
   //----------------------------------
   // Fog
   //----------------------------------
-  std::string generateFogZCoord();
-  std::string generateFogBase();
-  std::string generateFogAdj(const std::string& base);
-  std::string generateFogFunc(const std::string& base);
-  std::string generateFog();
+  llvm::Error generateFogZCoord(StringBuilder& builder);
+  llvm::Error generateFogBase(StringBuilder& builder);
+  llvm::Error generateFogAdj(StringBuilder& builder, std::string_view base);
+  llvm::Error generateFogFunc(StringBuilder& builder, std::string_view base);
+  llvm::Error generateFog(StringBuilder& builder);
 
   //----------------------------------
   // Attributes
   //----------------------------------
-  llvm::Error generateAttributeStorageType(StringBuilder& builder,u32 glFormat, u32 count);
+  llvm::Error generateAttributeStorageType(StringBuilder& builder, u32 glFormat,
+                                           u32 count);
   llvm::Error generateVertAttributeDefs(StringBuilder& builder);
 
   //----------------------------------
@@ -179,8 +203,15 @@ public:
   // Tying it all up
   //----------------------------------
 
+  //! Append the shaders without their version directive and name comment.
+  //! These depend only on the state hashed by `hashShaderState`, and are the
+  //! same on every platform.
+  llvm::Error generateShaderBodies(StringBuilder& vert, StringBuilder& frag);
+
   //! @brief Generate a pair of GLSL shaders for the given GX material.
   //!
+  //! Sources are memoized by shader state in `ShaderSourceCache::global()`.
+  //!
   //! @return vertex_source : fragment_source
   //!
   std::pair<std::string, std::string> generateShaders();
@@ -0,0 +1,201 @@
+#include "GXShaderCache.hpp"
+#include <algorithm> // std::min
+#include <array>     // std::array
+
+namespace libcube {
+
+namespace {
+
+// FNV-1a: simple, and stable across runs and platforms
+class StateHasher {
+public:
+  void add(u32 value) {
+    for (int i = 0; i < 4; ++i) {
+      mHash ^= (value >> (i * 8)) & 0xFF;
+      mHash *= Prime;
+    }
+  }
+  template <typename E> void addEnum(E value) { add(static_cast<u32>(value)); }
+
+  u64 get() const { return mHash; }
+
+private:
+  static constexpr u64 Basis = 0xcbf29ce484222325;
+  static constexpr u64 Prime = 0x100000001b3;
+  u64 mHash = Basis;
+};
+
+void hashChannel(StateHasher& h, const gx::ChannelControl& chan) {
+  h.add(chan.enabled);
+  h.addEnum(chan.Material);
+  if (!chan.enabled)
+    return;
+  h.addEnum(chan.Ambient);
+  h.addEnum(chan.lightMask);
+  if (chan.lightMask != gx::LightID::None) {
+    h.addEnum(chan.diffuseFn);
+    h.addEnum(chan.attenuationFn);
+  }
+}
+
+void hashSwapEntry(StateHasher& h, const gx::SwapTableEntry& entry) {
+  h.addEnum(entry.r);
+  h.addEnum(entry.g);
+  h.addEnum(entry.b);
+  h.addEnum(entry.a);
+}
+
+} // namespace
+
+u64 hashShaderState(const GXMaterial& mat) {
+  const GCMaterialData& data = mat.mat.getMaterialData();
+  StateHasher h;
+
+  h.add(mat.usePnMtxIdx);
+  h.add(mat.hasPostTexMtxBlock);
+  h.add(mat.hasLightsBlock);
+
+  // Lighting: two color/alpha channel pairs, defaulted past the end
+  std::array<gx::ChannelControl, 4> chans;
+  const std::size_t num_chans =
+      std::min<std::size_t>(chans.size(), data.colorChanControls.size());
+  for (std::size_t i = 0; i < num_chans; ++i)
+    chans[i] = data.colorChanControls[i];
+  for (std::size_t i = 0; i < 4; i += 2) {
+    // Channels with matching color and alpha controls are emitted once
+    const bool same = chans[i] == chans[i + 1];
+    h.add(same);
+    hashChannel(h, chans[i]);
+    if (!same)
+      hashChannel(h, chans[i + 1]);
+  }
+
+  // Texgens
+  h.add(data.texGens.size());
+  for (std::size_t i = 0; i < data.texGens.size(); ++i) {
+    const gx::TexCoordGen& gen = data.texGens[i];
+    h.addEnum(gen.func);
+    h.add(gen.normalize);
+    if (gen.func >= gx::TexGenType::Bump0 && gen.func <= gx::TexGenType::Bump7)
+      continue;
+    h.addEnum(gen.sourceParam);
+    if (gen.func == gx::TexGenType::SRTG)
+      continue;
+    h.add(mat.useTexMtxIdx[i]);
+    if (!mat.useTexMtxIdx[i])
+      h.addEnum(gen.matrix);
+  }
+
+  // TEV
+  const gx::Shader& shader = data.shader;
+  h.add(shader.mStages.size());
+  h.add(shader.mIndirectOrders[0].refCoord);
+  for (std::size_t i = 0; i < shader.mStages.size(); ++i) {
+    const gx::TevStage& stage = shader.mStages[i];
+    h.addEnum(stage.rasOrder);
+    h.add(stage.texMap);
+    h.add(stage.texCoord);
+    hashSwapEntry(h, shader.mSwapTable[stage.rasSwap]);
+    hashSwapEntry(h, shader.mSwapTable[stage.texMapSwap]);
+
+    const auto& color = stage.colorStage;
+    h.addEnum(color.constantSelection);
+    h.addEnum(color.a);
+    h.addEnum(color.b);
+    h.addEnum(color.c);
+    h.addEnum(color.d);
+    h.addEnum(color.formula);
+    h.addEnum(color.bias);
+    h.addEnum(color.scale);
+    h.add(color.clamp);
+    h.addEnum(color.out);
+
+    const auto& alpha = stage.alphaStage;
+    h.addEnum(alpha.constantSelection);
+    h.addEnum(alpha.a);
+    h.addEnum(alpha.b);
+    h.addEnum(alpha.c);
+    h.addEnum(alpha.d);
+    h.addEnum(alpha.formula);
+    h.addEnum(alpha.bias);
+    h.addEnum(alpha.scale);
+    h.add(alpha.clamp);
+    h.addEnum(alpha.out);
+
+    const auto& ind = stage.indirectStage;
+    h.add(ind.indStageSel);
+    h.addEnum(ind.format);
+    h.addEnum(ind.bias);
+    h.addEnum(ind.matrix);
+    h.addEnum(ind.wrapU);
+    h.addEnum(ind.wrapV);
+    h.add(ind.addPrev);
+
+    // Indirect texture stage `i`, defaulted past the end
+    const auto scale = i < data.mIndScales.size()
+                           ? data.mIndScales[i]
+                           : gx::IndirectTextureScalePair{};
+    const auto order = i < shader.mIndirectOrders.size()
+                           ? shader.mIndirectOrders[i]
+                           : gx::IndOrder{};
+    h.addEnum(scale.U);
+    h.addEnum(scale.V);
+    h.add(order.refMap);
+    h.add(order.refCoord);
+  }
+
+  // Alpha test
+  const gx::AlphaComparison& alpha_test = data.alphaCompare;
+  h.addEnum(alpha_test.compLeft);
+  h.add(alpha_test.refLeft);
+  h.addEnum(alpha_test.op);
+  h.addEnum(alpha_test.compRight);
+  h.add(alpha_test.refRight);
+
+  return h.get();
+}
+
+ShaderSourceCache& ShaderSourceCache::global() {
+  static ShaderSourceCache cache;
+  return cache;
+}
+
+std::optional<ShaderSourceCache::Sources> ShaderSourceCache::find(u64 key) {
+  std::lock_guard<std::mutex> guard(mMutex);
+  const auto found = mByKey.find(key);
+  if (found == mByKey.end()) {
+    ++mMisses;
+    return std::nullopt;
+  }
+  ++mHits;
+  mEntries.splice(mEntries.begin(), mEntries, found->second);
+  return found->second->sources;
+}
+
+void ShaderSourceCache::insert(u64 key, Sources sources) {
+  std::lock_guard<std::mutex> guard(mMutex);
+  if (const auto found = mByKey.find(key); found != mByKey.end()) {
+    found->second->sources = std::move(sources);
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+    return;
+  }
+  mEntries.push_front({key, std::move(sources)});
+  mByKey.emplace(key, mEntries.begin());
+  while (mEntries.size() > mCapacity) {
+    mByKey.erase(mEntries.back().key);
+    mEntries.pop_back();
+  }
+}
+
+void ShaderSourceCache::clear() {
+  std::lock_guard<std::mutex> guard(mMutex);
+  mEntries.clear();
+  mByKey.clear();
+}
+
+std::size_t ShaderSourceCache::size() const {
+  std::lock_guard<std::mutex> guard(mMutex);
+  return mEntries.size();
+}
+
+} // namespace libcube
@@ -0,0 +1,78 @@
+/*!
+ * @file
+ * @brief Memoization of generated GLSL by material shader state.
+ */
+
+#pragma once
+
+#include "GXMaterial.hpp"
+#include <core/common.h>  // u64
+#include <list>           // std::list
+#include <mutex>          // std::mutex
+#include <optional>       // std::optional
+#include <string>         // std::string
+#include <unordered_map>  // std::unordered_map
+#include <utility>        // std::pair
+
+namespace libcube {
+
+//! @brief Canonical 64-bit hash of the state GXProgram reads to generate
+//! shaders.
+//!
+//! The TEV stages, swap tables, indirect orders and scales, texgens, channel
+//! controls, alpha compare and GXMaterial flags are hashed field by field, in
+//! the form they are emitted: for instance, the swap table entries a stage
+//! references are hashed rather than their indices, and unused texgen matrix
+//! index flags are skipped. Uniform values (colors, matrices), samplers,
+//! pixel engine state and the material name are not part of the hash.
+//!
+//! The hash is stable across runs and platforms.
+//!
+u64 hashShaderState(const GXMaterial& mat);
+
+//! @brief LRU cache of generated vertex/fragment source pairs, keyed by
+//! `hashShaderState`.
+//!
+//! Cached sources omit the material name comment, which GXProgram prepends on
+//! every lookup, so that identically configured materials share an entry.
+//!
+class ShaderSourceCache {
+public:
+  using Sources = std::pair<std::string, std::string>;
+
+  explicit ShaderSourceCache(std::size_t capacity = DefaultCapacity)
+      : mCapacity(capacity) {}
+
+  //! Cache shared by all GXPrograms.
+  static ShaderSourceCache& global();
+
+  //! Sources for `key`, marking them most recently used.
+  std::optional<Sources> find(u64 key);
+  //! Add or replace the sources for `key`, evicting the least recently used
+  //! entry past capacity.
+  void insert(u64 key, Sources sources);
+  void clear();
+
+  std::size_t size() const;
+  std::size_t capacity() const { return mCapacity; }
+  u64 numHits() const { return mHits; }
+  u64 numMisses() const { return mMisses; }
+
+  static constexpr std::size_t DefaultCapacity = 256;
+
+private:
+  struct Entry {
+    u64 key;
+    Sources sources;
+  };
+
+  // Most recently used first
+  std::list<Entry> mEntries;
+  std::unordered_map<u64, std::list<Entry>::iterator> mByKey;
+  std::size_t mCapacity;
+  u64 mHits = 0;
+  u64 mMisses = 0;
+  mutable std::mutex mMutex;
+};
+
+} // namespace libcube
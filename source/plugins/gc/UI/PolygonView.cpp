@@ -78,9 +78,9 @@ void drawProperty(kpi::PropertyDelegate<IndexedPolygon> dl, PolyDataSurface) {
   auto& mesh_data = poly.getMeshData();
 
   auto draw_p = [&](int i, int j) {
-    auto prim = poly.getMatrixPrimitiveIndexedPrimitive(i, j);
+    const auto& prim = poly.getMatrixPrimitiveIndexedPrimitive(i, j);
     u32 k = 0;
-    for (auto& v : prim.mVertices) {
+    for (const auto& v : mesh_data.mMatrixPrimitives[i].vertices(prim)) {
       ImGui::TableNextRow();
 
       riistudio::util::IDScope v_s(k);
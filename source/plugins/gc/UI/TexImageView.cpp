@@ -53,16 +53,12 @@ void exportImage(const Texture& tex, u32 export_lod) {
   }
 #endif
 
-  std::vector<u8> data;
-  tex.decode(data, true);
+  std::vector<u8> data(tex.getDecodedLevelSize(export_lod));
+  tex.decodeLevel(export_lod, data);
 
-  u32 offset = 0;
-  for (u32 i = 0; i < export_lod; ++i)
-    offset += (tex.getWidth() >> i) * (tex.getHeight() >> i) * 4;
-
-  libcube::writeImageStbRGBA(
-      path.c_str(), imgType, tex.getWidth() >> export_lod,
-      tex.getHeight() >> export_lod, data.data() + offset);
+  libcube::writeImageStbRGBA(path.c_str(), imgType,
+                             tex.getWidth() >> export_lod,
+                             tex.getHeight() >> export_lod, data.data());
 }
 
 void importImage(Texture& tex, u32 import_lod) {
@@ -114,7 +110,7 @@ public:
         mImg.clear();
         mImg.resize(tex.getMipmapCount() + 1);
         for (int i = 0; i <= tex.getMipmapCount(); ++i)
-          mImg[i].setFromImage(tex);
+          mImg[i].setFromImageLevel(tex, i);
         lastTex = &tex;
       }
 
@@ -127,7 +123,6 @@ public:
       if (tex.getMipmapCount() > 0) {
         ImGui::Separator();
         for (unsigned i = 1; i <= tex.getMipmapCount(); ++i) {
-          mImg[i].mLod = i;
           mImg[i].draw(75, 75, false);
           if (ImGui::MenuItem(("LOD " + std::to_string(i)).c_str())) {
             export_lod = i;
@@ -143,7 +138,7 @@ public:
         mImg.clear();
         mImg.resize(tex.getMipmapCount() + 1);
         for (int i = 0; i <= tex.getMipmapCount(); ++i)
-          mImg[i].setFromImage(tex);
+          mImg[i].setFromImageLevel(tex, i);
         lastTex = &tex;
       }
 
@@ -156,7 +151,6 @@ public:
       if (tex.getMipmapCount() > 0) {
         ImGui::Separator();
         for (unsigned i = 1; i <= tex.getMipmapCount(); ++i) {
-          mImg[i].mLod = i;
           mImg[i].draw(75, 75, false);
           if (ImGui::MenuItem(("LOD " + std::to_string(i)).c_str())) {
             import_lod = i;
@@ -1,59 +1,171 @@
 #include <plugins/gc/Util/DisplayList.hpp>
 
+#include <algorithm>
+
 namespace libcube {
 
 // This is always BE
 constexpr oishii::EndianSelect CmdProcEndian = oishii::EndianSelect::Big;
 
-static llvm::Expected<u16> ProcessAttr(
-    oishii::BinaryReader& reader,
-    const std::map<gx::VertexAttribute, gx::VertexAttributeType>& attribstypes,
-    gx::VertexAttribute a, u32 vi) {
-  u16 val = 0;
-
-  switch (attribstypes.at(a)) {
-  case gx::VertexAttributeType::None:
-    break;
-  case gx::VertexAttributeType::Byte:
-    val = reader.read<u8, CmdProcEndian, true>();
-    assert(val != 0xff);
+llvm::Expected<VertexDecodePlan>
+CompileVertexDecodePlan(const VertexDescriptor& descriptor) {
+  const VertexLayout& layout = descriptor.getLayout();
+  switch (layout.mStatus) {
+  case VertexLayout::Status::Ok:
+    return layout;
+  case VertexLayout::Status::DirectData:
+    return llvm::createStringError(std::errc::executable_format_error,
+                                   "Direct vertex data is unsupported.");
+  case VertexLayout::Status::UnknownType:
     break;
-  case gx::VertexAttributeType::Short:
-    val = reader.read<u16, CmdProcEndian, true>();
-    if (val == 0xffff) {
-      printf("Index: %u, Attribute: %x\n", vi, (u32)a);
-      reader.warnAt("Disabled vertex", reader.tell() - 2, reader.tell());
+  }
+  return llvm::createStringError(std::errc::executable_format_error,
+                                 "Unknown vertex attribute format.");
+}
+
+u32 DecodeIndexedVertices(
+    std::span<const u8> data, const VertexDecodePlan& plan,
+    MutIndexedVertexRange vertices,
+    std::array<u16, (u64)gx::VertexAttribute::Max>* maxIndices) {
+  assert(data.size() >= plan.mStride * vertices.size());
+
+  std::array<u16, (u64)gx::VertexAttribute::Max> maxima{};
+  const u8* it = data.data();
+  vertices.forEachRun([&](std::size_t first, std::size_t count) {
+    std::array<u16*, (u64)gx::VertexAttribute::Max> streams;
+    for (u32 i = 0; i < plan.mNumAttributes; ++i)
+      streams[i] =
+          vertices.getStream(plan.mAttributes[i].attr, first, count).data();
+
+    for (std::size_t v = 0; v < count; ++v) {
+      for (u32 i = 0; i < plan.mNumAttributes; ++i) {
+        const auto& attrib = plan.mAttributes[i];
+        const u16 val = attrib.size == 1 ? it[0] : (it[0] << 8) | it[1];
+        it += attrib.size;
+
+        streams[i][v] = val;
+        maxima[i] = std::max(maxima[i], val);
+      }
     }
-    assert(val != 0xffff);
-    break;
-  case gx::VertexAttributeType::Direct:
-    if (a != gx::VertexAttribute::PositionNormalMatrixIndex &&
-        a != gx::VertexAttribute::Texture0MatrixIndex &&
-        a != gx::VertexAttribute::Texture1MatrixIndex) {
+  });
+
+  u32 disabled = 0;
+  for (u32 i = 0; i < plan.mNumAttributes; ++i) {
+    const auto& attrib = plan.mAttributes[i];
+    if (maxima[i] == (attrib.size == 1 ? 0xff : 0xffff))
+      disabled |= 1 << (u32)attrib.attr;
 
-      return llvm::createStringError(std::errc::executable_format_error,
-                                     "Direct vertex data is unsupported.");
+    if (maxIndices) {
+      u16& max = (*maxIndices)[(u64)attrib.attr];
+      max = std::max(max, maxima[i]);
     }
-    // As PNM indices are always direct, we
-    // still use them in an all-indexed vertex
-    val = reader.read<u8, CmdProcEndian, true>();
-    assert(val != 0xff);
-    break;
-  default:
-    return llvm::createStringError(std::errc::executable_format_error,
-                                   "Unknown vertex attribute format.");
   }
+  return disabled;
+}
 
-  return val;
+void DecodeIndexedVertices(
+    oishii::BinaryReader& reader, const VertexDecodePlan& plan,
+    MutIndexedVertexRange vertices,
+    std::array<u16, (u64)gx::VertexAttribute::Max>* maxIndices) {
+  const u32 start = reader.tell();
+  const u32 nBytes = plan.mStride * vertices.size();
+  const u32 disabled = DecodeIndexedVertices(
+      {reader.getStreamStart() + start, nBytes}, plan, vertices, maxIndices);
+
+  // Rare, so the decoded streams are searched again for the offsets
+  for (u32 i = 0; disabled != 0 && i < plan.mNumAttributes; ++i) {
+    const auto& attrib = plan.mAttributes[i];
+    if ((disabled & (1 << (u32)attrib.attr)) == 0)
+      continue;
+    const u16 disabledIndex = attrib.size == 1 ? 0xff : 0xffff;
+    for (std::size_t v = 0; v < vertices.size(); ++v) {
+      if (vertices[v].get(attrib.attr) != disabledIndex)
+        continue;
+      const u32 ofs =
+          start + v * plan.mStride + plan.mOffsets[(u32)attrib.attr];
+      reader.warnAt("Disabled vertex", ofs, ofs + attrib.size);
+    }
+  }
+  reader.skip(nBytes);
+}
+
+void EncodeIndexedVertices(std::span<u8> out, const VertexDecodePlan& plan,
+                           ConstIndexedVertexRange vertices) {
+  const std::size_t nVerts = vertices.size();
+  assert(out.size() >= plan.mStride * nVerts);
+
+  // One attribute at a time: reads each index stream sequentially
+  vertices.forEachRun([&](std::size_t first, std::size_t count) {
+    u8* base = out.data() + first * plan.mStride;
+    for (u32 i = 0; i < plan.mNumAttributes; ++i) {
+      const auto& attrib = plan.mAttributes[i];
+      const auto stream = vertices.getStream(attrib.attr, first, count);
+      u8* it = base;
+      base += attrib.size;
+
+      if (stream.empty()) {
+        for (std::size_t v = 0; v < count; ++v, it += plan.mStride)
+          std::fill_n(it, attrib.size, 0);
+      } else if (attrib.size == 1) {
+        for (std::size_t v = 0; v < count; ++v, it += plan.mStride)
+          it[0] = static_cast<u8>(stream[v]);
+      } else {
+        for (std::size_t v = 0; v < count; ++v, it += plan.mStride) {
+          it[0] = static_cast<u8>(stream[v] >> 8);
+          it[1] = static_cast<u8>(stream[v]);
+        }
+      }
+    }
+  });
+}
+
+void EncodeMeshDisplayList(std::vector<u8>& out, const VertexDecodePlan& plan,
+                           const MatrixPrimitive& mprim) {
+  std::size_t size = out.size();
+  for (const auto& prim : mprim.mPrimitives)
+    size += 3 + plan.mStride * prim.mNumVertices;
+
+  std::size_t pos = out.size();
+  out.resize(size);
+  for (const auto& prim : mprim.mPrimitives) {
+    const std::size_t nVerts = prim.mNumVertices;
+    assert(nVerts <= 0xffff);
+    out[pos] = static_cast<u8>(gx::EncodeDrawPrimitiveCommand(prim.mType));
+    out[pos + 1] = static_cast<u8>(nVerts >> 8);
+    out[pos + 2] = static_cast<u8>(nVerts);
+    pos += 3;
+
+    const std::size_t nBytes = plan.mStride * nVerts;
+    EncodeIndexedVertices({out.data() + pos, nBytes}, plan,
+                          mprim.vertices(prim));
+    pos += nBytes;
+  }
+}
+
+void EncodeMeshDisplayList(oishii::Writer& writer, const VertexDecodePlan& plan,
+                           const MatrixPrimitive& mprim) {
+  // Reused across calls to avoid an allocation per matrix primitive
+  thread_local std::vector<u8> scratch;
+  scratch.clear();
+  EncodeMeshDisplayList(scratch, plan, mprim);
+  writer.writeBuffer(scratch);
 }
 
 llvm::Error
 DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
-                      IMeshDLDelegate& delegate,
+                      MatrixPrimitive& mprim,
                       const VertexDescriptor& descriptor,
                       std::map<gx::VertexBufferAttribute, u32>* optUsageMap) {
+  auto plan = CompileVertexDecodePlan(descriptor);
+  if (!plan)
+    return plan.takeError();
+  mprim.mVertices.addAttributes(plan->mBitfield);
+
   oishii::Jump<oishii::Whence::Set> g(reader, start);
 
+  std::array<u16, (u64)gx::VertexAttribute::Max> maxIndices{};
+  bool anyVertices = false;
+
   const u32 end = reader.tell() + size;
   while (reader.tell() < end) {
     const u8 tag = reader.readUnaligned<u8>();
@@ -69,27 +181,25 @@ DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
     }
 
     u16 nVerts = reader.readUnaligned<u16, CmdProcEndian>();
-    IndexedPrimitive& prim = delegate.addIndexedPrimitive(
-        gx::DecodeDrawPrimitiveCommand(tag), nVerts);
-
-    for (u16 vi = 0; vi < nVerts; ++vi) {
-      for (int a = 0; a < (int)gx::VertexAttribute::Max; ++a) {
-        if (descriptor.mBitfield & (1 << a)) {
-          const auto attr = static_cast<gx::VertexAttribute>(a);
-          const auto attr_buf = static_cast<gx::VertexBufferAttribute>(a);
-
-          auto valOrErr = ProcessAttr(reader, descriptor.mAttributes, attr, vi);
-          if (auto e = valOrErr.takeError())
-            return e;
-
-          const u16 val = *valOrErr;
+    const u32 nBytes = plan->mStride * nVerts;
+    if (reader.tell() + nBytes > std::min(end, reader.endpos())) {
+      return llvm::createStringError(
+          std::errc::executable_format_error,
+          "Mesh display list vertex data is out of bounds.");
+    }
 
-          prim.mVertices[vi][attr] = val;
+    const auto& prim =
+        mprim.addPrimitive(gx::DecodeDrawPrimitiveCommand(tag), nVerts);
+    DecodeIndexedVertices(reader, *plan, mprim.vertices(prim),
+                          optUsageMap ? &maxIndices : nullptr);
+    anyVertices |= nVerts != 0;
+  }
 
-          if (optUsageMap && (*optUsageMap)[attr_buf] <= val)
-            (*optUsageMap)[attr_buf] = val;
-        }
-      }
+  if (optUsageMap && anyVertices) {
+    for (u32 i = 0; i < plan->mNumAttributes; ++i) {
+      const auto attr = plan->mAttributes[i].attr;
+      u32& max = (*optUsageMap)[static_cast<gx::VertexBufferAttribute>(attr)];
+      max = std::max<u32>(max, maxIndices[(u64)attr]);
     }
   }
 
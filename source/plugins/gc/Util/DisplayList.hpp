@@ -1,22 +1,86 @@
 #pragma once
 
+#include <array>
 #include <core/common.h>
 #include <llvm/Support/Error.h>
+#include <map>
 #include <oishii/reader/binary_reader.hxx>
+#include <oishii/writer/binary_writer.hxx>
 #include <plugins/gc/Export/IndexedPrimitive.hpp>
 #include <plugins/gc/Export/VertexDescriptor.hpp>
 #include <plugins/gc/GX/VertexTypes.hpp>
+#include <span>
+#include <vector>
 
 namespace libcube {
 
-struct IMeshDLDelegate {
-  virtual IndexedPrimitive& addIndexedPrimitive(gx::PrimitiveType type,
-                                                u16 nVerts) = 0;
-};
+//! Vertex layout as consumed by the display list encoder and decoder.
+using VertexDecodePlan = VertexLayout;
 
+//! @brief The byte layout of a vertex, as cached by the descriptor.
+//!
+//! @return An error if the descriptor contains direct data (other than matrix
+//! indices) or unknown attribute types.
+//!
+llvm::Expected<VertexDecodePlan>
+CompileVertexDecodePlan(const VertexDescriptor& descriptor);
+
+//! @brief Decode the indices of every vertex of a primitive.
+//!
+//! @pre The list of `vertices` stores every attribute of the plan.
+//!
+//! @param[in] data  Big-endian vertex data, at least
+//!                  `plan.mStride * vertices.size()` bytes.
+//! @param[out] maxIndices Optional. For each attribute of the plan, raised to
+//!                        the largest index read.
+//!
+//! @return The attributes, in the format of VertexDescriptor::mBitfield, with
+//! a disabled (all bits set) index.
+//!
+u32 DecodeIndexedVertices(
+    std::span<const u8> data, const VertexDecodePlan& plan,
+    MutIndexedVertexRange vertices,
+    std::array<u16, (u64)gx::VertexAttribute::Max>* maxIndices = nullptr);
+
+//! @brief Decode the indices of every vertex of a primitive at the reader's
+//! position, warning through the reader of every disabled index.
+//!
+//! @pre The reader holds `plan.mStride * vertices.size()` more bytes, and the
+//! list of `vertices` stores every attribute of the plan.
+//!
+void DecodeIndexedVertices(
+    oishii::BinaryReader& reader, const VertexDecodePlan& plan,
+    MutIndexedVertexRange vertices,
+    std::array<u16, (u64)gx::VertexAttribute::Max>* maxIndices = nullptr);
+
+//! @brief Encode the indices of every vertex of a primitive.
+//!
+//! @param[out] out Big-endian vertex data, at least
+//!                 `plan.mStride * vertices.size()` bytes. Attributes not
+//!                 stored by the list are encoded as 0.
+//!
+void EncodeIndexedVertices(std::span<u8> out, const VertexDecodePlan& plan,
+                           ConstIndexedVertexRange vertices);
+
+//! @brief Encode the primitives of a matrix primitive as draw commands,
+//! appending them to `out`.
+//!
+void EncodeMeshDisplayList(std::vector<u8>& out, const VertexDecodePlan& plan,
+                           const MatrixPrimitive& mprim);
+
+//! @brief Encode the primitives of a matrix primitive as draw commands, in a
+//! single write.
+//!
+//! Does not pad the display list.
+//!
+void EncodeMeshDisplayList(oishii::Writer& writer, const VertexDecodePlan& plan,
+                           const MatrixPrimitive& mprim);
+
+//! @brief Decode draw commands, appending their primitives to `mprim`.
+//!
 llvm::Error
 DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
-                      IMeshDLDelegate& delegate,
+                      MatrixPrimitive& mprim,
                       const VertexDescriptor& descriptor,
                       std::map<gx::VertexBufferAttribute, u32>* optUsageMap);
 
@@ -0,0 +1,65 @@
+#include "TextureDedup.hpp"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/SHA1.h>
+#include <string.h>
+#include <string>
+
+namespace libcube {
+
+TextureDigest hashTexture(const Texture& tex) {
+  const u32 header[4]{tex.getTextureFormat(), tex.getWidth(), tex.getHeight(),
+                      tex.getMipmapCount()};
+
+  llvm::SHA1 sha;
+  sha.update(llvm::ArrayRef<u8>(reinterpret_cast<const u8*>(header),
+                                sizeof(header)));
+  sha.update(llvm::ArrayRef<u8>(tex.getData(), tex.getEncodedSize(true)));
+
+  TextureDigest digest;
+  const auto result = sha.final();
+  assert(result.size() == digest.size());
+  memcpy(digest.data(), result.data(), digest.size());
+  return digest;
+}
+
+static bool isSameContent(const Texture& lhs, const Texture& rhs) {
+  return lhs.getTextureFormat() == rhs.getTextureFormat() &&
+         lhs.getWidth() == rhs.getWidth() &&
+         lhs.getHeight() == rhs.getHeight() &&
+         lhs.getMipmapCount() == rhs.getMipmapCount() &&
+         !memcmp(lhs.getData(), rhs.getData(), lhs.getEncodedSize(true));
+}
+
+u32 TextureDeduplicator::add(const Texture& tex) {
+  const u32 index = mCanonical.size();
+  const u32 size = tex.getEncodedSize(true);
+  mTextures.push_back(&tex);
+  mBytesTotal += size;
+
+  const auto [it, inserted] = mByDigest.emplace(hashTexture(tex), index);
+  // A digest match is confirmed byte-wise; a collision is treated as unique
+  if (!inserted && isSameContent(*mTextures[it->second], tex)) {
+    mCanonical.push_back(it->second);
+    mBytesSaved += size;
+  } else {
+    mCanonical.push_back(index);
+    ++mNumUnique;
+  }
+  return mCanonical.back();
+}
+
+void TextureDeduplicator::report(const kpi::IOMessageCallback& callback,
+                                 std::string_view domain) const {
+  if (!callback || getNumUnique() == getNumTextures())
+    return;
+
+  callback(kpi::IOMessageClass::Information, domain,
+           "Texture deduplication: " + std::to_string(getNumTextures()) +
+               " textures -> " + std::to_string(getNumUnique()) +
+               " unique. Saved " + std::to_string(getBytesSaved()) + " of " +
+               std::to_string(getBytesTotal()) + " bytes.");
+}
+
+} // namespace libcube
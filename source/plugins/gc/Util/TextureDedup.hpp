@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <core/common.h>
+#include <core/kpi/Plugins.hpp>
+#include <plugins/gc/Export/Texture.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace libcube {
+
+//! @brief SHA-1 digest of a texture's encoded payload.
+//!
+//! Covers the format, dimensions, mipmap count and the full encoded mip chain.
+//! The name is deliberately not part of the digest.
+//!
+using TextureDigest = std::array<u8, 20>;
+
+TextureDigest hashTexture(const Texture& tex);
+
+//! @brief Groups textures with identical encoded content, so that writers may
+//! emit shared data once.
+//!
+//! Textures must outlive the deduplicator.
+//!
+class TextureDeduplicator {
+public:
+  //! @brief Register the next texture.
+  //!
+  //! @return Index of the first registered texture with identical content. This
+  //! is the index of the texture itself if it is unique.
+  //!
+  u32 add(const Texture& tex);
+
+  u32 getCanonical(u32 index) const { return mCanonical[index]; }
+  bool isCanonical(u32 index) const { return mCanonical[index] == index; }
+
+  u32 getNumTextures() const { return mCanonical.size(); }
+  u32 getNumUnique() const { return mNumUnique; }
+  u32 getBytesTotal() const { return mBytesTotal; }
+  u32 getBytesSaved() const { return mBytesSaved; }
+
+  //! @brief Report how many textures were merged and the bytes saved, if any.
+  void report(const kpi::IOMessageCallback& callback,
+              std::string_view domain) const;
+
+private:
+  struct DigestHash {
+    std::size_t operator()(const TextureDigest& digest) const {
+      std::size_t h;
+      memcpy(&h, digest.data(), sizeof(h));
+      return h;
+    }
+  };
+
+  std::unordered_map<TextureDigest, u32, DigestHash> mByDigest;
+  std::vector<const Texture*> mTextures;
+  std::vector<u32> mCanonical;
+  u32 mNumUnique = 0;
+  u32 mBytesTotal = 0;
+  u32 mBytesSaved = 0;
+};
+
+} // namespace libcube
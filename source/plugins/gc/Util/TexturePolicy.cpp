@@ -0,0 +1,81 @@
+#include "TexturePolicy.hpp"
+
+#include <algorithm>
+#include <plugins/gc/Export/Texture.hpp>
+#include <plugins/gc/Util/TextureExport.hpp>
+#include <vector>
+
+namespace libcube {
+
+bool applyTexturePolicy(Texture& tex, const TexturePolicy& policy) {
+  const u32 old_width = tex.getWidth();
+  const u32 old_height = tex.getHeight();
+  const u32 old_format = tex.getTextureFormat();
+  const u32 old_mips = tex.getMipmapCount();
+
+  u32 width = old_width;
+  u32 height = old_height;
+  if (policy.maxDimension.has_value()) {
+    const u32 limit = std::max<u32>(*policy.maxDimension, 1);
+    while (std::max(width, height) > limit && width > 1 && height > 1) {
+      width >>= 1;
+      height >>= 1;
+    }
+  }
+  const u32 format = policy.format.has_value()
+                         ? static_cast<u32>(*policy.format)
+                         : old_format;
+  u32 mips = policy.mipmapCount.value_or(old_mips);
+  while (mips > 0 && ((width >> mips) == 0 || (height >> mips) == 0))
+    --mips;
+
+  if (width == old_width && height == old_height && format == old_format &&
+      mips == old_mips)
+    return false;
+
+  // The encoder only writes levels that are whole blocks
+  const auto gx_format = static_cast<gx::TextureFormat>(format);
+  while (mips > 0) {
+    const int level_width = width >> mips;
+    const int level_height = height >> mips;
+    if (image_platform::getBlockedDimensions(level_width, level_height,
+                                             gx_format) ==
+        std::make_pair(level_width, level_height))
+      break;
+    --mips;
+  }
+
+  const bool same_size = width == old_width && height == old_height;
+
+  // Decode the source chain. Levels are reused only when they line up.
+  std::vector<u8> source;
+  tex.decode(source, same_size);
+
+  std::vector<u8> rgba(image_platform::getMipOffset(width, height, mips + 1));
+  for (u32 i = 0; i <= mips; ++i) {
+    const u32 offset = image_platform::getMipOffset(width, height, i);
+    u8* level = rgba.data() + offset;
+    if (same_size && i <= old_mips) {
+      memcpy(level, source.data() + offset, (width >> i) * (height >> i) * 4);
+    } else {
+      image_platform::resize(level, width >> i, height >> i, source.data(),
+                             old_width, old_height, policy.algorithm);
+    }
+  }
+
+  tex.setWidth(width);
+  tex.setHeight(height);
+  tex.setTextureFormat(format);
+  tex.setMipmapCount(mips);
+  tex.encode(rgba.data());
+  return true;
+}
+
+void exportTexturePng(const Texture& tex, const std::string& path) {
+  std::vector<u8> rgba(tex.getDecodedLevelSize(0));
+  tex.decodeLevel(0, rgba);
+  writeImageStbRGBA(path.c_str(), STBImage::PNG, tex.getWidth(),
+                    tex.getHeight(), rgba.data());
+}
+
+} // namespace libcube
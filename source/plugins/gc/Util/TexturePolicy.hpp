@@ -0,0 +1,40 @@
+#pragma once
+
+#include <core/common.h>
+#include <optional>
+#include <plugins/gc/Encoder/ImagePlatform.hpp>
+#include <plugins/gc/GX/Material.hpp>
+#include <string>
+
+namespace libcube {
+
+struct Texture;
+
+//! @brief Target state for headless texture re-encoding.
+//!
+//! Unset fields keep the current value of the texture.
+//!
+struct TexturePolicy {
+  std::optional<gx::TextureFormat> format;
+  //! Textures whose longer side exceeds this are halved until they fit.
+  std::optional<u32> maxDimension;
+  //! Clamped to the number of levels the resized image can hold. When the
+  //! texture is re-encoded, levels smaller than a block are dropped too.
+  std::optional<u32> mipmapCount;
+  image_platform::ResizingAlgorithm algorithm =
+      image_platform::ResizingAlgorithm::AVIR;
+};
+
+//! @brief Re-encode a texture to match a policy.
+//!
+//! Existing mip levels are kept when the dimensions do not change; any other
+//! level is regenerated from the base image.
+//!
+//! @return If the texture was modified.
+//!
+bool applyTexturePolicy(Texture& tex, const TexturePolicy& policy);
+
+//! @brief Decode the base level of a texture and write it as a PNG file.
+void exportTexturePng(const Texture& tex, const std::string& path);
+
+} // namespace libcube
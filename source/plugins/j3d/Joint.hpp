@@ -70,13 +70,16 @@ struct Joint : public libcube::IBoneDelegate,
   // ICON_FA_BONE);
 
   std::string getName() const { return name; }
-  void setName(const std::string& n) override { name = n; }
+  void setName(const std::string& n) override {
+    name = n;
+    onRenamed();
+  }
   s64 getId() override { return id; }
   void copy(lib3d::Bone& to) const override {
     IBoneDelegate::copy(to);
     Joint* pJoint = dynamic_cast<Joint*>(&to);
     if (pJoint) {
-      pJoint->name = name;
+      pJoint->setName(name);
       pJoint->flag = flag;
     }
   }
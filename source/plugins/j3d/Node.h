@@ -70,6 +70,11 @@ public:
             kpi::nextFolder(this->mBones, _new.getBones(), old ? &old->mBones : nullptr);
             kpi::nextFolder(this->mMeshes, _new.getMeshes(), old ? &old->mMeshes : nullptr);
         }
+        void visitRecords(kpi::RecordVisitor visitor) const override {
+            kpi::visitFolder(mMaterials, visitor);
+            kpi::visitFolder(mBones, visitor);
+            kpi::visitFolder(mMeshes, visitor);
+        }
     };
     std::unique_ptr<kpi::IMemento> next(const kpi::IMemento* last) const override {
         return std::make_unique<_Memento>(*this, last);
@@ -146,6 +151,10 @@ public:
             kpi::nextFolder(this->mModels, _new.getModels(), old ? &old->mModels : nullptr);
             kpi::nextFolder(this->mTextures, _new.getTextures(), old ? &old->mTextures : nullptr);
         }
+        void visitRecords(kpi::RecordVisitor visitor) const override {
+            kpi::visitFolder(mModels, visitor);
+            kpi::visitFolder(mTextures, visitor);
+        }
     };
     std::unique_ptr<kpi::IMemento> next(const kpi::IMemento* last) const override {
         return std::make_unique<_Memento>(*this, last);
@@ -72,13 +72,10 @@ u64 Shape::addUv(u64 chan, const glm::vec2& v) {
 void Shape::addTriangle(std::array<SimpleVertex, 3> tri) {
   if (mMatrixPrimitives.empty())
     mMatrixPrimitives.emplace_back();
-  if (mMatrixPrimitives.back().mPrimitives.empty() ||
-      mMatrixPrimitives.back().mPrimitives.back().mType !=
-          libcube::gx::PrimitiveType::Triangles)
-    mMatrixPrimitives.back().mPrimitives.emplace_back(
-        libcube::gx::PrimitiveType::Triangles, 0);
-
-  auto& prim = mMatrixPrimitives.back().mPrimitives.back();
+  auto& mprim = mMatrixPrimitives.back();
+  if (mprim.mPrimitives.empty() ||
+      mprim.mPrimitives.back().mType != libcube::gx::PrimitiveType::Triangles)
+    mprim.addPrimitive(libcube::gx::PrimitiveType::Triangles);
 
   for (const auto& vtx : tri) {
     // assert(!hasAttrib(SimpleAttrib::EnvelopeIndex));
@@ -114,7 +111,7 @@ void Shape::addTriangle(std::array<SimpleVertex, 3> tri) {
     if (hasAttrib(SimpleAttrib::TexCoord1))
       ivtx[libcube::gx::VertexAttribute::TexCoord1] = addUv(1, vtx.uvs[1]);
 
-    prim.mVertices.push_back(ivtx);
+    mprim.pushVertex(ivtx);
   }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <core/common.h>
+#include <core/util/cow_buffer.hpp>
 #include <plugins/gc/GX/VertexTypes.hpp>
 #include <vector>
 
@@ -26,7 +27,11 @@ struct TextureData {
   s8 mMaxLod;
   u8 mMipmapLevel = 1;
 
-  std::vector<u8> mData;
+  util::CowBuffer mData;
+
+  template <typename F> void visitShared(F&& visitor) const {
+    mData.forEachAllocation(visitor);
+  }
 
   bool operator==(const TextureData& rhs) const {
     return mName == rhs.mName && mFormat == rhs.mFormat &&
@@ -43,7 +48,10 @@ struct Texture : public TextureData, public libcube::Texture {
   // ICON_FA_IMAGE);
 
   std::string getName() const override { return mName; }
-  void setName(const std::string& name) override { mName = name; }
+  void setName(const std::string& name) override {
+    mName = name;
+    onRenamed();
+  }
 
   u32 getTextureFormat() const override { return mFormat; }
 
@@ -38,7 +38,8 @@ struct BMDFile : public oishii::Node {
     return {};
   }
   Result gatherChildren(oishii::Node::NodeDelegate& ctx) const {
-    BMDExportContext exp{mCollection->getModels()[0], *mCollection};
+    BMDExportContext exp{mCollection->getModels()[0], *mCollection,
+                         *mCallback};
 
     auto addNode = [&](std::unique_ptr<oishii::Node> node) {
       node->getLinkingRestriction().alignment = 32;
@@ -59,6 +60,7 @@ struct BMDFile : public oishii::Node {
   }
 
   j3d::Collection* mCollection;
+  const kpi::IOMessageCallback* mCallback;
   bool bBDL = true;
   bool bMimic = true;
 };
@@ -128,6 +130,11 @@ public:
   }
 
   void write(kpi::INode& node, oishii::Writer& writer) const {
+    write(node, writer, {});
+  }
+  //! Write, reporting shared texture data to `callback`.
+  void write(kpi::INode& node, oishii::Writer& writer,
+             const kpi::IOMessageCallback& callback) const {
     assert(dynamic_cast<Collection*>(&node) != nullptr);
     Collection& collection = *dynamic_cast<Collection*>(&node);
 
@@ -137,6 +144,7 @@ public:
     bmd->bBDL = collection.getModels()[0].isBDL;
     bmd->bMimic = true;
     bmd->mCollection = &collection;
+    bmd->mCallback = &callback;
 
     linker.mUserPad = &BMD_Pad;
     writer.mUserPad = &BMD_Pad;
@@ -147,6 +147,7 @@ struct LinkNode final : public T, public oishii::Node {
 struct BMDExportContext {
   Model& mdl;
   Collection& col;
+  const kpi::IOMessageCallback& callback;
   /*
   We need to associate Samplers and TexData
   */
@@ -145,18 +145,8 @@ void readSHP1(BMDOutputContext& ctx) {
       MatrixPrimitive& mprim = shape.mMatrixPrimitives.emplace_back(
           mtxPrimHdr.current_matrix, mtxPrimHdr.matrixList);
 
-      struct SHP1_MPrim : IMeshDLDelegate {
-        IndexedPrimitive& addIndexedPrimitive(gx::PrimitiveType type,
-                                              u16 nVerts) override {
-          return mprim.mPrimitives.emplace_back(type, nVerts);
-        }
-        SHP1_MPrim(MatrixPrimitive& mp) : mprim(mp) {}
-
-      private:
-        MatrixPrimitive& mprim;
-      } mprim_del(mprim);
       auto err = DecodeMeshDisplayList(reader, g.start + ofsDL + dlOfs, dlSz,
-                                       mprim_del, shape.mVertexDescriptor,
+                                       mprim, shape.mVertexDescriptor,
                                        &ctx.mVertexBufferMaxIndices);
 
       if (err) {
@@ -266,7 +256,8 @@ struct WriteableMatrixList : public std::vector<s16> {
   }
 };
 struct SHP1Node final : public oishii::Node {
-  SHP1Node(const Model& model) : mModel(model) {
+  SHP1Node(const Model& model, const kpi::IOMessageCallback& callback)
+      : mModel(model), mCallback(callback) {
     mId = "SHP1";
     mLinkingRestriction.alignment = 32;
 
@@ -468,38 +459,17 @@ struct SHP1Node final : public oishii::Node {
         break; // MPrims write..
       case SubNodeID::_DLChildMPrim: {
         const auto& poly = mMdl.getMeshes()[mPolyId];
-        for (auto& prim : poly.mMatrixPrimitives[mMpId].mPrimitives) {
-          writer.write<u8>(gx::EncodeDrawPrimitiveCommand(prim.mType));
-          writer.write<u16>(prim.mVertices.size());
-          for (const auto& v : prim.mVertices) {
-            for (int a = 0; a < (int)gx::VertexAttribute::Max; ++a) {
-              if (poly.mVertexDescriptor[(gx::VertexAttribute)a]) {
-                switch (poly.mVertexDescriptor.mAttributes.at(
-                    (gx::VertexAttribute)a)) {
-                case gx::VertexAttributeType::None:
-                  break;
-                case gx::VertexAttributeType::Byte:
-                  writer.write<u8>(v[(gx::VertexAttribute)a]);
-                  break;
-                case gx::VertexAttributeType::Short:
-                  writer.write<u16>(v[(gx::VertexAttribute)a]);
-                  break;
-                case gx::VertexAttributeType::Direct:
-                  if (((gx::VertexAttribute)a) !=
-                      gx::VertexAttribute::PositionNormalMatrixIndex) {
-                    assert(!"Direct vertex data is unsupported.");
-                    abort();
-                  }
-                  writer.write<u8>(v[(gx::VertexAttribute)a]);
-                  break;
-                default:
-                  assert("!Unknown vertex attribute format.");
-                  abort();
-                }
-              }
-            }
-          }
+        auto plan = CompileVertexDecodePlan(poly.mVertexDescriptor);
+        if (!plan) {
+          const auto message = llvm::toString(plan.takeError());
+          // Once per shape, not per matrix primitive
+          if (mMpId == 0 && mParent.mCallback)
+            mParent.mCallback(kpi::IOMessageClass::Error,
+                              "bmd/SHP1/" + poly.getName(),
+                              "Cannot encode vertex data: " + message);
+          return eResult::Fatal;
         }
+        EncodeMeshDisplayList(writer, *plan, poly.mMatrixPrimitives[mMpId]);
         // DL pad
         while (writer.tell() % 32)
           writer.write<u8>(0);
@@ -616,10 +586,11 @@ struct SHP1Node final : public oishii::Node {
     return {};
   }
   const Model& mModel;
+  const kpi::IOMessageCallback& mCallback;
 };
 
 std::unique_ptr<oishii::Node> makeSHP1Node(BMDExportContext& ctx) {
-  return std::make_unique<SHP1Node>(ctx.mdl);
+  return std::make_unique<SHP1Node>(ctx.mdl, ctx.callback);
 }
 
 } // namespace riistudio::j3d
@@ -1,5 +1,7 @@
 #include "../Sections.hpp"
 #include <map>
+#include <plugins/gc/Util/TextureDedup.hpp>
+#include <set>
 #include <string.h>
 #include <vendor/ogc/texture.h>
 
@@ -173,23 +175,22 @@ void readTEX1(BMDOutputContext& ctx) {
 
   // Deduplicate and read.
   // Assumption: Data will not be spliced
-
-  std::vector<std::pair<u32, int>> uniques; // ofs : index
-  for (int i = 0; i < size; ++i) {
-    const auto found =
-        std::find_if(uniques.begin(), uniques.end(), [&](const auto& it) {
-          return it.first == texRaw[i].second.first;
-        });
-    if (found == uniques.end())
-      uniques.emplace_back(texRaw[i].second.first, i);
-  }
+  //
+  // Headers sharing data are only merged when they also share a name:
+  // samplers bind textures by name.
+  std::set<std::pair<u32, std::string>> uniques; // ofs : name
 
   int i = 0;
-  for (const auto& it : uniques) {
-    auto& texpair = texRaw[it.second];
+  for (auto& texpair : texRaw) {
     const auto [ofs, size] = texpair.second;
+    if (!uniques.emplace(ofs, texpair.first->mName).second)
+      continue;
     std::unique_ptr<Texture> data = std::move(texpair.first);
-	reader.readBuffer(data->mData, size, ofs);
+    // Borrowed from the file until edited
+    if (auto view = reader.shareBuffer(size, ofs))
+      data->mData.setView(std::move(view), size);
+    else
+      data->mData.resize(size); // Truncated file: leave the image blank
     ctx.col.getTextures().add() = *data.get();
 
     ++i;
@@ -207,10 +208,16 @@ void readTEX1(BMDOutputContext& ctx) {
   }
 }
 struct TEX1Node final : public oishii::Node {
-  TEX1Node(const Model& model, const Collection& col)
+  TEX1Node(const Model& model, const Collection& col,
+           const kpi::IOMessageCallback& callback)
       : mModel(model), mCol(col) {
     mId = "TEX1";
     mLinkingRestriction.alignment = 32;
+
+    // Headers of textures with identical content point to the same data
+    for (auto& tex : mCol.getTextures())
+      mDedup.add(tex);
+    mDedup.report(callback, "bmd/TEX1");
   }
 
   struct TexNames : public oishii::Node {
@@ -235,7 +242,9 @@ struct TEX1Node final : public oishii::Node {
   };
 
   struct TexHeaders : public oishii::Node {
-    TexHeaders(const Model& mdl, const Collection& col) : mMdl(mdl), mCol(col) {
+    TexHeaders(const Model& mdl, const Collection& col,
+               const libcube::TextureDeduplicator& dedup)
+        : mMdl(mdl), mCol(col), mDedup(dedup) {
       mId = "TexHeaders";
       getLinkingRestriction().alignment = 32;
     }
@@ -261,12 +270,14 @@ struct TEX1Node final : public oishii::Node {
     Result gatherChildren(NodeDelegate& d) const noexcept override {
       u32 id = 0;
       for (auto& tex : mMdl.mTexCache)
-        d.addNode(std::make_unique<TexHeaderEntryLink>(tex, id++, tex.btiId));
+        d.addNode(std::make_unique<TexHeaderEntryLink>(
+            tex, id++, mDedup.getCanonical(tex.btiId)));
       return {};
     }
 
     const Model& mMdl;
     const Collection& mCol;
+    const libcube::TextureDeduplicator& mDedup;
   };
   struct TexEntry : public oishii::Node {
     TexEntry(const Model& mdl, const Collection& col, u32 texIdx)
@@ -278,17 +289,7 @@ struct TEX1Node final : public oishii::Node {
 
     Result write(oishii::Writer& writer) const noexcept {
       const auto& tex = mCol.getTextures()[mIdx];
-      const auto before = writer.tell();
-
-      writer.skip(tex.mData.size() - 1);
-      writer.write<u8>(0);
-      writer.skip(-tex.mData.size());
-
-      // memcpy_s(writer.getDataBlockStart() + before, writer.endpos(),
-      // tex.mData.data(), tex.mData.size());
-      memcpy(writer.getDataBlockStart() + before, tex.mData.data(),
-             tex.mData.size());
-      writer.skip(tex.mData.size());
+      writer.writeBuffer(tex.mData.span());
       return {};
     }
 
@@ -311,10 +312,11 @@ struct TEX1Node final : public oishii::Node {
 
   Result gatherChildren(NodeDelegate& d) const noexcept override {
 
-    d.addNode(std::make_unique<TexHeaders>(mModel, mCol));
+    d.addNode(std::make_unique<TexHeaders>(mModel, mCol, mDedup));
 
     for (int i = 0; i < mCol.getTextures().size(); ++i)
-      d.addNode(std::make_unique<TexEntry>(mModel, mCol, i));
+      if (mDedup.isCanonical(i))
+        d.addNode(std::make_unique<TexEntry>(mModel, mCol, i));
 
     d.addNode(std::make_unique<TexNames>(mModel, mCol));
 
@@ -324,10 +326,11 @@ struct TEX1Node final : public oishii::Node {
 private:
   const Model& mModel;
   const Collection& mCol;
+  libcube::TextureDeduplicator mDedup;
 };
 
 std::unique_ptr<oishii::Node> makeTEX1Node(BMDExportContext& ctx) {
-  return std::make_unique<TEX1Node>(ctx.mdl, ctx.col);
+  return std::make_unique<TEX1Node>(ctx.mdl, ctx.col, ctx.callback);
 }
 
 } // namespace riistudio::j3d
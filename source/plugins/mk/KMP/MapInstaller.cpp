@@ -3,8 +3,11 @@
 #include <core/kpi/RichNameManager.hpp>
 #include <core/util/gui.hpp>
 #include <llvm/Support/Casting.h>
+#include <algorithm>
 #include <plugins/mk/KMP/Map.hpp>
+#include <plugins/mk/KMP/SpatialIndex.hpp>
 #include <plugins/mk/KMP/io/KMP.hpp>
+#include <vector>
 #include <vendor/fa5/IconsFontAwesome5.h>
 
 namespace riistudio::mk {
@@ -55,6 +58,47 @@ template <typename ObjectT> struct DelegateWrapper {
   kpi::PropertyDelegate<ObjectT>& mDelegate;
 };
 namespace ui {
+// Shared by every open map: switching maps rebuilds it
+SpatialIndex sNearbyIndex;
+
+// The path points and areas around `position`
+void drawNearby(const CourseMap& map, const glm::vec3& position) {
+  sNearbyIndex.update(map);
+
+  const std::pair<MapPointKind, const char*> paths[]{
+      {MapPointKind::EnemyPoint, "enemy path"},
+      {MapPointKind::ItemPoint, "item path"}};
+  for (const auto& [kind, title] : paths) {
+    if (auto nearest = sNearbyIndex.nearest(position, maskOf(kind))) {
+      ImGui::Text("Nearest %s: %u, point %u (%.0f units)", title,
+                  nearest->point.index, nearest->point.sub,
+                  nearest->distance);
+    } else {
+      ImGui::Text("Nearest %s: None", title);
+    }
+  }
+  if (auto nearest =
+          sNearbyIndex.nearest(position, maskOf(MapPointKind::RespawnPoint))) {
+    ImGui::Text("Nearest respawn point: %u (%.0f units)", nearest->point.index,
+                nearest->distance);
+  }
+
+  std::vector<u32> areas;
+  sNearbyIndex.forEachAreaContaining(position,
+                                     [&](u32 area) { areas.push_back(area); });
+  std::sort(areas.begin(), areas.end());
+  ImGui::Text("Inside %u area(s)", static_cast<unsigned int>(areas.size()));
+  for (u32 area : areas)
+    ImGui::BulletText("Area %u", area);
+}
+
+template <typename T> void drawNearby(kpi::PropertyDelegate<T>& delegate) {
+  const auto* map =
+      dynamic_cast<const CourseMap*>(delegate.getActiveObject().childOf);
+  if (map != nullptr)
+    drawNearby(*map, delegate.getActive().position);
+}
+
 auto ktpt = kpi::StatelessPropertyView<StartPoint>()
                 .setTitle("Properties")
                 .setIcon((const char*)ICON_FA_COGS)
@@ -179,6 +223,13 @@ auto area =
           draw_area();
         });
 
+auto ktpt_nearby = kpi::StatelessPropertyView<StartPoint>()
+                       .setTitle("Nearby")
+                       .setIcon((const char*)ICON_FA_SEARCH)
+                       .onDraw([](kpi::PropertyDelegate<StartPoint>& delegate) {
+                         drawNearby(delegate);
+                       });
+
 auto gobj =
     kpi::StatelessPropertyView<GeoObj>()
         .setTitle("Properties")
@@ -205,6 +256,13 @@ auto gobj =
           }
         });
 
+auto gobj_nearby = kpi::StatelessPropertyView<GeoObj>()
+                       .setTitle("Nearby")
+                       .setIcon((const char*)ICON_FA_SEARCH)
+                       .onDraw([](kpi::PropertyDelegate<GeoObj>& delegate) {
+                         drawNearby(delegate);
+                       });
+
 auto ckph = kpi::StatelessPropertyView<CheckPath>()
                 .setTitle("Properties")
                 .setIcon((const char*)ICON_FA_COGS)
@@ -160,6 +160,20 @@ public:
             kpi::nextFolder(this->mStages, _new.getStages(), old ? &old->mStages : nullptr);
             kpi::nextFolder(this->mMissionPoints, _new.getMissionPoints(), old ? &old->mMissionPoints : nullptr);
         }
+        void visitRecords(kpi::RecordVisitor visitor) const override {
+            kpi::visitFolder(mStartPoints, visitor);
+            kpi::visitFolder(mEnemyPaths, visitor);
+            kpi::visitFolder(mItemPaths, visitor);
+            kpi::visitFolder(mCheckPaths, visitor);
+            kpi::visitFolder(mPaths, visitor);
+            kpi::visitFolder(mGeoObjs, visitor);
+            kpi::visitFolder(mAreas, visitor);
+            kpi::visitFolder(mCameras, visitor);
+            kpi::visitFolder(mRespawnPoints, visitor);
+            kpi::visitFolder(mCannonPoints, visitor);
+            kpi::visitFolder(mStages, visitor);
+            kpi::visitFolder(mMissionPoints, visitor);
+        }
     };
     std::unique_ptr<kpi::IMemento> next(const kpi::IMemento* last) const override {
         return std::make_unique<_Memento>(*this, last);
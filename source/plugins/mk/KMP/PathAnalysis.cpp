@@ -0,0 +1,223 @@
+#include "PathAnalysis.hpp"
+#include <algorithm> // std::find
+#include <string>    // std::to_string
+
+namespace riistudio::mk {
+
+namespace {
+
+constexpr u8 NoKeyCheckpoint = 0xFF;
+
+bool contains(std::span<const u8> links, std::size_t group) {
+  return std::find(links.begin(), links.end(), group) != links.end();
+}
+
+// Mark every group reachable from group 0 along `adjacency`
+std::vector<bool>
+reachableFromFirst(const std::vector<std::vector<std::size_t>>& adjacency) {
+  std::vector<bool> reached(adjacency.size());
+  std::vector<std::size_t> queue{0};
+  reached[0] = true;
+  while (!queue.empty()) {
+    const std::size_t group = queue.back();
+    queue.pop_back();
+    for (const std::size_t next : adjacency[group]) {
+      if (!reached[next]) {
+        reached[next] = true;
+        queue.push_back(next);
+      }
+    }
+  }
+  return reached;
+}
+
+// Mark every group on a cycle that avoids the `excluded` groups, by finding
+// the strongly connected components of the remaining graph (Tarjan).
+std::vector<bool>
+cyclicGroups(const std::vector<std::vector<std::size_t>>& successors,
+             const std::vector<bool>& excluded) {
+  constexpr std::size_t Unvisited = ~std::size_t(0);
+  const std::size_t n = successors.size();
+  std::vector<std::size_t> index(n, Unvisited);
+  std::vector<std::size_t> low(n);
+  std::vector<bool> on_stack(n);
+  std::vector<bool> cyclic(n);
+  std::vector<std::size_t> stack;
+  // Explicit call stack: group, and the next successor to visit
+  std::vector<std::pair<std::size_t, std::size_t>> frames;
+  std::size_t next_index = 0;
+
+  const auto visit = [&](std::size_t group) {
+    index[group] = low[group] = next_index++;
+    stack.push_back(group);
+    on_stack[group] = true;
+    frames.emplace_back(group, 0);
+  };
+
+  for (std::size_t root = 0; root < n; ++root) {
+    if (excluded[root] || index[root] != Unvisited)
+      continue;
+    visit(root);
+    while (!frames.empty()) {
+      auto& [group, next] = frames.back();
+      if (next < successors[group].size()) {
+        const std::size_t succ = successors[group][next++];
+        if (excluded[succ])
+          continue;
+        if (index[succ] == Unvisited)
+          visit(succ);
+        else if (on_stack[succ])
+          low[group] = std::min(low[group], index[succ]);
+        continue;
+      }
+      const std::size_t done = group;
+      frames.pop_back();
+      if (!frames.empty()) {
+        const std::size_t parent = frames.back().first;
+        low[parent] = std::min(low[parent], low[done]);
+      }
+      if (low[done] != index[done])
+        continue;
+      // `done` is the root of a component: pop it
+      const auto& links = successors[done];
+      const bool is_cycle = stack.back() != done ||
+                            std::find(links.begin(), links.end(), done) !=
+                                links.end();
+      std::size_t member;
+      do {
+        member = stack.back();
+        stack.pop_back();
+        on_stack[member] = false;
+        cyclic[member] = is_cycle;
+      } while (member != done);
+    }
+  }
+  return cyclic;
+}
+
+} // namespace
+
+std::vector<PathDiagnostic>
+analyzePathGroups(std::span<const PathGroupView> groups, bool is_check_path) {
+  std::vector<PathDiagnostic> diagnostics;
+  const auto report = [&](PathDiagnostic::Severity severity, std::size_t group,
+                          std::string message) {
+    diagnostics.push_back({severity, group, std::move(message)});
+  };
+  using enum PathDiagnostic::Severity;
+
+  const std::size_t n = groups.size();
+  if (n == 0)
+    return diagnostics;
+
+  // Successors that exist, in both directions. Reachability follows the
+  // successor links only, so that one-sided links are not papered over.
+  std::vector<std::vector<std::size_t>> successors(n);
+  std::vector<std::vector<std::size_t>> reverse(n);
+
+  for (std::size_t g = 0; g < n; ++g) {
+    const PathGroupView& group = groups[g];
+    if (group.num_points == 0)
+      report(Warning, g, "Group has no points.");
+    if (group.predecessors.size() > MaxPathLinks)
+      report(Error, g,
+             std::to_string(group.predecessors.size()) +
+                 " predecessors; at most " + std::to_string(MaxPathLinks) +
+                 " can be saved.");
+    if (group.successors.size() > MaxPathLinks)
+      report(Error, g,
+             std::to_string(group.successors.size()) +
+                 " successors; at most " + std::to_string(MaxPathLinks) +
+                 " can be saved.");
+
+    for (const u8 succ : group.successors) {
+      if (succ >= n) {
+        report(Error, g,
+               "Successor " + std::to_string(succ) + " does not exist.");
+        continue;
+      }
+      successors[g].push_back(succ);
+      reverse[succ].push_back(g);
+      if (!contains(groups[succ].predecessors, g))
+        report(Warning, g,
+               "Successor " + std::to_string(succ) +
+                   " does not list this group as a predecessor.");
+    }
+    for (const u8 pred : group.predecessors) {
+      if (pred >= n) {
+        report(Error, g,
+               "Predecessor " + std::to_string(pred) + " does not exist.");
+        continue;
+      }
+      if (!contains(groups[pred].successors, g))
+        report(Warning, g,
+               "Predecessor " + std::to_string(pred) +
+                   " does not list this group as a successor.");
+    }
+  }
+
+  const std::vector<bool> reached = reachableFromFirst(successors);
+  const std::vector<bool> returns = reachableFromFirst(reverse);
+  for (std::size_t g = 0; g < n; ++g) {
+    if (!reached[g])
+      report(Warning, g, "Group cannot be reached from group 0.");
+    if (!returns[g])
+      report(Warning, g, "Group does not lead back to group 0.");
+  }
+
+  if (!is_check_path)
+    return diagnostics;
+
+  // Key checkpoints must never decrease along the course, except when
+  // crossing the lap checkpoint (key checkpoint 0).
+  std::vector<bool> has_lap_checkpoint(n);
+  bool any_lap_checkpoint = false;
+  // First and last key checkpoints of every group
+  std::vector<u8> first_key(n, NoKeyCheckpoint);
+  std::vector<u8> last_key(n, NoKeyCheckpoint);
+  for (std::size_t g = 0; g < n; ++g) {
+    u8& last = last_key[g];
+    for (const u8 key : groups[g].key_checkpoints) {
+      if (key == NoKeyCheckpoint)
+        continue;
+      if (first_key[g] == NoKeyCheckpoint)
+        first_key[g] = key;
+      if (key == 0) {
+        has_lap_checkpoint[g] = any_lap_checkpoint = true;
+      } else if (last != NoKeyCheckpoint && key < last) {
+        report(Error, g,
+               "Key checkpoint " + std::to_string(key) +
+                   " follows key checkpoint " + std::to_string(last) + ".");
+      }
+      last = key;
+    }
+  }
+  for (std::size_t g = 0; g < n; ++g) {
+    const u8 last = last_key[g];
+    if (last == NoKeyCheckpoint)
+      continue;
+    for (const std::size_t succ : successors[g]) {
+      const u8 first = first_key[succ];
+      if (first != NoKeyCheckpoint && first != 0 && first < last)
+        report(Error, g,
+               "Key checkpoint " + std::to_string(last) +
+                   " is followed by key checkpoint " + std::to_string(first) +
+                   " in successor " + std::to_string(succ) + ".");
+    }
+  }
+
+  if (!any_lap_checkpoint) {
+    report(Error, PathDiagnostic::AllGroups,
+           "No lap checkpoint (key checkpoint 0).");
+    return diagnostics;
+  }
+  const std::vector<bool> cyclic = cyclicGroups(successors, has_lap_checkpoint);
+  for (std::size_t g = 0; g < n; ++g) {
+    if (cyclic[g])
+      report(Error, g, "Group loops without crossing the lap checkpoint.");
+  }
+
+  return diagnostics;
+}
+
+} // namespace riistudio::mk
@@ -0,0 +1,82 @@
+/*!
+ * @brief Static analysis of the path graphs of a course map
+ */
+#pragma once
+
+#include <core/common.h>                   // u8
+#include <plugins/mk/KMP/data/MapPath.hpp> // CheckPath
+#include <span>                            // std::span
+#include <string>                          // std::string
+#include <type_traits>                     // std::is_same_v
+#include <vector>                          // std::vector
+
+namespace riistudio::mk {
+
+//! Links past this count cannot be serialized.
+constexpr std::size_t MaxPathLinks = 6;
+
+struct PathDiagnostic {
+  enum class Severity {
+    Warning, //!< The game accepts the map, but likely misbehaves
+    Error    //!< The map cannot be saved faithfully, or breaks in game
+  };
+  //! Value of `group` for diagnostics about the path as a whole.
+  static constexpr std::size_t AllGroups = ~std::size_t(0);
+
+  Severity severity;
+  std::size_t group;
+  std::string message;
+};
+
+//! Links and points of one group of a path, as stored by a DirectedGraph.
+struct PathGroupView {
+  std::span<const u8> predecessors;
+  std::span<const u8> successors;
+  std::size_t num_points = 0;
+  //! Checkpoint paths only: the key checkpoint index of every point, 0xFF for
+  //! none. Key checkpoint 0 is the lap checkpoint.
+  std::span<const u8> key_checkpoints;
+};
+
+//! @brief Check the links of a path: link limits, dangling and one-sided
+//! links, and reachability of every group from and back to group 0.
+//!
+//! With `is_check_path`, also check that key checkpoints are ordered along
+//! the course and that every loop crosses the lap checkpoint.
+//!
+//! Runs in time linear in the number of groups, points and links.
+//!
+std::vector<PathDiagnostic>
+analyzePathGroups(std::span<const PathGroupView> groups, bool is_check_path);
+
+//! Analyze a range of DirectedGraph groups, such as `map.getEnemyPaths()`.
+template <typename Paths>
+std::vector<PathDiagnostic> analyzePaths(const Paths& paths) {
+  std::vector<PathGroupView> views;
+  views.reserve(paths.size());
+  // Key checkpoints of every group, stored contiguously
+  std::vector<u8> key_checkpoints;
+  constexpr bool is_check_path =
+      std::is_same_v<std::decay_t<decltype(*paths.begin())>, CheckPath>;
+
+  for (auto& path : paths) {
+    views.push_back({.predecessors = path.mPredecessors,
+                     .successors = path.mSuccessors,
+                     .num_points = path.mPoints.size()});
+    if constexpr (is_check_path) {
+      for (auto& point : path.mPoints)
+        key_checkpoints.push_back(point.getLapCheck());
+    }
+  }
+  if constexpr (is_check_path) {
+    std::size_t first = 0;
+    for (auto& view : views) {
+      view.key_checkpoints = {key_checkpoints.data() + first, view.num_points};
+      first += view.num_points;
+    }
+  }
+
+  return analyzePathGroups(views, is_check_path);
+}
+
+} // namespace riistudio::mk
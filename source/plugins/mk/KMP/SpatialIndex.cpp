@@ -0,0 +1,316 @@
+#include "SpatialIndex.hpp"
+#include <algorithm>                    // std::nth_element
+#include <array>                        // std::array
+#include <cmath>                        // std::abs, std::sqrt
+#include <glm/geometric.hpp>            // glm::dot
+#include <glm/gtc/matrix_transform.hpp> // glm::rotate
+#include <glm/mat4x4.hpp>               // glm::mat4
+#include <glm/matrix.hpp>               // glm::inverse
+#include <glm/trigonometric.hpp>        // glm::radians
+#include <glm/vector_relational.hpp>    // glm::lessThanEqual
+
+namespace riistudio::mk {
+
+namespace {
+
+using Bounds = SpatialIndex::Bounds;
+using Node = SpatialIndex::Node;
+
+// Items per leaf
+constexpr u32 LeafSize = 4;
+// Deep enough for any hierarchy of median splits over 32-bit indices
+constexpr std::size_t MaxDepth = 64;
+
+// Unscaled extents of an area, in area space
+constexpr f32 AreaHalfWidth = 5000.0f;
+constexpr f32 AreaHeight = 10000.0f;
+
+void grow(Bounds& bounds, const glm::vec3& point) {
+  bounds.min = glm::min(bounds.min, point);
+  bounds.max = glm::max(bounds.max, point);
+}
+void grow(Bounds& bounds, const Bounds& other) {
+  bounds.min = glm::min(bounds.min, other.min);
+  bounds.max = glm::max(bounds.max, other.max);
+}
+// Squared distance from `point` to `bounds`, zero inside
+f32 distance2(const Bounds& bounds, const glm::vec3& point) {
+  const glm::vec3 d = glm::max(glm::max(bounds.min - point, point - bounds.max),
+                               glm::vec3(0.0f));
+  return glm::dot(d, d);
+}
+bool contains(const Bounds& bounds, const glm::vec3& point) {
+  return glm::all(glm::lessThanEqual(bounds.min, point)) &&
+         glm::all(glm::lessThanEqual(point, bounds.max));
+}
+
+// Build the hierarchy of items [first, last), reordering them. Returns the
+// index of the root node.
+template <typename T, typename BoundsOf, typename KindsOf>
+u32 buildNode(std::vector<T>& items, std::vector<Node>& nodes, u32 first,
+              u32 last, const BoundsOf& bounds_of, const KindsOf& kinds_of) {
+  const u32 index = nodes.size();
+  nodes.emplace_back();
+
+  Bounds bounds, centroids;
+  MapPointKindMask kinds = 0;
+  for (u32 i = first; i < last; ++i) {
+    const Bounds item = bounds_of(items[i]);
+    grow(bounds, item);
+    grow(centroids, (item.min + item.max) * 0.5f);
+    kinds |= kinds_of(items[i]);
+  }
+  if (last - first <= LeafSize) {
+    nodes[index] = {bounds, first, last - first, kinds};
+    return index;
+  }
+
+  // Split at the median centroid along the longest axis of the centroids
+  const glm::vec3 extent = centroids.max - centroids.min;
+  const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                       : (extent.y > extent.z ? 1 : 2);
+  const u32 mid = first + (last - first) / 2;
+  std::nth_element(items.begin() + first, items.begin() + mid,
+                   items.begin() + last, [&](const T& lhs, const T& rhs) {
+                     const Bounds l = bounds_of(lhs), r = bounds_of(rhs);
+                     return l.min[axis] + l.max[axis] <
+                            r.min[axis] + r.max[axis];
+                   });
+  // The left child immediately follows its parent
+  buildNode(items, nodes, first, mid, bounds_of, kinds_of);
+  const u32 right = buildNode(items, nodes, mid, last, bounds_of, kinds_of);
+  nodes[index] = {bounds, right, 0, kinds};
+  return index;
+}
+template <typename T, typename BoundsOf, typename KindsOf>
+void build(std::vector<T>& items, std::vector<Node>& nodes,
+           const BoundsOf& bounds_of, const KindsOf& kinds_of) {
+  nodes.clear();
+  if (items.empty())
+    return;
+  nodes.reserve(2 * (items.size() / LeafSize + 1));
+  buildNode<T>(items, nodes, 0, items.size(), bounds_of, kinds_of);
+}
+
+// Area space is scaled so that the extents of every area are the same
+bool areaContains(const SpatialIndex::Area& area, const glm::vec3& point) {
+  const glm::vec3 local = area.to_local * (point - area.position);
+  if (local.y < 0.0f || local.y > AreaHeight)
+    return false;
+  if (area.is_cylinder)
+    return local.x * local.x + local.z * local.z <=
+           AreaHalfWidth * AreaHalfWidth;
+  return std::abs(local.x) <= AreaHalfWidth &&
+         std::abs(local.z) <= AreaHalfWidth;
+}
+
+std::optional<SpatialIndex::Area> makeArea(const mk::Area& area, u32 index) {
+  const AreaModel& model = area.getModel();
+  const glm::vec3 scale = model.getScaling();
+  // Degenerate areas contain nothing
+  if (scale.x == 0.0f || scale.y == 0.0f || scale.z == 0.0f)
+    return std::nullopt;
+  const glm::vec3 rotation = glm::radians(model.getRotation());
+  glm::mat4 rotate(1.0f);
+  rotate = glm::rotate(rotate, rotation.z, {0.0f, 0.0f, 1.0f});
+  rotate = glm::rotate(rotate, rotation.y, {0.0f, 1.0f, 0.0f});
+  rotate = glm::rotate(rotate, rotation.x, {1.0f, 0.0f, 0.0f});
+  glm::mat3 to_world(rotate);
+  to_world[0] *= scale.x;
+  to_world[1] *= scale.y;
+  to_world[2] *= scale.z;
+
+  SpatialIndex::Area result{.position = model.getPosition(),
+                            .to_local = glm::inverse(to_world),
+                            .is_cylinder =
+                                model.getShape() == AreaShape::Cylinder,
+                            .index = index};
+  for (const f32 x : {-AreaHalfWidth, AreaHalfWidth})
+    for (const f32 y : {0.0f, AreaHeight})
+      for (const f32 z : {-AreaHalfWidth, AreaHalfWidth})
+        grow(result.bounds, result.position + to_world * glm::vec3(x, y, z));
+  return result;
+}
+
+} // namespace
+
+bool SpatialIndex::isStale(const CourseMap& map) const {
+  const kpi::INode& node = map;
+  if (mSourceGenerations.size() != node.numFolders())
+    return true;
+  for (std::size_t i = 0; i < mSourceGenerations.size(); ++i) {
+    if (mSourceGenerations[i] != node.folderAt(i)->getContentGeneration())
+      return true;
+  }
+  return false;
+}
+
+bool SpatialIndex::update(const CourseMap& map) {
+  if (!isStale(map))
+    return false;
+  rebuild(map);
+  return true;
+}
+
+void SpatialIndex::rebuild(const CourseMap& map) {
+  mPoints.clear();
+  const auto add = [&](MapPointKind kind, u32 index, u32 sub,
+                       const glm::vec3& position) {
+    mPoints.push_back({position, {kind, index, sub}});
+  };
+  const auto add_paths = [&](MapPointKind kind, const auto& paths) {
+    for (u32 i = 0; i < paths.size(); ++i) {
+      const auto& points = paths[i].mPoints;
+      for (u32 j = 0; j < points.size(); ++j)
+        add(kind, i, j, points[j].position);
+    }
+  };
+
+  const auto starts = map.getStartPoints();
+  for (u32 i = 0; i < starts.size(); ++i)
+    add(MapPointKind::StartPoint, i, 0, starts[i].position);
+  add_paths(MapPointKind::EnemyPoint, map.getEnemyPaths());
+  add_paths(MapPointKind::ItemPoint, map.getItemPaths());
+  const auto rails = map.getPaths();
+  for (u32 i = 0; i < rails.size(); ++i) {
+    u32 j = 0;
+    for (const auto& point : rails[i])
+      add(MapPointKind::RailPoint, i, j++, point.position);
+  }
+  const auto objs = map.getGeoObjs();
+  for (u32 i = 0; i < objs.size(); ++i)
+    add(MapPointKind::GeoObj, i, 0, objs[i].position);
+  const auto respawns = map.getRespawnPoints();
+  for (u32 i = 0; i < respawns.size(); ++i)
+    add(MapPointKind::RespawnPoint, i, 0, respawns[i].position);
+  const auto cannons = map.getCannonPoints();
+  for (u32 i = 0; i < cannons.size(); ++i)
+    add(MapPointKind::CannonPoint, i, 0, cannons[i].getPosition());
+  const auto missions = map.getMissionPoints();
+  for (u32 i = 0; i < missions.size(); ++i)
+    add(MapPointKind::MissionPoint, i, 0, missions[i].position);
+
+  build(
+      mPoints, mPointNodes,
+      [](const Point& point) { return Bounds{point.position, point.position}; },
+      [](const Point& point) { return maskOf(point.ref.kind); });
+
+  mAreas.clear();
+  const auto areas = map.getAreas();
+  for (u32 i = 0; i < areas.size(); ++i) {
+    if (auto area = makeArea(areas[i], i))
+      mAreas.push_back(*area);
+  }
+  build(
+      mAreas, mAreaNodes, [](const Area& area) { return area.bounds; },
+      [](const Area&) { return AllMapPointKinds; });
+
+  const kpi::INode& node = map;
+  mSourceGenerations.resize(node.numFolders());
+  for (std::size_t i = 0; i < mSourceGenerations.size(); ++i)
+    mSourceGenerations[i] = node.folderAt(i)->getContentGeneration();
+}
+
+std::optional<SpatialIndex::Nearest>
+SpatialIndex::nearest(const glm::vec3& position, MapPointKindMask kinds,
+                      f32 max_distance) const {
+  if (mPointNodes.empty())
+    return std::nullopt;
+
+  const Point* best = nullptr;
+  f32 best2 = max_distance * max_distance;
+
+  std::array<u32, MaxDepth> stack;
+  std::size_t depth = 0;
+  stack[depth++] = 0;
+  while (depth != 0) {
+    const Node& node = mPointNodes[stack[--depth]];
+    if (!(node.kinds & kinds) || distance2(node.bounds, position) > best2)
+      continue;
+    if (node.count != 0) {
+      for (u32 i = node.first; i < node.first + node.count; ++i) {
+        const Point& point = mPoints[i];
+        if (!(maskOf(point.ref.kind) & kinds))
+          continue;
+        const glm::vec3 d = point.position - position;
+        const f32 d2 = glm::dot(d, d);
+        if (d2 <= best2 && (best == nullptr || d2 < best2)) {
+          best = &point;
+          best2 = d2;
+        }
+      }
+      continue;
+    }
+    // Visit the nearer child first, so that the farther one is more likely
+    // to be culled
+    u32 near = &node - mPointNodes.data() + 1;
+    u32 far = node.first;
+    if (distance2(mPointNodes[far].bounds, position) <
+        distance2(mPointNodes[near].bounds, position))
+      std::swap(near, far);
+    assert(depth + 2 <= stack.size());
+    stack[depth++] = far;
+    stack[depth++] = near;
+  }
+
+  if (best == nullptr)
+    return std::nullopt;
+  return Nearest{best->ref, best->position, std::sqrt(best2)};
+}
+
+void SpatialIndex::forEachInRadius(
+    const glm::vec3& position, f32 radius,
+    llvm::function_ref<void(const MapPointRef&, const glm::vec3&)> fn,
+    MapPointKindMask kinds) const {
+  if (mPointNodes.empty())
+    return;
+  const f32 radius2 = radius * radius;
+
+  std::array<u32, MaxDepth> stack;
+  std::size_t depth = 0;
+  stack[depth++] = 0;
+  while (depth != 0) {
+    const Node& node = mPointNodes[stack[--depth]];
+    if (!(node.kinds & kinds) || distance2(node.bounds, position) > radius2)
+      continue;
+    if (node.count != 0) {
+      for (u32 i = node.first; i < node.first + node.count; ++i) {
+        const Point& point = mPoints[i];
+        const glm::vec3 d = point.position - position;
+        if ((maskOf(point.ref.kind) & kinds) && glm::dot(d, d) <= radius2)
+          fn(point.ref, point.position);
+      }
+      continue;
+    }
+    assert(depth + 2 <= stack.size());
+    stack[depth++] = node.first;
+    stack[depth++] = &node - mPointNodes.data() + 1;
+  }
+}
+
+void SpatialIndex::forEachAreaContaining(
+    const glm::vec3& position, llvm::function_ref<void(u32)> fn) const {
+  if (mAreaNodes.empty())
+    return;
+
+  std::array<u32, MaxDepth> stack;
+  std::size_t depth = 0;
+  stack[depth++] = 0;
+  while (depth != 0) {
+    const Node& node = mAreaNodes[stack[--depth]];
+    if (!contains(node.bounds, position))
+      continue;
+    if (node.count != 0) {
+      for (u32 i = node.first; i < node.first + node.count; ++i) {
+        if (areaContains(mAreas[i], position))
+          fn(mAreas[i].index);
+      }
+      continue;
+    }
+    assert(depth + 2 <= stack.size());
+    stack[depth++] = node.first;
+    stack[depth++] = &node - mAreaNodes.data() + 1;
+  }
+}
+
+} // namespace riistudio::mk
@@ -0,0 +1,134 @@
+/*!
+ * @brief Bounding volume hierarchy over the points and areas of a course map
+ */
+#pragma once
+
+#include <core/common.h>          // u32
+#include <glm/mat3x3.hpp>         // glm::mat3
+#include <glm/vec3.hpp>           // glm::vec3
+#include <limits>                 // std::numeric_limits
+#include <llvm/ADT/STLExtras.h>   // llvm::function_ref
+#include <optional>               // std::optional
+#include <plugins/mk/KMP/Map.hpp> // CourseMap
+#include <vector>                 // std::vector
+
+namespace riistudio::mk {
+
+//! Collections whose points are indexed by SpatialIndex. Checkpoints are two
+//! dimensional and not indexed.
+enum class MapPointKind : u32 {
+  StartPoint,
+  EnemyPoint,
+  ItemPoint,
+  RailPoint,
+  GeoObj,
+  RespawnPoint,
+  CannonPoint,
+  MissionPoint
+};
+
+//! Set of MapPointKind, to filter queries by.
+using MapPointKindMask = u32;
+constexpr MapPointKindMask AllMapPointKinds = ~0u;
+constexpr MapPointKindMask maskOf(MapPointKind kind) {
+  return 1u << static_cast<u32>(kind);
+}
+
+//! A point of a course map: object `index` of the collection of `kind` and,
+//! for paths and rails, point `sub` of that group.
+struct MapPointRef {
+  bool operator==(const MapPointRef&) const = default;
+
+  MapPointKind kind;
+  u32 index = 0;
+  u32 sub = 0;
+};
+
+//! @brief Spatial queries over the points and areas of a CourseMap.
+//!
+//! Points and oriented area volumes are each held in a bounding volume
+//! hierarchy, built in O(n log n) and queried in O(log n) for nearest
+//! neighbours. The index is a cache: `update()` rebuilds it when any
+//! collection of the map changed since the last build, as tracked by
+//! `kpi::ICollection::getContentGeneration()`. Edits must therefore flag the
+//! objects they modify with `markDirty()`, or be committed to history, before
+//! the index is updated.
+//!
+//! Areas follow the game's conventions: rotations are Euler angles in
+//! degrees, applied in X, Y, Z order. A box spans 5000 units either side of
+//! its position on X and Z, and 10000 units up on Y, before scaling. A
+//! cylinder is inscribed in that box.
+//!
+class SpatialIndex {
+public:
+  //! Rebuild the index if `map` is not the map it was built from, or was
+  //! modified since. Returns whether the index was rebuilt.
+  bool update(const CourseMap& map);
+  //! Unconditionally rebuild the index from `map`.
+  void rebuild(const CourseMap& map);
+  //! Whether the index does not reflect the current state of `map`.
+  bool isStale(const CourseMap& map) const;
+
+  struct Nearest {
+    MapPointRef point;
+    glm::vec3 position;
+    f32 distance;
+  };
+  //! The point closest to `position` among `kinds`, if any lies within
+  //! `max_distance`.
+  std::optional<Nearest>
+  nearest(const glm::vec3& position, MapPointKindMask kinds = AllMapPointKinds,
+          f32 max_distance = std::numeric_limits<f32>::infinity()) const;
+  //! Invoke `fn` for every point of `kinds` within `radius` of `position`,
+  //! in no particular order.
+  void forEachInRadius(
+      const glm::vec3& position, f32 radius,
+      llvm::function_ref<void(const MapPointRef&, const glm::vec3&)> fn,
+      MapPointKindMask kinds = AllMapPointKinds) const;
+  //! Invoke `fn` with the index of every area containing `position`, in no
+  //! particular order.
+  void forEachAreaContaining(const glm::vec3& position,
+                             llvm::function_ref<void(u32)> fn) const;
+
+  std::size_t numPoints() const { return mPoints.size(); }
+  std::size_t numAreas() const { return mAreas.size(); }
+
+  struct Bounds {
+    glm::vec3 min{std::numeric_limits<f32>::infinity()};
+    glm::vec3 max{-std::numeric_limits<f32>::infinity()};
+  };
+  //! Leaves hold `count` items from `first`. Inner nodes hold no items: their
+  //! children are the next node and node `first`.
+  struct Node {
+    Bounds bounds;
+    u32 first = 0;
+    u32 count = 0;
+    //! Kinds of the points below this node.
+    MapPointKindMask kinds = 0;
+  };
+  struct Point {
+    glm::vec3 position;
+    MapPointRef ref;
+  };
+  struct Area {
+    Bounds bounds;
+    glm::vec3 position;
+    //! World to area space, scale included.
+    glm::mat3 to_local;
+    bool is_cylinder;
+    u32 index;
+  };
+
+private:
+  // Sorted in hierarchy order
+  std::vector<Point> mPoints;
+  std::vector<Node> mPointNodes;
+  std::vector<Area> mAreas;
+  std::vector<Node> mAreaNodes;
+
+  // Content generations of the folders of the source map. Generations are
+  // unique, so they identify the map as well as its state.
+  std::vector<u64> mSourceGenerations;
+};
+
+} // namespace riistudio::mk
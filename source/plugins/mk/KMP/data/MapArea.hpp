@@ -55,11 +55,11 @@ public:
 
   AreaShape getShape() const { return mShape; }
 
-  const glm::vec3& getPosition() { return mPosition; }
+  const glm::vec3& getPosition() const { return mPosition; }
   const glm::vec3& setPosition(const glm::vec3& pos) { return mPosition = pos; }
-  const glm::vec3& getRotation() { return mRotation; }
+  const glm::vec3& getRotation() const { return mRotation; }
   const glm::vec3& setRotation(const glm::vec3& rot) { return mRotation = rot; }
-  const glm::vec3& getScaling() { return mScaling; }
+  const glm::vec3& getScaling() const { return mScaling; }
   const glm::vec3& setScaling(const glm::vec3& scl) { return mScaling = scl; }
 
 protected:
@@ -67,7 +67,7 @@ protected:
 
   // TRS block
   glm::vec3 mPosition{0.0f, 0.0f, 0.0f};
-  glm::vec3 mRotation{0.0f, 0.0f, 0.0f}; // Radians
+  glm::vec3 mRotation{0.0f, 0.0f, 0.0f}; // Degrees
   glm::vec3 mScaling{1.0f, 1.0f, 1.0f};
 };
 
@@ -1,11 +1,15 @@
 #include "KMP.hpp"
+#include <algorithm>
+#include <array>
 #include <core/util/glm_io.hpp>
-#include <functional>
+#include <cstring>
 #include <llvm/ADT/StringMap.h>
 #include <numeric>
 #include <oishii/writer/binary_writer.hxx>
+#include <plugins/mk/KMP/PathAnalysis.hpp>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace riistudio::mk {
@@ -45,6 +49,197 @@ struct IOContext {
   IOContext(kpi::IOTransaction& t) : transaction(t) {}
 };
 
+std::string stringifyId(u32 key) {
+  const char fmt[5]{static_cast<char>((key & 0xFF00'0000) >> 24),
+                    static_cast<char>((key & 0x00FF'0000) >> 16),
+                    static_cast<char>((key & 0x0000'FF00) >> 8),
+                    static_cast<char>(key & 0x0000'00FF), '\0'};
+  return fmt;
+}
+
+// On-disk records of the fixed-size sections. Records are copied out of the
+// file in bulk and byte-swapped in place; `Layout` lists the width of every
+// field in order.
+struct RawPlacement {
+  glm::vec3 position;
+  glm::vec3 rotation;
+  std::array<u16, 2> params;
+
+  static constexpr std::array<u8, 8> Layout{4, 4, 4, 4, 4, 4, 2, 2};
+};
+struct RawPathPoint {
+  glm::vec3 position;
+  f32 deviation;
+  std::array<u8, 4> param;
+
+  static constexpr std::array<u8, 8> Layout{4, 4, 4, 4, 1, 1, 1, 1};
+};
+struct RawCheckPoint {
+  glm::vec2 left;
+  glm::vec2 right;
+  u8 respawn_index;
+  u8 lap_check;
+  // Intrusive linked list, which is regenerated on write
+  u8 previous;
+  u8 next;
+
+  static constexpr std::array<u8, 8> Layout{4, 4, 4, 4, 1, 1, 1, 1};
+};
+struct RawPath {
+  u8 start;
+  u8 size;
+  std::array<u8, 6> predecessors;
+  std::array<u8, 6> successors;
+  std::array<u8, 2> misc;
+
+  static constexpr std::array<u8, 16> Layout{1, 1, 1, 1, 1, 1, 1, 1,
+                                             1, 1, 1, 1, 1, 1, 1, 1};
+};
+struct RawGeoObj {
+  u16 id;
+  u16 _;
+  glm::vec3 position;
+  glm::vec3 rotation;
+  glm::vec3 scale;
+  u16 path_id;
+  std::array<u16, 8> settings;
+  u16 flags;
+
+  static constexpr std::array<u8, 21> Layout{
+      2, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2};
+};
+struct RawArea {
+  u8 shape;
+  u8 type;
+  u8 camera_index;
+  u8 priority;
+  glm::vec3 position;
+  glm::vec3 rotation;
+  glm::vec3 scaling;
+  std::array<u16, 2> parameters;
+  // R2200:
+  u8 rail_id;
+  u8 enemy_link_id;
+  std::array<u8, 2> pad;
+
+  static constexpr std::array<u8, 19> Layout{
+      1, 1, 1, 1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 2, 2, 1, 1, 1, 1};
+};
+struct RawCamera {
+  u8 type;
+  u8 next;
+  u8 shake;
+  u8 path_id;
+  u16 path_speed;
+  u16 fov_speed;
+  u16 view_speed;
+  u8 start_flag;
+  u8 movie_flag;
+  glm::vec3 position;
+  glm::vec3 rotation;
+  f32 fov_from;
+  f32 fov_to;
+  glm::vec3 view_from;
+  glm::vec3 view_to;
+  f32 active_frames;
+
+  static constexpr std::array<u8, 24> Layout{
+      1, 1, 1, 1, 2, 2, 2, 1, 1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4};
+};
+struct RawStage {
+  u8 lap_count;
+  u8 corner;
+  u8 start_position;
+  u8 flare_tobi;
+  std::array<u8, 4> lens_flare_argb;
+  // R2320:
+  u8 unk08;
+  u8 _;
+  u16 speed_modifier;
+
+  static constexpr std::array<u8, 11> Layout{1, 1, 1, 1, 1, 1,
+                                             1, 1, 1, 1, 2};
+};
+
+//! @brief Read `count` records of type `T`, each `stride` bytes in the file.
+//!
+//! A shorter stride reads the older, truncated form of a record: the missing
+//! trailing fields are zeroed. Records past the end of the file are reported
+//! to `ctx` and dropped.
+//!
+template <typename T>
+std::vector<T> readEntries(oishii::BinaryReader& reader, IOContext ctx,
+                           u32 count, u32 stride = sizeof(T)) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::accumulate(T::Layout.begin(), T::Layout.end(), 0u) ==
+                    sizeof(T),
+                "Layout does not cover the record, or the record is padded");
+  assert(stride != 0 && stride <= sizeof(T));
+
+  const u32 available = reader.tell() < reader.endpos()
+                            ? (reader.endpos() - reader.tell()) / stride
+                            : 0;
+  if (count > available) {
+    ctx.error("Expected " + std::to_string(count) + " entries. Only " +
+              std::to_string(available) + " fit in the file.");
+    count = available;
+  }
+
+  const u8* data = reader.readBytes(count * stride).data();
+  std::vector<T> entries(count);
+  for (u32 i = 0; i < count; ++i) {
+    std::memcpy(&entries[i], data + i * stride, stride);
+    if (!reader.isSwapped())
+      continue;
+    u8* field = reinterpret_cast<u8*>(&entries[i]);
+    for (const u8 width : T::Layout) {
+      std::reverse(field, field + width);
+      field += width;
+    }
+  }
+  return entries;
+}
+
+// Sections of a KMP file. Only the first section of each key is read.
+constexpr std::array<u32, 15> SectionKeys{
+    'KTPT', 'ENPT', 'ENPH', 'ITPT', 'ITPH', 'CKPT', 'CKPH', 'GOBJ',
+    'POTI', 'AREA', 'CAME', 'JGPT', 'CNPT', 'MSPT', 'STGI'};
+
+//! Offsets of the sections of a file, by key, read once from the header.
+class SectionDirectory {
+public:
+  static constexpr u32 None = ~0u;
+
+  SectionDirectory(oishii::BinaryReader& reader, u16 num_sec,
+                   u16 header_size) {
+    mOffsets.fill(None);
+    for (u32 i = 0; i < num_sec; ++i) {
+      const u32 ofs = header_size +
+                      reader.getAt<u32>(header_size - (num_sec - i) * 4);
+      // Sections starting past the end of the file are left absent
+      if (static_cast<u64>(ofs) + 4 > reader.endpos())
+        continue;
+      const auto it = std::find(SectionKeys.begin(), SectionKeys.end(),
+                                reader.getAt<u32>(ofs));
+      if (it == SectionKeys.end())
+        continue;
+      u32& slot = mOffsets[it - SectionKeys.begin()];
+      if (slot == None)
+        slot = ofs;
+    }
+  }
+
+  //! Offset of the section `key`, or `None` if absent.
+  u32 find(u32 key) const {
+    const auto it = std::find(SectionKeys.begin(), SectionKeys.end(), key);
+    assert(it != SectionKeys.end());
+    return mOffsets[it - SectionKeys.begin()];
+  }
+
+private:
+  std::array<u32, SectionKeys.size()> mOffsets;
+};
+
 void KMP::read(kpi::IOTransaction& transaction) const {
   CourseMap& map = static_cast<CourseMap&>(transaction.node);
   oishii::BinaryReader reader(std::move(transaction.data));
@@ -70,115 +265,127 @@ void KMP::read(kpi::IOTransaction& transaction) const {
   }
 
   assert(num_sec < 32);
-  u32 sections_handled = 0;
+  const SectionDirectory directory(reader, num_sec, header_size);
 
+  // Seek past the magic of a section and read its entry count and user data
   const auto search = [&](u32 key, bool standard_fields =
                                        true) -> std::tuple<bool, u16, u16> {
-    for (u32 i = 0; i < num_sec; ++i) {
-      reader.seekSet(header_size +
-                     reader.getAt<u32>(header_size + (i - num_sec) * 4));
-      const auto magic = reader.read<u32>();
-      if (magic == key) {
-        sections_handled |= (1 << i);
-        if (!standard_fields)
-          return {true, 1, 0};
-        const auto num_entry = reader.read<u16>();
-        const auto user_data = reader.read<u16>();
-        return {true, num_entry, user_data};
-      }
+    const u32 ofs = directory.find(key);
+    if (ofs == SectionDirectory::None)
+      return {false, 0, 0};
+    reader.seekSet(ofs + 4);
+    if (!standard_fields)
+      return {true, 1, 0};
+    if (static_cast<u64>(ofs) + 8 > reader.endpos()) {
+      ctx.sublet(stringifyId(key)).error("Section header is truncated.");
+      return {false, 0, 0};
     }
-    return {false, 0, 0};
+    const auto num_entry = reader.read<u16>();
+    const auto user_data = reader.read<u16>();
+    return {true, num_entry, user_data};
   };
 
   if (auto [found, num_entry, user_data] =
           search('KTPT', map.getRevision() > 1830);
       found) {
+    const auto raw =
+        readEntries<RawPlacement>(reader, ctx.sublet("KTPT"), num_entry);
     auto sec = map.getStartPoints();
-    sec.resize(num_entry);
-    for (auto& entry : sec) {
-      entry.position << reader;
-      entry.rotation << reader;
-      entry.player_index = reader.read<s16>();
-      entry._ = reader.read<u16>();
+    sec.resize(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      entry.position = raw[i].position;
+      entry.rotation = raw[i].rotation;
+      entry.player_index = static_cast<s16>(raw[i].params[0]);
+      entry._ = static_cast<s16>(raw[i].params[1]);
     }
   }
 
-  const auto read_path_section = [&](u32 path_key, u32 point_key, auto sec,
-                                     u32 point_stride, auto read_point) {
+  const auto read_path_section = [&]<typename RawPoint>(
+      u32 path_key, u32 point_key, auto sec, auto read_point, RawPoint) {
     auto [pt_found, pt_num_entry, pt_user_data] = search(point_key);
     if (!pt_found)
       return;
-    const auto pt_ofs = reader.tell();
+    const auto points = readEntries<RawPoint>(
+        reader, ctx.sublet(stringifyId(point_key)), pt_num_entry);
 
     auto [ph_found, ph_num_entry, ph_user_data] = search(path_key);
     if (!ph_found)
       return;
+    const auto paths = readEntries<RawPath>(
+        reader, ctx.sublet(stringifyId(path_key)), ph_num_entry);
 
-    sec.resize(ph_num_entry);
-    for (auto& entry : sec) {
-      const auto [start, size] = reader.readX<u8, 2>();
+    sec.resize(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+      const RawPath& raw = paths[i];
+      auto& entry = sec[i];
 
-      for (auto& e : reader.readX<u8, 6>())
+      for (auto e : raw.predecessors)
         if (e != 0xFF)
           entry.mPredecessors.push_back(e);
-      for (auto& e : reader.readX<u8, 6>())
+      for (auto e : raw.successors)
         if (e != 0xFF)
           entry.mSuccessors.push_back(e);
 
-      entry.misc = reader.readX<u8, 2>();
+      entry.misc = raw.misc;
 
-      {
-        oishii::Jump<oishii::Whence::Set> g(reader,
-                                            pt_ofs + point_stride * start);
-        entry.mPoints.resize(size);
-        for (auto& pt : entry.mPoints)
-          read_point(pt, reader);
+      std::size_t size = raw.size;
+      if (raw.start + size > points.size()) {
+        ctx.sublet(stringifyId(path_key))
+            .error("Path #" + std::to_string(i) +
+                   " refers to points past the end of " +
+                   stringifyId(point_key) + ".");
+        size = raw.start < points.size() ? points.size() - raw.start : 0;
       }
+      entry.mPoints.resize(size);
+      for (std::size_t j = 0; j < size; ++j)
+        read_point(entry.mPoints[j], points[raw.start + j]);
     }
   };
 
-  const auto read_enpt = [](EnemyPoint& pt, oishii::BinaryReader& reader) {
-    pt.position << reader;
-    pt.deviation = reader.read<f32>();
-    pt.param = reader.readX<u8, 4>();
+  const auto read_enpt = [](EnemyPoint& pt, const RawPathPoint& raw) {
+    pt.position = raw.position;
+    pt.deviation = raw.deviation;
+    pt.param = raw.param;
   };
-  read_path_section('ENPH', 'ENPT', map.getEnemyPaths(), 0x14, read_enpt);
+  read_path_section('ENPH', 'ENPT', map.getEnemyPaths(), read_enpt,
+                    RawPathPoint{});
 
-  const auto read_itpt = [](ItemPoint& pt, oishii::BinaryReader& reader) {
-    pt.position << reader;
-    pt.deviation = reader.read<f32>();
-    pt.param = reader.readX<u8, 4>();
+  const auto read_itpt = [](ItemPoint& pt, const RawPathPoint& raw) {
+    pt.position = raw.position;
+    pt.deviation = raw.deviation;
+    pt.param = raw.param;
   };
-  read_path_section('ITPH', 'ITPT', map.getItemPaths(), 0x14, read_itpt);
-
-  const auto read_ckpt = [&](CheckPoint& pt, oishii::BinaryReader& reader) {
-    glm::vec2 scratch;
-    scratch << reader;
-    pt.setLeft(scratch);
-    scratch << reader;
-    pt.setRight(scratch);
-    pt.setRespawnIndex(reader.read<u8>());
-    pt.setLapCheck(reader.read<u8>());
+  read_path_section('ITPH', 'ITPT', map.getItemPaths(), read_itpt,
+                    RawPathPoint{});
+
+  const auto read_ckpt = [](CheckPoint& pt, const RawCheckPoint& raw) {
+    pt.setLeft(raw.left);
+    pt.setRight(raw.right);
+    pt.setRespawnIndex(raw.respawn_index);
+    pt.setLapCheck(raw.lap_check);
     // TODO: We assume the intrusive linked-list data is valid
-    reader.skip(2);
   };
-  read_path_section('CKPH', 'CKPT', map.getCheckPaths(), 0x14, read_ckpt);
+  read_path_section('CKPH', 'CKPT', map.getCheckPaths(), read_ckpt,
+                    RawCheckPoint{});
 
   if (auto [found, num_entry, user_data] = search('GOBJ'); found) {
+    const auto raw =
+        readEntries<RawGeoObj>(reader, ctx.sublet("GOBJ"), num_entry);
     auto sec = map.getGeoObjs();
-    sec.resize(num_entry);
-    for (auto& entry : sec) {
-      entry.id = reader.read<u16>();
-      entry._ = reader.read<u16>();
-      entry.position << reader;
-      entry.rotation << reader;
-      entry.scale << reader;
-      entry.pathId = reader.read<u16>();
-      entry.settings = reader.readX<u16, 8>();
-      entry.flags = reader.read<u16>();
+    sec.resize(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      entry.id = raw[i].id;
+      entry._ = raw[i]._;
+      entry.position = raw[i].position;
+      entry.rotation = raw[i].rotation;
+      entry.scale = raw[i].scale;
+      entry.pathId = raw[i].path_id;
+      entry.settings = raw[i].settings;
+      entry.flags = raw[i].flags;
     }
   }
-
   if (auto [found, num_entry, user_data] = search('POTI'); found) {
     const auto total_points_expected = user_data;
     u32 total_points_real = 0;
@@ -205,45 +412,46 @@ void KMP::read(kpi::IOTransaction& transaction) const {
   }
 
   if (auto [found, num_entry, user_data] = search('AREA'); found) {
-    auto area_ctx = ctx.sublet("Areas");
+    const auto raw = readEntries<RawArea>(
+        reader, ctx.sublet("AREA"), num_entry,
+        map.getRevision() >= 2200 ? 0x30 : 0x2C);
     auto sec = map.getAreas();
-    sec.resize(num_entry);
+    sec.resize(raw.size());
 
-    int i = 0;
-    for (auto& entry : sec) {
-      auto entry_ctx = area_ctx.sublet("#" + std::to_string(i++));
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      const auto entry_ctx = [&] {
+        return ctx.sublet("Areas").sublet("#" + std::to_string(i));
+      };
 
-      auto raw_area_shp = reader.read<u8>();
+      auto raw_area_shp = raw[i].shape;
       if (raw_area_shp > 1) {
-        entry_ctx.error("Invalid area shape: " + std::to_string(raw_area_shp) +
-                        ". Expected range: [0, 1]. Defaulting to 0 (Box).");
+        entry_ctx().error("Invalid area shape: " +
+                          std::to_string(raw_area_shp) +
+                          ". Expected range: [0, 1]. Defaulting to 0 (Box).");
         raw_area_shp = 0;
       }
 
-      auto raw_area_type = reader.read<u8>();
+      const auto raw_area_type = raw[i].type;
       if (raw_area_type > 10) {
-        entry_ctx.error(
+        entry_ctx().error(
             "Invalid area type: " + std::to_string(raw_area_type) +
             ". Expected range: [0, 10]. This will be ignored  by the game.");
       }
 
       entry.getModel().mShape = static_cast<AreaShape>(raw_area_shp);
       entry.mType = static_cast<AreaType>(raw_area_type);
-      entry.mCameraIndex = reader.read<u8>();
-      entry.mPriority = reader.read<u8>();
-      glm::vec3 scratch;
-      scratch << reader;
-      entry.getModel().setPosition(scratch);
-      scratch << reader;
-      entry.getModel().setRotation(scratch);
-      scratch << reader;
-      entry.getModel().setScaling(scratch);
-
-      entry.mParameters = reader.readX<u16, 2>();
+      entry.mCameraIndex = raw[i].camera_index;
+      entry.mPriority = raw[i].priority;
+      entry.getModel().setPosition(raw[i].position);
+      entry.getModel().setRotation(raw[i].rotation);
+      entry.getModel().setScaling(raw[i].scaling);
+
+      entry.mParameters = raw[i].parameters;
       if (map.getRevision() >= 2200) {
-        entry.mRailID = reader.read<u8>();
-        entry.mEnemyLinkID = reader.read<u8>();
-        entry.mPad = reader.readX<u8, 2>();
+        entry.mRailID = raw[i].rail_id;
+        entry.mEnemyLinkID = raw[i].enemy_link_id;
+        entry.mPad = raw[i].pad;
       } else {
         entry.mRailID = 0xFF;
         entry.mEnemyLinkID = 0xFF;
@@ -255,265 +463,287 @@ void KMP::read(kpi::IOTransaction& transaction) const {
   if (auto [found, num_entry, user_data] = search('CAME'); found) {
     map.setOpeningPanIndex(user_data >> 8);
     map.setVideoPanIndex(user_data & 0xff);
+    const auto raw =
+        readEntries<RawCamera>(reader, ctx.sublet("CAME"), num_entry);
     auto sec = map.getCameras();
-    sec.resize(num_entry);
-    for (auto& entry : sec) {
-      entry.mType = static_cast<CameraType>(reader.read<u8>());
-      entry.mNext = reader.read<u8>();
-      entry.mShake = reader.read<u8>();
-      entry.mPathId = reader.read<u8>();
-      entry.mPathSpeed = reader.read<u16>();
-      entry.mFov.mSpeed = reader.read<u16>();
-      entry.mView.mSpeed = reader.read<u16>();
-      entry.mStartFlag = reader.read<u8>();
-      entry.mMovieFlag = reader.read<u8>();
-      entry.mPosition << reader;
-      entry.mRotation << reader;
-      entry.mFov.from = reader.read<f32>();
-      entry.mFov.to = reader.read<f32>();
-      entry.mView.from << reader;
-      entry.mView.to << reader;
-      entry.mActiveFrames = reader.read<f32>();
+    sec.resize(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      entry.mType = static_cast<CameraType>(raw[i].type);
+      entry.mNext = raw[i].next;
+      entry.mShake = raw[i].shake;
+      entry.mPathId = raw[i].path_id;
+      entry.mPathSpeed = raw[i].path_speed;
+      entry.mFov.mSpeed = raw[i].fov_speed;
+      entry.mView.mSpeed = raw[i].view_speed;
+      entry.mStartFlag = raw[i].start_flag;
+      entry.mMovieFlag = raw[i].movie_flag;
+      entry.mPosition = raw[i].position;
+      entry.mRotation = raw[i].rotation;
+      entry.mFov.from = raw[i].fov_from;
+      entry.mFov.to = raw[i].fov_to;
+      entry.mView.from = raw[i].view_from;
+      entry.mView.to = raw[i].view_to;
+      entry.mActiveFrames = raw[i].active_frames;
     }
   }
 
   if (auto [found, num_entry, user_data] = search('JGPT'); found) {
+    const auto raw =
+        readEntries<RawPlacement>(reader, ctx.sublet("JGPT"), num_entry);
     auto sec = map.getRespawnPoints();
-    sec.resize(num_entry);
-    for (auto& entry : sec) {
-      entry.position << reader;
-      entry.rotation << reader;
-      entry.id = reader.read<u16>();
-      entry.range = reader.read<u16>();
+    sec.resize(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      entry.position = raw[i].position;
+      entry.rotation = raw[i].rotation;
+      entry.id = raw[i].params[0];
+      entry.range = raw[i].params[1];
     }
   }
 
   if (auto [found, num_entry, user_data] = search('CNPT'); found) {
-    auto ctx_cnpt = ctx.sublet("Cannons");
-
+    const auto raw =
+        readEntries<RawPlacement>(reader, ctx.sublet("CNPT"), num_entry);
     auto sec = map.getCannonPoints();
-    sec.resize(num_entry);
-    int i = 0;
-    for (auto& entry : sec) {
-      auto ctx_entry = ctx_cnpt.sublet(std::to_string(i));
-      entry.mPosition << reader;
-      entry.mRotation << reader;
-      ctx_entry.require(reader.read<u16>() == i, "Invalid cannon ID");
-      entry.mType = static_cast<CannonType>(reader.read<u16>());
-      ++i;
+    sec.resize(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      entry.mPosition = raw[i].position;
+      entry.mRotation = raw[i].rotation;
+      if (raw[i].params[0] != i)
+        ctx.sublet("Cannons").sublet(std::to_string(i)).error(
+            "Invalid cannon ID");
+      entry.mType = static_cast<CannonType>(raw[i].params[1]);
     }
   }
 
   if (auto [found, num_entry, user_data] = search('MSPT'); found) {
+    const auto raw =
+        readEntries<RawPlacement>(reader, ctx.sublet("MSPT"), num_entry);
     auto sec = map.getMissionPoints();
-    sec.resize(num_entry);
-    for (auto& entry : sec) {
-      entry.position << reader;
-      entry.rotation << reader;
-      entry.id = reader.read<u16>();
-      entry.unknown = reader.read<u16>();
+    sec.resize(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      entry.position = raw[i].position;
+      entry.rotation = raw[i].rotation;
+      entry.id = raw[i].params[0];
+      entry.unknown = raw[i].params[1];
     }
   }
 
   if (auto [found, num_entry, user_data] = search('STGI'); found) {
+    const auto raw = readEntries<RawStage>(
+        reader, ctx.sublet("STGI"), num_entry,
+        map.getRevision() >= 2320 ? 0xC : 0x8);
     auto sec = map.getStages();
-    sec.resize(num_entry);
-    for (auto& entry : sec) {
-      entry.mLapCount = reader.read<u8>();
-      entry.mCorner = static_cast<Corner>(reader.read<u8>());
-      entry.mStartPosition = static_cast<StartPosition>(reader.read<u8>());
-      entry.mFlareTobi = reader.read<u8>();
-      entry.mLensFlareOptions.a = reader.read<u8>();
-      entry.mLensFlareOptions.r = reader.read<u8>();
-      entry.mLensFlareOptions.g = reader.read<u8>();
-      entry.mLensFlareOptions.b = reader.read<u8>();
-
-      if (map.getRevision() >= 2320) {
-        entry.mUnk08 = reader.read<u8>();
-        entry._ = reader.read<u8>();
-        entry.mSpeedModifier = reader.read<u16>();
-      } else {
-        entry.mUnk08 = 0;
-        entry._ = 0;
-        entry.mSpeedModifier = 0;
-      }
+    sec.resize(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      auto& entry = sec[i];
+      entry.mLapCount = raw[i].lap_count;
+      entry.mCorner = static_cast<Corner>(raw[i].corner);
+      entry.mStartPosition = static_cast<StartPosition>(raw[i].start_position);
+      entry.mFlareTobi = raw[i].flare_tobi;
+      entry.mLensFlareOptions.a = raw[i].lens_flare_argb[0];
+      entry.mLensFlareOptions.r = raw[i].lens_flare_argb[1];
+      entry.mLensFlareOptions.g = raw[i].lens_flare_argb[2];
+      entry.mLensFlareOptions.b = raw[i].lens_flare_argb[3];
+
+      // Zeroed before R2320
+      entry.mUnk08 = raw[i].unk08;
+      entry._ = raw[i]._;
+      entry.mSpeedModifier = raw[i].speed_modifier;
     }
   }
 }
 
-class RelocWriter {
-public:
-  struct Reloc {
-    std::string from, to;
-    std::size_t ofs, sz;
-  };
+// Total number of points of a path section
+template <typename Paths> u32 countPoints(const Paths& paths) {
+  u32 total = 0;
+  for (auto& path : paths)
+    total += path.mPoints.size();
+  return total;
+}
+// Bytes taken by the entries of a path section. Links beyond the sixth are
+// still written, as they always were.
+template <typename Paths> u32 pathEntriesSize(const Paths& paths) {
+  u32 total = 0;
+  for (auto& path : paths)
+    total += 2 + std::max<u32>(path.mPredecessors.size(), 6) +
+             std::max<u32>(path.mSuccessors.size(), 6) + 2;
+  return total;
+}
 
-  RelocWriter(oishii::Writer& writer) : mWriter(writer) {}
-  // Define a label, associated with the current stream position
-  void label(const std::string& id) { mLabels.try_emplace(id, mWriter.tell()); }
-  // Write a relocation, to be filled in by a resolve() call
-  template <typename T>
-  void writeReloc(const std::string& from, const std::string& to) {
-    mRelocs.emplace_back(
-        Reloc{.from = from, .to = to, .ofs = mWriter.tell(), .sz = sizeof(T)});
-    mWriter.write<T>(static_cast<T>(-1));
-  }
-  // Write a relocation, with an associated child frame to be written by
-  // writeChildren()
-  template <typename T>
-  void writeReloc(const std::string& from, const std::string& to,
-                  std::function<void(oishii::Writer&)> write) {
-    mRelocs.emplace_back(
-        Reloc{.from = from, .to = to, .ofs = mWriter.tell(), .sz = sizeof(T)});
-    mWriter.write<T>(static_cast<T>(-1));
-    mChildren.emplace_back(to, write);
+//! Size in bytes of the section `key` of `map`, header included.
+u32 sectionSize(const CourseMap& map, u32 key) {
+  // Magic, entry count and user data
+  constexpr u32 header = 8;
+  switch (key) {
+  case 'KTPT':
+    return (map.getRevision() > 1830 ? header : 4) +
+           map.getStartPoints().size() * 0x1C;
+  case 'ENPT':
+    return header + countPoints(map.getEnemyPaths()) * 0x14;
+  case 'ENPH':
+    return header + pathEntriesSize(map.getEnemyPaths());
+  case 'ITPT':
+    return header + countPoints(map.getItemPaths()) * 0x14;
+  case 'ITPH':
+    return header + pathEntriesSize(map.getItemPaths());
+  case 'CKPT':
+    return header + countPoints(map.getCheckPaths()) * 0x14;
+  case 'CKPH':
+    return header + pathEntriesSize(map.getCheckPaths());
+  case 'GOBJ':
+    return header + map.getGeoObjs().size() * 0x3C;
+  case 'POTI': {
+    u32 size = header;
+    for (auto& path : map.getPaths())
+      size += 4 + std::distance(path.begin(), path.end()) * 0x10;
+    return size;
   }
-  // Write all child bodies
-  void writeChildren() {
-    for (auto& child : mChildren) {
-      label(child.first);
-      child.second(mWriter);
-    }
-    mChildren.clear();
+  case 'AREA':
+    return header +
+           map.getAreas().size() * (map.getRevision() >= 2200 ? 0x30 : 0x2C);
+  case 'CAME':
+    return header + map.getCameras().size() * 0x48;
+  case 'JGPT':
+    return header + map.getRespawnPoints().size() * 0x1C;
+  case 'CNPT':
+    return header + map.getCannonPoints().size() * 0x1C;
+  case 'MSPT':
+    return header + map.getMissionPoints().size() * 0x1C;
+  case 'STGI':
+    return header +
+           map.getStages().size() * (map.getRevision() >= 2320 ? 0xC : 0x8);
   }
-  // Resolve a single relocation
-  void resolve(Reloc& reloc) {
-    const auto from = mLabels.find(reloc.from);
-    const auto to = mLabels.find(reloc.to);
-
-    std::size_t delta = 0;
-    if (from == mLabels.end() || to == mLabels.end()) {
-      printf("Bad lookup: %s to %s\n", reloc.from.c_str(), reloc.to.c_str());
-    } else {
-      delta = to->second - from->second;
-    }
-
-    const auto back = mWriter.tell();
-
-    mWriter.seekSet(reloc.ofs);
-
-    if (reloc.sz == 4) {
-      mWriter.write<u32>(delta);
-    } else if (reloc.sz == 2) {
-      mWriter.write<u16>(delta);
-    } else {
-      assert(false);
-      printf("Invalid reloc size..\n");
-    }
+  assert(!"Unknown section");
+  return 0;
+}
 
-    mWriter.seekSet(back);
-  }
-  // Resolve all relocations
-  void resolve() {
-    for (auto& reloc : mRelocs)
-      resolve(reloc);
+// Report broken path graphs, which are otherwise only noticed in game
+template <typename Paths>
+void reportPaths(const kpi::IOMessageCallback& callback, u32 key,
+                 const Paths& paths) {
+  const std::string domain = "kmp/" + stringifyId(key);
+  for (const auto& diag : analyzePaths(paths)) {
+    const auto mclass = diag.severity == PathDiagnostic::Severity::Error
+                            ? kpi::IOMessageClass::Error
+                            : kpi::IOMessageClass::Warning;
+    if (diag.group == PathDiagnostic::AllGroups)
+      callback(mclass, domain, diag.message);
+    else
+      callback(mclass, domain,
+               "Group " + std::to_string(diag.group) + ": " + diag.message);
   }
-
-private:
-  oishii::Writer& mWriter;
-  std::map<std::string, std::size_t> mLabels;
-
-  llvm::SmallVector<Reloc, 64> mRelocs;
-  llvm::SmallVector<
-      std::pair<std::string, std::function<void(oishii::Writer&)>>, 16>
-      mChildren;
-};
-
-std::string stringifyId(u32 key) {
-  const char fmt[5]{static_cast<char>((key & 0xFF00'0000) >> 24),
-                    static_cast<char>((key & 0x00FF'0000) >> 16),
-                    static_cast<char>((key & 0x0000'FF00) >> 8),
-                    static_cast<char>(key & 0x0000'00FF), '\0'};
-  return fmt;
 }
 
 void KMP::write(kpi::INode& node, oishii::Writer& writer) const {
+  write(node, writer, {});
+}
+
+void KMP::write(kpi::INode& node, oishii::Writer& writer,
+                const kpi::IOMessageCallback& callback) const {
   const CourseMap& map = *dynamic_cast<CourseMap*>(&node);
   writer.setEndian(true);
-  RelocWriter reloc(writer);
-  reloc.label("KMP_BEGIN");
+
+  if (callback) {
+    reportPaths(callback, 'ENPH', map.getEnemyPaths());
+    reportPaths(callback, 'ITPH', map.getItemPaths());
+    reportPaths(callback, 'CKPH', map.getCheckPaths());
+  }
+
+  // First pass: lay out the sections, which follow the header in order
+  constexpr u32 header_size = 0x10 + SectionKeys.size() * sizeof(u32);
+  std::array<u32, SectionKeys.size()> sizes;
+  u32 file_size = header_size;
+  for (std::size_t i = 0; i < SectionKeys.size(); ++i) {
+    sizes[i] = sectionSize(map, SectionKeys[i]);
+    file_size += sizes[i];
+  }
+
+  // Second pass: emit into a buffer of the final size
+  if (writer.endpos() < writer.tell() + file_size)
+    writer.resize(writer.tell() + file_size);
 
   writer.write<u32>('RKMD');
-  reloc.writeReloc<u32>("KMP_BEGIN", "KMP_END");
-  writer.write<u16>(15);                      // 15 sections
-  writer.write<u16>(15 * sizeof(u32) + 0x10); // header size
+  writer.write<u32>(file_size);
+  writer.write<u16>(SectionKeys.size());
+  writer.write<u16>(header_size);
   writer.write<u32>(map.getRevision());
 
-  reloc.writeReloc<s32>("KMP", "KTPT", [&](oishii::Writer& stream) {
+  // Section offsets are relative to the end of the header
+  u32 section_offset = 0;
+  for (const u32 size : sizes) {
+    writer.write<s32>(section_offset);
+    section_offset += size;
+  }
+
+  std::size_t section_index = 0;
+  const auto write_section = [&](u32 key, auto write_body) {
+    assert(SectionKeys[section_index] == key);
+    [[maybe_unused]] const u32 start = writer.tell();
+    writer.write<u32>(key);
+    write_body();
+    assert(writer.tell() - start == sizes[section_index]);
+    ++section_index;
+  };
+
+  write_section('KTPT', [&] {
     auto sec = map.getStartPoints();
-    stream.write<u32>('KTPT');
     if (map.getRevision() > 1830) {
-      stream.write<u16>(sec.size());
-      stream.write<u16>(0); // user data
+      writer.write<u16>(sec.size());
+      writer.write<u16>(0); // user data
     }
     for (auto& point : sec) {
       point.position >> writer;
       point.rotation >> writer;
-      stream.write<u16>(point.player_index);
-      stream.write<u16>(point._);
+      writer.write<u16>(point.player_index);
+      writer.write<u16>(point._);
     }
   });
+
   // All points are written contiguously by order of their path
   // No duplicate removal
-  const auto write_path = [&]<typename T = float>(
-      u32 ph_key, u32 pt_key, auto paths, auto write_point, T = {}) {
-
-    auto point_impl = [](oishii::Writer& stream, u32 pt_key, auto paths,
-                         auto write_point) {
-      stream.write<u32>(pt_key);
-      stream.write<u16>(std::accumulate(
-          paths.begin(), paths.end(), 0,
-          [](auto total, auto& path) { return total + path.mPoints.size(); }));
-      stream.write<u16>(0); // user data
+  const auto write_path = [&](u32 ph_key, u32 pt_key, auto paths,
+                              auto write_point) {
+    write_section(pt_key, [&] {
+      writer.write<u16>(countPoints(paths));
+      writer.write<u16>(0); // user data
 
       std::size_t i = 0;
       for (auto& path : paths) {
         const auto p_start = i;
         for (auto& point : path.mPoints) {
-          if constexpr (std::is_same_v<T, bool>) {
-            write_point(point, stream, i, p_start,
-                        p_start + path.mPoints.size());
-          } else {
-            write_point(point, stream);
-          }
+          write_point(point, i, p_start, p_start + path.mPoints.size());
           ++i;
         }
       }
-    };
-    auto path_impl = [](oishii::Writer& stream, u32 pt_key, auto paths) {
-      stream.write<u32>(pt_key);
-      stream.write<u16>(paths.size());
-      stream.write<u16>(0); // user data
-      int i = 0;
+    });
+    write_section(ph_key, [&] {
+      writer.write<u16>(paths.size());
+      writer.write<u16>(0); // user data
       u8 ph_start_index = 0;
       for (auto& path : paths) {
-        stream.write<u8>(ph_start_index);
+        writer.write<u8>(ph_start_index);
         ph_start_index += path.mPoints.size();
-        stream.write<u8>(path.mPoints.size());
+        writer.write<u8>(path.mPoints.size());
         for (auto p : path.mPredecessors)
-          stream.write<u8>(p);
+          writer.write<u8>(p);
         for (int i = path.mPredecessors.size(); i < 6; ++i)
-          stream.write<u8>(0xff);
+          writer.write<u8>(0xff);
         for (auto p : path.mSuccessors)
-          stream.write<u8>(p);
+          writer.write<u8>(p);
         for (int i = path.mSuccessors.size(); i < 6; ++i)
-          stream.write<u8>(0xff);
+          writer.write<u8>(0xff);
         for (auto p : path.misc)
-          stream.write<u8>(p);
-        ++i;
+          writer.write<u8>(p);
       }
-    };
-
-    reloc.writeReloc<s32>("KMP", stringifyId(pt_key),
-                          std::bind(point_impl, std::placeholders::_1, pt_key,
-                                    paths, write_point));
-    reloc.writeReloc<s32>(
-        "KMP", stringifyId(ph_key),
-        std::bind(path_impl, std::placeholders::_1, ph_key, paths));
+    });
   };
 
-  const auto write_enpt = [](const EnemyPoint& point, oishii::Writer& writer) {
-    assert(&writer);
+  const auto write_enpt = [&](const EnemyPoint& point, std::size_t,
+                              std::size_t, std::size_t) {
     point.position >> writer;
     writer.write<f32>(point.deviation);
     for (auto p : point.param)
@@ -521,7 +751,8 @@ void KMP::write(kpi::INode& node, oishii::Writer& writer) const {
   };
   write_path('ENPH', 'ENPT', map.getEnemyPaths(), write_enpt);
 
-  const auto write_itpt = [](const ItemPoint& point, oishii::Writer& writer) {
+  const auto write_itpt = [&](const ItemPoint& point, std::size_t,
+                              std::size_t, std::size_t) {
     point.position >> writer;
     writer.write<f32>(point.deviation);
     for (auto p : point.param)
@@ -529,9 +760,8 @@ void KMP::write(kpi::INode& node, oishii::Writer& writer) const {
   };
   write_path('ITPH', 'ITPT', map.getItemPaths(), write_itpt);
 
-  const auto write_ckpt = [](const CheckPoint& point, oishii::Writer& writer,
-                             std::size_t seq, std::size_t first,
-                             std::size_t last) {
+  const auto write_ckpt = [&](const CheckPoint& point, std::size_t seq,
+                              std::size_t first, std::size_t last) {
     point.getLeft() >> writer;
     point.getRight() >> writer;
     writer.write<u8>(point.getRespawnIndex());
@@ -540,165 +770,152 @@ void KMP::write(kpi::INode& node, oishii::Writer& writer) const {
     writer.write<u8>(seq <= first ? 0xFF : seq - 1);
     writer.write<u8>(seq + 1 == last ? 0xFF : seq + 1);
   };
-  write_path('CKPH', 'CKPT', map.getCheckPaths(), write_ckpt, true);
+  write_path('CKPH', 'CKPT', map.getCheckPaths(), write_ckpt);
 
-  reloc.writeReloc<s32>("KMP", "GOBJ", [&](oishii::Writer& stream) {
+  write_section('GOBJ', [&] {
     auto sec = map.getGeoObjs();
-    stream.write<u32>('GOBJ');
-    stream.write<u16>(sec.size());
-    stream.write<u16>(0); // user data
+    writer.write<u16>(sec.size());
+    writer.write<u16>(0); // user data
     for (auto& entry : sec) {
-      stream.write<u16>(entry.id);
-      stream.write<u16>(entry._);
-      entry.position >> stream;
-      entry.rotation >> stream;
-      entry.scale >> stream;
-      stream.write<u16>(entry.pathId);
+      writer.write<u16>(entry.id);
+      writer.write<u16>(entry._);
+      entry.position >> writer;
+      entry.rotation >> writer;
+      entry.scale >> writer;
+      writer.write<u16>(entry.pathId);
       for (auto s : entry.settings)
-        stream.write<u16>(s);
-      stream.write<u16>(entry.flags);
+        writer.write<u16>(s);
+      writer.write<u16>(entry.flags);
     }
   });
 
-  reloc.writeReloc<s32>("KMP", "POTI", [&](oishii::Writer& stream) {
-    stream.write<u32>('POTI');
-    stream.write<u16>(map.getPaths().size());
+  write_section('POTI', [&] {
+    writer.write<u16>(map.getPaths().size());
     u32 total_count = 0;
     for (auto& entry : map.getPaths())
       total_count += std::distance(entry.begin(), entry.end());
-    stream.write<u16>(total_count);
+    writer.write<u16>(total_count);
     for (auto& entry : map.getPaths()) {
-      stream.write<u16>(std::distance(entry.begin(), entry.end()));
-      stream.write<u8>(static_cast<u8>(entry.getInterpolation()));
-      stream.write<u8>(static_cast<u8>(entry.getLoopPolicy()));
+      writer.write<u16>(std::distance(entry.begin(), entry.end()));
+      writer.write<u8>(static_cast<u8>(entry.getInterpolation()));
+      writer.write<u8>(static_cast<u8>(entry.getLoopPolicy()));
       for (auto& sub : entry) {
-        sub.position >> stream;
+        sub.position >> writer;
         for (auto p : sub.params)
-          stream.write<u16>(p);
+          writer.write<u16>(p);
       }
     }
   });
 
-  reloc.writeReloc<s32>("KMP", "AREA", [&](oishii::Writer& stream) {
-    stream.write<u32>('AREA');
-    stream.write<u16>(map.getAreas().size());
-    stream.write<u16>(0); // user data
+  write_section('AREA', [&] {
+    writer.write<u16>(map.getAreas().size());
+    writer.write<u16>(0); // user data
     for (auto& entry : map.getAreas()) {
-      stream.write<u8>(static_cast<u8>(entry.getModel().mShape));
-      stream.write<u8>(static_cast<u8>(entry.mType));
-      stream.write<u8>(entry.mCameraIndex);
-      stream.write<u8>(entry.mPriority);
-      entry.getModel().mPosition >> stream;
-      entry.getModel().mRotation >> stream;
-      entry.getModel().mScaling >> stream;
+      writer.write<u8>(static_cast<u8>(entry.getModel().mShape));
+      writer.write<u8>(static_cast<u8>(entry.mType));
+      writer.write<u8>(entry.mCameraIndex);
+      writer.write<u8>(entry.mPriority);
+      entry.getModel().mPosition >> writer;
+      entry.getModel().mRotation >> writer;
+      entry.getModel().mScaling >> writer;
       for (auto p : entry.mParameters)
-        stream.write<u16>(p);
+        writer.write<u16>(p);
       if (map.getRevision() >= 2200) {
-        stream.write<u8>(entry.mRailID);
-        stream.write<u8>(entry.mEnemyLinkID);
+        writer.write<u8>(entry.mRailID);
+        writer.write<u8>(entry.mEnemyLinkID);
         for (auto p : entry.mPad)
-          stream.write<u8>(p);
+          writer.write<u8>(p);
       }
     }
   });
 
-  reloc.writeReloc<s32>("KMP", "CAME", [&](oishii::Writer& stream) {
-    stream.write<u32>('CAME');
-    stream.write<u16>(map.getCameras().size());
+  write_section('CAME', [&] {
+    writer.write<u16>(map.getCameras().size());
     // Ignored < 1920
-    stream.write<u8>(map.getOpeningPanIndex());
-    stream.write<u8>(map.getVideoPanIndex());
+    writer.write<u8>(map.getOpeningPanIndex());
+    writer.write<u8>(map.getVideoPanIndex());
     for (auto& entry : map.getCameras()) {
-      stream.write<u8>(static_cast<u8>(entry.mType));
-      stream.write<u8>(entry.mNext);
-      stream.write<u8>(entry.mShake);
-      stream.write<u8>(entry.mPathId);
-      stream.write<u16>(entry.mPathSpeed);
-      stream.write<u16>(entry.mFov.mSpeed);
-      stream.write<u16>(entry.mView.mSpeed);
-      stream.write<u8>(entry.mStartFlag);
-      stream.write<u8>(entry.mMovieFlag);
-      entry.mPosition >> stream;
-      entry.mRotation >> stream;
-      stream.write<f32>(entry.mFov.from);
-      stream.write<f32>(entry.mFov.to);
-      entry.mView.from >> stream;
-      entry.mView.to >> stream;
-      stream.write<f32>(entry.mActiveFrames);
+      writer.write<u8>(static_cast<u8>(entry.mType));
+      writer.write<u8>(entry.mNext);
+      writer.write<u8>(entry.mShake);
+      writer.write<u8>(entry.mPathId);
+      writer.write<u16>(entry.mPathSpeed);
+      writer.write<u16>(entry.mFov.mSpeed);
+      writer.write<u16>(entry.mView.mSpeed);
+      writer.write<u8>(entry.mStartFlag);
+      writer.write<u8>(entry.mMovieFlag);
+      entry.mPosition >> writer;
+      entry.mRotation >> writer;
+      writer.write<f32>(entry.mFov.from);
+      writer.write<f32>(entry.mFov.to);
+      entry.mView.from >> writer;
+      entry.mView.to >> writer;
+      writer.write<f32>(entry.mActiveFrames);
     }
   });
-  reloc.writeReloc<s32>("KMP", "JGPT", [&](oishii::Writer& stream) {
+
+  write_section('JGPT', [&] {
     auto sec = map.getRespawnPoints();
-    stream.write<u32>('JGPT');
-    stream.write<u16>(sec.size());
-    stream.write<u16>(0); // user data
+    writer.write<u16>(sec.size());
+    writer.write<u16>(0); // user data
     for (auto& entry : sec) {
-      entry.position >> stream;
-      entry.rotation >> stream;
+      entry.position >> writer;
+      entry.rotation >> writer;
       writer.write<u16>(entry.id);
       writer.write<u16>(entry.range);
     }
   });
-  reloc.writeReloc<s32>("KMP", "CNPT", [&](oishii::Writer& stream) {
+
+  write_section('CNPT', [&] {
     auto sec = map.getCannonPoints();
-    stream.write<u32>('CNPT');
-    stream.write<u16>(sec.size());
-    stream.write<u16>(0); // user data
+    writer.write<u16>(sec.size());
+    writer.write<u16>(0); // user data
     int i = 0;
     for (auto& entry : sec) {
-      entry.mPosition >> stream;
-      entry.mRotation >> stream;
-      stream.write<u16>(i++);
-      stream.write<u16>(static_cast<u16>(entry.mType));
+      entry.mPosition >> writer;
+      entry.mRotation >> writer;
+      writer.write<u16>(i++);
+      writer.write<u16>(static_cast<u16>(entry.mType));
     }
   });
 
-  reloc.writeReloc<s32>("KMP", "MSPT", [&](oishii::Writer& stream) {
+  write_section('MSPT', [&] {
     auto sec = map.getMissionPoints();
-    stream.write<u32>('MSPT');
-    stream.write<u16>(sec.size());
-    stream.write<u16>(0); // user data
+    writer.write<u16>(sec.size());
+    writer.write<u16>(0); // user data
     for (auto& entry : sec) {
-      entry.position >> stream;
-      entry.rotation >> stream;
+      entry.position >> writer;
+      entry.rotation >> writer;
       writer.write<u16>(entry.id);
       writer.write<u16>(entry.unknown);
     }
   });
 
-  reloc.writeReloc<s32>("KMP", "STGI", [&](oishii::Writer& stream) {
+  write_section('STGI', [&] {
     auto sec = map.getStages();
-    stream.write<u32>('STGI');
-    stream.write<u16>(sec.size());
-    stream.write<u16>(0); // user data
+    writer.write<u16>(sec.size());
+    writer.write<u16>(0); // user data
     for (auto& entry : sec) {
-      stream.write<u8>(entry.mLapCount);
-      stream.write<u8>(static_cast<u8>(entry.mCorner));
-      stream.write<u8>(static_cast<u8>(entry.mStartPosition));
-      stream.write<u8>(entry.mFlareTobi);
-      stream.write<u8>(entry.mLensFlareOptions.a);
-      stream.write<u8>(entry.mLensFlareOptions.r);
-      stream.write<u8>(entry.mLensFlareOptions.g);
-      stream.write<u8>(entry.mLensFlareOptions.b);
+      writer.write<u8>(entry.mLapCount);
+      writer.write<u8>(static_cast<u8>(entry.mCorner));
+      writer.write<u8>(static_cast<u8>(entry.mStartPosition));
+      writer.write<u8>(entry.mFlareTobi);
+      writer.write<u8>(entry.mLensFlareOptions.a);
+      writer.write<u8>(entry.mLensFlareOptions.r);
+      writer.write<u8>(entry.mLensFlareOptions.g);
+      writer.write<u8>(entry.mLensFlareOptions.b);
 
       if (map.getRevision() >= 2320) {
-        stream.write<u8>(entry.mUnk08);
-        stream.write<u8>(entry._);
-        stream.write<u16>(entry.mSpeedModifier);
+        writer.write<u8>(entry.mUnk08);
+        writer.write<u8>(entry._);
+        writer.write<u16>(entry.mSpeedModifier);
       } else {
         // Speed mod value will be defined by whatever comes next in the
         // archive. Nice.
       }
     }
   });
-  reloc.label("KMP");
-  // Write and sections
-  reloc.writeChildren();
-
-  reloc.label("KMP_END");
-
-  // Link relocs
-  reloc.resolve();
+  assert(section_index == SectionKeys.size());
 }
 
 } // namespace riistudio::mk
@@ -18,5 +18,8 @@ public:
     return dynamic_cast<CourseMap*>(&node) != nullptr;
   }
   void write(kpi::INode& node, oishii::Writer& writer) const;
+  //! Write, reporting broken path graphs to `callback`.
+  void write(kpi::INode& node, oishii::Writer& writer,
+             const kpi::IOMessageCallback& callback) const;
 };
 } // namespace riistudio::mk
@@ -92,6 +92,10 @@ def compile_members(members, concrete, parent_data):
 				title(member[1]), title(member[1]), title(member[1])
 			)
 		result += "\t\t}\n"
+		result += "\t\tvoid visitRecords(kpi::RecordVisitor visitor) const override {\n"
+		for member in members:
+			result += "\t\t\tkpi::visitFolder(m%s, visitor);\n" % title(member[1])
+		result += "\t\t}\n"
 		
 		result += "\t};\n"
 		result += "\tstd::unique_ptr<kpi::IMemento> next(const kpi::IMemento* last) const override {\n"
@@ -0,0 +1,434 @@
+// Headless batch texture transcoder.
+//
+// Re-encodes every texture of a BRRES, BMD/BDL or U8/SZS archive to a target
+// policy, optionally dumping the results as PNGs. Textures are processed in
+// parallel; file I/O is sequential.
+
+#include <core/api.hpp>
+#include <core/kpi/Node.hpp>
+#include <core/util/thread_pool.hpp>
+
+#include <oishii/data_provider.hxx>
+#include <oishii/writer/binary_writer.hxx>
+
+#include <plugins/gc/Encoder/ImagePlatform.hpp>
+#include <plugins/gc/Export/Texture.hpp>
+#include <plugins/gc/Util/TexturePolicy.hpp>
+#include <plugins/szs/SZS.hpp>
+
+#include <vendor/llvm/Support/InitLLVM.h>
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace riistudio;
+
+struct Options {
+  std::string input;
+  std::string output;
+  std::string dump_dir;
+  unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+  libcube::TexturePolicy policy;
+};
+
+//! A model or texture file, possibly nested in an archive.
+struct LoadedFile {
+  std::string name;
+  std::unique_ptr<kpi::INode> node;
+};
+
+struct TextureJob {
+  libcube::Texture* texture;
+  const LoadedFile* file;
+};
+
+constexpr u32 U8Magic = 0x55AA382D;
+
+u32 readBE32(const std::vector<u8>& buf, std::size_t ofs) {
+  return (buf[ofs] << 24) | (buf[ofs + 1] << 16) | (buf[ofs + 2] << 8) |
+         buf[ofs + 3];
+}
+void writeBE32(std::vector<u8>& buf, std::size_t ofs, u32 val) {
+  buf[ofs] = val >> 24;
+  buf[ofs + 1] = val >> 16;
+  buf[ofs + 2] = val >> 8;
+  buf[ofs + 3] = val;
+}
+
+std::optional<std::vector<u8>> readFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return std::nullopt;
+  std::vector<u8> vec(file.tellg());
+  file.seekg(0, std::ios::beg);
+  if (!file.read(reinterpret_cast<char*>(vec.data()), vec.size()))
+    return std::nullopt;
+  return vec;
+}
+bool writeFile(const std::string& path, std::span<const u8> data) {
+  std::ofstream file(path, std::ios::binary);
+  return file &&
+         file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+std::unique_ptr<kpi::INode> openNode(const std::string& name,
+                                     std::span<const u8> data) {
+  oishii::DataProvider provider({data.begin(), data.end()}, name);
+  auto importer = SpawnImporter(name, provider.slice());
+  if (!importer.second || !IsConstructible(importer.first))
+    return nullptr;
+
+  std::unique_ptr<kpi::INode> node{
+      dynamic_cast<kpi::INode*>(SpawnState(importer.first).release())};
+  if (!node)
+    return nullptr;
+
+  kpi::IOTransaction transaction{*node, provider.slice(), [](...) {}};
+  importer.second->read_(transaction);
+  if (transaction.state == kpi::TransactionState::Failure)
+    return nullptr;
+  return node;
+}
+
+std::vector<u8> saveNode(kpi::INode& node) {
+  oishii::Writer writer(1024);
+  auto exporter = SpawnExporter(node);
+  assert(exporter);
+  exporter->write_(node, writer);
+  return {writer.getDataBlockStart(),
+          writer.getDataBlockStart() + writer.getBufSize()};
+}
+
+void collectTextures(const LoadedFile& file, std::vector<TextureJob>& out) {
+  for (std::size_t i = 0; i < file.node->numFolders(); ++i) {
+    auto* folder = file.node->folderAt(i);
+    for (std::size_t j = 0; j < folder->size(); ++j) {
+      if (auto* tex = dynamic_cast<libcube::Texture*>(folder->atObject(j)))
+        out.push_back({tex, &file});
+    }
+  }
+}
+
+//! U8 files are rewritten in place: the FST and string table are kept verbatim
+//! and only file offsets and sizes are updated.
+//!
+//! Accessors assume `isValid()`.
+struct U8Archive {
+  std::vector<u8> data;
+  //! Node index -> replacement contents
+  std::map<u32, std::vector<u8>> replaced;
+
+  //! Whether the header, FST, names and file extents all lie within `data`,
+  //! with the FST and string table ahead of the file data.
+  bool isValid() const {
+    if (data.size() < 16 || readBE32(data, 0) != U8Magic)
+      return false;
+    const u64 fst = fstStart();
+    if (fst < 16 || fst + 12 > data.size())
+      return false;
+    const u64 strings = fst + u64(numNodes()) * 12;
+    if (numNodes() == 0 || isFile(0) || strings > dataStart() ||
+        dataStart() > data.size())
+      return false;
+    for (u32 i = 0; i < numNodes(); ++i) {
+      const u64 name_ofs = strings + (readBE32(data, nodeAt(i)) & 0xff'ffff);
+      if (name_ofs >= dataStart() ||
+          !memchr(data.data() + name_ofs, 0, dataStart() - name_ofs))
+        return false;
+      if (!isFile(i))
+        continue;
+      const u64 file_end =
+          u64(readBE32(data, nodeAt(i) + 4)) + readBE32(data, nodeAt(i) + 8);
+      if (file_end > data.size())
+        return false;
+    }
+    return true;
+  }
+
+  u32 fstStart() const { return readBE32(data, 4); }
+  u32 dataStart() const { return readBE32(data, 12); }
+  u32 numNodes() const { return readBE32(data, fstStart() + 8); }
+  u32 nodeAt(u32 index) const { return fstStart() + 12 * index; }
+  bool isFile(u32 index) const { return (data[nodeAt(index)] & 0xff) == 0; }
+
+  std::string name(u32 index) const {
+    const u32 strings = fstStart() + numNodes() * 12;
+    const u32 ofs = readBE32(data, nodeAt(index)) & 0xff'ffff;
+    return reinterpret_cast<const char*>(data.data() + strings + ofs);
+  }
+  std::span<const u8> file(u32 index) const {
+    return {data.data() + readBE32(data, nodeAt(index) + 4),
+            readBE32(data, nodeAt(index) + 8)};
+  }
+
+  std::vector<u8> rebuild() const {
+    std::vector<u8> out(data.begin(), data.begin() + dataStart());
+    for (u32 i = 1; i < numNodes(); ++i) {
+      if (!isFile(i))
+        continue;
+      const auto it = replaced.find(i);
+      const std::span<const u8> contents =
+          it != replaced.end() ? std::span<const u8>(it->second) : file(i);
+
+      out.resize(roundUp(out.size(), 32));
+      writeBE32(out, nodeAt(i) + 4, out.size());
+      writeBE32(out, nodeAt(i) + 8, contents.size());
+      out.insert(out.end(), contents.begin(), contents.end());
+    }
+    out.resize(roundUp(out.size(), 32));
+    return out;
+  }
+};
+
+bool parseFormat(std::string_view str, libcube::gx::TextureFormat& out) {
+  using libcube::gx::TextureFormat;
+  static const std::pair<std::string_view, TextureFormat> formats[]{
+      {"I4", TextureFormat::I4},         {"I8", TextureFormat::I8},
+      {"IA4", TextureFormat::IA4},       {"IA8", TextureFormat::IA8},
+      {"RGB565", TextureFormat::RGB565}, {"RGB5A3", TextureFormat::RGB5A3},
+      {"RGBA8", TextureFormat::RGBA8},   {"CMPR", TextureFormat::CMPR}};
+  for (auto& [name, format] : formats) {
+    if (name == str) {
+      out = format;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::optional<u32> parseCount(std::string_view str) {
+  u32 value = 0;
+  const auto result =
+      std::from_chars(str.data(), str.data() + str.size(), value);
+  if (str.empty() || result.ec != std::errc() ||
+      result.ptr != str.data() + str.size())
+    return std::nullopt;
+  return value;
+}
+
+//! Names read from the input may contain separators or `..`; reduce them to a
+//! single path component.
+std::string sanitizeName(std::string_view name) {
+  std::string out;
+  for (const char c : name) {
+    const bool unsafe = c == '/' || c == '\\' || c == ':' || c == '*' ||
+                        c == '?' || c == '"' || c == '<' || c == '>' ||
+                        c == '|' || static_cast<unsigned char>(c) < 0x20;
+    out += unsafe ? '_' : c;
+  }
+  if (out.empty() || out.find_first_not_of('.') == std::string::npos)
+    out = "_" + out;
+  return out;
+}
+
+//! Hands out sanitized names, suffixing repeats so no two are equal (ignoring
+//! case, for case-insensitive filesystems).
+class UniqueNames {
+public:
+  std::string get(std::string_view name) {
+    const std::string base = sanitizeName(name);
+    std::string out = base;
+    for (int i = 1; !mUsed.insert(lower(out)).second; ++i)
+      out = base + "_" + std::to_string(i);
+    return out;
+  }
+
+private:
+  static std::string lower(std::string str) {
+    for (char& c : str)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return str;
+  }
+
+  std::set<std::string> mUsed;
+};
+
+void printUsage() {
+  printf("Usage: texbatch <input> [options]\n"
+         "  -o <path>          Write the transcoded file to <path>\n"
+         "  --dump <dir>       Dump every texture as a PNG to <dir>\n"
+         "  --format <fmt>     I4, I8, IA4, IA8, RGB565, RGB5A3, RGBA8, CMPR\n"
+         "  --max-dim <n>      Halve textures larger than <n> pixels\n"
+         "  --mips <n>         Number of mipmaps past the base level\n"
+         "  --lanczos          Resize with Lanczos instead of AVIR\n"
+         "  --threads <n>      Worker threads (default: all cores)\n");
+}
+
+std::optional<Options> parseOptions(int argc, const char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "-o" && has_value) {
+      opt.output = argv[++i];
+    } else if (arg == "--dump" && has_value) {
+      opt.dump_dir = argv[++i];
+    } else if (arg == "--format" && has_value) {
+      libcube::gx::TextureFormat format;
+      if (!parseFormat(argv[++i], format)) {
+        printf("Unknown texture format: %s\n", argv[i]);
+        return std::nullopt;
+      }
+      opt.policy.format = format;
+    } else if ((arg == "--max-dim" || arg == "--mips" || arg == "--threads") &&
+               has_value) {
+      const auto value = parseCount(argv[++i]);
+      if (!value || (arg == "--threads" && *value == 0)) {
+        printf("Invalid value for %s: %s\n", argv[i - 1], argv[i]);
+        return std::nullopt;
+      }
+      if (arg == "--max-dim")
+        opt.policy.maxDimension = *value;
+      else if (arg == "--mips")
+        opt.policy.mipmapCount = *value;
+      else
+        opt.num_threads = *value;
+    } else if (arg == "--lanczos") {
+      opt.policy.algorithm = libcube::image_platform::Lanczos;
+    } else if (opt.input.empty() && !arg.starts_with("-")) {
+      opt.input = arg;
+    } else {
+      printf("Unexpected argument: %s\n", argv[i]);
+      return std::nullopt;
+    }
+  }
+  if (opt.input.empty() || (opt.output.empty() && opt.dump_dir.empty()))
+    return std::nullopt;
+  return opt;
+}
+
+int run(const Options& opt) {
+  auto input = readFile(opt.input);
+  if (!input) {
+    printf("Cannot read %s\n", opt.input.c_str());
+    return 1;
+  }
+
+  // SZS -> U8
+  const bool is_szs = input->size() >= 16 && !memcmp(input->data(), "Yaz0", 4);
+  if (is_szs) {
+    std::vector<u8> expanded(szs::getExpandedSize(*input));
+    if (auto err = szs::decode(expanded, *input)) {
+      printf("Cannot decompress %s: %s\n", opt.input.c_str(),
+             llvm::toString(std::move(err)).c_str());
+      return 1;
+    }
+    *input = std::move(expanded);
+  }
+
+  std::optional<U8Archive> archive;
+  std::vector<LoadedFile> files;
+  std::vector<u32> file_nodes; // U8 node index of each file
+
+  if (input->size() >= 16 && readBE32(*input, 0) == U8Magic) {
+    archive = U8Archive{std::move(*input)};
+    if (!archive->isValid()) {
+      printf("Malformed U8 archive %s\n", opt.input.c_str());
+      return 1;
+    }
+    for (u32 i = 1; i < archive->numNodes(); ++i) {
+      if (!archive->isFile(i))
+        continue;
+      const auto name = archive->name(i);
+      if (auto node = openNode(name, archive->file(i))) {
+        files.push_back({name, std::move(node)});
+        file_nodes.push_back(i);
+      }
+    }
+  } else if (auto node = openNode(opt.input, *input)) {
+    const auto name = std::filesystem::path(opt.input).filename().string();
+    files.push_back({name, std::move(node)});
+  }
+  if (files.empty()) {
+    printf("No supported files in %s\n", opt.input.c_str());
+    return 1;
+  }
+
+  std::vector<TextureJob> jobs;
+  for (const auto& file : files)
+    collectTextures(file, jobs);
+  printf("Processing %u textures on %u threads\n",
+         static_cast<u32>(jobs.size()), opt.num_threads);
+
+  // Assigned up front: jobs run concurrently and must not share a path
+  std::vector<std::filesystem::path> dump_paths(jobs.size());
+  if (!opt.dump_dir.empty()) {
+    UniqueNames dir_names;
+    std::map<const LoadedFile*, std::pair<std::filesystem::path, UniqueNames>>
+        dirs;
+    for (const auto& file : files) {
+      auto& [dir, names] = dirs[&file];
+      dir = std::filesystem::path(opt.dump_dir) / dir_names.get(file.name);
+      std::filesystem::create_directories(dir);
+    }
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+      auto& [dir, names] = dirs[jobs[i].file];
+      dump_paths[i] = dir / (names.get(jobs[i].texture->getName()) + ".png");
+    }
+  }
+
+  // Not vector<bool>: elements are written concurrently
+  std::vector<u8> modified(jobs.size());
+  {
+    // Textures are already spread across the pool; don't split them further.
+    if (opt.num_threads > 1)
+      libcube::image_platform::setResizeConcurrency(1);
+    util::ThreadPool pool(opt.num_threads);
+    util::parallelFor(pool, jobs.size(), [&](std::size_t i) {
+      auto& tex = *jobs[i].texture;
+      modified[i] = libcube::applyTexturePolicy(tex, opt.policy);
+      if (!dump_paths[i].empty())
+        libcube::exportTexturePng(tex, dump_paths[i].string());
+    });
+  }
+  printf("Re-encoded %u of %u textures\n",
+         static_cast<u32>(std::count(modified.begin(), modified.end(), 1)),
+         static_cast<u32>(jobs.size()));
+
+  if (opt.output.empty())
+    return 0;
+
+  std::vector<u8> result;
+  if (archive) {
+    for (std::size_t i = 0; i < files.size(); ++i)
+      archive->replaced[file_nodes[i]] = saveNode(*files[i].node);
+    result = archive->rebuild();
+    if (is_szs)
+      result = szs::encodeFast(result);
+  } else {
+    result = saveNode(*files[0].node);
+  }
+
+  if (!writeFile(opt.output, result)) {
+    printf("Cannot write %s\n", opt.output.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, const char** argv) {
+  llvm::InitLLVM init_llvm(argc, argv);
+
+  const auto options = parseOptions(argc, argv);
+  if (!options) {
+    printUsage();
+    return 1;
+  }
+
+  InitAPI();
+  const int result = run(*options);
+  DeinitAPI();
+  return result;
+}
@@ -0,0 +1,131 @@
+#include "test.hpp"
+
+#include <unittests/fixtures/Document.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using riistudio::test::Document;
+
+// Large enough for the collection to index names
+constexpr std::size_t NumMeshes = 12;
+
+void fill(Document& doc) {
+  for (std::size_t i = 0; i < NumMeshes; ++i)
+    doc.getMeshes().add().mName = "Mesh" + std::to_string(i);
+}
+
+// Expect every name to be found at its index, and `missing` at none
+void expectFindsAll(const Document& doc,
+                    const std::vector<std::string>& missing) {
+  const auto meshes = doc.getMeshes();
+  for (std::size_t i = 0; i < meshes.size(); ++i) {
+    EXPECT(meshes.indexOf(meshes[i].mName) == static_cast<s32>(i));
+    EXPECT(meshes.findByName(meshes[i].mName) == &meshes[i]);
+  }
+  for (const auto& name : missing)
+    EXPECT(meshes.findByName(name) == nullptr);
+}
+
+} // namespace
+
+RII_TEST(CollectionFindsByName) {
+  Document doc;
+  auto meshes = doc.getMeshes();
+  // Small collections are scanned; adding the eighth object starts indexing
+  for (std::size_t i = 0; i < NumMeshes; ++i) {
+    meshes.add().mName = "Mesh" + std::to_string(i);
+    expectFindsAll(doc, {"Mesh" + std::to_string(i + 1)});
+  }
+  EXPECT(meshes.toConst().indexOf("") == -1);
+
+  // Duplicates resolve to the first, as a scan would
+  meshes.add().mName = "Mesh3";
+  EXPECT(meshes.toConst().indexOf("Mesh3") == 3);
+}
+
+RII_TEST(CollectionFindsRenamedObjects) {
+  Document doc;
+  fill(doc);
+  expectFindsAll(doc, {});
+
+  auto meshes = doc.getMeshes();
+  meshes[3].setName("Renamed");
+  expectFindsAll(doc, {"Mesh3"});
+  // Swapped names: the index points each name at the other object
+  meshes[5].setName("Mesh6");
+  meshes[6].setName("Mesh5");
+  expectFindsAll(doc, {"Mesh3"});
+  // An object takes the name of a removed one
+  meshes[7].setName("Mesh3");
+  expectFindsAll(doc, {"Mesh7", "Renamed2"});
+
+  // A name written without notifying the collection is not seen until the
+  // index is next rebuilt
+  meshes[8].mName = "Unnotified";
+  EXPECT(meshes.toConst().indexOf("Unnotified") == -1);
+  EXPECT(meshes.toConst().indexOf("Mesh8") == 8);
+  meshes[8].onRenamed();
+  expectFindsAll(doc, {"Mesh8"});
+}
+
+RII_TEST(CollectionFindsByNameAfterResize) {
+  Document doc;
+  fill(doc);
+  auto meshes = doc.getMeshes();
+  expectFindsAll(doc, {});
+
+  meshes.add().mName = "Added";
+  expectFindsAll(doc, {});
+  // Removing the last objects
+  meshes.resize(NumMeshes - 2);
+  expectFindsAll(doc, {"Added", "Mesh11", "Mesh10"});
+  // Below the indexed size
+  meshes.resize(4);
+  expectFindsAll(doc, {"Mesh4", "Mesh9"});
+  meshes.resize(NumMeshes);
+  for (std::size_t i = 4; i < NumMeshes; ++i)
+    meshes[i].setName("New" + std::to_string(i));
+  // A removed name given to two new objects resolves to the first
+  meshes[6].setName("Mesh11");
+  meshes[11].setName("Mesh11");
+  EXPECT(meshes.toConst().indexOf("Mesh11") == 6);
+  meshes[6].setName("New6");
+  expectFindsAll(doc, {"Mesh4", "Mesh9"});
+}
+
+RII_TEST(CollectionFindsByNameAfterUndo) {
+  Document doc;
+  fill(doc);
+  auto meshes = doc.getMeshes();
+  kpi::History history;
+  history.commit(doc);
+  expectFindsAll(doc, {});
+
+  meshes[2].setName("Renamed");
+  history.commit(doc);
+  meshes.add().mName = "Added";
+  history.commit(doc);
+  meshes.resize(NumMeshes - 1);
+  history.commit(doc);
+  expectFindsAll(doc, {"Added", "Mesh2", "Mesh11"});
+
+  history.undo(doc);
+  expectFindsAll(doc, {"Mesh2"});
+  EXPECT(meshes.toConst().indexOf("Added") == static_cast<s32>(NumMeshes));
+  history.undo(doc);
+  expectFindsAll(doc, {"Added", "Mesh2"});
+  EXPECT(meshes.toConst().indexOf("Renamed") == 2);
+  history.undo(doc);
+  expectFindsAll(doc, {"Added", "Renamed"});
+  EXPECT(meshes.toConst().indexOf("Mesh2") == 2);
+
+  history.redo(doc);
+  expectFindsAll(doc, {"Added", "Mesh2"});
+  history.redo(doc);
+  history.redo(doc);
+  expectFindsAll(doc, {"Added", "Mesh2", "Mesh11"});
+  history.flush();
+}
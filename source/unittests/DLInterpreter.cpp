@@ -0,0 +1,171 @@
+#include "test.hpp"
+
+#include <plugins/gc/GPU/DLInterpreter.hpp>
+#include <plugins/gc/GPU/DLPixShader.hpp>
+
+#include <initializer_list>
+#include <vector>
+
+namespace {
+
+using namespace libcube::gpu;
+
+// Hand-encoded register commands, as they appear in a material display list
+struct DisplayList {
+  void bp(u8 reg, u32 val) {
+    bytes.push_back(0x61);
+    bytes.push_back(reg);
+    push24(val);
+  }
+  void cp(u8 reg, u32 val) {
+    bytes.push_back(0x08);
+    bytes.push_back(reg);
+    push32(val);
+  }
+  void xf(u16 reg, std::initializer_list<u32> vals) {
+    bytes.push_back(0x10);
+    const u16 nCmd = vals.size() - 1;
+    bytes.push_back(nCmd >> 8);
+    bytes.push_back(nCmd & 0xff);
+    bytes.push_back(reg >> 8);
+    bytes.push_back(reg & 0xff);
+    for (const u32 val : vals)
+      push32(val);
+  }
+  void push24(u32 val) {
+    bytes.push_back(val >> 16);
+    bytes.push_back(val >> 8);
+    bytes.push_back(val);
+  }
+  void push32(u32 val) {
+    bytes.push_back(val >> 24);
+    push24(val);
+  }
+
+  std::vector<u8> bytes;
+};
+
+// Records every callback, flattening the XF payloads
+struct Recorder {
+  void onCommandsBP(std::span<const QBPCommand> tokens) {
+    batches.push_back(tokens.size());
+    for (const auto& token : tokens)
+      bp.push_back({token.reg, token.val});
+  }
+  void onCommandCP(const QCPCommand& token) { cp.push_back(token); }
+  void onCommandXF(const QXFCommand& token) {
+    for (std::size_t i = 0; i < token.size(); ++i)
+      xf.push_back({static_cast<u16>(token.reg + i), token.getValue(i)});
+  }
+
+  struct Write {
+    u32 reg;
+    u32 val;
+    bool operator==(const Write&) const = default;
+  };
+  std::vector<std::size_t> batches;
+  std::vector<Write> bp;
+  std::vector<QCPCommand> cp;
+  std::vector<Write> xf;
+};
+
+} // namespace
+
+RII_TEST(DLInterpreterDecodesRegisterWrites) {
+  DisplayList dl;
+  dl.bytes.push_back(0); // NOP
+  for (u32 i = 0; i < 40; ++i)
+    dl.bp(0x40, i);
+  dl.cp(0x50, 0x12345678);
+  dl.xf(0x1040, {0xAAAA0001, 0xBBBB0002, 0xCCCC0003});
+  dl.bp(0xF3, 0xABCDEF);
+  const std::size_t end = dl.bytes.size();
+  // Decoding stops at a draw command
+  dl.bytes.push_back(0x90);
+  dl.bytes.push_back(0);
+  dl.bytes.push_back(3);
+
+  Recorder rec;
+  EXPECT(DecodeRegisterWrites(dl.bytes, rec) == end);
+  // Batches are flushed when full and before every other command
+  EXPECT(rec.batches == std::vector<std::size_t>{32, 8, 1});
+  EXPECT(rec.bp.size() == 41);
+  EXPECT(rec.bp[39] == Recorder::Write{0x40, 39});
+  EXPECT(rec.bp[40] == Recorder::Write{0xF3, 0xABCDEF});
+  EXPECT(rec.cp.size() == 1 && rec.cp[0].reg == 0x50 &&
+         rec.cp[0].val == 0x12345678);
+  // Every value of the XF command, each to its own register
+  EXPECT(rec.xf == std::vector<Recorder::Write>{{0x1040, 0xAAAA0001},
+                                                {0x1041, 0xBBBB0002},
+                                                {0x1042, 0xCCCC0003}});
+}
+
+RII_TEST(DLInterpreterStopsAtTruncatedCommands) {
+  DisplayList dl;
+  dl.bp(0x40, 1);
+  const std::size_t end = dl.bytes.size();
+  dl.xf(0x1040, {1, 2});
+  dl.bytes.pop_back();
+
+  Recorder rec;
+  EXPECT(DecodeRegisterWrites(dl.bytes, rec) == end);
+  EXPECT(rec.bp.size() == 1);
+  EXPECT(rec.xf.empty());
+
+  // A BP command missing its last byte
+  Recorder rec2;
+  EXPECT(DecodeRegisterWrites({dl.bytes.data(), end - 1}, rec2) == 0);
+  EXPECT(rec2.bp.empty());
+}
+
+RII_TEST(DLInterpreterAppliesMaterialDisplayList) {
+  DisplayList dl;
+  dl.bp(BPAddress::ALPHACOMPARE, 0x123456);
+  // The mask applies to the next write only
+  dl.bp(BPAddress::BP_MASK, 0x0000FF);
+  dl.bp(BPAddress::ZMODE, 0xABCDEF);
+  dl.bp(BPAddress::BLENDMODE, 0x00ABCD);
+  // Konstant 1: red/alpha, then blue/green
+  dl.bp(BPAddress::TEV_COLOR_RA + 2, (1 << 23) | (0x22 << 12) | 0x11);
+  dl.bp(BPAddress::TEV_COLOR_BG + 2, (1 << 23) | (0x44 << 12) | 0x33);
+  // Register 2: red/alpha
+  dl.bp(BPAddress::TEV_COLOR_RA + 4, (0x66 << 12) | 0x55);
+  dl.cp(0x50, 0x12345678);
+  // Texgens 0-2, then the post-transform of texgens 6 and 7. Registers past
+  // the last texgen are ignored.
+  dl.xf(XF_TEX0_ID, {0x10, 0x20, 0x30});
+  dl.xf(XF_DUALTEX0_ID + 6, {0x46, 0x47, 0x48});
+
+  // Registers start out undefined
+  GPUMaterial mat;
+  mat.mPixel.mZMode.hex = 0x111111;
+  for (auto& color : mat.mShaderColor.Konstants)
+    color.hex = 0;
+  for (auto& color : mat.mShaderColor.Registers)
+    color.hex = 0;
+  for (auto& texture : mat.mTexture) {
+    texture.tex.hex = 0xFFFF;
+    texture.dualTex.hex = 0xFFFF;
+  }
+  EXPECT(ApplyMaterialDisplayList(dl.bytes, mat) == dl.bytes.size());
+
+  EXPECT(mat.mPixel.mAlphaCompare.hex == 0x123456);
+  EXPECT(mat.mPixel.mZMode.hex == 0x1111EF);
+  EXPECT(mat.mPixel.mBlendMode.hex == 0x00ABCD);
+
+  const auto& konst = mat.mShaderColor.Konstants[1];
+  EXPECT(konst.red.Value() == 0x11 && konst.alpha.Value() == 0x22);
+  EXPECT(konst.blue.Value() == 0x33 && konst.green.Value() == 0x44);
+  const auto& reg = mat.mShaderColor.Registers[2];
+  EXPECT(reg.red.Value() == 0x55 && reg.alpha.Value() == 0x66);
+
+  EXPECT(mat.mTexture[0].tex.hex == 0x10);
+  EXPECT(mat.mTexture[1].tex.hex == 0x20);
+  EXPECT(mat.mTexture[2].tex.hex == 0x30);
+  EXPECT(mat.mTexture[3].tex.hex == 0xFFFF);
+  EXPECT(mat.mTexture[5].dualTex.hex == 0xFFFF);
+  EXPECT(mat.mTexture[6].dualTex.hex == 0x46);
+  EXPECT(mat.mTexture[7].dualTex.hex == 0x47);
+  for (u32 i = 0; i < 8; ++i)
+    EXPECT(mat.mTexture[i].id == i);
+}
@@ -0,0 +1,228 @@
+#include "test.hpp"
+
+#include <plugins/gc/Util/DisplayList.hpp>
+
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace libcube;
+
+using Layout =
+    std::vector<std::pair<gx::VertexAttribute, gx::VertexAttributeType>>;
+
+VertexDescriptor makeDescriptor(const Layout& layout) {
+  VertexDescriptor vcd;
+  for (const auto& [attr, type] : layout)
+    vcd.mAttributes[attr] = type;
+  vcd.calcVertexDescriptorFromAttributeList();
+  return vcd;
+}
+
+// Append a primitive with indices of every attribute the list stores; `seed`
+// varies them per primitive. Byte indices stay below the disabled index 0xff.
+void addPrimitive(MatrixPrimitive& mp, gx::PrimitiveType type, u16 nVerts,
+                  const VertexDescriptor& vcd, u32 seed) {
+  const auto vertices = mp.vertices(mp.addPrimitive(type, nVerts));
+  for (u32 a = 0; a < (u32)gx::VertexAttribute::Max; ++a) {
+    const auto attr = static_cast<gx::VertexAttribute>(a);
+    if (!vertices.hasAttribute(attr))
+      continue;
+    const bool isShort =
+        vcd.mAttributes.at(attr) == gx::VertexAttributeType::Short;
+    for (std::size_t v = 0; v < vertices.size(); ++v)
+      vertices[v][attr] = ((seed + a * 31 + v) * 2654435761u >> 12) %
+                          (isShort ? 0xfffe : 0xfe);
+  }
+}
+
+// The per-vertex writer EncodeMeshDisplayList replaced in the BMD and MDL0
+// writers. Those only accepted direct position/normal matrix indices; texture
+// matrix indices are written the same way.
+std::vector<u8> encodePerVertex(const VertexDescriptor& vcd,
+                                const MatrixPrimitive& mp) {
+  oishii::Writer writer(0);
+  writer.setEndian(true);
+  for (auto& prim : mp.mPrimitives) {
+    writer.write<u8>(gx::EncodeDrawPrimitiveCommand(prim.mType));
+    writer.write<u16>(prim.mNumVertices);
+    for (const auto& v : mp.vertices(prim)) {
+      for (int a = 0; a < (int)gx::VertexAttribute::Max; ++a) {
+        const auto attr = static_cast<gx::VertexAttribute>(a);
+        if (!vcd[attr])
+          continue;
+        if (vcd.mAttributes.at(attr) == gx::VertexAttributeType::Short)
+          writer.write<u16>(v[attr]);
+        else
+          writer.write<u8>(v[attr]);
+      }
+    }
+  }
+  const u8* data = writer.getDataBlockStart();
+  return {data, data + writer.getBufSize()};
+}
+
+std::vector<u8> encodeThroughWriter(const VertexDecodePlan& plan,
+                                    const MatrixPrimitive& mp) {
+  oishii::Writer writer(0);
+  writer.setEndian(true);
+  EncodeMeshDisplayList(writer, plan, mp);
+  const u8* data = writer.getDataBlockStart();
+  return {data, data + writer.getBufSize()};
+}
+
+const Layout Layouts[] = {
+    {{gx::VertexAttribute::Position, gx::VertexAttributeType::Byte},
+     {gx::VertexAttribute::Color0, gx::VertexAttributeType::Byte},
+     {gx::VertexAttribute::TexCoord0, gx::VertexAttributeType::Byte}},
+    {{gx::VertexAttribute::Position, gx::VertexAttributeType::Short},
+     {gx::VertexAttribute::Normal, gx::VertexAttributeType::Short},
+     {gx::VertexAttribute::TexCoord0, gx::VertexAttributeType::Short},
+     {gx::VertexAttribute::TexCoord1, gx::VertexAttributeType::Short}},
+    {{gx::VertexAttribute::PositionNormalMatrixIndex,
+      gx::VertexAttributeType::Direct},
+     {gx::VertexAttribute::Texture0MatrixIndex,
+      gx::VertexAttributeType::Direct},
+     {gx::VertexAttribute::Texture1MatrixIndex,
+      gx::VertexAttributeType::Direct},
+     {gx::VertexAttribute::Position, gx::VertexAttributeType::Short},
+     {gx::VertexAttribute::Normal, gx::VertexAttributeType::Byte},
+     {gx::VertexAttribute::Color0, gx::VertexAttributeType::Short},
+     {gx::VertexAttribute::TexCoord0, gx::VertexAttributeType::Byte}},
+};
+
+} // namespace
+
+RII_TEST(DisplayListEncodeMatchesPerVertexWriter) {
+  for (const auto& layout : Layouts) {
+    const auto vcd = makeDescriptor(layout);
+    auto plan = CompileVertexDecodePlan(vcd);
+    if (!EXPECT(static_cast<bool>(plan))) {
+      llvm::consumeError(plan.takeError());
+      continue;
+    }
+
+    // Streams of every attribute, all but the first, and none
+    const u32 first = 1 << (u32)layout.front().first;
+    for (const u32 attributes : {vcd.mBitfield, vcd.mBitfield & ~first, 0u}) {
+      MatrixPrimitive mp;
+      mp.mVertices.setAttributes(attributes);
+      addPrimitive(mp, gx::PrimitiveType::Triangles, 3, vcd, 1);
+      addPrimitive(mp, gx::PrimitiveType::TriangleStrip, 300, vcd, 2);
+      addPrimitive(mp, gx::PrimitiveType::TriangleFan, 0, vcd, 3);
+      addPrimitive(mp, gx::PrimitiveType::Triangles, 6, vcd, 4);
+      // Crosses a storage chunk
+      addPrimitive(mp, gx::PrimitiveType::TriangleStrip,
+                   IndexedVertexList::ChunkVertices, vcd, 5);
+      const auto expected = encodePerVertex(vcd, mp);
+
+      std::vector<u8> out{0xAB};
+      EncodeMeshDisplayList(out, *plan, mp);
+      EXPECT(out.front() == 0xAB);
+      EXPECT(std::vector<u8>(out.begin() + 1, out.end()) == expected);
+      EXPECT(encodeThroughWriter(*plan, mp) == expected);
+    }
+    EXPECT(encodeThroughWriter(*plan, MatrixPrimitive{}).empty());
+  }
+}
+
+RII_TEST(DisplayListDecodeInvertsEncode) {
+  for (const auto& layout : Layouts) {
+    const auto vcd = makeDescriptor(layout);
+    const auto plan = *CompileVertexDecodePlan(vcd);
+    MatrixPrimitive mp;
+    mp.mVertices.setAttributes(vcd.mBitfield);
+    addPrimitive(mp, gx::PrimitiveType::Triangles, 3, vcd, 1);
+    addPrimitive(mp, gx::PrimitiveType::TriangleStrip, 300, vcd, 2);
+    addPrimitive(mp, gx::PrimitiveType::TriangleStrip,
+                 IndexedVertexList::ChunkVertices, vcd, 3);
+    std::vector<u8> dl;
+    EncodeMeshDisplayList(dl, plan, mp);
+    const u32 size = dl.size();
+
+    oishii::DataProvider provider(std::move(dl));
+    oishii::BinaryReader reader(provider.slice());
+    MatrixPrimitive decoded;
+    if (auto err = DecodeMeshDisplayList(reader, 0, size, decoded, vcd,
+                                         nullptr)) {
+      EXPECT(!"DecodeMeshDisplayList failed");
+      llvm::consumeError(std::move(err));
+      continue;
+    }
+    EXPECT(decoded == mp);
+  }
+}
+
+RII_TEST(DisplayListResizesPrimitivesInPlace) {
+  const auto vcd = makeDescriptor(Layouts[0]);
+  MatrixPrimitive mp;
+  mp.mVertices.setAttributes(vcd.mBitfield);
+  addPrimitive(mp, gx::PrimitiveType::Triangles, 6, vcd, 1);
+  addPrimitive(mp, gx::PrimitiveType::TriangleStrip, 5, vcd, 2);
+  addPrimitive(mp, gx::PrimitiveType::TriangleFan, 4, vcd, 3);
+  const auto before = mp;
+  const auto vertices = [](const MatrixPrimitive& mp, std::size_t i) {
+    const auto range = mp.vertices(mp.mPrimitives[i]);
+    return std::vector<IndexedVertex>(range.begin(), range.end());
+  };
+
+  // Growing the first primitive moves the later ones, and keeps their vertices
+  mp.resizePrimitive(0, 9);
+  EXPECT(mp.mPrimitives[1].mFirstVertex == 9);
+  EXPECT(mp.mPrimitives[2].mFirstVertex == 14);
+  EXPECT(mp.mVertices.size() == 18);
+  for (std::size_t i = 1; i < 3; ++i)
+    EXPECT(vertices(mp, i) == vertices(before, i));
+  auto grown = vertices(before, 0);
+  grown.resize(9);
+  EXPECT(vertices(mp, 0) == grown);
+
+  // Shrinking it back restores the original
+  mp.resizePrimitive(0, 6);
+  EXPECT(mp == before);
+  mp.resizePrimitive(1, 0);
+  EXPECT(mp.mPrimitives[2].mFirstVertex == 6);
+  EXPECT(vertices(mp, 2) == vertices(before, 2));
+}
+
+RII_TEST(DisplayListMeshCopiesShareVertexChunks) {
+  const auto vcd = makeDescriptor(Layouts[1]);
+  MatrixPrimitive mp;
+  mp.mVertices.setAttributes(vcd.mBitfield);
+  addPrimitive(mp, gx::PrimitiveType::TriangleStrip,
+               3 * IndexedVertexList::ChunkVertices, vcd, 1);
+  const auto chunks = [](const MatrixPrimitive& mp) {
+    std::set<const void*> chunks;
+    mp.mVertices.forEachAllocation(
+        [&](const void* chunk, std::size_t) { chunks.insert(chunk); });
+    return chunks;
+  };
+  const auto shared = [&](const MatrixPrimitive& a, const MatrixPrimitive& b) {
+    std::size_t count = 0;
+    for (const void* chunk : chunks(a))
+      count += chunks(b).count(chunk);
+    return count;
+  };
+
+  // Four streams of three chunks, all shared with the copy
+  const auto snapshot = mp;
+  EXPECT(chunks(mp).size() == 4 * 3);
+  EXPECT(shared(mp, snapshot) == 4 * 3);
+
+  // Reading does not detach; writing one index detaches one chunk
+  const std::size_t v = IndexedVertexList::ChunkVertices + 52;
+  const auto vertices = mp.vertices(mp.mPrimitives[0]);
+  const auto& readOnly = mp;
+  const u16 before = readOnly.vertices(
+      readOnly.mPrimitives[0])[v][gx::VertexAttribute::Normal];
+  EXPECT(shared(mp, snapshot) == 4 * 3);
+  vertices[v][gx::VertexAttribute::Normal] = before + 1;
+  EXPECT(shared(mp, snapshot) == 4 * 3 - 1);
+  EXPECT(!(mp == snapshot));
+  EXPECT(snapshot.vertices(snapshot.mPrimitives[0])[v]
+                         [gx::VertexAttribute::Normal] == before);
+  vertices[v][gx::VertexAttribute::Normal] = before;
+  EXPECT(mp == snapshot);
+}
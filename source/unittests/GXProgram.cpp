@@ -0,0 +1,479 @@
+#include "test.hpp"
+
+#include <plugins/gc/GX/Shader/GXProgram.hpp>
+#include <plugins/gc/GX/Shader/GXShaderCache.hpp>
+#include <unittests/fixtures/Material.hpp>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace libcube;
+using namespace libcube::gx;
+
+using riistudio::test::GCMaterial;
+
+// Two stages over two texgens, unlit
+void makeBaseMaterial(GCMaterialData& data) {
+  riistudio::test::makeTexturedMaterial(data);
+  data.shader.mStages.emplace_back();
+  data.shader.mStages[1].colorStage.b = TevColorArg::rasc;
+  data.shader.mStages[1].texCoord = 1;
+}
+
+// Bodies generated for the base material: no platform header, so the same on
+// every platform
+const std::string_view BaseVert = R"glsl(precision mediump float;
+
+// Expected to be constant across the entire scene.
+layout(std140) uniform ub_SceneParams {
+    mat4x4 u_Projection;
+    vec4 u_Misc0;
+};
+
+#define u_SceneTextureLODBias u_Misc0[0]
+struct Light {
+    vec4 Color;
+    vec4 Position;
+    vec4 Direction;
+    vec4 DistAtten;
+    vec4 CosAtten;
+};
+// Expected to change with each material.
+layout(std140, row_major) uniform ub_MaterialParams {
+    vec4 u_ColorMatReg[2];
+    vec4 u_ColorAmbReg[2];
+    vec4 u_KonstColor[4];
+    vec4 u_Color[4];
+    mat4x3 u_TexMtx[10]; //4x3
+    // SizeX, SizeY, 0, Bias
+    vec4 u_TextureParams[8];
+    mat4x2 u_IndTexMtx[3]; // 4x2
+    // Optional parameters.
+Light u_LightParams[8];
+};
+// Expected to change with each shape packet.
+layout(std140, row_major) uniform ub_PacketParams {
+    mat4x3 u_PosMtx[10];
+};
+uniform sampler2D u_Texture[8];
+out vec3 v_Position;
+out vec4 v_Color0;
+out vec4 v_Color1;
+out vec3 v_TexCoord0;
+out vec3 v_TexCoord1;
+out vec3 v_TexCoord2;
+out vec3 v_TexCoord3;
+out vec3 v_TexCoord4;
+out vec3 v_TexCoord5;
+out vec3 v_TexCoord6;
+out vec3 v_TexCoord7;
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in float a_PnMtxIdx;
+layout(location = 2) in vec4 a_TexMtx0123Idx;
+layout(location = 3) in vec4 a_TexMtx4567Idx;
+layout(location = 4) in vec3 a_Normal;
+layout(location = 5) in vec4 a_Color0;
+layout(location = 6) in vec4 a_Color1;
+layout(location = 7) in vec2 a_Tex0;
+layout(location = 8) in vec2 a_Tex1;
+layout(location = 9) in vec2 a_Tex2;
+layout(location = 10) in vec2 a_Tex3;
+layout(location = 11) in vec2 a_Tex4;
+layout(location = 12) in vec2 a_Tex5;
+layout(location = 13) in vec2 a_Tex6;
+layout(location = 14) in vec2 a_Tex7;
+mat4x3 GetPosTexMatrix(uint t_MtxIdx) {
+    if (t_MtxIdx == 60u)
+        return mat4x3(1.0);
+    else if (t_MtxIdx >= 30u)
+        return u_TexMtx[(t_MtxIdx - 30u) / 3u];
+    else
+        return u_PosMtx[t_MtxIdx / 3u];
+}
+
+float ApplyAttenuation(vec3 t_Coeff, float t_Value) {
+    return dot(t_Coeff, vec3(1.0, t_Value, t_Value*t_Value));
+}
+void main() {
+    vec3 t_Position = (GetPosTexMatrix(uint(a_PnMtxIdx)) * vec4(a_Position, 1.0));
+    v_Position = t_Position;
+    vec3 t_Normal = (GetPosTexMatrix(uint(a_PnMtxIdx)) * vec4(a_Normal, 0.0));
+    vec4 t_LightAccum;
+    vec3 t_LightDelta, t_LightDeltaDir;
+    float t_LightDeltaDist2, t_LightDeltaDist, t_Attenuation;
+    vec4 t_ColorChanTemp;
+    v_Color0 = a_Color0;
+        t_LightAccum = vec4(1.0);
+    v_Color0 = u_ColorMatReg[0] * clamp(t_LightAccum, 0.0, 1.0);
+
+        t_LightAccum = vec4(1.0);
+    v_Color1 = u_ColorMatReg[1] * clamp(t_LightAccum, 0.0, 1.0);
+
+v_TexCoord0 = vec3((u_TexMtx[0] * vec4(a_Tex0, 1.0, 1.0)).xy, 1.0);
+v_TexCoord1 = vec4(a_Tex1, 1.0, 1.0).xyz;
+gl_Position = (u_Projection * vec4(t_Position, 1.0));
+}
+)glsl";
+const std::string_view BaseFrag = R"glsl(precision mediump float;
+
+// Expected to be constant across the entire scene.
+layout(std140) uniform ub_SceneParams {
+    mat4x4 u_Projection;
+    vec4 u_Misc0;
+};
+
+#define u_SceneTextureLODBias u_Misc0[0]
+struct Light {
+    vec4 Color;
+    vec4 Position;
+    vec4 Direction;
+    vec4 DistAtten;
+    vec4 CosAtten;
+};
+// Expected to change with each material.
+layout(std140, row_major) uniform ub_MaterialParams {
+    vec4 u_ColorMatReg[2];
+    vec4 u_ColorAmbReg[2];
+    vec4 u_KonstColor[4];
+    vec4 u_Color[4];
+    mat4x3 u_TexMtx[10]; //4x3
+    // SizeX, SizeY, 0, Bias
+    vec4 u_TextureParams[8];
+    mat4x2 u_IndTexMtx[3]; // 4x2
+    // Optional parameters.
+Light u_LightParams[8];
+};
+// Expected to change with each shape packet.
+layout(std140, row_major) uniform ub_PacketParams {
+    mat4x3 u_PosMtx[10];
+};
+uniform sampler2D u_Texture[8];
+in vec3 v_Position;
+in vec4 v_Color0;
+in vec4 v_Color1;
+in vec3 v_TexCoord0;
+in vec3 v_TexCoord1;
+in vec3 v_TexCoord2;
+in vec3 v_TexCoord3;
+in vec3 v_TexCoord4;
+in vec3 v_TexCoord5;
+in vec3 v_TexCoord6;
+in vec3 v_TexCoord7;
+out vec4 fragOut;
+vec2 ReadTexCoord0() { return v_TexCoord0.xy / v_TexCoord0.z; }
+vec2 ReadTexCoord1() { return v_TexCoord1.xy / v_TexCoord1.z; }
+
+float TextureLODBias(int index) { return u_SceneTextureLODBias + u_TextureParams[index].w; }
+vec2 TextureInvScale(int index) { return 1.0 / u_TextureParams[index].xy; }
+vec2 TextureScale(int index) { return u_TextureParams[index].xy; }
+vec3 TevBias(vec3 a, float b) { return a + vec3(b); }
+float TevBias(float a, float b) { return a + b; }
+vec3 TevSaturate(vec3 a) { return clamp(a, vec3(0), vec3(1)); }
+float TevSaturate(float a) { return clamp(a, 0.0, 1.0); }
+float TevOverflow(float a) { return float(int(a * 255.0) & 255) / 255.0; }
+vec4 TevOverflow(vec4 a) { return vec4(TevOverflow(a.r), TevOverflow(a.g), TevOverflow(a.b), TevOverflow(a.a)); }
+float TevPack16(vec2 a) { return dot(a, vec2(1.0, 256.0)); }
+float TevPack24(vec3 a) { return dot(a, vec3(1.0, 256.0, 256.0 * 256.0)); }
+float TevPerCompGT(float a, float b) { return float(a >  b); }
+float TevPerCompEQ(float a, float b) { return float(a == b); }
+vec3 TevPerCompGT(vec3 a, vec3 b) { return vec3(greaterThan(a, b)); }
+vec3 TevPerCompEQ(vec3 a, vec3 b) { return vec3(greaterThan(a, b)); }
+
+
+void main() {
+    vec4 s_kColor0   = u_KonstColor[0];
+    vec4 s_kColor1   = u_KonstColor[1];
+    vec4 s_kColor2   = u_KonstColor[2];
+    vec4 s_kColor3   = u_KonstColor[3];
+    vec4 t_ColorPrev = u_Color[0];
+    vec4 t_Color0    = u_Color[1];
+    vec4 t_Color1    = u_Color[2];
+    vec4 t_Color2    = u_Color[3];
+vec3 t_IndTexCoord0 = 255.0 * texture(u_Texture[0], ReadTexCoord0(), TextureLODBias(0)).abg;
+vec3 t_IndTexCoord1 = 255.0 * texture(u_Texture[0], ReadTexCoord0(), TextureLODBias(0)).abg;
+
+    vec2 t_TexCoord = vec2(0.0, 0.0);
+    vec4 t_TevA, t_TevB, t_TevC, t_TevD;
+
+    //
+    // TEV Stage 0
+    //
+    t_TexCoord = ReadTexCoord0();
+
+    t_TevA = TevOverflow(vec4(
+        texture(u_Texture[0], t_TexCoord, TextureLODBias(0)).rgb,
+        0.0
+    ));
+    t_TevB = TevOverflow(vec4(
+        vec3(0),
+        0.0
+    ));
+    t_TevC = TevOverflow(vec4(
+        vec3(0),
+        0.0
+    ));
+    t_TevD = vec4(
+        t_ColorPrev.rgb,
+        t_ColorPrev.a
+    );
+    t_ColorPrev.rgb = TevSaturate(mix(t_TevA.rgb, t_TevB.rgb, t_TevC.rgb) + t_TevD.rgb);
+    t_ColorPrev.a = TevSaturate(mix(t_TevA.a, t_TevB.a, t_TevC.a) + t_TevD.a);
+
+
+    //
+    // TEV Stage 1
+    //
+    t_TexCoord = ReadTexCoord1();
+
+    t_TevA = TevOverflow(vec4(
+        vec3(0),
+        0.0
+    ));
+    t_TevB = TevOverflow(vec4(
+        TevSaturate(vec4(0, 0, 0, 0).rgb),
+        0.0
+    ));
+    t_TevC = TevOverflow(vec4(
+        vec3(0),
+        0.0
+    ));
+    t_TevD = vec4(
+        t_ColorPrev.rgb,
+        t_ColorPrev.a
+    );
+    t_ColorPrev.rgb = TevSaturate(mix(t_TevA.rgb, t_TevB.rgb, t_TevC.rgb) + t_TevD.rgb);
+    t_ColorPrev.a = TevSaturate(mix(t_TevA.a, t_TevB.a, t_TevC.a) + t_TevD.a);
+    vec4 t_TevOutput = t_ColorPrev;
+    vec4 t_PixelOut = TevOverflow(t_TevOutput);
+
+	bool t_AlphaTestA = true;
+	bool t_AlphaTestB = true;
+	if (!(t_AlphaTestA && t_AlphaTestB))
+		discard;
+    fragOut = t_PixelOut;
+}
+)glsl";
+
+struct Bodies {
+  std::string vert, frag;
+};
+
+Bodies generateBodies(GXMaterial& mat) {
+  StringBuilder vert, frag;
+  llvm::cantFail(GXProgram(mat).generateShaderBodies(vert, frag));
+  return {std::string(vert.view()), std::string(frag.view())};
+}
+
+std::vector<std::string_view> splitLines(std::string_view text) {
+  std::vector<std::string_view> lines;
+  while (!text.empty()) {
+    const std::size_t end = std::min(text.find('\n'), text.size());
+    lines.push_back(text.substr(0, end));
+    text.remove_prefix(std::min(end + 1, text.size()));
+  }
+  return lines;
+}
+
+// Print the lines of `from` missing in `to` with "-", and the lines of `to`
+// missing in `from` with "+", each numbered by its line in its own text
+void printDiff(std::string_view from, std::string_view to) {
+  const auto a = splitLines(from);
+  const auto b = splitLines(to);
+  // Length of the longest common subsequence of a[i..] and b[j..]
+  std::vector<std::vector<u32>> common(a.size() + 1,
+                                       std::vector<u32>(b.size() + 1));
+  for (std::size_t i = a.size(); i-- > 0;)
+    for (std::size_t j = b.size(); j-- > 0;)
+      common[i][j] = a[i] == b[j]
+                         ? common[i + 1][j + 1] + 1
+                         : std::max(common[i + 1][j], common[i][j + 1]);
+  std::size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size()) {
+    if (i < a.size() && j < b.size() && a[i] == b[j]) {
+      ++i;
+      ++j;
+    } else if (i < a.size() &&
+               (j == b.size() || common[i + 1][j] >= common[i][j + 1])) {
+      std::printf("  %4zu - %.*s\n", i + 1, int(a[i].size()), a[i].data());
+      ++i;
+    } else {
+      std::printf("  %4zu + %.*s\n", j + 1, int(b[j].size()), b[j].data());
+      ++j;
+    }
+  }
+}
+
+struct Variation {
+  void (*apply)(GXMaterial& mat, GCMaterialData& data);
+  //! FNV-1a of the vertex and fragment bodies. These match the generator
+  //! that built each piece as a std::string, before StringBuilder.
+  u64 digest;
+};
+
+u64 fnv1a(u64 hash, std::string_view text) {
+  for (const char c : text) {
+    hash ^= static_cast<u8>(c);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+// Lighting, texgens, indirect stages, TEV ops and the alpha test, applied to
+// the base material
+const Variation Variations[] = {
+    {[](auto&, auto& data) {
+       auto& chan = data.colorChanControls[0];
+       chan.enabled = true;
+       chan.lightMask = LightID::Light0;
+       chan.attenuationFn = AttenuationFunction::Spotlight;
+     },
+     0xfb33e219fbd0e0b7},
+    {[](auto&, auto& data) {
+       data.shader.mStages[0].colorStage.c = TevColorArg::konst;
+       data.shader.mStages[1].indirectStage.wrapU = IndTexWrap::_256;
+     },
+     0x7d6f4b6591d36e74},
+    {[](auto&, auto& data) {
+       data.alphaCompare.compLeft = Comparison::GREATER;
+       data.alphaCompare.refLeft = 128;
+     },
+     0x43d9661bb4c4f17d},
+    {[](auto&, auto& data) {
+       data.texGens[1].func = TexGenType::SRTG;
+       data.texGens[0].normalize = true;
+     },
+     0xd197fba327fc12b0},
+    {[](auto&, auto& data) {
+       auto& chan = data.colorChanControls[1];
+       chan.enabled = true;
+       chan.lightMask = LightID(0x85);
+       chan.attenuationFn = AttenuationFunction::Specular;
+       chan.diffuseFn = DiffuseFunction::Clamp;
+       chan.Ambient = ColorSource::Vertex;
+     },
+     0x0c025022e170321d},
+    {[](auto&, auto& data) {
+       data.colorChanControls.push_back({});
+       data.colorChanControls.push_back({});
+       data.colorChanControls[3].enabled = true;
+       data.colorChanControls[3].diffuseFn = DiffuseFunction::Sign;
+     },
+     0xbacf51ac220f3659},
+    {[](auto&, auto& data) {
+       data.mIndScales.push_back({IndirectTextureScalePair::Selection::x_4,
+                                  IndirectTextureScalePair::Selection::x_1});
+       data.shader.mIndirectOrders[0] = {1, 2};
+       auto& ind = data.shader.mStages[1].indirectStage;
+       ind.matrix = IndTexMtxID::_1;
+       ind.bias = IndTexBiasSel::su;
+       ind.wrapV = IndTexWrap::_16;
+       ind.addPrev = true;
+       ind.indStageSel = 0;
+     },
+     0x5a8f7a7346ebec2f},
+    {[](auto&, auto& data) {
+       auto& ind = data.shader.mStages[1].indirectStage;
+       ind.matrix = IndTexMtxID::_0;
+       ind.bias = IndTexBiasSel::stu;
+     },
+     0x7ce9eb121581f8aa},
+    {[](auto&, auto& data) {
+       auto& color = data.shader.mStages[0].colorStage;
+       color.formula = TevColorOp::subtract;
+       color.bias = TevBias::sub_half;
+       color.scale = TevScale::scale_4;
+       color.clamp = false;
+       data.shader.mStages[0].alphaStage.out = TevReg::reg1;
+     },
+     0xef53454d3f7f769f},
+    {[](auto&, auto& data) {
+       auto& color = data.shader.mStages[1].colorStage;
+       color.bias = TevBias::add_half;
+       color.scale = TevScale::scale_1;
+       auto& alpha = data.shader.mStages[1].alphaStage;
+       alpha.scale = TevScale::divide_2;
+       alpha.a = TevAlphaArg::texa;
+       alpha.b = TevAlphaArg::rasa;
+       alpha.c = TevAlphaArg::konst;
+     },
+     0x35a2e2fc8899fa2a},
+    {[](auto&, auto& data) {
+       data.shader.mStages[0].colorStage.formula = TevColorOp::comp_gr16_eq;
+       data.shader.mStages[1].colorStage.formula = TevColorOp::comp_rgb8_gt;
+       data.shader.mStages[1].alphaStage.formula = TevAlphaOp::comp_r8_gt;
+     },
+     0x4832bdcb0ac0750c},
+    {[](auto&, auto& data) {
+       data.alphaCompare = {Comparison::LEQUAL, 3, AlphaOp::_xnor,
+                            Comparison::NEQUAL, 250};
+       data.shader.mStages[1].texMap = 0xff;
+       data.shader.mStages[0].texCoord = 0xff;
+     },
+     0x1824a8a96b336321},
+    {[](auto&, auto& data) {
+       data.texGens[0].func = TexGenType::Bump2;
+       data.texGens[1].sourceParam = TexGenSrc::Normal;
+       data.texGens[1].matrix = TexMatrix::TexMatrix3;
+       data.shader.mStages[0].colorStage.d = TevColorArg::half;
+     },
+     0x53519c501ebedab4},
+    {[](auto& mat, auto& data) {
+       data.texGens[1].matrix = TexMatrix::TexMatrix2;
+       mat.usePnMtxIdx = false;
+       mat.useTexMtxIdx[1] = true;
+       mat.hasLightsBlock = true;
+     },
+     0xf6192599df15b0b8},
+    {[](auto& mat, auto& data) {
+       data.texGens[1].matrix = TexMatrix::TexMatrix2;
+       mat.usePnMtxIdx = true;
+       mat.useTexMtxIdx[1] = true;
+       mat.hasLightsBlock = true;
+     },
+     0x9834d192fd340768},
+};
+
+} // namespace
+
+RII_TEST(GXProgramMatchesGolden) {
+  GCMaterial material;
+  makeBaseMaterial(material.data);
+  GXMaterial mat{0, material.getName(), material};
+  const Bodies bodies = generateBodies(mat);
+  if (!EXPECT(bodies.vert == BaseVert))
+    printDiff(BaseVert, bodies.vert);
+  if (!EXPECT(bodies.frag == BaseFrag))
+    printDiff(BaseFrag, bodies.frag);
+
+  // Complete shaders only add a version directive and the material name
+  ShaderSourceCache::global().clear();
+  const auto [vert, frag] = GXProgram(mat).generateShaders();
+  EXPECT(vert.starts_with("#version ") && vert.ends_with(bodies.vert));
+  EXPECT(frag.starts_with("#version ") && frag.ends_with(bodies.frag));
+}
+
+RII_TEST(GXProgramMatchesPreviousGenerator) {
+  for (const Variation& variation : Variations) {
+    GCMaterial material;
+    makeBaseMaterial(material.data);
+    GXMaterial mat{0, material.getName(), material};
+    variation.apply(mat, material.data);
+    const Bodies bodies = generateBodies(mat);
+    const u64 digest =
+        fnv1a(fnv1a(0xcbf29ce484222325, bodies.vert), bodies.frag);
+    if (EXPECT(digest == variation.digest))
+      continue;
+    // What the variation generates, against the golden base
+    std::printf("  Variation %zu: 0x%016llx\n",
+                static_cast<std::size_t>(&variation - Variations),
+                static_cast<unsigned long long>(digest));
+    std::printf("  Vertex shader:\n");
+    printDiff(BaseVert, bodies.vert);
+    std::printf("  Fragment shader:\n");
+    printDiff(BaseFrag, bodies.frag);
+  }
+}
@@ -0,0 +1,294 @@
+#include "test.hpp"
+
+#include <plugins/gc/GX/Shader/GXProgram.hpp>
+#include <plugins/gc/GX/Shader/GXShaderCache.hpp>
+#include <unittests/fixtures/Material.hpp>
+
+#include <string>
+
+namespace {
+
+using namespace libcube;
+
+using riistudio::test::GCMaterial;
+
+void unlight(GCMaterialData& data) {
+  data.colorChanControls[0].lightMask = gx::LightID::None;
+  data.colorChanControls[1].lightMask = gx::LightID::None;
+}
+
+struct Mutation {
+  const char* name;
+  void (*apply)(GXMaterial& mat, GCMaterialData& data);
+};
+
+struct Output {
+  u64 hash;
+  std::string vert;
+  std::string frag;
+};
+
+// Generate from scratch, so the hash cannot hide a change of source
+Output generate(const Mutation* mutation = nullptr) {
+  GCMaterial material;
+  riistudio::test::makeDetailedMaterial(material.data);
+  GXMaterial mat{0, "base", material};
+  if (mutation != nullptr)
+    mutation->apply(mat, material.data);
+  ShaderSourceCache::global().clear();
+  const auto [vert, frag] = GXProgram(mat).generateShaders();
+  return {hashShaderState(mat), vert, frag};
+}
+
+using enum gx::TevColorArg;
+using Selection = gx::IndirectTextureScalePair::Selection;
+
+// Every field GXProgram reads to generate code
+const Mutation ShaderState[] = {
+    {"usePnMtxIdx", [](auto& mat, auto&) { mat.usePnMtxIdx = false; }},
+    {"hasPostTexMtxBlock",
+     [](auto& mat, auto&) { mat.hasPostTexMtxBlock = true; }},
+    {"useTexMtxIdx", [](auto& mat, auto&) { mat.useTexMtxIdx[0] = true; }},
+    {"chan.enabled",
+     [](auto&, auto& data) { data.colorChanControls[0].enabled = false; }},
+    {"chan.Material",
+     [](auto&, auto& data) {
+       data.colorChanControls[0].Material = gx::ColorSource::Register;
+     }},
+    {"chan.Ambient",
+     [](auto&, auto& data) {
+       data.colorChanControls[0].Ambient = gx::ColorSource::Vertex;
+     }},
+    {"chan.lightMask",
+     [](auto&, auto& data) {
+       data.colorChanControls[0].lightMask = gx::LightID::Light3;
+     }},
+    {"chan.diffuseFn",
+     [](auto&, auto& data) {
+       data.colorChanControls[0].diffuseFn = gx::DiffuseFunction::Sign;
+     }},
+    {"chan.attenuationFn",
+     [](auto&, auto& data) {
+       data.colorChanControls[0].attenuationFn =
+           gx::AttenuationFunction::Specular;
+     }},
+    {"alpha channel",
+     [](auto&, auto& data) { data.colorChanControls[1].enabled = false; }},
+    {"second channel",
+     [](auto&, auto& data) { data.colorChanControls[2].enabled = true; }},
+    {"texGens.size", [](auto&, auto& data) { data.texGens.pop_back(); }},
+    {"texGen.func",
+     [](auto&, auto& data) {
+       data.texGens[0].func = gx::TexGenType::Matrix3x4;
+     }},
+    {"texGen.sourceParam",
+     [](auto&, auto& data) {
+       data.texGens[0].sourceParam = gx::TexGenSrc::Normal;
+     }},
+    {"texGen.matrix",
+     [](auto&, auto& data) {
+       data.texGens[0].matrix = gx::TexMatrix::TexMatrix1;
+     }},
+    {"texGen.normalize",
+     [](auto&, auto& data) { data.texGens[0].normalize = true; }},
+    {"mStages.size",
+     [](auto&, auto& data) { data.shader.mStages.pop_back(); }},
+    {"rasOrder",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].rasOrder = gx::ColorSelChanApi::color1a1;
+     }},
+    {"texMap", [](auto&, auto& data) { data.shader.mStages[1].texMap = 0; }},
+    {"texCoord",
+     [](auto&, auto& data) { data.shader.mStages[1].texCoord = 0; }},
+    {"rasSwap", [](auto&, auto& data) { data.shader.mStages[0].rasSwap = 3; }},
+    {"texMapSwap",
+     [](auto&, auto& data) { data.shader.mStages[1].texMapSwap = 0; }},
+    {"referenced swap table entry",
+     [](auto&, auto& data) {
+       data.shader.mSwapTable[2].g = gx::ColorComponent::b;
+     }},
+    {"colorStage.constantSelection",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].colorStage.constantSelection =
+           gx::TevKColorSel::k2;
+     }},
+    {"colorStage.a",
+     [](auto&, auto& data) { data.shader.mStages[1].colorStage.a = c0; }},
+    {"colorStage.b",
+     [](auto&, auto& data) { data.shader.mStages[1].colorStage.b = c1; }},
+    {"colorStage.c",
+     [](auto&, auto& data) { data.shader.mStages[1].colorStage.c = c2; }},
+    {"colorStage.d",
+     [](auto&, auto& data) { data.shader.mStages[1].colorStage.d = one; }},
+    {"colorStage.formula",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].colorStage.formula = gx::TevColorOp::subtract;
+     }},
+    {"colorStage.bias",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].colorStage.bias = gx::TevBias::add_half;
+     }},
+    {"colorStage.scale",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].colorStage.scale = gx::TevScale::scale_2;
+     }},
+    {"colorStage.clamp",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].colorStage.clamp = false;
+     }},
+    {"colorStage.out",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].colorStage.out = gx::TevReg::reg1;
+     }},
+    {"alphaStage.constantSelection",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.constantSelection =
+           gx::TevKAlphaSel::k2_a;
+     }},
+    {"alphaStage.a",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.a = gx::TevAlphaArg::a0;
+     }},
+    {"alphaStage.b",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.b = gx::TevAlphaArg::a1;
+     }},
+    {"alphaStage.c",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.c = gx::TevAlphaArg::a2;
+     }},
+    {"alphaStage.d",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.d = gx::TevAlphaArg::rasa;
+     }},
+    {"alphaStage.formula",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.formula = gx::TevAlphaOp::subtract;
+     }},
+    {"alphaStage.bias",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.bias = gx::TevBias::sub_half;
+     }},
+    {"alphaStage.scale",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.scale = gx::TevScale::divide_2;
+     }},
+    {"alphaStage.clamp",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].alphaStage.clamp = false;
+     }},
+    {"alphaStage.out",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].alphaStage.out = gx::TevReg::reg2;
+     }},
+    {"indirectStage.indStageSel",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].indirectStage.indStageSel = 1;
+     }},
+    {"indirectStage.format",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].indirectStage.format = gx::IndTexFormat::_5bit;
+     }},
+    {"indirectStage.bias",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].indirectStage.bias = gx::IndTexBiasSel::stu;
+     }},
+    {"indirectStage.matrix",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].indirectStage.matrix = gx::IndTexMtxID::_1;
+     }},
+    {"indirectStage.wrapU",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].indirectStage.wrapU = gx::IndTexWrap::_64;
+     }},
+    {"indirectStage.wrapV",
+     [](auto&, auto& data) {
+       data.shader.mStages[0].indirectStage.wrapV = gx::IndTexWrap::_32;
+     }},
+    {"indirectStage.addPrev",
+     [](auto&, auto& data) {
+       data.shader.mStages[1].indirectStage.addPrev = true;
+     }},
+    {"mIndScales",
+     [](auto&, auto& data) { data.mIndScales[0].U = Selection::x_16; }},
+    {"mIndirectOrders.refMap",
+     [](auto&, auto& data) { data.shader.mIndirectOrders[0].refMap = 0; }},
+    {"mIndirectOrders.refCoord",
+     [](auto&, auto& data) { data.shader.mIndirectOrders[0].refCoord = 0; }},
+    {"alphaCompare.compLeft",
+     [](auto&, auto& data) {
+       data.alphaCompare.compLeft = gx::Comparison::EQUAL;
+     }},
+    {"alphaCompare.refLeft",
+     [](auto&, auto& data) { data.alphaCompare.refLeft = 65; }},
+    {"alphaCompare.op",
+     [](auto&, auto& data) { data.alphaCompare.op = gx::AlphaOp::_xor; }},
+    {"alphaCompare.compRight",
+     [](auto&, auto& data) {
+       data.alphaCompare.compRight = gx::Comparison::NEQUAL;
+     }},
+    {"alphaCompare.refRight",
+     [](auto&, auto& data) { data.alphaCompare.refRight = 199; }},
+};
+
+// Uniform values, pixel engine state, and state that is emitted the same way
+const Mutation OtherState[] = {
+    {"GXMaterial.name", [](auto& mat, auto&) { mat.name = "other"; }},
+    {"cullMode",
+     [](auto&, auto& data) { data.cullMode = gx::CullMode::None; }},
+    {"chanData",
+     [](auto&, auto& data) { data.chanData.push_back({{1, 2, 3, 4}}); }},
+    {"tevKonstColors",
+     [](auto&, auto& data) { data.tevKonstColors[1] = {1, 2, 3, 4}; }},
+    {"blendMode",
+     [](auto&, auto& data) {
+       data.blendMode.type = gx::BlendModeType::blend;
+     }},
+    {"earlyZComparison",
+     [](auto&, auto& data) { data.earlyZComparison = false; }},
+    {"dither", [](auto&, auto& data) { data.dither = true; }},
+    {"unreferenced swap table entry",
+     [](auto&, auto& data) {
+       data.shader.mSwapTable[3].r = gx::ColorComponent::a;
+     }},
+    {"swap table index of an identical entry",
+     [](auto&, auto& data) {
+       data.shader.mSwapTable[3] = data.shader.mSwapTable[0];
+       data.shader.mStages[0].rasSwap = 3;
+     }},
+    {"bump texgen matrix",
+     [](auto&, auto& data) {
+       data.texGens[1].matrix = gx::TexMatrix::TexMatrix5;
+     }},
+};
+
+} // namespace
+
+RII_TEST(GXShaderHashCoversGeneratedState) {
+  const auto check = [](const Output& base, const Mutation& mutation) {
+    const Output out = generate(&mutation);
+    const bool source_changed = out.vert != base.vert || out.frag != base.frag;
+    if (!EXPECT(source_changed) || !EXPECT(out.hash != base.hash))
+      std::printf("  Shader state: %s\n", mutation.name);
+  };
+  const Output base = generate();
+  for (const Mutation& mutation : ShaderState)
+    check(base, mutation);
+
+  // Lit channels require the lights block, so drop it from an unlit material
+  const Mutation unlit{"unlit", [](auto&, auto& data) { unlight(data); }};
+  check(generate(&unlit), {"hasLightsBlock", [](auto& mat, auto& data) {
+                             unlight(data);
+                             mat.hasLightsBlock = false;
+                           }});
+}
+
+RII_TEST(GXShaderHashIgnoresOtherState) {
+  const Output base = generate();
+  for (const Mutation& mutation : OtherState) {
+    const Output out = generate(&mutation);
+    if (!EXPECT(out.vert == base.vert && out.frag == base.frag) ||
+        !EXPECT(out.hash == base.hash))
+      std::printf("  Other state: %s\n", mutation.name);
+  }
+}
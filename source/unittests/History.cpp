@@ -0,0 +1,250 @@
+#include "test.hpp"
+
+#include <unittests/fixtures/Document.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using riistudio::test::Mesh;
+
+// Holds the history's worker back, so that tests can act on states that are
+// still being sized.
+class Gate {
+public:
+  void close() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mOpen = false;
+  }
+  void open() {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mOpen = true;
+    }
+    mOpened.notify_all();
+  }
+  // Times out rather than hanging a test that sizes on the committing thread
+  void pass() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mOpened.wait_for(lock, std::chrono::seconds(10), [this] { return mOpen; });
+  }
+
+private:
+  std::mutex mMutex;
+  std::condition_variable mOpened;
+  bool mOpen = true;
+};
+
+// Threads mementos were sized or destroyed on
+class ThreadLog {
+public:
+  void add() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mThreads.push_back(std::this_thread::get_id());
+  }
+  std::vector<std::thread::id> take() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return std::exchange(mThreads, {});
+  }
+
+private:
+  std::mutex mMutex;
+  std::vector<std::thread::id> mThreads;
+};
+
+Gate sSizingGate;
+ThreadLog sSizedOn;
+ThreadLog sReleasedOn;
+
+// Sizes states behind the gate, and logs the threads states are sized and
+// released on
+struct Observer : riistudio::test::StateObserver {
+  void onSized() override {
+    sSizingGate.pass();
+    sSizedOn.add();
+  }
+  void onReleased() override { sReleasedOn.add(); }
+} sObserver;
+
+// A document whose states report to sObserver
+struct Document : riistudio::test::Document {
+  Document() : riistudio::test::Document(&sObserver) {}
+};
+
+constexpr std::size_t NumMeshes = 4;
+constexpr std::size_t NumIndices = 1024;
+
+void fill(Document& doc) {
+  for (std::size_t i = 0; i < NumMeshes; ++i)
+    doc.getMeshes().add().mIndices.assign(NumIndices, static_cast<u32>(i));
+}
+// Modify one mesh, so a commit only records that mesh anew
+void edit(Document& doc, std::size_t mesh) {
+  auto meshes = doc.getMeshes();
+  ++meshes[mesh].mIndices[0];
+  meshes.objectAt(mesh)->markDirty();
+}
+// The first index of every mesh, which `edit` changes
+std::vector<u32> contents(const Document& doc) {
+  std::vector<u32> result;
+  for (const auto& mesh : doc.getMeshes())
+    result.push_back(mesh.mIndices[0]);
+  return result;
+}
+
+// Memory retained by a state with `unshared` meshes not shared with its
+// predecessor
+constexpr std::size_t stateSize(std::size_t unshared) {
+  const std::size_t folder =
+      NumMeshes * sizeof(std::shared_ptr<const Mesh>);
+  return folder + unshared * (sizeof(Mesh) + NumIndices * sizeof(u32));
+}
+
+} // namespace
+
+RII_TEST(HistoryBudgetKeepsCurrentState) {
+  Document doc;
+  fill(doc);
+  kpi::History history;
+  std::vector<std::vector<u32>> states;
+  history.commit(doc);
+  states.push_back(contents(doc));
+  for (std::size_t i = 0; i < 5; ++i) {
+    edit(doc, i % NumMeshes);
+    history.commit(doc);
+    states.push_back(contents(doc));
+  }
+  history.undo(doc);
+  history.undo(doc);
+  history.flush();
+  EXPECT(history.retainedSize(0) == stateSize(NumMeshes));
+  EXPECT(history.retainedSize(1) == stateSize(1));
+  const std::size_t total = history.retainedSize();
+  EXPECT(total == stateSize(NumMeshes) + 5 * stateSize(1));
+
+  // Evicting the first state makes the second one retain every mesh
+  history.setMemoryBudget(total - 1);
+  EXPECT(history.size() == 5);
+  EXPECT(history.cursor() == 2);
+  EXPECT(history.retainedSize(0) == stateSize(NumMeshes));
+  EXPECT(history.retainedSize(1) == stateSize(1));
+  EXPECT(history.retainedSize() == stateSize(NumMeshes) + 4 * stateSize(1));
+  EXPECT(contents(doc) == states[3]);
+
+  // States past the cursor are kept: only the oldest are evicted
+  history.setMemoryBudget(1);
+  EXPECT(history.size() == 3);
+  EXPECT(history.cursor() == 0);
+  EXPECT(history.retainedSize(0) == stateSize(NumMeshes));
+  EXPECT(contents(doc) == states[3]);
+  history.undo(doc);
+  EXPECT(contents(doc) == states[3]);
+  history.redo(doc);
+  history.redo(doc);
+  EXPECT(contents(doc) == states[5]);
+}
+
+RII_TEST(HistoryDiscardsRedoBranchWhileSizing) {
+  Document doc;
+  fill(doc);
+  kpi::History history;
+  history.setMemoryBudget(1);
+  sSizingGate.close();
+  history.commit(doc);
+  const auto first = contents(doc);
+  edit(doc, 0);
+  history.commit(doc);
+  edit(doc, 1);
+  history.commit(doc);
+  history.undo(doc);
+  history.undo(doc);
+  edit(doc, 2);
+  history.commit(doc);
+  const auto last = contents(doc);
+
+  // Unsized states are never evicted, whatever the budget
+  EXPECT(history.size() == 2);
+  EXPECT(history.cursor() == 1);
+  EXPECT(history.retainedSize(1) == 0);
+  history.undo(doc);
+  EXPECT(contents(doc) == first);
+  history.redo(doc);
+  EXPECT(contents(doc) == last);
+
+  // The last state is sized against the first, not the discarded branch
+  history.setMemoryBudget(0);
+  sSizingGate.open();
+  history.flush();
+  EXPECT(history.retainedSize(0) == stateSize(NumMeshes));
+  EXPECT(history.retainedSize(1) == stateSize(1));
+
+  history.setMemoryBudget(1);
+  EXPECT(history.size() == 1);
+  EXPECT(history.cursor() == 0);
+  EXPECT(history.retainedSize(0) == stateSize(NumMeshes));
+  EXPECT(contents(doc) == last);
+}
+
+RII_TEST(HistorySizesOffCommittingThread) {
+  Document doc;
+  fill(doc);
+  kpi::History history;
+  sSizedOn.take();
+  sSizingGate.close();
+  std::vector<std::vector<u32>> states;
+  for (std::size_t i = 0; i < 4; ++i) {
+    edit(doc, i);
+    history.commit(doc);
+    states.push_back(contents(doc));
+  }
+
+  // Commits return before their states are sized; undo and redo do not wait
+  EXPECT(history.retainedSize() == 0);
+  history.undo(doc);
+  history.undo(doc);
+  EXPECT(contents(doc) == states[1]);
+  history.redo(doc);
+  EXPECT(contents(doc) == states[2]);
+  EXPECT(history.retainedSize() == 0);
+
+  sSizingGate.open();
+  history.flush();
+  EXPECT(history.retainedSize() == stateSize(NumMeshes) + 3 * stateSize(1));
+  const auto sizedOn = sSizedOn.take();
+  EXPECT(sizedOn.size() == 4);
+  for (const auto thread : sizedOn)
+    EXPECT(thread != std::this_thread::get_id());
+}
+
+RII_TEST(HistoryReleasesStatesOffCommittingThread) {
+  Document doc;
+  fill(doc);
+  kpi::History history;
+  for (std::size_t i = 0; i < 4; ++i) {
+    edit(doc, i);
+    history.commit(doc);
+  }
+  history.undo(doc);
+  history.flush();
+  sReleasedOn.take();
+
+  // Discard the last state with the redo branch, then the first two with the
+  // budget
+  edit(doc, 0);
+  history.commitMarked(doc);
+  history.flush();
+  history.setMemoryBudget(stateSize(NumMeshes) + stateSize(1));
+  history.flush();
+  EXPECT(history.size() == 2);
+  EXPECT(history.cursor() == 1);
+
+  const auto releasedOn = sReleasedOn.take();
+  EXPECT(releasedOn.size() == 3);
+  for (const auto thread : releasedOn)
+    EXPECT(thread != std::this_thread::get_id());
+}
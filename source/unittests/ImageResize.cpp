@@ -0,0 +1,44 @@
+#include "test.hpp"
+
+#include <plugins/gc/Encoder/ImagePlatform.hpp>
+#include <unittests/fixtures/Image.hpp>
+
+#include <vector>
+
+namespace {
+
+using namespace libcube::image_platform;
+using riistudio::test::makeImage;
+
+std::vector<u8> resizeWith(unsigned threads, const std::vector<u8>& src,
+                           int sx, int sy, int dx, int dy) {
+  setResizeConcurrency(threads);
+  std::vector<u8> dst(dx * dy * 4);
+  resize(dst.data(), dx, dy, src.data(), sx, sy, Lanczos);
+  return dst;
+}
+
+struct Resize {
+  int sx, sy, dx, dy;
+};
+
+} // namespace
+
+// Each band must sample exactly the columns the whole image would. Output
+// widths are not multiples of the band counts, so bands differ in width, and
+// every image is large enough to be split.
+RII_TEST(ImageResizeLanczosBandsMatchSingleBand) {
+  constexpr Resize Resizes[] = {
+      {1022, 766, 511, 383},   // 2x
+      {1300, 900, 325, 225},   // 4x
+      {1500, 1000, 701, 467},  // Non-integer downscale
+      {700, 500, 1021, 611},   // Non-integer upscale
+  };
+  for (const auto [sx, sy, dx, dy] : Resizes) {
+    const auto src = makeImage(sx, sy);
+    const auto expected = resizeWith(1, src, sx, sy, dx, dy);
+    for (const unsigned threads : {2u, 3u, 7u})
+      EXPECT(resizeWith(threads, src, sx, sy, dx, dy) == expected);
+  }
+  setResizeConcurrency(0);
+}
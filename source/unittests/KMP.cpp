@@ -0,0 +1,307 @@
+#include "test.hpp"
+
+#include <oishii/data_provider.hxx>
+#include <oishii/writer/binary_writer.hxx>
+#include <plugins/mk/KMP/io/KMP.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+using namespace riistudio::mk;
+
+struct Message {
+  kpi::IOMessageClass mclass;
+  std::string domain;
+  std::string body;
+};
+
+void makeMap(CourseMap& map) {
+  for (u32 i = 0; i < 4; ++i) {
+    auto& obj = map.getGeoObjs().add();
+    obj.id = 0x65 + i;
+    obj.position = {float(i), 2.0f, 3.0f};
+    obj.settings = {1, 2, 3, 4, 5, 6, 7, static_cast<u16>(i)};
+    obj.flags = 0x3F;
+  }
+}
+
+std::vector<u8> writeMap(CourseMap& map) {
+  oishii::Writer writer(0);
+  KMP().write(map, writer);
+  const u8* data = writer.getDataBlockStart();
+  return {data, data + writer.getBufSize()};
+}
+
+// Write with a message callback, as the editor does when saving
+std::vector<Message> writeMap(CourseMap& map, std::vector<u8>& file) {
+  std::vector<Message> messages;
+  oishii::Writer writer(0);
+  KMP().write(map, writer,
+              [&](kpi::IOMessageClass mclass, std::string_view domain,
+                  std::string_view body) {
+                messages.push_back(
+                    {mclass, std::string(domain), std::string(body)});
+              });
+  const u8* data = writer.getDataBlockStart();
+  file.assign(data, data + writer.getBufSize());
+  return messages;
+}
+
+std::vector<Message> readMap(CourseMap& map, std::vector<u8> file) {
+  std::vector<Message> messages;
+  oishii::DataProvider provider(std::move(file), "test.kmp");
+  kpi::IOTransaction transaction{
+      map, provider.slice(),
+      [&](kpi::IOMessageClass mclass, std::string_view domain,
+          std::string_view body) {
+        messages.push_back({mclass, std::string(domain), std::string(body)});
+      }};
+  KMP().read(transaction);
+  return messages;
+}
+
+// Offset of the section `index` in the order of the header
+u32 sectionOffset(const std::vector<u8>& file, u32 index) {
+  const u32 header_size = (file[0xA] << 8) | file[0xB];
+  const u8* entry = &file[0x10 + index * 4];
+  return header_size +
+         ((entry[0] << 24) | (entry[1] << 16) | (entry[2] << 8) | entry[3]);
+}
+
+// Every section, a path with more than six links and the fields that
+// depend on the revision
+void makeRoundTripMap(CourseMap& map, u16 revision) {
+  map.setRevision(revision);
+  auto& start = map.getStartPoints().add();
+  start.position = {1.0f, 2.0f, 3.0f};
+  start.rotation = {0.0f, 90.0f, 0.0f};
+  start.player_index = -1;
+  start._ = 0;
+
+  for (u32 g = 0; g < 2; ++g) {
+    auto& path = map.getEnemyPaths().add();
+    path.mPredecessors.push_back(1 - g);
+    for (u32 i = 0; i < (g == 0 ? 8 : 1); ++i)
+      path.mSuccessors.push_back((i + 1) % 2);
+    path.misc = {0, static_cast<u8>(g)};
+    path.mPoints.resize(2);
+    for (u32 p = 0; p < 2; ++p) {
+      path.mPoints[p].position = {float(g), float(p), 0.5f};
+      path.mPoints[p].deviation = 10.0f;
+      path.mPoints[p].param = {1, 2, 3, 4};
+    }
+  }
+  auto& items = map.getItemPaths().add();
+  items.mPredecessors.push_back(0);
+  items.mSuccessors.push_back(0);
+  items.misc = {};
+  items.mPoints.resize(1);
+  items.mPoints[0].position = {4.0f, 5.0f, 6.0f};
+  items.mPoints[0].deviation = 1.0f;
+  items.mPoints[0].param = {0, 1, 2, 3};
+  auto& checks = map.getCheckPaths().add();
+  checks.mPredecessors.push_back(0);
+  checks.mSuccessors.push_back(0);
+  checks.misc = {};
+  checks.mPoints.resize(3);
+  for (u32 p = 0; p < 3; ++p) {
+    checks.mPoints[p].setLeft({float(p), -1.0f});
+    checks.mPoints[p].setRight({float(p), 1.0f});
+    checks.mPoints[p].setRespawnIndex(0);
+    checks.mPoints[p].setLapCheck(p == 0 ? 0 : 0xFF);
+  }
+
+  auto& obj = map.getGeoObjs().add();
+  obj.id = 0x65;
+  obj._ = 0;
+  obj.position = {7.0f, 8.0f, 9.0f};
+  obj.rotation = {};
+  obj.scale = {1.0f, 1.0f, 1.0f};
+  obj.pathId = 0;
+  obj.settings = {1, 2, 3, 4, 5, 6, 7, 8};
+  obj.flags = 0x3F;
+
+  auto& rail = map.getPaths().add();
+  rail.setInterpolation(Interpolation::Spline);
+  rail.setLoopPolicy(LoopPolicy::Closed);
+  rail.resize(2);
+  for (auto& point : rail) {
+    point.position = {1.0f, 1.0f, 1.0f};
+    point.params = {0, 30};
+  }
+
+  auto& area = map.getAreas().add();
+  area.setPriority(1);
+  area.getModel().setPosition({0.0f, 100.0f, 0.0f});
+
+  auto& stage = map.getStages().add();
+  stage.mLapCount = 3;
+  stage.mCorner = Corner::Left;
+  stage.mStartPosition = StartPosition::Standard;
+  stage.mFlareTobi = 0;
+  stage.mLensFlareOptions = {0xE6, 0xE6, 0xE6, 0x32};
+  stage.mUnk08 = 0;
+  stage._ = 0;
+  stage.mSpeedModifier = 0x3F80;
+}
+
+// Output of the writer before it wrote in two passes, at R1830
+constexpr u8 PreviousWriterR1830[] = {
+    0x52, 0x4B, 0x4D, 0x44, 0x00, 0x00, 0x02, 0x52, 0x00, 0x0F, 0x00, 0x4C,
+    0x00, 0x00, 0x07, 0x26, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20,
+    0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00, 0xA2, 0x00, 0x00, 0x00, 0xBE,
+    0x00, 0x00, 0x00, 0xD6, 0x00, 0x00, 0x01, 0x1A, 0x00, 0x00, 0x01, 0x32,
+    0x00, 0x00, 0x01, 0x76, 0x00, 0x00, 0x01, 0xA2, 0x00, 0x00, 0x01, 0xD6,
+    0x00, 0x00, 0x01, 0xDE, 0x00, 0x00, 0x01, 0xE6, 0x00, 0x00, 0x01, 0xEE,
+    0x00, 0x00, 0x01, 0xF6, 0x4B, 0x54, 0x50, 0x54, 0x3F, 0x80, 0x00, 0x00,
+    0x40, 0x00, 0x00, 0x00, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x42, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00,
+    0x45, 0x4E, 0x50, 0x54, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x41, 0x20, 0x00, 0x00,
+    0x01, 0x02, 0x03, 0x04, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00,
+    0x3F, 0x00, 0x00, 0x00, 0x41, 0x20, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04,
+    0x3F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00,
+    0x41, 0x20, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x3F, 0x80, 0x00, 0x00,
+    0x3F, 0x80, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x41, 0x20, 0x00, 0x00,
+    0x01, 0x02, 0x03, 0x04, 0x45, 0x4E, 0x50, 0x48, 0x00, 0x02, 0x00, 0x00,
+    0x00, 0x02, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x01, 0x00,
+    0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x02, 0x00, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x01, 0x49, 0x54,
+    0x50, 0x54, 0x00, 0x01, 0x00, 0x00, 0x40, 0x80, 0x00, 0x00, 0x40, 0xA0,
+    0x00, 0x00, 0x40, 0xC0, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x01,
+    0x02, 0x03, 0x49, 0x54, 0x50, 0x48, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x00, 0x43, 0x4B, 0x50, 0x54, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xBF, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x00, 0x00, 0xFF, 0x01, 0x3F, 0x80, 0x00, 0x00, 0xBF, 0x80,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0xFF,
+    0x00, 0x02, 0x40, 0x00, 0x00, 0x00, 0xBF, 0x80, 0x00, 0x00, 0x40, 0x00,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0xFF, 0x01, 0xFF, 0x43, 0x4B,
+    0x50, 0x48, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x00, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x47, 0x4F,
+    0x42, 0x4A, 0x00, 0x01, 0x00, 0x00, 0x00, 0x65, 0x00, 0x00, 0x40, 0xE0,
+    0x00, 0x00, 0x41, 0x00, 0x00, 0x00, 0x41, 0x10, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x00, 0x05, 0x00, 0x06,
+    0x00, 0x07, 0x00, 0x08, 0x00, 0x3F, 0x50, 0x4F, 0x54, 0x49, 0x00, 0x01,
+    0x00, 0x02, 0x00, 0x02, 0x01, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1E, 0x3F, 0x80,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x1E, 0x41, 0x52, 0x45, 0x41, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xFE, 0x00, 0x00, 0x00, 0x00, 0x42, 0xC8, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x43, 0x41, 0x4D, 0x45, 0x00, 0x00,
+    0x00, 0x00, 0x4A, 0x47, 0x50, 0x54, 0x00, 0x00, 0x00, 0x00, 0x43, 0x4E,
+    0x50, 0x54, 0x00, 0x00, 0x00, 0x00, 0x4D, 0x53, 0x50, 0x54, 0x00, 0x00,
+    0x00, 0x00, 0x53, 0x54, 0x47, 0x49, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+    0x00, 0x00, 0xE6, 0xE6, 0xE6, 0x32
+};
+
+// Output of the writer before it wrote in two passes, at R2520
+constexpr u8 PreviousWriterR2520[] = {
+    0x52, 0x4B, 0x4D, 0x44, 0x00, 0x00, 0x02, 0x5E, 0x00, 0x0F, 0x00, 0x4C,
+    0x00, 0x00, 0x09, 0xD8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x24,
+    0x00, 0x00, 0x00, 0x7C, 0x00, 0x00, 0x00, 0xA6, 0x00, 0x00, 0x00, 0xC2,
+    0x00, 0x00, 0x00, 0xDA, 0x00, 0x00, 0x01, 0x1E, 0x00, 0x00, 0x01, 0x36,
+    0x00, 0x00, 0x01, 0x7A, 0x00, 0x00, 0x01, 0xA6, 0x00, 0x00, 0x01, 0xDE,
+    0x00, 0x00, 0x01, 0xE6, 0x00, 0x00, 0x01, 0xEE, 0x00, 0x00, 0x01, 0xF6,
+    0x00, 0x00, 0x01, 0xFE, 0x4B, 0x54, 0x50, 0x54, 0x00, 0x01, 0x00, 0x00,
+    0x3F, 0x80, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x40, 0x40, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x42, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xFF, 0x00, 0x00, 0x45, 0x4E, 0x50, 0x54, 0x00, 0x04, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00,
+    0x41, 0x20, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x80, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x41, 0x20, 0x00, 0x00,
+    0x01, 0x02, 0x03, 0x04, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x00, 0x00, 0x41, 0x20, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04,
+    0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00,
+    0x41, 0x20, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x45, 0x4E, 0x50, 0x48,
+    0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x02,
+    0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x49, 0x54, 0x50, 0x54, 0x00, 0x01, 0x00, 0x00, 0x40, 0x80,
+    0x00, 0x00, 0x40, 0xA0, 0x00, 0x00, 0x40, 0xC0, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x49, 0x54, 0x50, 0x48, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x43, 0x4B, 0x50, 0x54, 0x00, 0x03,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xBF, 0x80, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x01, 0x3F, 0x80,
+    0x00, 0x00, 0xBF, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x00, 0xFF, 0x00, 0x02, 0x40, 0x00, 0x00, 0x00, 0xBF, 0x80,
+    0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0xFF,
+    0x01, 0xFF, 0x43, 0x4B, 0x50, 0x48, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x00, 0x47, 0x4F, 0x42, 0x4A, 0x00, 0x01, 0x00, 0x00, 0x00, 0x65,
+    0x00, 0x00, 0x40, 0xE0, 0x00, 0x00, 0x41, 0x00, 0x00, 0x00, 0x41, 0x10,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04,
+    0x00, 0x05, 0x00, 0x06, 0x00, 0x07, 0x00, 0x08, 0x00, 0x3F, 0x50, 0x4F,
+    0x54, 0x49, 0x00, 0x01, 0x00, 0x02, 0x00, 0x02, 0x01, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x1E, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x1E, 0x41, 0x52, 0x45, 0x41, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0xFF, 0xFE, 0x00, 0x00, 0x00, 0x00, 0x42, 0xC8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x3F, 0x80,
+    0x00, 0x00, 0x3F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x43, 0x41, 0x4D, 0x45, 0x00, 0x00, 0x00, 0x00, 0x4A, 0x47,
+    0x50, 0x54, 0x00, 0x00, 0x00, 0x00, 0x43, 0x4E, 0x50, 0x54, 0x00, 0x00,
+    0x00, 0x00, 0x4D, 0x53, 0x50, 0x54, 0x00, 0x00, 0x00, 0x00, 0x53, 0x54,
+    0x47, 0x49, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0xE6, 0xE6,
+    0xE6, 0x32, 0x00, 0x00, 0x3F, 0x80
+};
+
+} // namespace
+
+RII_TEST(KMPEntryCountPastEndOfFile) {
+  CourseMap source;
+  makeMap(source);
+  std::vector<u8> file = writeMap(source);
+
+  // Claim far more GOBJ entries than the file holds
+  const u32 gobj = sectionOffset(file, 7);
+  file[gobj + 4] = 0xFF;
+  file[gobj + 5] = 0xFF;
+  const u32 fit = (file.size() - (gobj + 8)) / 0x3C;
+
+  CourseMap map;
+  const auto messages = readMap(map, std::move(file));
+  EXPECT(map.getGeoObjs().size() == fit);
+  for (u32 i = 0; i < 4; ++i)
+    EXPECT(map.getGeoObjs()[i] == source.getGeoObjs()[i]);
+  EXPECT(std::any_of(messages.begin(), messages.end(), [](const Message& m) {
+    return m.mclass == kpi::IOMessageClass::Error && m.domain == "kmp/GOBJ";
+  }));
+}
+
+RII_TEST(KMPWriterMatchesPreviousWriter) {
+  const auto check = [](u16 revision, const u8* begin, const u8* end) {
+    CourseMap map;
+    makeRoundTripMap(map, revision);
+    const std::vector<u8> file = writeMap(map);
+    EXPECT(std::equal(file.begin(), file.end(), begin, end));
+  };
+  // Headerless KTPT, short AREA entries and truncated STGI
+  check(1830, std::begin(PreviousWriterR1830), std::end(PreviousWriterR1830));
+  check(2520, std::begin(PreviousWriterR2520), std::end(PreviousWriterR2520));
+}
+
+RII_TEST(KMPWriterReportsPathDiagnostics) {
+  CourseMap map;
+  makeRoundTripMap(map, 2520);
+  std::vector<u8> file;
+  const auto messages = writeMap(map, file);
+  EXPECT(file == writeMap(map));
+  EXPECT(std::any_of(messages.begin(), messages.end(), [](const Message& m) {
+    return m.mclass == kpi::IOMessageClass::Error && m.domain == "kmp/ENPH" &&
+           m.body == "Group 0: 8 successors; at most 6 can be saved.";
+  }));
+  EXPECT(std::none_of(messages.begin(), messages.end(), [](const Message& m) {
+    return m.domain == "kmp/ITPH" || m.domain == "kmp/CKPH";
+  }));
+}
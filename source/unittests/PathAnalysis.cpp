@@ -0,0 +1,141 @@
+#include "test.hpp"
+
+#include <plugins/mk/KMP/PathAnalysis.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+using namespace riistudio::mk;
+using enum PathDiagnostic::Severity;
+
+// Groups of one point each, unless key checkpoints are given
+struct Group {
+  std::vector<u8> predecessors;
+  std::vector<u8> successors;
+  std::vector<u8> key_checkpoints;
+};
+
+std::vector<PathDiagnostic> analyze(const std::vector<Group>& groups,
+                                    bool is_check_path = false) {
+  std::vector<PathGroupView> views;
+  for (auto& group : groups)
+    views.push_back({.predecessors = group.predecessors,
+                     .successors = group.successors,
+                     .num_points = std::max<std::size_t>(
+                         group.key_checkpoints.size(), 1),
+                     .key_checkpoints = group.key_checkpoints});
+  return analyzePathGroups(views, is_check_path);
+}
+
+bool reports(const std::vector<PathDiagnostic>& diagnostics,
+             PathDiagnostic::Severity severity, std::size_t group,
+             std::string_view message) {
+  return std::any_of(diagnostics.begin(), diagnostics.end(),
+                     [&](const PathDiagnostic& diag) {
+                       return diag.severity == severity &&
+                              diag.group == group && diag.message == message;
+                     });
+}
+
+// A ring of `n` groups, each with the key checkpoint of its index
+std::vector<Group> ring(u8 n) {
+  std::vector<Group> groups(n);
+  for (u8 g = 0; g < n; ++g) {
+    groups[g].predecessors = {static_cast<u8>((g + n - 1) % n)};
+    groups[g].successors = {static_cast<u8>((g + 1) % n)};
+    groups[g].key_checkpoints = {g};
+  }
+  return groups;
+}
+
+} // namespace
+
+RII_TEST(PathAnalysisRingIsClean) {
+  EXPECT(analyze(ring(8)).empty());
+  EXPECT(analyze(ring(8), /*is_check_path=*/true).empty());
+}
+
+RII_TEST(PathAnalysisDanglingLinks) {
+  const auto diags = analyze({{{1}, {1, 7}}, {{0, 9}, {0}}});
+  EXPECT(reports(diags, Error, 0, "Successor 7 does not exist."));
+  EXPECT(reports(diags, Error, 1, "Predecessor 9 does not exist."));
+}
+
+RII_TEST(PathAnalysisAsymmetricLinks) {
+  // 0 -> 1 is only listed by group 0; 2 -> 0 only by group 0
+  const auto diags = analyze({{{2}, {1}}, {{}, {2}}, {{1}, {}}});
+  EXPECT(reports(diags, Warning, 0,
+                 "Successor 1 does not list this group as a predecessor."));
+  EXPECT(reports(diags, Warning, 0,
+                 "Predecessor 2 does not list this group as a successor."));
+  EXPECT(reports(diags, Warning, 2, "Group does not lead back to group 0."));
+}
+
+RII_TEST(PathAnalysisUnreachableGroup) {
+  // Group 2 leads into the ring, but nothing leads to it
+  auto groups = ring(2);
+  groups.push_back({{}, {0}});
+  groups[0].predecessors.push_back(2);
+  const auto diags = analyze(groups);
+  EXPECT(reports(diags, Warning, 2, "Group cannot be reached from group 0."));
+  EXPECT(!reports(diags, Warning, 2, "Group does not lead back to group 0."));
+}
+
+RII_TEST(PathAnalysisTooManyLinks) {
+  std::vector<Group> groups(9);
+  for (u8 g = 1; g < 9; ++g) {
+    groups[0].successors.push_back(g);
+    groups[0].predecessors.push_back(g);
+    groups[g] = {{0}, {0}};
+  }
+  const auto diags = analyze(groups);
+  EXPECT(reports(diags, Error, 0, "8 predecessors; at most 6 can be saved."));
+  EXPECT(reports(diags, Error, 0, "8 successors; at most 6 can be saved."));
+  EXPECT(diags.size() == 2);
+}
+
+RII_TEST(PathAnalysisDecreasingKeyCheckpoints) {
+  auto groups = ring(3);
+  // Within a group, then across a link into group 2
+  groups[1].key_checkpoints = {0xFF, 4, 0xFF, 3};
+  const auto diags = analyze(groups, /*is_check_path=*/true);
+  EXPECT(
+      reports(diags, Error, 1, "Key checkpoint 3 follows key checkpoint 4."));
+  EXPECT(reports(diags, Error, 1,
+                 "Key checkpoint 3 is followed by key checkpoint 2 in "
+                 "successor 2."));
+  // Crossing the lap checkpoint starts over
+  EXPECT(!reports(diags, Error, 2,
+                  "Key checkpoint 2 is followed by key checkpoint 0 in "
+                  "successor 0."));
+}
+
+RII_TEST(PathAnalysisLoopAvoidingLapCheckpoint) {
+  // Group 0 holds the lap checkpoint. Every other group forms a ring, as long
+  // as a KMP can hold, that may loop forever without returning to group 0.
+  constexpr u8 n = 255;
+  std::vector<Group> groups(n);
+  groups[0] = {{n - 1}, {1}, {0}};
+  for (u8 g = 1; g < n; ++g) {
+    const u8 next = g + 1 == n ? 1 : g + 1;
+    groups[g] = {{static_cast<u8>(g == 1 ? n - 1 : g - 1)}, {next}, {0xFF}};
+  }
+  groups[n - 1].successors.push_back(0);
+  groups[1].predecessors.push_back(0);
+  const auto diags = analyze(groups, /*is_check_path=*/true);
+  for (u8 g = 1; g < n; ++g)
+    EXPECT(reports(diags, Error, g,
+                   "Group loops without crossing the lap checkpoint."));
+  EXPECT(!reports(diags, Error, 0,
+                  "Group loops without crossing the lap checkpoint."));
+}
+
+RII_TEST(PathAnalysisNoLapCheckpoint) {
+  auto groups = ring(2);
+  groups[0].key_checkpoints = {0xFF};
+  EXPECT(reports(analyze(groups, /*is_check_path=*/true), Error,
+                 PathDiagnostic::AllGroups,
+                 "No lap checkpoint (key checkpoint 0)."));
+}
@@ -0,0 +1,115 @@
+#include "test.hpp"
+
+#include <core/3d/renderer/ShaderDiskCache.hpp>
+
+#include <fstream>
+#include <string>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// A fresh directory per test, removed afterwards
+struct TempDirectory {
+  explicit TempDirectory(const char* name)
+      : path(fs::temp_directory_path() / "riistudio-unittests" / name) {
+    fs::remove_all(path);
+    fs::create_directories(path);
+  }
+  ~TempDirectory() {
+    std::error_code ec;
+    fs::remove_all(path, ec);
+  }
+
+  fs::path path;
+};
+
+std::vector<u8> blob(std::size_t size, u8 value) {
+  return std::vector<u8>(size, value);
+}
+
+void writeFile(const fs::path& path, std::string_view contents) {
+  std::ofstream stream(path, std::ios::binary);
+  stream.write(contents.data(), contents.size());
+}
+
+fs::path versionDirectory(const fs::path& root) {
+  return root / ("v" + std::to_string(ShaderDiskCache::FormatVersion));
+}
+
+} // namespace
+
+RII_TEST(ShaderDiskCachePersistsAcrossReopen) {
+  TempDirectory dir("persist");
+  {
+    ShaderDiskCache cache(dir.path);
+    EXPECT(cache.store(1, blob(100, 0xAA)));
+    EXPECT(cache.store(2, blob(200, 0xBB)));
+    EXPECT(cache.store(2, blob(50, 0xCC)));
+    EXPECT(!cache.load(3));
+  }
+  ShaderDiskCache cache(dir.path);
+  EXPECT(cache.size() == 2);
+  EXPECT(cache.load(1) == blob(100, 0xAA));
+  EXPECT(cache.load(2) == blob(50, 0xCC));
+}
+
+RII_TEST(ShaderDiskCacheDropsCorruptRecords) {
+  TempDirectory dir("corrupt");
+  ShaderDiskCache cache(dir.path);
+  EXPECT(cache.store(1, blob(100, 0xAA)));
+  EXPECT(cache.store(2, blob(100, 0xBB)));
+
+  // Same size, so only the checksum can tell
+  const fs::path record = versionDirectory(dir.path) / "0000000000000001.bin";
+  {
+    std::fstream stream(record, std::ios::binary | std::ios::in |
+                                    std::ios::out);
+    stream.seekp(-1, std::ios::end);
+    stream.put(0x00);
+  }
+  fs::resize_file(versionDirectory(dir.path) / "0000000000000002.bin", 10);
+  EXPECT(!cache.load(1));
+  EXPECT(!cache.load(2));
+  EXPECT(!fs::exists(record));
+  EXPECT(cache.size() == 0);
+}
+
+RII_TEST(ShaderDiskCacheEvictsLeastRecentlyUsed) {
+  TempDirectory dir("evict");
+  // Room for two records of 100 bytes, headers included
+  ShaderDiskCache cache(dir.path, 300);
+  EXPECT(cache.store(1, blob(100, 1)));
+  EXPECT(cache.store(2, blob(100, 2)));
+  EXPECT(cache.load(1));
+  EXPECT(cache.store(3, blob(100, 3)));
+  EXPECT(cache.load(1));
+  EXPECT(!cache.load(2));
+  EXPECT(cache.load(3));
+  EXPECT(cache.totalBytes() <= 300);
+  EXPECT(!cache.store(4, blob(300, 4)));
+}
+
+RII_TEST(ShaderDiskCacheRemovesOnlyStaleFiles) {
+  TempDirectory dir("stale");
+  const fs::path current = versionDirectory(dir.path);
+  fs::create_directories(current);
+  fs::create_directories(dir.path / "v0");
+  fs::create_directories(dir.path / "other");
+
+  // One temporary file abandoned by a crash, one still being written
+  const fs::path abandoned = current / "0000000000000001.a-0.tmp";
+  const fs::path in_progress = current / "0000000000000002.b-0.tmp";
+  writeFile(abandoned, "partial");
+  writeFile(in_progress, "partial");
+  fs::last_write_time(abandoned, fs::file_time_type::clock::now() -
+                                     ShaderDiskCache::StaleTempAge -
+                                     std::chrono::minutes(1));
+
+  ShaderDiskCache cache(dir.path);
+  EXPECT(!fs::exists(abandoned));
+  EXPECT(fs::exists(in_progress));
+  EXPECT(!fs::exists(dir.path / "v0"));
+  EXPECT(fs::exists(dir.path / "other"));
+  EXPECT(cache.size() == 0);
+}
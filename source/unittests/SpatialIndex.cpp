@@ -0,0 +1,81 @@
+#include "test.hpp"
+
+#include <core/kpi/History.hpp>
+#include <plugins/mk/KMP/SpatialIndex.hpp>
+
+#include <memory>
+#include <new>
+
+namespace {
+
+using namespace riistudio::mk;
+
+void addObject(CourseMap& map, const glm::vec3& position) {
+  auto& obj = map.getGeoObjs().add();
+  obj.position = position;
+  obj.settings = {};
+  obj.flags = 0x3F;
+}
+
+} // namespace
+
+RII_TEST(SpatialIndexStaleAfterEdit) {
+  CourseMap map;
+  addObject(map, {0.0f, 0.0f, 0.0f});
+  SpatialIndex index;
+  EXPECT(index.update(map));
+  EXPECT(!index.update(map));
+
+  // Reading through a mutable map leaves the index fresh
+  auto objs = map.getGeoObjs();
+  EXPECT(objs[0].position.x == 0.0f);
+  EXPECT(!index.isStale(map));
+
+  // Edits are seen once flagged
+  objs[0].position = {100.0f, 0.0f, 0.0f};
+  objs.objectAt(0)->markDirty();
+  EXPECT(index.isStale(map));
+  EXPECT(index.update(map));
+  EXPECT(index.nearest({90.0f, 0.0f, 0.0f})->position.x == 100.0f);
+}
+
+RII_TEST(SpatialIndexStaleAfterCommit) {
+  CourseMap map;
+  addObject(map, {0.0f, 0.0f, 0.0f});
+  kpi::History history;
+  history.commit(map);
+  SpatialIndex index;
+  index.update(map);
+
+  // Edited without being flagged, then committed
+  map.getGeoObjs()[0].position = {100.0f, 0.0f, 0.0f};
+  EXPECT(!index.isStale(map));
+  history.commit(map);
+  EXPECT(index.isStale(map));
+  index.update(map);
+  EXPECT(index.nearest({0.0f, 0.0f, 0.0f})->position.x == 100.0f);
+
+  history.undo(map);
+  EXPECT(index.isStale(map));
+  index.update(map);
+  EXPECT(index.nearest({90.0f, 0.0f, 0.0f})->position.x == 0.0f);
+  history.flush();
+}
+
+RII_TEST(SpatialIndexStaleForMapAtSameAddress) {
+  // A second map built in the storage of the first, with the same history of
+  // edits, so per-collection counters would match
+  alignas(CourseMap) unsigned char storage[sizeof(CourseMap)];
+  CourseMap* map = new (storage) CourseMap;
+  addObject(*map, {0.0f, 0.0f, 0.0f});
+  SpatialIndex index;
+  index.update(*map);
+  std::destroy_at(map);
+
+  map = new (storage) CourseMap;
+  addObject(*map, {500.0f, 0.0f, 0.0f});
+  EXPECT(index.isStale(*map));
+  index.update(*map);
+  EXPECT(index.nearest({0.0f, 0.0f, 0.0f})->position.x == 500.0f);
+  std::destroy_at(map);
+}
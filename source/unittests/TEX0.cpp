@@ -0,0 +1,91 @@
+#include "test.hpp"
+
+#include <oishii/data_provider.hxx>
+#include <oishii/reader/binary_reader.hxx>
+#include <oishii/writer/binary_writer.hxx>
+#include <plugins/g3d/texture.hpp>
+#include <plugins/g3d/util/NameTable.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace riistudio::g3d {
+// TEX0.cpp
+void readTexture(Texture& data, oishii::BinaryReader& reader);
+void writeTexture(const Texture& data, oishii::Writer& writer,
+                  NameTable& names, std::optional<u32> shared_data);
+} // namespace riistudio::g3d
+
+namespace {
+
+using namespace riistudio::g3d;
+
+Texture makeTexture(const std::string& name, u8 seed) {
+  Texture tex;
+  tex.name = name;
+  tex.format = 1; // I8
+  tex.dimensions = {16, 16};
+  tex.resizeData();
+  for (u32 i = 0; i < tex.getEncodedSize(true); ++i)
+    tex.getData()[i] = static_cast<u8>(seed + i);
+  return tex;
+}
+
+// Write `textures` as consecutive TEX0s, the way the BRRES writer lays them
+// out. `shares[i]` is the earlier texture whose data texture `i` points to.
+std::vector<u8> writeTextures(const std::vector<Texture>& textures,
+                              const std::vector<std::optional<u32>>& shares,
+                              std::vector<u32>& starts) {
+  oishii::Writer writer(0);
+  writer.setEndian(true);
+  NameTable names;
+  for (std::size_t i = 0; i < textures.size(); ++i) {
+    writer.alignTo(32);
+    starts.push_back(writer.tell());
+    std::optional<u32> shared_data;
+    if (shares[i].has_value())
+      shared_data = starts[*shares[i]] + 64;
+    writeTexture(textures[i], writer, names, shared_data);
+  }
+  const auto end = writer.tell();
+  names.poolNames();
+  names.resolve(end);
+  writer.seekSet(end);
+  for (auto c : names.mPool)
+    writer.write<u8>(c);
+  const u8* data = writer.getDataBlockStart();
+  return {data, data + writer.getBufSize()};
+}
+
+s32 readS32(const std::vector<u8>& file, u32 pos) {
+  return static_cast<s32>((file[pos] << 24) | (file[pos + 1] << 16) |
+                          (file[pos + 2] << 8) | file[pos + 3]);
+}
+
+} // namespace
+
+RII_TEST(TEX0SharedDataRoundTrips) {
+  const std::vector<Texture> textures{makeTexture("First", 0),
+                                      makeTexture("Unique", 7),
+                                      makeTexture("Copy", 0)};
+  std::vector<u32> starts;
+  auto file = writeTextures(textures, {std::nullopt, std::nullopt, 0}, starts);
+
+  // The copy is a bare header whose texture offset points back at the first
+  const u32 size = textures[0].getEncodedSize(true);
+  EXPECT(readS32(file, starts[0] + 4) == static_cast<s32>(64 + size));
+  EXPECT(readS32(file, starts[2] + 4) == 64);
+  EXPECT(readS32(file, starts[2] + 16) ==
+         static_cast<s32>(starts[0]) + 64 - static_cast<s32>(starts[2]));
+  EXPECT(readS32(file, starts[2] + 16) < 0);
+
+  oishii::DataProvider provider(std::move(file), "test.brres");
+  oishii::BinaryReader reader(provider.slice());
+  for (std::size_t i = 0; i < textures.size(); ++i) {
+    reader.seekSet(starts[i]);
+    Texture tex;
+    readTexture(tex, reader);
+    EXPECT(tex == textures[i]);
+  }
+}
@@ -0,0 +1,124 @@
+#include "test.hpp"
+
+#include <plugins/g3d/texture.hpp>
+#include <plugins/gc/Util/TexturePolicy.hpp>
+
+#include <array>
+#include <vector>
+
+namespace {
+
+using namespace libcube;
+using riistudio::g3d::Texture;
+
+// A lossless color for each level, so tests can tell kept levels from
+// regenerated ones
+std::array<u8, 4> levelColor(u32 level) {
+  return {static_cast<u8>(40 * level), static_cast<u8>(200 - 30 * level), 90,
+          255};
+}
+
+Texture makeTexture(u32 width, u32 height, u32 mips) {
+  Texture tex;
+  tex.setTextureFormat(static_cast<u32>(gx::TextureFormat::RGBA8));
+  tex.setWidth(width);
+  tex.setHeight(height);
+  tex.setMipmapCount(mips);
+  std::vector<u8> rgba(image_platform::getMipOffset(width, height, mips + 1));
+  for (u32 i = 0; i <= mips; ++i) {
+    const auto color = levelColor(i);
+    const u32 begin = image_platform::getMipOffset(width, height, i);
+    const u32 end = image_platform::getMipOffset(width, height, i + 1);
+    for (u32 p = begin; p < end; p += 4)
+      std::copy(color.begin(), color.end(), rgba.begin() + p);
+  }
+  tex.encode(rgba.data());
+  return tex;
+}
+
+// Whether every pixel of `level` has the color `makeTexture` gave `source`
+bool hasLevelColor(const Texture& tex, u32 level, u32 source) {
+  std::vector<u8> rgba(tex.getDecodedLevelSize(level));
+  tex.decodeLevel(level, rgba);
+  const auto color = levelColor(source);
+  for (std::size_t p = 0; p < rgba.size(); p += 4)
+    if (!std::equal(color.begin(), color.end(), rgba.begin() + p))
+      return false;
+  return true;
+}
+
+} // namespace
+
+RII_TEST(TexturePolicyKeepsMatchingTexture) {
+  auto tex = makeTexture(32, 16, 2);
+  const auto original = tex;
+
+  EXPECT(!applyTexturePolicy(tex, {}));
+  TexturePolicy policy;
+  policy.format = gx::TextureFormat::RGBA8;
+  policy.maxDimension = 32;
+  policy.mipmapCount = 2;
+  EXPECT(!applyTexturePolicy(tex, policy));
+  EXPECT(tex == original);
+}
+
+RII_TEST(TexturePolicyHalvesToMaxDimension) {
+  TexturePolicy policy;
+  policy.maxDimension = 20;
+  auto tex = makeTexture(64, 16, 0);
+  EXPECT(applyTexturePolicy(tex, policy));
+  EXPECT(tex.getWidth() == 16);
+  EXPECT(tex.getHeight() == 4);
+  EXPECT(tex.getMipmapCount() == 0);
+  EXPECT(hasLevelColor(tex, 0, 0));
+
+  // Already within the limit
+  policy.maxDimension = 64;
+  tex = makeTexture(64, 16, 0);
+  EXPECT(!applyTexturePolicy(tex, policy));
+}
+
+RII_TEST(TexturePolicyClampsMipmapCount) {
+  // 8x4 is the last level that is whole RGBA8 blocks
+  TexturePolicy policy;
+  policy.mipmapCount = 5;
+  auto tex = makeTexture(32, 16, 0);
+  EXPECT(applyTexturePolicy(tex, policy));
+  EXPECT(tex.getMipmapCount() == 2);
+
+  // I4 blocks are 8x8
+  policy.format = gx::TextureFormat::I4;
+  tex = makeTexture(32, 32, 0);
+  EXPECT(applyTexturePolicy(tex, policy));
+  EXPECT(tex.getMipmapCount() == 2);
+
+  // Resizing clamps against the new dimensions
+  policy = {};
+  policy.maxDimension = 16;
+  tex = makeTexture(32, 32, 3);
+  EXPECT(applyTexturePolicy(tex, policy));
+  EXPECT(tex.getWidth() == 16);
+  EXPECT(tex.getMipmapCount() == 2);
+}
+
+RII_TEST(TexturePolicyKeepsExistingLevels) {
+  // Same size: existing levels are kept, new ones come from the base image
+  TexturePolicy policy;
+  policy.mipmapCount = 3;
+  auto tex = makeTexture(32, 32, 1);
+  EXPECT(applyTexturePolicy(tex, policy));
+  EXPECT(tex.getMipmapCount() == 3);
+  EXPECT(hasLevelColor(tex, 0, 0));
+  EXPECT(hasLevelColor(tex, 1, 1));
+  EXPECT(hasLevelColor(tex, 2, 0));
+  EXPECT(hasLevelColor(tex, 3, 0));
+
+  // Resizing regenerates every level from the base image
+  policy = {};
+  policy.maxDimension = 16;
+  tex = makeTexture(32, 32, 2);
+  EXPECT(applyTexturePolicy(tex, policy));
+  EXPECT(tex.getMipmapCount() == 2);
+  for (u32 i = 0; i <= 2; ++i)
+    EXPECT(hasLevelColor(tex, i, 0));
+}
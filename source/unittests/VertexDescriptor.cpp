@@ -0,0 +1,62 @@
+#include "test.hpp"
+
+#include <plugins/gc/Export/VertexDescriptor.hpp>
+
+namespace {
+
+using namespace libcube;
+
+VertexDescriptor makeDescriptor() {
+  VertexDescriptor vcd;
+  vcd.mAttributes[gx::VertexAttribute::PositionNormalMatrixIndex] =
+      gx::VertexAttributeType::Direct;
+  vcd.mAttributes[gx::VertexAttribute::Position] =
+      gx::VertexAttributeType::Short;
+  vcd.mAttributes[gx::VertexAttribute::Color0] = gx::VertexAttributeType::Byte;
+  vcd.calcVertexDescriptorFromAttributeList();
+  return vcd;
+}
+
+} // namespace
+
+RII_TEST(VertexDescriptorReadsKeepLayout) {
+  auto vcd = makeDescriptor();
+  EXPECT(vcd.getVertexSize() == 1 + 2 + 1);
+  const u64 stamp = vcd.mAttributes.stamp();
+
+  // Lookups through a mutable descriptor do not invalidate the layout
+  u32 present = 0;
+  for (auto& [attr, type] : vcd.mAttributes)
+    present += type != gx::VertexAttributeType::None;
+  EXPECT(present == 3);
+  EXPECT(vcd.mAttributes.find(gx::VertexAttribute::Position) !=
+         vcd.mAttributes.end());
+  EXPECT(vcd.mAttributes[gx::VertexAttribute::Color0] ==
+         gx::VertexAttributeType::Byte);
+  // Nor does assigning an entry its current type
+  vcd.mAttributes[gx::VertexAttribute::Position] =
+      gx::VertexAttributeType::Short;
+  EXPECT(vcd.mAttributes.stamp() == stamp);
+}
+
+RII_TEST(VertexDescriptorChangesUpdateLayout) {
+  auto vcd = makeDescriptor();
+  EXPECT(vcd.getVertexSize() == 4);
+
+  vcd.mAttributes[gx::VertexAttribute::Color0] =
+      gx::VertexAttributeType::Short;
+  EXPECT(vcd.getVertexSize() == 5);
+  EXPECT(vcd.getAttributeOffset(gx::VertexAttribute::Color0) == 3);
+
+  // Inserting an attribute as None changes the entries, not the layout
+  const u64 stamp = vcd.mAttributes.stamp();
+  vcd.mAttributes[gx::VertexAttribute::Normal];
+  EXPECT(vcd.mAttributes.stamp() != stamp);
+  EXPECT(vcd.mAttributes.contains(gx::VertexAttribute::Normal));
+  EXPECT(vcd.getVertexSize() == 5);
+
+  vcd.mAttributes.erase(gx::VertexAttribute::Color0);
+  vcd.calcVertexDescriptorFromAttributeList();
+  EXPECT(vcd.getVertexSize() == 3);
+  EXPECT(vcd.getAttributeSize(gx::VertexAttribute::Color0) == 0);
+}
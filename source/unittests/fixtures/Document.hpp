@@ -0,0 +1,99 @@
+#pragma once
+
+#include <core/kpi/History.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace riistudio::test {
+
+//! @brief Stand-in for a polygon: a name and a few kilobytes of indices,
+//! compared as a whole.
+//!
+struct Mesh : public virtual kpi::IObject {
+  std::string mName;
+  std::vector<u32> mIndices;
+
+  std::string getName() const override { return mName; }
+  void setName(const std::string& name) {
+    mName = name;
+    onRenamed();
+  }
+  bool operator==(const Mesh& rhs) const {
+    return mName == rhs.mName && mIndices == rhs.mIndices;
+  }
+  //! Only the indices: names are kept short enough to be stored inline.
+  std::size_t retainedSize() const {
+    return mIndices.capacity() * sizeof(u32);
+  }
+};
+
+//! @brief Told when a history sizes or releases a document's state, on
+//! whichever thread does so.
+//!
+struct StateObserver {
+  virtual ~StateObserver() = default;
+  virtual void onSized() {}
+  virtual void onReleased() {}
+};
+
+//! @brief A document with a single folder of meshes.
+//!
+class Document : public kpi::INode {
+public:
+  //! `observer` must outlive every state recorded from this document.
+  explicit Document(StateObserver* observer = nullptr) : mObserver(observer) {}
+
+  kpi::MutCollectionRange<Mesh> getMeshes() { return {&mMeshes}; }
+  kpi::ConstCollectionRange<Mesh> getMeshes() const { return {&mMeshes}; }
+
+  std::size_t numFolders() const override { return 1; }
+  const kpi::ICollection* folderAt(std::size_t index) const override {
+    return index == 0 ? &mMeshes : nullptr;
+  }
+  kpi::ICollection* folderAt(std::size_t index) override {
+    return index == 0 ? &mMeshes : nullptr;
+  }
+  kpi::IDocData* getImmediateData() override { return nullptr; }
+  const kpi::IDocData* getImmediateData() const override { return nullptr; }
+  const char* idAt(std::size_t index) const override {
+    return index == 0 ? "Mesh" : nullptr;
+  }
+  std::size_t fromId(const char* id) const override {
+    return std::string_view(id) == "Mesh" ? 0 : ~0;
+  }
+
+  struct _Memento : public kpi::IMemento {
+    kpi::ConstPersistentVec<Mesh> mMeshes;
+    StateObserver* mObserver;
+    _Memento(const Document& doc, const kpi::IMemento* last)
+        : mObserver(doc.mObserver) {
+      const auto* old = dynamic_cast<const _Memento*>(last);
+      kpi::nextFolder(mMeshes, doc.getMeshes(),
+                      old != nullptr ? &old->mMeshes : nullptr);
+    }
+    ~_Memento() {
+      if (mObserver != nullptr)
+        mObserver->onReleased();
+    }
+    void visitRecords(kpi::RecordVisitor visitor) const override {
+      if (mObserver != nullptr)
+        mObserver->onSized();
+      kpi::visitFolder(mMeshes, visitor);
+    }
+  };
+  std::unique_ptr<kpi::IMemento>
+  next(const kpi::IMemento* last) const override {
+    return std::make_unique<_Memento>(*this, last);
+  }
+  void from(const kpi::IMemento& memento) override {
+    kpi::fromFolder(getMeshes(), static_cast<const _Memento&>(memento).mMeshes);
+  }
+
+private:
+  kpi::CollectionImpl<Mesh> mMeshes{this};
+  StateObserver* mObserver;
+};
+
+} // namespace riistudio::test
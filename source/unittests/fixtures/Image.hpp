@@ -0,0 +1,19 @@
+#pragma once
+
+#include <core/common.h>
+
+#include <vector>
+
+namespace riistudio::test {
+
+//! @brief A raw RGBA8 image of hashed pixels, which every resampling filter
+//! changes.
+//!
+inline std::vector<u8> makeImage(int width, int height) {
+  std::vector<u8> image(width * height * 4);
+  for (std::size_t i = 0; i < image.size(); ++i)
+    image[i] = static_cast<u8>((i * 2654435761u) >> 24);
+  return image;
+}
+
+} // namespace riistudio::test
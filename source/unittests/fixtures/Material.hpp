@@ -0,0 +1,106 @@
+#pragma once
+
+#include <plugins/gc/Export/Material.hpp>
+
+#include <string>
+
+namespace riistudio::test {
+
+//! @brief A material owning its data, with no textures or scene, so shaders
+//! can be generated for it without a GL context.
+//!
+struct GCMaterial final : public libcube::IGCMaterial {
+  libcube::GCMaterialData& getMaterialData() override { return data; }
+  const libcube::GCMaterialData& getMaterialData() const override {
+    return data;
+  }
+  const libcube::Texture* getTexture(const std::string&) const override {
+    return nullptr;
+  }
+  void setXluPass(bool) override {}
+
+  libcube::GCMaterialData data;
+};
+
+//! @brief One unlit stage sampling a texture, over two texgens.
+//!
+inline void makeTexturedMaterial(libcube::GCMaterialData& data) {
+  using namespace libcube::gx;
+  data.name = "mat";
+  data.texGens.push_back(
+      {TexGenType::Matrix2x4, TexGenSrc::UV0, TexMatrix::TexMatrix0});
+  data.texGens.push_back(
+      {TexGenType::Matrix3x4, TexGenSrc::UV1, TexMatrix::Identity});
+  data.colorChanControls.push_back({});
+  data.colorChanControls.push_back({});
+  data.shader.mIndirectOrders = {};
+  data.shader.mStages[0].colorStage.a = TevColorArg::texc;
+  data.shader.mStages[0].rasOrder = ColorSelChanApi::color0a0;
+}
+
+//! @brief Two textured stages with lighting, a bump texgen, an indirect stage
+//! and an alpha test, so that every field of the shader state reaches the
+//! generated code.
+//!
+inline void makeDetailedMaterial(libcube::GCMaterialData& data) {
+  using namespace libcube::gx;
+  data.name = "base";
+
+  ChannelControl lit;
+  lit.enabled = true;
+  lit.Material = ColorSource::Vertex;
+  lit.lightMask = LightID::Light0;
+  lit.diffuseFn = DiffuseFunction::Clamp;
+  lit.attenuationFn = AttenuationFunction::Spotlight;
+  data.colorChanControls.push_back(lit);
+  data.colorChanControls.push_back(lit);
+  data.colorChanControls.push_back({});
+  data.colorChanControls.push_back({});
+
+  data.texGens.push_back(
+      {TexGenType::Matrix2x4, TexGenSrc::UV0, TexMatrix::TexMatrix0});
+  data.texGens.push_back(
+      {TexGenType::Bump0, TexGenSrc::UV1, TexMatrix::Identity});
+
+  Shader& shader = data.shader;
+  shader.mIndirectOrders.fill({0, 0});
+  shader.mIndirectOrders[0] = {2, 1};
+  shader.mStages.resize(2);
+  TevStage& first = shader.mStages[0];
+  first.rasOrder = ColorSelChanApi::color0a0;
+  first.colorStage = {.a = TevColorArg::zero,
+                      .b = TevColorArg::texc,
+                      .c = TevColorArg::rasc,
+                      .d = TevColorArg::zero};
+  first.alphaStage = {.a = TevAlphaArg::zero,
+                      .b = TevAlphaArg::texa,
+                      .c = TevAlphaArg::rasa,
+                      .d = TevAlphaArg::zero};
+  first.indirectStage = {.indStageSel = 0,
+                         .bias = IndTexBiasSel::st,
+                         .matrix = IndTexMtxID::_0,
+                         .wrapU = IndTexWrap::_256};
+  TevStage& second = shader.mStages[1];
+  second.rasOrder = ColorSelChanApi::color0a0;
+  second.texMap = 1;
+  second.texCoord = 1;
+  second.rasSwap = 1;
+  second.texMapSwap = 2;
+  second.colorStage = {.constantSelection = TevKColorSel::k1,
+                       .a = TevColorArg::cprev,
+                       .b = TevColorArg::konst,
+                       .c = TevColorArg::texc,
+                       .d = TevColorArg::zero};
+  second.alphaStage = {.a = TevAlphaArg::aprev,
+                       .b = TevAlphaArg::konst,
+                       .c = TevAlphaArg::texa,
+                       .d = TevAlphaArg::zero,
+                       .constantSelection = TevKAlphaSel::k1_a};
+  data.mIndScales.push_back({IndirectTextureScalePair::Selection::x_2,
+                             IndirectTextureScalePair::Selection::x_4});
+
+  data.alphaCompare = {Comparison::GREATER, 64, AlphaOp::_and,
+                       Comparison::LESS, 200};
+}
+
+} // namespace riistudio::test
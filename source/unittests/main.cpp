@@ -0,0 +1,37 @@
+// Unit tests over synthetic inputs.
+//
+// Usage: unittests [name-prefix...]
+//
+// Runs every test whose name starts with one of the given prefixes, or all of
+// them. Exits with a nonzero status if any expectation failed.
+
+#include "test.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+int main(int argc, const char** argv) {
+  auto& tests = riistudio::test::registry();
+  std::sort(tests.begin(), tests.end(),
+            [](const auto& l, const auto& r) { return l.name < r.name; });
+
+  int failed_tests = 0;
+  for (const auto& test : tests) {
+    const bool selected =
+        argc < 2 || std::any_of(argv + 1, argv + argc, [&](const char* arg) {
+          return test.name.starts_with(arg);
+        });
+    if (!selected)
+      continue;
+    std::printf("%.*s\n", int(test.name.size()), test.name.data());
+    const int before = riistudio::test::failures();
+    test.run();
+    if (riistudio::test::failures() != before)
+      ++failed_tests;
+  }
+  if (failed_tests != 0) {
+    std::printf("%i test(s) failed\n", failed_tests);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdio>      // std::printf
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+
+namespace riistudio::test {
+
+//! @brief A named test, registered with `RII_TEST`.
+//!
+//! Tests check their results with `EXPECT`, which reports a failure and
+//! carries on. Inputs are synthetic so results do not depend on local files.
+//!
+struct Test {
+  std::string_view name;
+  void (*run)();
+};
+
+inline std::vector<Test>& registry() {
+  static std::vector<Test> tests;
+  return tests;
+}
+
+struct Registrar {
+  Registrar(std::string_view name, void (*run)()) {
+    registry().push_back({name, run});
+  }
+};
+
+//! Number of failed expectations so far.
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+
+inline bool expect(bool passed, const char* expr, const char* file, int line) {
+  if (!passed) {
+    std::printf("  %s:%i: EXPECT(%s) failed\n", file, line, expr);
+    ++failures();
+  }
+  return passed;
+}
+
+#define RII_TEST(NAME)                                                         \
+  static void NAME();                                                          \
+  static ::riistudio::test::Registrar NAME##_registrar(#NAME, NAME);           \
+  static void NAME()
+
+#define EXPECT(...)                                                            \
+  ::riistudio::test::expect(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__,      \
+                            __FILE__, __LINE__)
+
+} // namespace riistudio::test